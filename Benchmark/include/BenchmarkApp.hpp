@@ -0,0 +1,767 @@
+#pragma once
+
+#include <glacier.hpp>
+
+#include "BenchmarkSuite.hpp"
+
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Command-line options of glacier_bench
+*/
+struct BenchmarkOptions
+{
+	std::string resourceDirectory = ".";
+	std::string filter;
+	std::string output;
+
+	/* A .gmesh file to measure decoding on, besides the generated mesh */
+	std::string mesh;
+
+	/* A .obj, .gltf or .glb file to measure importing on, besides the generated ones */
+	std::string model;
+
+	unsigned int frames = 500;
+	bool headless = true;
+};
+
+glacier::ApplicationInfo generateApplicationInfo(const BenchmarkOptions& options)
+{
+	glacier::WindowCreateInfo windowInfo = { 0 };
+	windowInfo.title = "glacier_bench";
+	windowInfo.width = 800;
+	windowInfo.height = 600;
+	windowInfo.resizable = false;
+	windowInfo.headless = options.headless;
+
+	// Frames are timed without vsync so that the CPU submit path is what gets measured
+	glacier::ApplicationInfo info = { "glacier_bench", 0, 1, 0, false, windowInfo };
+
+	return info;
+}
+
+/**
+ * @brief Runs the micro-benchmarks once the renderer is available, then times a fixed number of frames.
+*/
+class BenchmarkApp : public glacier::Application
+{
+public:
+	BenchmarkApp(const BenchmarkOptions& options)
+		: Application(generateApplicationInfo(options)), m_Options(options), m_BenchmarksRun(false), m_VertexShaderSource(nullptr), m_FragmentShaderSource(nullptr), m_VertexShader(nullptr), m_FragmentShader(nullptr), m_VertexBuffer(nullptr), m_IndexBuffer(nullptr), m_Pipeline(nullptr)
+	{
+		m_Suite.setFilter(m_Options.filter);
+	}
+
+	~BenchmarkApp()
+	{}
+
+	void initialize() override
+	{
+		m_VertexShaderSource = glacier::File("shaders/vertex.spv").read_ptr();
+		m_FragmentShaderSource = glacier::File("shaders/fragment.spv").read_ptr();
+	}
+
+	void initializeRenderer(glacier::Renderer* renderer) override
+	{
+		// The renderer is recreated with the swapchain, but the micro-benchmarks only need to run once
+		if (!m_BenchmarksRun)
+		{
+			benchmarkBufferUpload();
+			benchmarkVertexBufferLayout();
+			benchmarkVertexPacking();
+			benchmarkMeshCodec();
+			benchmarkMeshImport();
+			benchmarkAssetLoading();
+			benchmarkFileRead();
+			benchmarkPipelineCreation(renderer);
+
+			m_BenchmarksRun = true;
+		}
+
+		createQuad();
+
+		std::unordered_map<glacier::ShaderType, glacier::Shader*> shaders;
+		shaders.insert(std::make_pair(glacier::ShaderType::Vertex, m_VertexShader));
+		shaders.insert(std::make_pair(glacier::ShaderType::Fragment, m_FragmentShader));
+
+		m_Pipeline = new glacier::Pipeline(this, renderer, shaders, *m_VertexBuffer, *m_IndexBuffer);
+
+		renderer->bindPipeline(*m_Pipeline, 6);
+	}
+
+	void render(glacier::Renderer* renderer) override
+	{
+		BenchmarkSuite::Clock::time_point now = BenchmarkSuite::Clock::now();
+
+		// Skip the first frames while the swapchain and driver settle
+		if (m_RenderedFrames > WARMUP_FRAMES)
+			m_FrameSamples.push_back(std::chrono::duration<double, std::nano>(now - m_LastFrame).count());
+
+		m_LastFrame = now;
+		m_RenderedFrames++;
+
+		if (m_FrameSamples.size() >= m_Options.frames)
+			stop();
+	}
+
+	void terminateRenderer(glacier::Renderer* renderer) override
+	{
+		renderer->unbindPipeline();
+
+		delete m_Pipeline;
+
+		delete m_VertexShader;
+		delete m_FragmentShader;
+
+		delete m_VertexBuffer;
+		delete m_IndexBuffer;
+	}
+
+	void terminate() override
+	{
+		delete m_VertexShaderSource;
+		delete m_FragmentShaderSource;
+
+		m_Suite.record("frame/submit", m_FrameSamples);
+
+		if (m_Options.output.empty())
+		{
+			m_Suite.writeJson(std::cout, getDeviceName());
+		}
+		else
+		{
+			std::ofstream stream(m_Options.output);
+			if (!stream)
+				throw std::runtime_error("Failed to open benchmark output " + m_Options.output);
+
+			m_Suite.writeJson(stream, getDeviceName());
+			glacier::g_Logger->info("Wrote {} benchmark results to {}", m_Suite.results().size(), m_Options.output);
+		}
+	}
+private:
+	static constexpr unsigned int WARMUP_FRAMES = 10;
+
+	BenchmarkOptions m_Options;
+	BenchmarkSuite m_Suite;
+	bool m_BenchmarksRun;
+
+	std::vector<double> m_FrameSamples;
+	BenchmarkSuite::Clock::time_point m_LastFrame;
+	unsigned int m_RenderedFrames = 0;
+
+	glacier::Buffer* m_VertexShaderSource;
+	glacier::Buffer* m_FragmentShaderSource;
+
+	glacier::Shader* m_VertexShader;
+	glacier::Shader* m_FragmentShader;
+
+	glacier::VertexBuffer* m_VertexBuffer;
+	glacier::IndexBuffer* m_IndexBuffer;
+
+	glacier::Pipeline* m_Pipeline;
+
+	static std::vector<uint64_t> uploadSizes()
+	{
+		return { 1ull << 10, 1ull << 14, 1ull << 18, 1ull << 22, 1ull << 26 };
+	}
+
+	static size_t iterationsFor(uint64_t size)
+	{
+		// Aim for roughly 256 MiB of traffic per case, within sane iteration bounds
+		return static_cast<size_t>(std::max<uint64_t>(5, std::min<uint64_t>(200, (1ull << 28) / size)));
+	}
+
+	void createQuad()
+	{
+		float vertices[]{
+			-0.5f, -0.5f, 0.0f,  0.0f, 1.0f, 1.0f,
+			 0.5f, -0.5f, 0.0f,  1.0f, 0.0f, 1.0f,
+			 0.5f,  0.5f, 0.0f,  1.0f, 1.0f, 0.0f,
+			-0.5f,  0.5f, 0.0f,  0.0f, 0.0f, 0.0f
+		};
+
+		uint32_t indices[]{
+			0, 1, 2,
+			0, 2, 3
+		};
+
+		glacier::VertexBufferLayout layout;
+		layout.push(glacier::VertexBufferElement::Float, 3);
+		layout.push(glacier::VertexBufferElement::Float, 3);
+
+		m_VertexBuffer = new glacier::VertexBuffer(this, vertices, sizeof(vertices), layout);
+		m_IndexBuffer = new glacier::IndexBuffer(this, indices, sizeof(indices));
+
+		m_VertexShader = new glacier::Shader(this, *m_VertexShaderSource);
+		m_FragmentShader = new glacier::Shader(this, *m_FragmentShaderSource);
+	}
+
+	void benchmarkBufferUpload()
+	{
+		glacier::VertexBufferLayout layout;
+		layout.push(glacier::VertexBufferElement::Float, 3);
+		layout.push(glacier::VertexBufferElement::Float, 3);
+
+		for (uint64_t size : uploadSizes())
+		{
+			std::vector<char> data(size, 0x5a);
+
+			m_Suite.run(fmt::format("upload/vertex_buffer/{}", size), iterationsFor(size), size, [&]()
+				{
+					glacier::VertexBuffer buffer(this, data.data(), size, layout);
+				});
+
+			m_Suite.run(fmt::format("upload/index_buffer/{}", size), iterationsFor(size), size, [&]()
+				{
+					glacier::IndexBuffer buffer(this, reinterpret_cast<const uint32_t*>(data.data()), size);
+				});
+		}
+	}
+
+	void benchmarkVertexBufferLayout()
+	{
+		for (uint32_t elements : { 2u, 4u, 8u })
+		{
+			glacier::VertexBufferLayout layout;
+			for (uint32_t i = 0; i < elements; i++)
+				layout.push(i % 2 == 0 ? glacier::VertexBufferElement::Float : glacier::VertexBufferElement::UnsignedByte, 1 + i % 4);
+
+			size_t sink = 0;
+			m_Suite.run(fmt::format("layout/descriptions/{}", elements), 100000, 0, [&]()
+				{
+					sink += layout.getBindingDescription().stride;
+					sink += layout.getAttributeDescriptions().size();
+				});
+
+			if (sink == 0)
+				glacier::g_Logger->warn("Vertex buffer layout benchmark produced no output");
+		}
+	}
+
+	void benchmarkVertexPacking()
+	{
+		// 1M vec4s, bytes are the floats read so every element reports comparable throughput
+		std::vector<float> source(1u << 22);
+		for (size_t i = 0; i < source.size(); i++)
+			source[i] = static_cast<float>(i % 2001) / 1000.0f - 1.0f;
+
+		std::vector<char> destination(source.size() * sizeof(float));
+		uint64_t bytes = source.size() * sizeof(float);
+
+		std::pair<const char*, glacier::VertexBufferElement> elements[] = {
+			{ "half", glacier::VertexBufferElement::Half },
+			{ "unorm8", glacier::VertexBufferElement::UnsignedByteNormalized },
+			{ "snorm8", glacier::VertexBufferElement::ByteNormalized },
+			{ "unorm16", glacier::VertexBufferElement::UnsignedShortNormalized },
+			{ "snorm16", glacier::VertexBufferElement::ShortNormalized },
+			{ "snorm1010102", glacier::VertexBufferElement::Packed1010102Normalized }
+		};
+
+		// Compare the kernels of the best instruction set against the scalar ones
+		glacier::SimdLevel best = glacier::getVertexPackingSimdLevel();
+
+		std::vector<std::pair<const char*, glacier::SimdLevel>> levels = { { "scalar", glacier::SimdLevel::Scalar } };
+		if (best != glacier::SimdLevel::Scalar)
+			levels.push_back(std::make_pair(best == glacier::SimdLevel::AVX2 ? "avx2" : best == glacier::SimdLevel::SSE2 ? "sse2" : "neon", best));
+
+		for (const std::pair<const char*, glacier::SimdLevel>& level : levels)
+		{
+			glacier::setVertexPackingSimdLevel(level.second);
+
+			for (const std::pair<const char*, glacier::VertexBufferElement>& element : elements)
+			{
+				m_Suite.run(fmt::format("packing/{}/{}", element.first, level.first), 20, bytes, [&]()
+					{
+						glacier::packVertexAttribute(source.data(), 4, source.size() / 4, element.second, destination.data());
+					});
+			}
+
+			// Interleaved destination, a half vec4 in each 32 byte vertex
+			m_Suite.run(fmt::format("packing/half_interleaved/{}", level.first), 20, bytes / 2, [&]()
+				{
+					glacier::packVertexAttribute(source.data(), 4, destination.size() / 32, glacier::VertexBufferElement::Half, destination.data(), 32);
+				});
+		}
+
+		glacier::setVertexPackingSimdLevel(best);
+	}
+
+	void benchmarkMeshCodec()
+	{
+		// A 512x512 grid of 20 byte vertices with quantized normals and uvs, in the order it would be drawn
+		constexpr uint32_t size = 512;
+
+		struct Vertex
+		{
+			float position[3];
+			glacier::Packed1010102<int32_t> normal;
+			glacier::HalfVector<2> uv;
+		};
+
+		std::vector<Vertex> vertices(size * size);
+		std::vector<float> normals(vertices.size() * 3);
+		std::vector<float> uvs(vertices.size() * 2);
+
+		for (uint32_t y = 0; y < size; y++)
+		{
+			for (uint32_t x = 0; x < size; x++)
+			{
+				size_t i = static_cast<size_t>(y) * size + x;
+				float u = static_cast<float>(x) / (size - 1);
+				float v = static_cast<float>(y) / (size - 1);
+				float height = 0.1f * std::sin(u * 12.0f) * std::cos(v * 9.0f);
+
+				vertices[i].position[0] = u;
+				vertices[i].position[1] = height;
+				vertices[i].position[2] = v;
+
+				float dx = -1.2f * std::cos(u * 12.0f) * std::cos(v * 9.0f);
+				float dz = 0.9f * std::sin(u * 12.0f) * std::sin(v * 9.0f);
+				float length = std::sqrt(dx * dx + 1.0f + dz * dz);
+				normals[i * 3] = dx / length;
+				normals[i * 3 + 1] = 1.0f / length;
+				normals[i * 3 + 2] = dz / length;
+
+				uvs[i * 2] = u;
+				uvs[i * 2 + 1] = v;
+			}
+		}
+
+		glacier::packVertexAttribute(normals.data(), 3, vertices.size(), glacier::VertexBufferElement::Packed1010102Normalized, &vertices[0].normal, sizeof(Vertex));
+		glacier::packVertexAttribute(uvs.data(), 2, vertices.size(), glacier::VertexBufferElement::Half, &vertices[0].uv, sizeof(Vertex));
+
+		std::vector<uint32_t> indices;
+		indices.reserve(static_cast<size_t>(size - 1) * (size - 1) * 6);
+
+		for (uint32_t y = 0; y + 1 < size; y++)
+		{
+			for (uint32_t x = 0; x + 1 < size; x++)
+			{
+				uint32_t i = y * size + x;
+				indices.insert(indices.end(), { i, i + size, i + 1, i + 1, i + size, i + size + 1 });
+			}
+		}
+
+		glacier::VertexBufferLayout layout;
+		layout.push(glacier::VertexBufferElement::Float, 3);
+		layout.push(glacier::VertexBufferElement::Packed1010102Normalized, 4);
+		layout.push(glacier::VertexBufferElement::Half, 2);
+
+		std::vector<uint8_t> encoded = glacier::Mesh::encode(vertices.data(), static_cast<uint32_t>(vertices.size()), layout, indices.data(), static_cast<uint32_t>(indices.size()));
+
+		uint64_t vertexBytes = vertices.size() * sizeof(Vertex);
+		uint64_t indexBytes = indices.size() * sizeof(uint32_t);
+
+		benchmarkMeshDecode("mesh/decode/grid", encoded, vertexBytes + indexBytes);
+
+		// Compressed loads against uploading the same mesh uncompressed
+		m_Suite.run("mesh/load/grid", 10, vertexBytes + indexBytes, [&]()
+			{
+				glacier::Mesh mesh(this, encoded.data(), encoded.size());
+			});
+
+		m_Suite.run("mesh/load_uncompressed/grid", 10, vertexBytes + indexBytes, [&]()
+			{
+				glacier::VertexBuffer vertexBuffer(this, vertices.data(), vertexBytes, layout);
+				glacier::IndexBuffer indexBuffer(this, indices.data(), indexBytes);
+			});
+
+		if (!m_Options.mesh.empty())
+		{
+			std::ifstream stream(m_Options.mesh, std::ios::binary);
+			std::vector<uint8_t> file((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+			if (file.empty())
+				throw std::runtime_error("Failed to read mesh " + m_Options.mesh);
+
+			glacier::VertexBufferLayout fileLayout;
+			std::vector<uint8_t> fileVertices;
+			std::vector<uint32_t> fileIndices;
+			glacier::Mesh::decode(file.data(), file.size(), fileLayout, fileVertices, fileIndices);
+
+			benchmarkMeshDecode("mesh/decode/file", file, fileVertices.size() + fileIndices.size() * sizeof(uint32_t));
+		}
+	}
+
+	/**
+	 * @brief Time decoding a .gmesh file into memory and report its compression ratio
+	 * @param bytes Size of the decoded vertices and indices
+	*/
+	void benchmarkMeshDecode(const std::string& name, const std::vector<uint8_t>& file, uint64_t bytes)
+	{
+		glacier::VertexBufferLayout layout;
+		std::vector<uint8_t> vertices;
+		std::vector<uint32_t> indices;
+
+		// The vectors keep their size between iterations, so only decoding is timed
+		m_Suite.run(name, 20, bytes, [&]()
+			{
+				glacier::Mesh::decode(file.data(), file.size(), layout, vertices, indices);
+			});
+
+		double ratio = static_cast<double>(bytes) / static_cast<double>(file.size());
+		m_Suite.addCounter(name, "compression_ratio", ratio);
+
+		if (m_Suite.enabled(name))
+			glacier::g_Logger->info("{}: {} bytes compressed to {}, ratio {:.2f}", name, bytes, file.size(), ratio);
+	}
+
+	void benchmarkMeshImport()
+	{
+		std::filesystem::path directory = std::filesystem::temp_directory_path() / "glacier_bench";
+		std::filesystem::create_directories(directory);
+
+		// The same 512x512 grid as an OBJ with normals and uvs, and as a binary glTF
+		constexpr uint32_t size = 512;
+		uint32_t vertexCount = size * size;
+
+		std::vector<float> positions;
+		std::vector<float> normals;
+		std::vector<float> uvs;
+		std::vector<uint32_t> indices;
+
+		for (uint32_t y = 0; y < size; y++)
+		{
+			for (uint32_t x = 0; x < size; x++)
+			{
+				float u = static_cast<float>(x) / (size - 1);
+				float v = static_cast<float>(y) / (size - 1);
+				float dx = -1.2f * std::cos(u * 12.0f) * std::cos(v * 9.0f);
+				float dz = 0.9f * std::sin(u * 12.0f) * std::sin(v * 9.0f);
+				float length = std::sqrt(dx * dx + 1.0f + dz * dz);
+
+				positions.insert(positions.end(), { u, 0.1f * std::sin(u * 12.0f) * std::cos(v * 9.0f), v });
+				normals.insert(normals.end(), { dx / length, 1.0f / length, dz / length });
+				uvs.insert(uvs.end(), { u, v });
+			}
+		}
+
+		for (uint32_t y = 0; y + 1 < size; y++)
+		{
+			for (uint32_t x = 0; x + 1 < size; x++)
+			{
+				uint32_t i = y * size + x;
+				indices.insert(indices.end(), { i, i + size, i + 1, i + 1, i + size, i + size + 1 });
+			}
+		}
+
+		{
+			std::ofstream stream(directory / "grid.obj", std::ios::binary);
+
+			for (uint32_t i = 0; i < vertexCount; i++)
+			{
+				stream << fmt::format("v {:.6f} {:.6f} {:.6f}\n", positions[i * 3], positions[i * 3 + 1], positions[i * 3 + 2]);
+				stream << fmt::format("vn {:.6f} {:.6f} {:.6f}\n", normals[i * 3], normals[i * 3 + 1], normals[i * 3 + 2]);
+				stream << fmt::format("vt {:.6f} {:.6f}\n", uvs[i * 2], 1.0f - uvs[i * 2 + 1]);
+			}
+
+			for (size_t i = 0; i < indices.size(); i += 3)
+				stream << fmt::format("f {0}/{0}/{0} {1}/{1}/{1} {2}/{2}/{2}\n", indices[i] + 1, indices[i + 1] + 1, indices[i + 2] + 1);
+		}
+
+		{
+			uint64_t positionBytes = positions.size() * sizeof(float);
+			uint64_t normalBytes = normals.size() * sizeof(float);
+			uint64_t uvBytes = uvs.size() * sizeof(float);
+			uint64_t indexBytes = indices.size() * sizeof(uint32_t);
+			uint64_t binaryBytes = positionBytes + normalBytes + uvBytes + indexBytes;
+
+			std::string json = fmt::format("{{\"asset\":{{\"version\":\"2.0\"}},\"buffers\":[{{\"byteLength\":{}}}],\"bufferViews\":["
+				"{{\"buffer\":0,\"byteOffset\":0,\"byteLength\":{}}},{{\"buffer\":0,\"byteOffset\":{},\"byteLength\":{}}},{{\"buffer\":0,\"byteOffset\":{},\"byteLength\":{}}},{{\"buffer\":0,\"byteOffset\":{},\"byteLength\":{}}}],"
+				"\"accessors\":[{{\"bufferView\":0,\"componentType\":5126,\"count\":{},\"type\":\"VEC3\"}},{{\"bufferView\":1,\"componentType\":5126,\"count\":{},\"type\":\"VEC3\"}},"
+				"{{\"bufferView\":2,\"componentType\":5126,\"count\":{},\"type\":\"VEC2\"}},{{\"bufferView\":3,\"componentType\":5125,\"count\":{},\"type\":\"SCALAR\"}}],"
+				"\"meshes\":[{{\"primitives\":[{{\"attributes\":{{\"POSITION\":0,\"NORMAL\":1,\"TEXCOORD_0\":2}},\"indices\":3}}]}}]}}",
+				binaryBytes, positionBytes, positionBytes, normalBytes, positionBytes + normalBytes, uvBytes, positionBytes + normalBytes + uvBytes, indexBytes,
+				vertexCount, vertexCount, vertexCount, indices.size());
+
+			// Chunks are padded to 4 bytes, the JSON one with spaces
+			json.append((4 - json.size() % 4) % 4, ' ');
+
+			uint32_t header[5] = { 0x46546c67, 2, static_cast<uint32_t>(12 + 8 + json.size() + 8 + binaryBytes), static_cast<uint32_t>(json.size()), 0x4e4f534a };
+			uint32_t binaryHeader[2] = { static_cast<uint32_t>(binaryBytes), 0x004e4942 };
+
+			std::ofstream stream(directory / "grid.glb", std::ios::binary);
+			stream.write(reinterpret_cast<const char*>(header), sizeof(header));
+			stream.write(json.data(), static_cast<std::streamsize>(json.size()));
+			stream.write(reinterpret_cast<const char*>(binaryHeader), sizeof(binaryHeader));
+			stream.write(reinterpret_cast<const char*>(positions.data()), static_cast<std::streamsize>(positionBytes));
+			stream.write(reinterpret_cast<const char*>(normals.data()), static_cast<std::streamsize>(normalBytes));
+			stream.write(reinterpret_cast<const char*>(uvs.data()), static_cast<std::streamsize>(uvBytes));
+			stream.write(reinterpret_cast<const char*>(indices.data()), static_cast<std::streamsize>(indexBytes));
+		}
+
+		glacier::File::setBaseDirectory(directory.string());
+
+		benchmarkMeshImport("mesh/import/obj", "grid.obj");
+		benchmarkMeshImport("mesh/import/gltf", "grid.glb");
+
+		glacier::File::setBaseDirectory(m_Options.resourceDirectory);
+
+		if (!m_Options.model.empty())
+			benchmarkMeshImport("mesh/import/file", m_Options.model);
+
+		std::filesystem::remove_all(directory);
+	}
+
+	/**
+	 * @brief Time importing a file without the cache, then loading it from the cache, and report the time per MB of source
+	 * @param path Path of the file, relative to the file base directory
+	*/
+	void benchmarkMeshImport(const std::string& name, const std::string& path)
+	{
+		std::string cached = name + "/cached";
+		if (!m_Suite.enabled(name) && !m_Suite.enabled(cached))
+			return;
+
+		glacier::MeshImporter importer(this);
+
+		std::string source = glacier::File(path).getPath();
+		uint64_t bytes = std::filesystem::file_size(source);
+		bool hadCache = std::filesystem::exists(source + ".gmesh");
+
+		m_Suite.run(name, 5, bytes, [&]()
+			{
+				importer.load(path, glacier::MeshImporter::getDefaultLayout(), false);
+			});
+
+		// The first load writes the cache if there is none, every later one reads it
+		m_Suite.run(cached, 10, bytes, [&]()
+			{
+				importer.load(path);
+			});
+
+		for (const BenchmarkResult& result : m_Suite.results())
+		{
+			if (result.name == name || result.name == cached)
+				m_Suite.addCounter(result.name, "ms_per_mb", result.mean() / 1.0e6 * (1024.0 * 1024.0) / static_cast<double>(bytes));
+		}
+
+		if (!hadCache)
+			std::filesystem::remove(source + ".gmesh");
+	}
+
+	void benchmarkAssetLoading()
+	{
+		std::filesystem::path directory = std::filesystem::temp_directory_path() / "glacier_bench" / "level";
+		std::filesystem::create_directories(directory);
+
+		// A level of 16 meshes, each a 256x256 grid at a different height
+		constexpr uint32_t size = 256;
+		constexpr uint32_t meshCount = 16;
+
+		glacier::VertexBufferLayout layout;
+		layout.push(glacier::VertexBufferElement::Float, 3);
+		layout.push(glacier::VertexBufferElement::Float, 2);
+
+		std::vector<uint32_t> indices;
+		for (uint32_t y = 0; y + 1 < size; y++)
+		{
+			for (uint32_t x = 0; x + 1 < size; x++)
+			{
+				uint32_t i = y * size + x;
+				indices.insert(indices.end(), { i, i + size, i + 1, i + 1, i + size, i + size + 1 });
+			}
+		}
+
+		std::vector<std::string> paths;
+		uint64_t bytes = 0;
+
+		for (uint32_t mesh = 0; mesh < meshCount; mesh++)
+		{
+			std::vector<float> vertices;
+			vertices.reserve(static_cast<size_t>(size) * size * 5);
+
+			for (uint32_t y = 0; y < size; y++)
+			{
+				for (uint32_t x = 0; x < size; x++)
+				{
+					float u = static_cast<float>(x) / (size - 1);
+					float v = static_cast<float>(y) / (size - 1);
+
+					vertices.insert(vertices.end(), { u, static_cast<float>(mesh) + 0.1f * std::sin(u * 12.0f) * std::cos(v * 9.0f), v, u, v });
+				}
+			}
+
+			std::vector<uint8_t> file = glacier::Mesh::encode(vertices.data(), size * size, layout, indices.data(), static_cast<uint32_t>(indices.size()));
+
+			paths.push_back(fmt::format("mesh_{}.gmesh", mesh));
+			std::ofstream stream(directory / paths.back(), std::ios::binary);
+			stream.write(reinterpret_cast<const char*>(file.data()), static_cast<std::streamsize>(file.size()));
+
+			bytes += file.size();
+		}
+
+		glacier::File::setBaseDirectory(directory.string());
+
+		// The files stay in the page cache between iterations, so this measures decoding and uploading overlapping rather than the disk
+		m_Suite.run("assets/level/sequential", 5, bytes, [&]()
+			{
+				std::vector<std::unique_ptr<glacier::Mesh>> meshes;
+				for (const std::string& path : paths)
+					meshes.push_back(std::make_unique<glacier::Mesh>(this, path));
+			});
+
+		m_Suite.run("assets/level/loader", 5, bytes, [&]()
+			{
+				glacier::AssetLoader loader(this);
+
+				std::vector<glacier::AssetHandle<glacier::Mesh>> meshes;
+				for (const std::string& path : paths)
+					meshes.push_back(loader.loadMesh(path));
+
+				loader.waitAll();
+			});
+
+		m_Suite.run("assets/level/coroutine", 5, bytes, [&]()
+			{
+				glacier::AssetLoader loader(this);
+
+				// waitAll completes every load, which resumes the task until it has finished
+				glacier::Task<uint32_t> level = loadLevel(loader, paths);
+				loader.waitAll();
+
+				if (level.get() != meshCount * size * size)
+					throw std::runtime_error("The level coroutine loaded the wrong meshes");
+			});
+
+		glacier::File::setBaseDirectory(m_Options.resourceDirectory);
+		std::filesystem::remove_all(directory);
+	}
+
+	/**
+	 * @brief Start loading every mesh of a level, then wait for each in turn
+	 * @return The number of vertices of the level
+	*/
+	static glacier::Task<uint32_t> loadLevel(glacier::AssetLoader& loader, const std::vector<std::string>& paths)
+	{
+		std::vector<glacier::AssetHandle<glacier::Mesh>> meshes;
+		for (const std::string& path : paths)
+			meshes.push_back(loader.load<glacier::Mesh>(path));
+
+		uint32_t vertices = 0;
+		for (const glacier::AssetHandle<glacier::Mesh>& mesh : meshes)
+			vertices += (co_await mesh)->getVertexCount();
+
+		co_return vertices;
+	}
+
+	void benchmarkFileRead()
+	{
+		std::filesystem::path directory = std::filesystem::temp_directory_path() / "glacier_bench" / "files";
+		std::filesystem::path archive = std::filesystem::temp_directory_path() / "glacier_bench" / "files.gpak";
+		std::filesystem::create_directories(directory);
+
+		std::vector<uint64_t> sizes = { 1ull << 12, 1ull << 16, 1ull << 20, 1ull << 24, 1ull << 26 };
+
+		for (uint64_t size : sizes)
+		{
+			std::vector<char> data(size, 0x5a);
+			std::ofstream stream(directory / fmt::format("file_{}.bin", size), std::ios::binary);
+			stream.write(data.data(), static_cast<std::streamsize>(size));
+		}
+
+		glacier::FileSystem::createArchive(directory.string(), archive.string());
+		glacier::File::setBaseDirectory(directory.string());
+
+		size_t budget = glacier::FileSystem::getCacheBudget();
+
+		for (uint64_t size : sizes)
+		{
+			std::string name = fmt::format("file_{}.bin", size);
+
+			// Without the cache every read goes to the disk, or rather the OS page cache
+			glacier::FileSystem::setCacheBudget(0);
+
+			m_Suite.run(fmt::format("file/read/{}", size), iterationsFor(size), size, [&]()
+				{
+					glacier::Buffer buffer = glacier::File(name).read();
+				});
+
+			// Cached and archived reads only share the contents
+			glacier::FileSystem::setCacheBudget(size);
+
+			m_Suite.run(fmt::format("file/read_cached/{}", size), iterationsFor(size), size, [&]()
+				{
+					glacier::FileContents contents = glacier::FileSystem::read(name);
+				});
+
+			glacier::FileSystem::mount(archive.string(), 0, "archive");
+
+			m_Suite.run(fmt::format("file/read_archive/{}", size), iterationsFor(size), size, [&]()
+				{
+					glacier::FileContents contents = glacier::FileSystem::read("archive/" + name);
+				});
+
+			glacier::FileSystem::unmount(archive.string());
+		}
+
+		glacier::FileSystem::setCacheBudget(budget);
+		glacier::FileSystem::clearCache();
+		glacier::File::setBaseDirectory(m_Options.resourceDirectory);
+
+		std::filesystem::remove_all(directory);
+		std::filesystem::remove(archive);
+	}
+
+	void benchmarkPipelineCreation(glacier::Renderer* renderer)
+	{
+		createQuad();
+
+		std::unordered_map<glacier::ShaderType, glacier::Shader*> shaders;
+		shaders.insert(std::make_pair(glacier::ShaderType::Vertex, m_VertexShader));
+		shaders.insert(std::make_pair(glacier::ShaderType::Fragment, m_FragmentShader));
+
+		// Cold: the driver sees brand new shader modules every time, so nothing can be reused
+		if (m_Suite.enabled("pipeline/create_cold"))
+		{
+			std::vector<double> samples;
+
+			for (unsigned int i = 0; i < 20; i++)
+			{
+				glacier::Shader vertexShader(this, *m_VertexShaderSource);
+				glacier::Shader fragmentShader(this, *m_FragmentShaderSource);
+
+				std::unordered_map<glacier::ShaderType, glacier::Shader*> coldShaders;
+				coldShaders.insert(std::make_pair(glacier::ShaderType::Vertex, &vertexShader));
+				coldShaders.insert(std::make_pair(glacier::ShaderType::Fragment, &fragmentShader));
+
+				BenchmarkSuite::Clock::time_point start = BenchmarkSuite::Clock::now();
+				glacier::Pipeline pipeline(this, renderer, coldShaders, *m_VertexBuffer, *m_IndexBuffer);
+				BenchmarkSuite::Clock::time_point end = BenchmarkSuite::Clock::now();
+
+				samples.push_back(std::chrono::duration<double, std::nano>(end - start).count());
+			}
+
+			m_Suite.record("pipeline/create_cold", samples);
+		}
+
+		// Warm: the same modules and state are used again, which any cache along the way can exploit
+		m_Suite.run("pipeline/create_warm", 100, 0, [&]()
+			{
+				glacier::Pipeline pipeline(this, renderer, shaders, *m_VertexBuffer, *m_IndexBuffer);
+			});
+
+		// Shared: an identical pipeline is alive, so the registry hands out the existing one
+		if (m_Suite.enabled("pipeline/create_shared"))
+		{
+			glacier::Pipeline original(this, renderer, shaders, *m_VertexBuffer, *m_IndexBuffer);
+
+			m_Suite.run("pipeline/create_shared", 1000, 0, [&]()
+				{
+					glacier::Pipeline pipeline(this, renderer, shaders, *m_VertexBuffer, *m_IndexBuffer);
+				});
+		}
+
+		delete m_VertexShader;
+		delete m_FragmentShader;
+
+		delete m_VertexBuffer;
+		delete m_IndexBuffer;
+	}
+};
@@ -0,0 +1,207 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Timing statistics of a single benchmark case
+*/
+struct BenchmarkResult
+{
+	std::string name;
+	std::vector<double> samples; // Nanoseconds per iteration
+
+	/* Bytes processed per iteration, 0 if the case has no throughput */
+	uint64_t bytes = 0;
+
+	/* Extra values reported with the case, such as a compression ratio */
+	std::vector<std::pair<std::string, double>> counters;
+
+	double mean() const
+	{
+		double sum = 0.0;
+		for (double sample : samples)
+			sum += sample;
+
+		return samples.empty() ? 0.0 : sum / static_cast<double>(samples.size());
+	}
+
+	double percentile(double p) const
+	{
+		if (samples.empty())
+			return 0.0;
+
+		std::vector<double> sorted = samples;
+		std::sort(sorted.begin(), sorted.end());
+
+		size_t index = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5);
+		return sorted[std::min(index, sorted.size() - 1)];
+	}
+};
+
+/**
+ * @brief A minimal benchmark harness. Times callables and writes the results as JSON compatible with Google Benchmark's output format.
+*/
+class BenchmarkSuite
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	/**
+	 * @brief Only run cases whose name contains this string
+	 * @param filter The substring to match, or an empty string to run everything
+	*/
+	void setFilter(const std::string& filter)
+	{
+		m_Filter = filter;
+	}
+
+	/**
+	 * @brief Check if a case passes the current filter
+	 * @param name Name of the case
+	 * @return True if the case should run
+	*/
+	bool enabled(const std::string& name) const
+	{
+		return m_Filter.empty() || name.find(m_Filter) != std::string::npos;
+	}
+
+	/**
+	 * @brief Time a callable
+	 * @param name Name of the case
+	 * @param iterations How many timed iterations to run. One untimed warm-up iteration is run first.
+	 * @param bytes Bytes processed per iteration, used to report throughput
+	 * @param function The code to benchmark
+	*/
+	void run(const std::string& name, size_t iterations, uint64_t bytes, const std::function<void()>& function)
+	{
+		if (!enabled(name))
+			return;
+
+		function();
+
+		BenchmarkResult result;
+		result.name = name;
+		result.bytes = bytes;
+		result.samples.reserve(iterations);
+
+		for (size_t i = 0; i < iterations; i++)
+		{
+			Clock::time_point start = Clock::now();
+			function();
+			Clock::time_point end = Clock::now();
+
+			result.samples.push_back(std::chrono::duration<double, std::nano>(end - start).count());
+		}
+
+		m_Results.push_back(std::move(result));
+	}
+
+	/**
+	 * @brief Record samples that were measured outside of run()
+	 * @param name Name of the case
+	 * @param samples Nanoseconds per iteration
+	 * @param bytes Bytes processed per iteration
+	*/
+	void record(const std::string& name, std::vector<double> samples, uint64_t bytes = 0)
+	{
+		if (!enabled(name) || samples.empty())
+			return;
+
+		BenchmarkResult result;
+		result.name = name;
+		result.samples = std::move(samples);
+		result.bytes = bytes;
+
+		m_Results.push_back(std::move(result));
+	}
+
+	/**
+	 * @brief Report an extra value with a case that already ran, written as a user counter in the JSON
+	 * @param name Name of the case, nothing is recorded if it didn't run
+	 * @param counter Name of the value
+	 * @param value The value
+	*/
+	void addCounter(const std::string& name, const std::string& counter, double value)
+	{
+		for (BenchmarkResult& result : m_Results)
+		{
+			if (result.name == name)
+				result.counters.push_back(std::make_pair(counter, value));
+		}
+	}
+
+	/**
+	 * @brief Write all results as JSON
+	 * @param stream The stream to write to
+	 * @param device Name of the Vulkan device the benchmarks ran on
+	*/
+	void writeJson(std::ostream& stream, const std::string& device) const
+	{
+		stream << "{\n";
+		stream << "  \"context\": {\n";
+		stream << "    \"library\": \"glacier_bench\",\n";
+		stream << "    \"device\": \"" << escape(device) << "\"\n";
+		stream << "  },\n";
+		stream << "  \"benchmarks\": [";
+
+		for (size_t i = 0; i < m_Results.size(); i++)
+		{
+			const BenchmarkResult& result = m_Results[i];
+			double mean = result.mean();
+
+			stream << (i == 0 ? "\n" : ",\n");
+			stream << "    {\n";
+			stream << "      \"name\": \"" << escape(result.name) << "\",\n";
+			stream << "      \"run_type\": \"iteration\",\n";
+			stream << "      \"iterations\": " << result.samples.size() << ",\n";
+			stream << "      \"real_time\": " << mean << ",\n";
+			stream << "      \"median_time\": " << result.percentile(0.5) << ",\n";
+			stream << "      \"p99_time\": " << result.percentile(0.99) << ",\n";
+			stream << "      \"min_time\": " << result.percentile(0.0) << ",\n";
+			stream << "      \"max_time\": " << result.percentile(1.0) << ",\n";
+
+			if (result.bytes > 0 && mean > 0.0)
+				stream << "      \"bytes_per_second\": " << static_cast<double>(result.bytes) * 1.0e9 / mean << ",\n";
+
+			for (const std::pair<std::string, double>& counter : result.counters)
+				stream << "      \"" << escape(counter.first) << "\": " << counter.second << ",\n";
+
+			stream << "      \"time_unit\": \"ns\"\n";
+			stream << "    }";
+		}
+
+		stream << "\n  ]\n";
+		stream << "}\n";
+	}
+
+	const std::vector<BenchmarkResult>& results() const
+	{
+		return m_Results;
+	}
+private:
+	std::string m_Filter;
+	std::vector<BenchmarkResult> m_Results;
+
+	static std::string escape(const std::string& string)
+	{
+		std::string escaped;
+		escaped.reserve(string.size());
+
+		for (char c : string)
+		{
+			if (c == '"' || c == '\\')
+				escaped.push_back('\\');
+
+			escaped.push_back(c);
+		}
+
+		return escaped;
+	}
+};
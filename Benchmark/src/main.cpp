@@ -0,0 +1,80 @@
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include <glacier.hpp>
+#include <BenchmarkApp.hpp>
+
+int main(int argc, char** argv)
+{
+	BenchmarkOptions options;
+
+	// Results go to stdout by default, so keep the log quiet unless asked otherwise
+	glacier::g_Logger->set_level(spdlog::level::warn);
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--window") == 0)
+		{
+			options.headless = false;
+			continue;
+		}
+
+		if (argc <= i + 1)
+		{
+			glacier::g_Logger->error("Not enough arguments");
+			return -1;
+		}
+
+		if (strcmp(argv[i], "--resource-dir") == 0)
+		{
+			options.resourceDirectory = argv[++i];
+		}
+		else if (strcmp(argv[i], "--filter") == 0)
+		{
+			options.filter = argv[++i];
+		}
+		else if (strcmp(argv[i], "--output") == 0)
+		{
+			options.output = argv[++i];
+		}
+		else if (strcmp(argv[i], "--mesh") == 0)
+		{
+			options.mesh = argv[++i];
+		}
+		else if (strcmp(argv[i], "--model") == 0)
+		{
+			options.model = argv[++i];
+		}
+		else if (strcmp(argv[i], "--frames") == 0)
+		{
+			options.frames = static_cast<unsigned int>(std::stoul(argv[++i]));
+		}
+		else if (strcmp(argv[i], "--log-level") == 0)
+		{
+			glacier::g_Logger->set_level(spdlog::level::from_str(argv[++i]));
+		}
+		else
+		{
+			glacier::g_Logger->error("Invalid command-line arguments");
+			return -1;
+		}
+	}
+
+	glacier::File::setBaseDirectory(options.resourceDirectory);
+
+	std::shared_ptr<BenchmarkApp> app;
+
+	try
+	{
+		app = std::make_shared<BenchmarkApp>(options);
+		app->run();
+	}
+	catch (const std::exception& e)
+	{
+		glacier::g_Logger->error("{}", e.what());
+		return -1;
+	}
+
+	return 0;
+}
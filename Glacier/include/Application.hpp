@@ -1,16 +1,46 @@
 #pragma once
 
 #include <optional>
+#include <string>
 
 #include <spdlog/spdlog.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
 
 #include "Window.hpp"
 
+class AssetWatcher;
+class BindlessHeap;
+class DeletionQueue;
+class PipelineRegistry;
+class SamplerCache;
+class ShaderCompiler;
+class ThreadPool;
+
 namespace glacier
 {
 	class Renderer;
 
+	/**
+	 * @brief How finished frames are handed to the presentation engine.
+	*/
+	enum class PresentPolicy
+	{
+		/* Derived from ApplicationInfo::vsync: mailbox if vsync is enabled, otherwise immediate */
+		Auto,
+
+		/* Wait for vertical blank. Always supported. */
+		Fifo,
+
+		/* Wait for vertical blank, but present immediately if a frame was late. Tears instead of stuttering. */
+		FifoRelaxed,
+
+		/* Replace the queued frame with the newest one. No tearing and lower latency than FIFO. */
+		Mailbox,
+
+		/* Present immediately. Lowest latency, may tear. */
+		Immediate
+	};
+
 	/**
 	 * @brief Information about how the application should be initialized.
 	*/
@@ -25,6 +55,66 @@ namespace glacier
 		bool vsync;
 
 		WindowCreateInfo windowInfo;
+
+		/**
+		 * @brief How many frames the CPU may record ahead of the GPU. 1 minimizes input latency, 3 maximizes throughput.
+		*/
+		unsigned int framesInFlight = 2;
+
+		/**
+		 * @brief How many swapchain images to request. 0 requests one more than the surface minimum. Clamped to the range supported by the surface.
+		*/
+		unsigned int swapchainImageCount = 0;
+
+		/**
+		 * @brief The preferred present mode. Falls back to FIFO if the surface doesn't support it.
+		*/
+		PresentPolicy presentPolicy = PresentPolicy::Auto;
+
+		/**
+		 * @brief Upper limit of frames per second. 0 disables the limiter.
+		*/
+		double maxFrameRate = 0.0;
+
+		/**
+		 * @brief Delay input sampling and update() until the GPU has released the next frame and a swapchain image was acquired, just before recording. Reduces input-to-photon latency.
+		*/
+		bool justInTime = false;
+
+		/**
+		 * @brief Render with Vulkan 1.3 dynamic rendering instead of render pass and framebuffer objects when the device supports it
+		*/
+		bool dynamicRendering = true;
+
+		/**
+		 * @brief Render opaque geometry in a depth-only pass before shading it, so every pixel is shaded at most once. Vertex buffers keep an extra copy of their positions for this pass.
+		*/
+		bool depthPrepass = false;
+
+		/**
+		 * @brief MSAA sample count of the render targets. Rounded down to what the device supports for both colour and depth.
+		*/
+		unsigned int samples = 1;
+
+		/**
+		 * @brief Directory where SPIR-V compiled from GLSL at runtime is cached. nullptr disables the cache.
+		*/
+		const char* shaderCacheDirectory = "shader_cache";
+
+		/**
+		 * @brief Recompile GLSL shaders in the background when their source or includes change, and rebuild the pipelines using them
+		*/
+		bool shaderHotReload = false;
+
+		/**
+		 * @brief Reload textures and meshes loaded from files when the files change, on worker threads, and swap them in between frames. Files in archives aren't watched.
+		*/
+		bool assetHotReload = false;
+
+		/**
+		 * @brief Put every texture and storage buffer in one large descriptor set at set 0, which shaders index into with values from push constants or buffers. Falls back to off if the device lacks Vulkan 1.2 descriptor indexing.
+		*/
+		bool bindless = true;
 	};
 
 	/**
@@ -54,6 +144,24 @@ namespace glacier
 		*/
 		GLACIER_API void stop();
 
+		/**
+		 * @brief Get the name of the GPU selected by this application.
+		 * @return The device name reported by the Vulkan driver
+		*/
+		GLACIER_API const std::string& getDeviceName() const;
+
+		/**
+		 * @brief Get the timeline value of the most recent GPU submission. Every frame and upload signals a new, higher value.
+		 * @return The last submitted timeline value
+		*/
+		GLACIER_API uint64_t getSubmittedTimelineValue() const;
+
+		/**
+		 * @brief Get the timeline value the GPU has reached. All submissions with a value less than or equal to it have completed.
+		 * @return The completed timeline value
+		*/
+		GLACIER_API uint64_t getCompletedTimelineValue() const;
+
 		/**
 		 * @brief Initialize the application. Called before starting the main loop.
 		*/
@@ -100,11 +208,53 @@ namespace glacier
 		void* m_Device;
 		void* m_Surface;
 
+		std::string m_DeviceName;
+
+		/* Whether the renderer uses dynamic rendering and synchronization2 instead of render passes */
+		bool m_DynamicRendering;
+
+		/* ApplicationInfo::samples clamped to the device */
+		uint32_t m_Samples;
+
+		/* Largest sampler anisotropy the device supports, 1 if anisotropic filtering isn't available */
+		float m_MaxAnisotropy;
+
+		/* Timeline semaphore tracking GPU progress, and the last value submitted to it */
+		void* m_Timeline;
+		mutable uint64_t m_TimelineValue;
+
+		/* Destroys objects once the GPU has passed their last usage */
+		DeletionQueue* m_DeletionQueue;
+
+		/* Shares pipelines and pipeline layouts between identical requests */
+		PipelineRegistry* m_PipelineRegistry;
+
+		/* Workers for background jobs such as pipeline compilation */
+		ThreadPool* m_ThreadPool;
+
+		/* Compiles and caches GLSL shaders */
+		ShaderCompiler* m_ShaderCompiler;
+
+		/* Reloads edited shaders, textures and meshes, nullptr unless ApplicationInfo::shaderHotReload or assetHotReload is set */
+		AssetWatcher* m_AssetWatcher;
+
+		/* Descriptor set holding every texture and storage buffer, nullptr if bindless resources are disabled */
+		BindlessHeap* m_BindlessHeap;
+
+		/* Shares samplers between textures with the same sampling state */
+		SamplerCache* m_SamplerCache;
+
 		bool m_FramebufferResized;
 
+		friend class AssetLoader;
 		friend class VertexBuffer;
 		friend class IndexBuffer;
+		friend class StorageBuffer;
+		friend class GeometryPool;
+		friend class Mesh;
+		friend class MeshImporter;
 		friend class Renderer;
 		friend class Pipeline;
+		friend class Texture;
 	};
 }
\ No newline at end of file
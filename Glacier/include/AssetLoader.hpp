@@ -0,0 +1,296 @@
+#pragma once
+
+#include "common.hpp"
+#include "Mesh.hpp"
+#include "Shader.hpp"
+#include "Task.hpp"
+#include "Texture.hpp"
+
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+class ThreadPool;
+
+namespace glacier
+{
+	class Application;
+
+	enum class AssetStatus
+	{
+		/* Still being read, decoded or uploaded */
+		Loading,
+
+		/* Uploaded, get() returns it */
+		Ready,
+
+		/* Reading, decoding or uploading threw, getError() says why */
+		Failed
+	};
+
+	/**
+	 * @brief A shared reference to an asset an AssetLoader is loading. The asset lives as long as any handle to it.
+	 *
+	 * Handles are only updated by AssetLoader::update and AssetLoader::wait, so they may be read on the main thread without locking.
+	 * A Task can co_await a handle, which gives the asset once it has loaded and throws if it failed.
+	*/
+	template<typename T>
+	class AssetHandle
+	{
+	public:
+		/**
+		 * @brief Create an empty handle, which refers to no asset
+		*/
+		AssetHandle() = default;
+
+		/**
+		 * @brief Check if the handle refers to an asset
+		*/
+		bool isValid() const
+		{
+			return m_State != nullptr;
+		}
+
+		AssetStatus getStatus() const
+		{
+			return m_State->status;
+		}
+
+		bool isReady() const
+		{
+			return m_State != nullptr && m_State->status == AssetStatus::Ready;
+		}
+
+		/**
+		 * @brief Get the asset
+		 * @return The asset, or nullptr if it is still loading or failed
+		*/
+		T* get() const
+		{
+			return m_State != nullptr ? m_State->asset.get() : nullptr;
+		}
+
+		/**
+		 * @brief Get why the asset failed to load
+		 * @return The message of the exception, empty unless the status is Failed
+		*/
+		const std::string& getError() const
+		{
+			return m_State->error;
+		}
+
+		/**
+		 * @brief Call a function on the main thread once the asset has loaded or failed. Calls it right away if that has already happened.
+		 * @param callback Called with the asset, or with nullptr if it failed
+		*/
+		void then(std::function<void(T*)> callback) const
+		{
+			if (m_State->status == AssetStatus::Loading)
+				m_State->callbacks.push_back(std::move(callback));
+			else
+				callback(m_State->asset.get());
+		}
+
+		/**
+		 * @brief Resumes the awaiting coroutine from the callbacks of the handle, on the main thread
+		*/
+		struct Awaiter
+		{
+			std::shared_ptr<typename AssetHandle<T>::State> state;
+
+			bool await_ready() const
+			{
+				return state->status != AssetStatus::Loading;
+			}
+
+			template<typename Promise>
+			void await_suspend(std::coroutine_handle<Promise> coroutine) const
+			{
+				// A task may be destroyed while it waits, and is then no longer resumed
+				if constexpr (std::is_base_of_v<TaskPromiseBase, Promise>)
+				{
+					std::weak_ptr<const void> alive = coroutine.promise().getAliveToken();
+					state->callbacks.push_back([coroutine, alive](T*) { if (!alive.expired()) coroutine.resume(); });
+				}
+				else
+				{
+					state->callbacks.push_back([coroutine](T*) { coroutine.resume(); });
+				}
+			}
+
+			T* await_resume() const
+			{
+				if (state->status == AssetStatus::Failed)
+					throw std::runtime_error(state->error);
+
+				return state->asset.get();
+			}
+		};
+
+		Awaiter operator co_await() const
+		{
+			return Awaiter{ m_State };
+		}
+	private:
+		struct State
+		{
+			AssetStatus status = AssetStatus::Loading;
+
+			std::unique_ptr<T> asset;
+			std::string error;
+
+			std::vector<std::function<void(T*)>> callbacks;
+		};
+
+		std::shared_ptr<State> m_State;
+
+		AssetHandle(std::shared_ptr<State> state)
+			: m_State(std::move(state))
+		{
+		}
+
+		friend class AssetLoader;
+	};
+
+	/**
+	 * @brief Loads assets in the background. Each load runs in three stages:
+	 * the file is read on the loader's I/O threads, decoded on the application's worker threads, and copied to the GPU by a submission from update().
+	 *
+	 * The stages of different loads overlap, so a level's disk reads, CPU decoding and GPU transfers run at the same time instead of one after another.
+	 * Assets decoded by the same update share one staging buffer and submission. Only wait() and waitAll() block, update() never waits for the disk, the workers or the GPU.
+	 * Loads are followed with the callbacks of their handles, or awaited with co_await loader.load<T>(path) in a Task, which update() resumes on the main thread.
+	*/
+	class AssetLoader
+	{
+	public:
+		/**
+		 * @param application The application, whose worker threads decode the assets
+		 * @param ioThreads Number of threads reading files. They mostly wait for the disk, so they don't take cores from the workers.
+		*/
+		GLACIER_API AssetLoader(const Application* application, unsigned int ioThreads = 2);
+
+		/**
+		 * @brief Cancel the loads that haven't finished. Their handles stay in the Loading state, and their callbacks are never called.
+		*/
+		GLACIER_API ~AssetLoader();
+
+		// Delete copy
+		AssetLoader(const AssetLoader&) = delete;
+		AssetLoader& operator=(const AssetLoader&) = delete;
+
+		// Delete move
+		AssetLoader(AssetLoader&& other) = delete;
+		AssetLoader& operator=(AssetLoader&& other) = delete;
+
+		/**
+		 * @brief Start loading a .gmesh file
+		 * @param path Path to the file, relative to the file base directory
+		*/
+		GLACIER_API AssetHandle<Mesh> loadMesh(std::string_view path);
+
+		/**
+		 * @brief Start loading a KTX2 texture
+		 * @param path Path to the file, relative to the file base directory
+		 * @param info How to create and sample the texture
+		*/
+		GLACIER_API AssetHandle<Texture> loadTexture(std::string_view path, const TextureInfo& info = TextureInfo());
+
+		/**
+		 * @brief Start loading a compiled SPIR-V shader
+		 * @param path Path to the file, relative to the file base directory
+		*/
+		GLACIER_API AssetHandle<Shader> loadShader(std::string_view path);
+
+		/**
+		 * @brief Start loading a mesh, texture or shader, for example with co_await loader.load<Mesh>(path) in a Task
+		 * @param path Path to the file, relative to the file base directory
+		 * @param args Passed on after the path, a TextureInfo for textures
+		*/
+		template<typename T, typename... Args>
+		AssetHandle<T> load(std::string_view path, Args&&... args)
+		{
+			static_assert(std::is_same_v<T, Mesh> || std::is_same_v<T, Texture> || std::is_same_v<T, Shader>, "The asset loader loads meshes, textures and shaders");
+
+			if constexpr (std::is_same_v<T, Mesh>)
+				return loadMesh(path, std::forward<Args>(args)...);
+			else if constexpr (std::is_same_v<T, Texture>)
+				return loadTexture(path, std::forward<Args>(args)...);
+			else
+				return loadShader(path, std::forward<Args>(args)...);
+		}
+
+		/**
+		 * @brief Submit the copies of the assets that have been decoded, and complete the loads whose copies the GPU has finished, calling their callbacks.
+		 * Call once per frame on the main thread, for example from Application::update. Uploads go through the renderer, so assets only finish between initializeRenderer and terminateRenderer.
+		*/
+		GLACIER_API void update();
+
+		/**
+		 * @brief Block until an asset has loaded or failed, including its upload, and call its callbacks. Stages no thread has started yet run on the calling thread. Call on the main thread.
+		 * @param handle The asset
+		*/
+		template<typename T>
+		void wait(const AssetHandle<T>& handle)
+		{
+			waitFor(handle.m_State.get());
+		}
+
+		/**
+		 * @brief Block until every load started so far has loaded or failed, including their uploads, and call their callbacks. Call on the main thread.
+		*/
+		GLACIER_API void waitAll();
+
+		/**
+		 * @brief Get the number of loads that haven't completed yet, including those the GPU is still copying
+		*/
+		GLACIER_API size_t getPendingCount() const;
+	private:
+		struct Request;
+		struct Upload;
+
+		const Application* m_Application;
+
+		/* Runs the reading stage */
+		ThreadPool* m_IoThreads;
+
+		/* Loads still being read or decoded, in the order they were started */
+		std::vector<std::shared_ptr<Request>> m_Requests;
+
+		/* Submitted copies the GPU may not have finished yet, oldest first */
+		std::vector<std::shared_ptr<Upload>> m_Uploads;
+
+		/* Allocates the command buffers of the uploads, created with the first one. The renderer's pool is replaced with the swapchain while copies may still be pending. */
+		void* m_CommandPool;
+
+		/**
+		 * @brief Create a load that completes the state of a handle
+		 * @param path Path to the file, relative to the file base directory
+		*/
+		template<typename T>
+		std::shared_ptr<Request> createRequest(std::string_view path, const std::shared_ptr<typename AssetHandle<T>::State>& state);
+
+		/**
+		 * @brief Queue the reading stage of a load, which queues its decoding stage
+		*/
+		void start(const std::shared_ptr<Request>& request);
+
+		/**
+		 * @brief Complete the loads of the uploads the GPU has finished
+		 * @param completedValue The timeline value the GPU has reached
+		*/
+		void finishUploads(uint64_t completedValue);
+
+		/**
+		 * @brief Wait for the load of the handle with a state
+		*/
+		GLACIER_API void waitFor(const void* state);
+	};
+}
@@ -3,12 +3,13 @@
 #include "Buffer.hpp"
 #include "common.hpp"
 
+#include <string>
 #include <string_view>
 
 namespace glacier
 {
 	/**
-	 * @brief Class representing a file on the user's file system
+	 * @brief Class representing a file on the user's file system. Reads go through the FileSystem, so they see its mounts and share its cache.
 	*/
 	class File
 	{
@@ -36,6 +37,11 @@ namespace glacier
 		*/
 		GLACIER_API Buffer* read_ptr() const;
 
+		/**
+		 * @brief Get the path of this file, including the base directory. Mounts are ignored, FileSystem::resolve takes them into account.
+		*/
+		GLACIER_API const std::string& getPath() const;
+
 		/**
 		 * @brief Set the base directory of all future file instances. Prepended to the file path.
 		 * @param directory Base directory
@@ -45,6 +51,8 @@ namespace glacier
 			s_BaseDirectory = directory;
 		}
 	private:
+		/* The path as given, and with the base directory */
+		std::string m_Name;
 		std::string m_Path;
 		GLACIER_API static std::string s_BaseDirectory;
 	};
@@ -0,0 +1,156 @@
+#pragma once
+
+#include "common.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace glacier
+{
+	/**
+	 * @brief Immutable contents of a file, shared by everyone who read it. Copies only take a reference.
+	*/
+	class FileContents
+	{
+	public:
+		/**
+		 * @brief Create empty contents
+		*/
+		FileContents()
+			: m_Size(0)
+		{
+		}
+
+		/**
+		 * @param data The bytes, their owner is released once the last copy is destroyed
+		 * @param size Number of bytes
+		*/
+		FileContents(std::shared_ptr<const uint8_t> data, size_t size)
+			: m_Data(std::move(data)), m_Size(size)
+		{
+		}
+
+		const uint8_t* data() const
+		{
+			return m_Data.get();
+		}
+
+		size_t size() const
+		{
+			return m_Size;
+		}
+
+		/**
+		 * @brief Get the bytes as a shared pointer, for keeping them alive as long as something else
+		*/
+		const std::shared_ptr<const uint8_t>& getOwner() const
+		{
+			return m_Data;
+		}
+	private:
+		std::shared_ptr<const uint8_t> m_Data;
+		size_t m_Size;
+	};
+
+	/**
+	 * @brief How well the file cache is doing
+	*/
+	struct FileSystemStatistics
+	{
+		/* Reads answered from the cache, and reads that went to disk or an archive */
+		uint64_t hits = 0;
+		uint64_t misses = 0;
+
+		/* Files in the cache and their total size */
+		size_t cachedFiles = 0;
+		size_t cachedBytes = 0;
+	};
+
+	/**
+	 * @brief The virtual file system every glacier file read goes through.
+	 *
+	 * Directories and .gpak archives are mounted with a priority, and a path is looked up in every mount from the highest priority to the lowest.
+	 * When nothing is mounted, paths are relative to File's base directory as before.
+	 * Files read from directories are kept in a least recently used cache with a memory budget; files in archives are used straight from a mapping of the archive.
+	 * Every function may be called from any thread.
+	*/
+	class FileSystem
+	{
+	public:
+		/**
+		 * @brief Mount a directory or a .gpak archive
+		 * @param path Path to the directory or archive on disk
+		 * @param priority Mounts with a higher priority are searched first. Among mounts with the same priority, the last one is searched first.
+		 * @param mountPoint Directory the mount's files appear under, empty for the root
+		 * @throw std::runtime_error if the path doesn't exist or the archive is invalid
+		*/
+		GLACIER_API static void mount(std::string_view path, int priority = 0, std::string_view mountPoint = "");
+
+		/**
+		 * @brief Remove every mount of a directory or archive
+		 * @param path The path it was mounted with
+		 * @return True if it was mounted
+		*/
+		GLACIER_API static bool unmount(std::string_view path);
+
+		/**
+		 * @brief Remove every mount and clear the cache
+		*/
+		GLACIER_API static void unmountAll();
+
+		/**
+		 * @brief Check if a file exists in any mount
+		 * @param path Virtual path of the file, separated by '/'
+		*/
+		GLACIER_API static bool exists(std::string_view path);
+
+		/**
+		 * @brief Read a file, from the cache if it holds it and the file hasn't changed on disk since
+		 * @param path Virtual path of the file, separated by '/'
+		 * @return The contents
+		 * @throw std::runtime_error if no mount has the file or it can't be read
+		*/
+		GLACIER_API static FileContents read(std::string_view path);
+
+		/**
+		 * @brief Get the path on disk a virtual path resolves to, for code that needs a real file
+		 * @param path Virtual path of the file
+		 * @return The path on disk, or an empty string if no mount has the file or it lies in an archive
+		*/
+		GLACIER_API static std::string resolve(std::string_view path);
+
+		/**
+		 * @brief Drop a file from the cache, so the next read goes to disk
+		 * @param path Virtual path of the file
+		*/
+		GLACIER_API static void invalidate(std::string_view path);
+
+		/**
+		 * @brief Set how many bytes of file contents the cache keeps, 64 MiB by default. Files larger than the budget are never cached, 0 disables the cache.
+		 * Contents still held by a reader stay alive when they are evicted, but no longer count.
+		*/
+		GLACIER_API static void setCacheBudget(size_t bytes);
+
+		GLACIER_API static size_t getCacheBudget();
+
+		/**
+		 * @brief Empty the cache
+		*/
+		GLACIER_API static void clearCache();
+
+		GLACIER_API static FileSystemStatistics getStatistics();
+
+		/**
+		 * @brief Pack every file under a directory into a .gpak archive. Files are stored uncompressed, 16-byte aligned.
+		 * @param directory The directory to pack, paths in the archive are relative to it
+		 * @param archive Path of the archive to write
+		 * @return Number of files packed
+		 * @throw std::runtime_error if a file can't be read or the archive can't be written
+		*/
+		GLACIER_API static size_t createArchive(std::string_view directory, std::string_view archive);
+	};
+}
@@ -0,0 +1,163 @@
+#pragma once
+
+#include "common.hpp"
+#include "IndexBuffer.hpp"
+#include "VertexBuffer.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class RangeAllocator;
+
+namespace glacier
+{
+	class Application;
+
+	/**
+	 * @brief Where a mesh of a GeometryPool lies in the pool's buffers
+	*/
+	struct GeometryRange
+	{
+		/* Passed to an indexed draw as the first index and the vertex offset. Indices are relative to the first vertex of the mesh. */
+		uint32_t firstIndex;
+		int32_t vertexOffset;
+
+		uint32_t indexCount;
+		uint32_t vertexCount;
+	};
+
+	struct GeometryPoolStatistics
+	{
+		uint32_t meshes = 0;
+
+		uint32_t vertexCapacity = 0;
+		uint32_t freeVertices = 0;
+
+		uint32_t indexCapacity = 0;
+		uint32_t freeIndices = 0;
+
+		/* How often the buffers were rebuilt, by compact or to grow them */
+		uint32_t compactions = 0;
+	};
+
+	/**
+	 * @brief Sub-allocates the vertices and indices of many meshes from one vertex buffer and one index buffer, so a whole scene draws with a single bind of each.
+	 *
+	 * Meshes are addressed by handles, and drawn with Renderer::draw(pipeline, pool, handle). Freed space is reused once the GPU is done with it.
+	 * When a mesh doesn't fit, the pool compacts its buffers, and grows them if that isn't enough.
+	*/
+	class GeometryPool
+	{
+	public:
+		/**
+		 * @brief Create an empty pool
+		 * @param application The application
+		 * @param layout The vertex layout of every mesh in the pool
+		 * @param vertexCapacity Initial number of vertices the pool holds
+		 * @param indexCapacity Initial number of indices the pool holds
+		*/
+		GLACIER_API GeometryPool(const Application* application, const VertexBufferLayout& layout, uint32_t vertexCapacity, uint32_t indexCapacity);
+		GLACIER_API ~GeometryPool();
+
+		// Delete copy
+		GeometryPool(const GeometryPool&) = delete;
+		GeometryPool& operator=(const GeometryPool&) = delete;
+
+		// Delete move
+		GeometryPool(GeometryPool&& other) = delete;
+		GeometryPool& operator=(GeometryPool&& other) = delete;
+
+		/**
+		 * @brief Upload a mesh into the pool. May compact or grow the pool, which moves the other meshes. Draws already made this frame follow them, as their ranges are looked up when the frame is recorded.
+		 * @param vertices vertexCount * the layout's stride bytes
+		 * @param vertexCount Number of vertices, greater than 0
+		 * @param indices Indices of the mesh, starting from 0 at its first vertex
+		 * @param indexCount Number of indices, greater than 0
+		 * @return The handle of the mesh
+		*/
+		GLACIER_API uint32_t allocate(const void* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount);
+
+		/**
+		 * @brief Remove a mesh. Its space is reused once the frames that drew it are done, and draws of it already made this frame are dropped.
+		 * @param handle A handle returned by allocate
+		*/
+		GLACIER_API void free(uint32_t handle);
+
+		/**
+		 * @brief Move every mesh to the start of new buffers, so the free space is in one piece. Ranges of all meshes change.
+		*/
+		GLACIER_API void compact();
+
+		/**
+		 * @brief Get where a mesh currently lies. Valid until the pool is compacted or grown.
+		 * @param handle A handle returned by allocate
+		*/
+		GLACIER_API const GeometryRange& getRange(uint32_t handle) const;
+
+		/**
+		 * @brief Get the shared vertex buffer, to create pipelines for the meshes of the pool
+		*/
+		GLACIER_API const VertexBuffer& getVertexBuffer() const;
+
+		/**
+		 * @brief Get the shared index buffer, to create pipelines for the meshes of the pool
+		*/
+		GLACIER_API const IndexBuffer& getIndexBuffer() const;
+
+		GLACIER_API GeometryPoolStatistics getStatistics() const;
+	private:
+		struct Entry
+		{
+			GeometryRange range;
+			bool allocated;
+		};
+
+		/* A freed mesh whose space can be reused once the timeline passes lastUsage */
+		struct PendingFree
+		{
+			uint64_t lastUsage;
+			uint32_t firstVertex;
+			uint32_t vertexCount;
+			uint32_t firstIndex;
+			uint32_t indexCount;
+		};
+
+		const Application* m_Application;
+
+		/* Buffers without memory of their own, whose handles are replaced when the pool is rebuilt */
+		std::unique_ptr<VertexBuffer> m_VertexBuffer;
+		std::unique_ptr<IndexBuffer> m_IndexBuffer;
+
+		/* Size of the first attribute, copied into the position buffer for the depth prepass. 0 if the prepass is disabled. */
+		uint32_t m_PositionSize;
+
+		std::unique_ptr<RangeAllocator> m_Vertices;
+		std::unique_ptr<RangeAllocator> m_Indices;
+
+		std::vector<Entry> m_Entries;
+		std::vector<uint32_t> m_FreeHandles;
+		std::vector<PendingFree> m_PendingFrees;
+
+		uint32_t m_Compactions;
+
+		/**
+		 * @brief Return the space of freed meshes the GPU no longer reads to the allocators
+		*/
+		void reclaim();
+
+		/**
+		 * @brief Copy every mesh to the start of new buffers and destroy the old ones once the GPU is done with them
+		*/
+		void rebuild(uint32_t vertexCapacity, uint32_t indexCapacity);
+
+		/**
+		 * @brief Create the buffers of the pool
+		 * @param buffers Receives the vertex, position and index buffers, the position buffer is nullptr without the depth prepass
+		 * @param memory Receives their memory
+		*/
+		void createBuffers(uint32_t vertexCapacity, uint32_t indexCapacity, void* buffers[3], void* memory[3]) const;
+
+		friend class Renderer;
+	};
+}
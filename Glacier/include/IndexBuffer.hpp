@@ -2,6 +2,13 @@
 
 #include "common.hpp"
 
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+class TextureUploader;
+
 namespace glacier
 {
 	class Application;
@@ -20,13 +27,37 @@ namespace glacier
 		IndexBuffer(IndexBuffer&& other) = delete;
 		IndexBuffer& operator=(IndexBuffer&& other) = delete;
 	private:
+		/**
+		 * @brief Create the buffer and let a callback fill the staging memory, so indices can be decoded straight into it
+		 * @param size Size of the indices in bytes
+		 * @param write Receives the mapped indices. The memory is uncached, only write to it.
+		*/
+		IndexBuffer(const Application* application, uint64_t size, const std::function<void(void* indices)>& write);
+
+		/**
+		 * @brief Create the buffer and queue the copy of the indices on an uploader rather than waiting for it
+		 * @param indices Kept alive until the upload is submitted
+		 * @param uploader Must be submitted with the application's current timeline value, which the caller takes before creating the buffer
+		*/
+		IndexBuffer(const Application* application, std::shared_ptr<const std::vector<uint32_t>> indices, TextureUploader& uploader);
+
+		/**
+		 * @brief Create a buffer without memory, whose handle a GeometryPool sets
+		*/
+		IndexBuffer(const Application* application);
+
 		const Application* m_Application;
 
 		void* m_Handle;
 		void* m_Memory;
 
+		/* Timeline value of the last submission that used this buffer */
+		mutable uint64_t m_LastUsage;
+
 		friend class Application;
 		friend class Renderer;
 		friend class Pipeline;
+		friend class Mesh;
+		friend class GeometryPool;
 	};
 }
@@ -0,0 +1,142 @@
+#pragma once
+
+#include "common.hpp"
+#include "IndexBuffer.hpp"
+#include "VertexBuffer.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+class TextureUploader;
+
+namespace glacier
+{
+	class Application;
+
+	/**
+	 * @brief A vertex and an index buffer loaded from a compressed .gmesh file.
+	 *
+	 * Vertices and indices are stored losslessly as small differences between neighbours, which usually takes a third to a fifth of the size.
+	 * They are decoded with SIMD straight into the staging buffers, so loading never holds an uncompressed copy in memory.
+	*/
+	class Mesh
+	{
+	public:
+		/**
+		 * @brief Load a .gmesh file through the file system. With ApplicationInfo::assetHotReload, the mesh is reloaded when the file changes.
+		 * @param application The application
+		 * @param path Path to the file, relative to the file base directory
+		*/
+		GLACIER_API Mesh(const Application* application, std::string_view path);
+
+		/**
+		 * @brief Load a mesh from the contents of a .gmesh file
+		 * @param application The application
+		 * @param data The contents of the file
+		 * @param size Size of the file in bytes
+		*/
+		GLACIER_API Mesh(const Application* application, const void* data, size_t size);
+
+		GLACIER_API ~Mesh();
+
+		// Delete copy
+		Mesh(const Mesh&) = delete;
+		Mesh& operator=(const Mesh&) = delete;
+
+		// Delete move
+		Mesh(Mesh&& other) = delete;
+		Mesh& operator=(Mesh&& other) = delete;
+
+		/**
+		 * @brief Compress a mesh into the contents of a .gmesh file. Vertices that change little from one to the next compress best, so keep them in the order they are drawn.
+		 * @param vertices vertexCount * layout.getStride() bytes
+		 * @param vertexCount Number of vertices
+		 * @param layout The layout of the vertices. Its first attribute is the position.
+		 * @param indices The indices
+		 * @param indexCount Number of indices
+		 * @return The file contents
+		*/
+		GLACIER_API static std::vector<uint8_t> encode(const void* vertices, uint32_t vertexCount, const VertexBufferLayout& layout, const uint32_t* indices, uint32_t indexCount);
+
+		/**
+		 * @brief Decompress the contents of a .gmesh file into memory, for tools and tests
+		 * @param data The contents of the file
+		 * @param size Size of the file in bytes
+		 * @param layout Receives the layout of the vertices
+		 * @param vertices Receives the vertices
+		 * @param indices Receives the indices
+		*/
+		GLACIER_API static void decode(const void* data, size_t size, VertexBufferLayout& layout, std::vector<uint8_t>& vertices, std::vector<uint32_t>& indices);
+
+		GLACIER_API const VertexBuffer& getVertexBuffer() const;
+		GLACIER_API const IndexBuffer& getIndexBuffer() const;
+
+		GLACIER_API uint32_t getVertexCount() const;
+		GLACIER_API uint32_t getIndexCount() const;
+	private:
+		/**
+		 * @brief Where the parts of a .gmesh file are
+		*/
+		struct Contents
+		{
+			uint32_t vertexCount;
+			uint32_t indexCount;
+
+			const void* vertexData;
+			size_t vertexDataSize;
+
+			const void* indexData;
+			size_t indexDataSize;
+		};
+
+		/**
+		 * @brief Check the header of a .gmesh file and locate its streams
+		 * @param layout Receives the layout of the vertices
+		 * @throw std::runtime_error if the file is invalid or truncated
+		*/
+		static Contents parse(const void* data, size_t size, VertexBufferLayout& layout);
+
+		void load(const void* data, size_t size);
+
+		/**
+		 * @brief Reload the mesh when its .gmesh file changes, if ApplicationInfo::assetHotReload is set and the file isn't in an archive
+		*/
+		void watch(std::string_view path);
+
+		/**
+		 * @brief Replace the vertices and indices and wait for their upload. The buffer objects stay the same, so pipelines and draws using them see the new contents.
+		 * @throw std::runtime_error if the layout differs from the current one, which pipelines created with the mesh can't follow
+		*/
+		void reload(const VertexBufferLayout& layout, const std::vector<uint8_t>& vertices, const std::vector<uint32_t>& indices);
+
+		/**
+		 * @brief Check if two layouts have the same attributes at the same offsets
+		*/
+		static bool isSameLayout(const VertexBufferLayout& a, const VertexBufferLayout& b);
+
+		/**
+		 * @brief Upload vertices and indices that were already decoded
+		*/
+		Mesh(const Application* application, const VertexBufferLayout& layout, const std::vector<uint8_t>& vertices, const std::vector<uint32_t>& indices);
+
+		/**
+		 * @brief Create the buffers for vertices and indices that were already decoded, and queue their upload on an uploader rather than waiting for it
+		 * @param uploader Must be submitted with the application's current timeline value, which the caller takes before creating the mesh
+		*/
+		Mesh(const Application* application, const VertexBufferLayout& layout, std::shared_ptr<const std::vector<uint8_t>> vertices, std::shared_ptr<const std::vector<uint32_t>> indices, TextureUploader& uploader);
+
+		const Application* m_Application;
+
+		std::unique_ptr<VertexBuffer> m_VertexBuffer;
+		std::unique_ptr<IndexBuffer> m_IndexBuffer;
+
+		uint32_t m_VertexCount;
+		uint32_t m_IndexCount;
+
+		friend class AssetLoader;
+		friend class MeshImporter;
+	};
+}
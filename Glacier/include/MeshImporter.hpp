@@ -0,0 +1,111 @@
+#pragma once
+
+#include "common.hpp"
+#include "Mesh.hpp"
+#include "VertexBuffer.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace glacier
+{
+	class Application;
+
+	/**
+	 * @brief How the last mesh of a MeshImporter was loaded
+	*/
+	struct MeshImportStatistics
+	{
+		/* Size of the source file */
+		uint64_t sourceBytes = 0;
+
+		/* True if the mesh came from the binary cache and the source wasn't parsed */
+		bool cached = false;
+
+		/* Time spent parsing and converting the source, 0 for cached meshes */
+		double parseMilliseconds = 0.0;
+
+		/* Time from opening the file until the mesh is uploaded */
+		double totalMilliseconds = 0.0;
+
+		uint32_t vertexCount = 0;
+		uint32_t indexCount = 0;
+	};
+
+	/**
+	 * @brief Imports meshes from Wavefront OBJ and glTF 2.0 (.gltf and .glb) files.
+	 *
+	 * Sources are parsed on the application's worker threads and converted into any vertex layout. The result is written next to the source
+	 * as a compressed .gmesh file, which later loads use instead as long as it is newer than the source and has the same layout.
+	*/
+	class MeshImporter
+	{
+	public:
+		/**
+		 * @param application The application, whose worker threads parse the files
+		*/
+		GLACIER_API MeshImporter(const Application* application);
+		GLACIER_API ~MeshImporter();
+
+		// Delete copy
+		MeshImporter(const MeshImporter&) = delete;
+		MeshImporter& operator=(const MeshImporter&) = delete;
+
+		// Delete move
+		MeshImporter(MeshImporter&& other) = delete;
+		MeshImporter& operator=(MeshImporter&& other) = delete;
+
+		/**
+		 * @brief Get a compact layout for imported meshes: a float position, a 10:10:10:2 normal and half float texture coordinates, 20 bytes per vertex
+		*/
+		GLACIER_API static VertexBufferLayout getDefaultLayout();
+
+		/**
+		 * @brief Load a mesh, from its cache if there is a valid one. Logs the time it took per MB of source.
+		 * With ApplicationInfo::assetHotReload, the mesh is imported again when the source changes.
+		 * @param path Path to a .obj, .gltf or .glb file, relative to the file base directory. The cache is the same path with .gmesh appended.
+		 * @param layout The vertex layout to convert to. Attributes are, in order, the position, the normal and the texture coordinates, a layout may stop after any of them.
+		 * Their elements can be anything but the integer ones, and a position with 4 components gets a w of 1.
+		 * @param useCache Whether to read and write the cache
+		 * @return The mesh
+		 * @throw std::runtime_error if the file can't be read or parsed
+		*/
+		GLACIER_API std::unique_ptr<Mesh> load(std::string_view path, const VertexBufferLayout& layout = getDefaultLayout(), bool useCache = true);
+
+		/**
+		 * @brief Parse a source file into the contents of a .gmesh file, without touching the cache or the GPU
+		 * @param path Path to a .obj, .gltf or .glb file, relative to the file base directory
+		 * @param layout The vertex layout to convert to, as for load
+		 * @return The contents of the .gmesh file
+		*/
+		GLACIER_API std::vector<uint8_t> import(std::string_view path, const VertexBufferLayout& layout = getDefaultLayout());
+
+		/**
+		 * @brief Get how the last mesh was loaded or imported
+		*/
+		GLACIER_API const MeshImportStatistics& getStatistics() const;
+	private:
+		const Application* m_Application;
+
+		MeshImportStatistics m_Statistics;
+
+		/**
+		 * @brief Load the cache of a source if it's newer than the source and has the layout
+		 * @return The mesh, or nullptr if the cache is missing, outdated or invalid
+		*/
+		std::unique_ptr<Mesh> loadCache(const std::string& source, const std::string& cache, const VertexBufferLayout& layout);
+
+		/**
+		 * @brief Parse a source file, the path includes the base directory
+		*/
+		std::vector<uint8_t> importFile(const std::string& source, const VertexBufferLayout& layout);
+
+		/**
+		 * @brief Import a loaded mesh again when its source changes, if ApplicationInfo::assetHotReload is set
+		*/
+		void watch(Mesh* mesh, std::string_view path, const std::string& source, const VertexBufferLayout& layout, bool useCache) const;
+	};
+}
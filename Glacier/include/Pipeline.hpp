@@ -6,12 +6,161 @@
 #include "IndexBuffer.hpp"
 
 #include <unordered_map>
+#include <vector>
+
+class AssetWatcher;
 
 namespace glacier
 {
 	class Application;
 	class Renderer;
 
+	/**
+	 * @brief Comparison used by the depth test. The order matches VkCompareOp.
+	*/
+	enum class CompareOp
+	{
+		Never, Less, Equal, LessOrEqual, Greater, NotEqual, GreaterOrEqual, Always
+	};
+
+	/**
+	 * @brief Depth test and write state of a pipeline
+	*/
+	struct DepthState
+	{
+		bool test = true;
+		bool write = true;
+		CompareOp compare = CompareOp::Less;
+	};
+
+	/**
+	 * @brief Which faces are discarded. The order matches VkCullModeFlagBits.
+	*/
+	enum class CullMode
+	{
+		None, Front, Back, FrontAndBack
+	};
+
+	/**
+	 * @brief Winding order of front faces, as seen on screen. The order matches VkFrontFace.
+	*/
+	enum class FrontFace
+	{
+		CounterClockwise, Clockwise
+	};
+
+	/**
+	 * @brief How vertices are assembled into primitives. The order matches VkPrimitiveTopology.
+	*/
+	enum class Topology
+	{
+		PointList, LineList, LineStrip, TriangleList, TriangleStrip, TriangleFan
+	};
+
+	/**
+	 * @brief Blend factors. The order matches VkBlendFactor.
+	*/
+	enum class BlendFactor
+	{
+		Zero, One, SrcColor, OneMinusSrcColor, DstColor, OneMinusDstColor, SrcAlpha, OneMinusSrcAlpha, DstAlpha, OneMinusDstAlpha
+	};
+
+	/**
+	 * @brief Blend operations. The order matches VkBlendOp.
+	*/
+	enum class BlendOp
+	{
+		Add, Subtract, ReverseSubtract, Min, Max
+	};
+
+	/**
+	 * @brief Colour blending of a pipeline. The default overwrites the target.
+	*/
+	struct BlendState
+	{
+		bool enable = false;
+
+		BlendFactor srcColor = BlendFactor::One;
+		BlendFactor dstColor = BlendFactor::Zero;
+		BlendOp colorOp = BlendOp::Add;
+
+		BlendFactor srcAlpha = BlendFactor::One;
+		BlendFactor dstAlpha = BlendFactor::Zero;
+		BlendOp alphaOp = BlendOp::Add;
+	};
+
+	/**
+	 * @brief Values for the layout(constant_id = ...) constants of one shader stage. The value's type has to match the constant's declared type.
+	*/
+	class SpecializationConstants
+	{
+	public:
+		GLACIER_API void set(uint32_t id, bool value);
+		GLACIER_API void set(uint32_t id, int32_t value);
+		GLACIER_API void set(uint32_t id, uint32_t value);
+		GLACIER_API void set(uint32_t id, float value);
+		GLACIER_API void set(uint32_t id, double value);
+
+		GLACIER_API bool empty() const;
+	private:
+		struct Entry
+		{
+			uint32_t id;
+			ShaderScalarType type;
+
+			/* Size of the value in bytes, bools are 32-bit like VkBool32 */
+			uint32_t size;
+
+			/* The value's bytes, in the low bytes */
+			uint64_t bits;
+		};
+
+		/* Sorted by id */
+		std::vector<Entry> m_Entries;
+
+		void set(uint32_t id, ShaderScalarType type, const void* value, uint32_t size);
+
+		friend class Pipeline;
+	};
+
+	/**
+	 * @brief Fixed-function state and shader specialization of a pipeline. The defaults draw filled, unculled triangle lists without blending.
+	*/
+	struct PipelineDescription
+	{
+		CullMode cullMode = CullMode::None;
+		FrontFace frontFace = FrontFace::Clockwise;
+
+		Topology topology = Topology::TriangleList;
+
+		/* Restart strips and fans at index 0xFFFFFFFF. Only valid with strip and fan topologies. */
+		bool primitiveRestart = false;
+
+		DepthState depth;
+		BlendState blend;
+
+		/* MSAA sample count. Must match ApplicationInfo::samples after clamping, 0 uses the renderer's count. */
+		uint32_t samples = 0;
+
+		/* Specialization constant values per stage. Constants without a value keep the default from the shader. */
+		std::unordered_map<ShaderType, SpecializationConstants> specialization;
+	};
+
+	/**
+	 * @brief How a pipeline is compiled
+	*/
+	enum class CompileMode
+	{
+		/* Compile in the constructor */
+		Blocking,
+
+		/* Compile on a worker thread. Draws are skipped or use the fallback pipeline until it is ready. */
+		Async,
+
+		/* Compile on a worker thread ahead of every Async pipeline */
+		AsyncPriority
+	};
+
 	/**
 	 * @brief A graphics pipeline configuration. There needs to be a separate Pipeline instance for every pipeline configuration. Must only be created in initializeRenderer
 	*/
@@ -24,8 +173,10 @@ namespace glacier
 		 * @param renderer The currently active renderer
 		 * @param shaders A map of the basic shader types and a pointer to their respective shaders. At least one ShaderType::Vertex and ShaderType::Fragment must be bound.
 		 * @param vertexBuffer A VertexBuffer corresponding to the current vertex input
+		 * @param description Fixed-function state and specialization constants. Pipelines that test and write depth without blending are treated as opaque.
+		 * @param compileMode Whether to compile on this thread or in the background. The shaders must stay alive until the pipeline is ready.
 		*/
-		GLACIER_API Pipeline(const Application* application, const Renderer* renderer, const std::unordered_map<ShaderType, Shader*>& shaders, const VertexBuffer& vertexBuffer, const IndexBuffer& indexBuffer);
+		GLACIER_API Pipeline(const Application* application, const Renderer* renderer, const std::unordered_map<ShaderType, Shader*>& shaders, const VertexBuffer& vertexBuffer, const IndexBuffer& indexBuffer, const PipelineDescription& description = PipelineDescription(), CompileMode compileMode = CompileMode::Blocking);
 
 		/**
 		 * @brief Destroy this graphics pipeline configuration
@@ -39,15 +190,91 @@ namespace glacier
 		// Delete move constructor and operator
 		Pipeline(Pipeline&& other) = delete;
 		Pipeline& operator=(Pipeline&& other) = delete;
+
+		/**
+		 * @brief Check if this pipeline draws opaque geometry, which is sorted front to back and drawn in the depth prepass
+		 * @return True if the pipeline both tests and writes depth, and doesn't blend
+		*/
+		GLACIER_API bool isOpaque() const;
+
+		/**
+		 * @brief Check if the pipeline has finished compiling. Always true for blocking pipelines.
+		 * @return False while the pipeline is compiling, or if compilation failed
+		*/
+		GLACIER_API bool isReady() const;
+
+		/**
+		 * @brief Block until the pipeline has finished compiling. Compiles on this thread if no worker has started yet.
+		 * @throw std::runtime_error if compilation failed
+		*/
+		GLACIER_API void wait() const;
+
+		/**
+		 * @brief Move the pipeline ahead of every normal priority pipeline still waiting for a worker. The renderer does this for pipelines drawn before they are ready.
+		*/
+		GLACIER_API void prioritize() const;
+
+		/**
+		 * @brief Set a pipeline to draw with while this one is compiling
+		 * @param fallback A pipeline accepting the same vertex layout, or nullptr to skip draws until this pipeline is ready
+		*/
+		GLACIER_API void setFallback(const Pipeline* fallback);
 	private:
 		void* m_PipelineLayout;
-		void* m_Pipeline;
+
+		/* Push constant range of the layout, which draws push their data to. Size 0 if the shaders have no push constants. */
+		uint32_t m_PushConstantStages;
+		uint32_t m_PushConstantSize;
+
+		/* Copied from the registry entry by isReady once compilation has finished */
+		mutable void* m_Pipeline;
+
+		/* Vertex-only variant used by the depth prepass, nullptr if the prepass is disabled or the pipeline isn't opaque */
+		mutable void* m_DepthPipeline;
+
+		PipelineDescription m_Description;
+
+		/* Identifies the pipeline state in render queue sort keys, shared by pipelines with identical state */
+		uint32_t m_Id;
+
+		/* The registry entry owning the Vulkan objects above */
+		void* m_RegistryEntry;
+
+		/* Entry being compiled after a shader was reloaded, swapped in once it is ready. nullptr if there is none. */
+		void* m_PendingEntry;
+
+		const Pipeline* m_Fallback;
+
+		/* Timeline value of the last submission that used this pipeline */
+		mutable uint64_t m_LastUsage;
 
 		const Application* m_Application;
+		const Renderer* m_Renderer;
 		const VertexBuffer* m_VertexBuffer;
 		const IndexBuffer* m_IndexBuffer;
 		const std::unordered_map<ShaderType, Shader*> m_Shaders;
 
+		/**
+		 * @brief Validate the state and acquire its registry entry, starting the compile job
+		 *
+		 * Each vertex attribute takes one location, the index it was pushed at, so the vertex input at location N is matched with attribute N.
+		 * Reflection splits matrix and array inputs into one input per location, which keeps this true for them.
+		 * @return The registry entry
+		*/
+		void* build(CompileMode compileMode);
+
+		/**
+		 * @brief Start compiling the current state of the shaders in the background
+		*/
+		void rebuild();
+
+		/**
+		 * @brief Replace the current state with the rebuilt one if it has finished compiling
+		 * @return False while the rebuild is still compiling
+		*/
+		bool swapPending();
+
+		friend class ::AssetWatcher;
 		friend class Renderer;
 	};
 }
@@ -4,17 +4,54 @@
 #include "Shader.hpp"
 
 #include <vector>
+#include <optional>
+#include <type_traits>
 #include <unordered_map>
 
+class RenderQueue;
+
 namespace glacier
 {
 	class Application;
+	class Pipeline;
+	class VertexBuffer;
+	class IndexBuffer;
+	class GeometryPool;
+
+	/**
+	 * @brief Counters describing the work recorded for a single frame
+	*/
+	struct RenderStatistics
+	{
+		uint32_t drawCalls = 0;
+		uint32_t pipelineBinds = 0;
+		uint32_t vertexBufferBinds = 0;
+		uint32_t indexBufferBinds = 0;
+
+		/* The bindless descriptor set is bound once per frame, 0 if bindless resources are disabled */
+		uint32_t descriptorSetBinds = 0;
+
+		uint32_t pushConstantUpdates = 0;
+
+		/* Draws recorded by the depth prepass, not included in drawCalls */
+		uint32_t prepassDrawCalls = 0;
+
+		/* Binds of the main pass avoided by sorting draws, compared to recording them in submission order */
+		uint32_t bindsSavedBySorting = 0;
+
+		/* Draws whose pipeline was still compiling, either dropped or recorded with the fallback pipeline */
+		uint32_t skippedDraws = 0;
+		uint32_t fallbackDraws = 0;
+
+		/* Vertices (or indices for indexed draws) submitted */
+		uint64_t vertices = 0;
+	};
 
 	class Renderer
 	{
 	public:
 		/**
-		 * @brief Bind a graphics pipeline configuration to this renderer. There can only be one graphics pipeline bound at a time.
+		 * @brief Bind a graphics pipeline configuration to this renderer. The bound pipeline is drawn every frame until it is unbound. There can only be one graphics pipeline bound at a time.
 		 * @param pipeline The pipeline to be bound.
 		 * @param count If the pipeline has an index buffer count is how many indices there are in the buffer. Otherwise count is how many vertices there are in the vertex buffer.
 		*/
@@ -24,22 +61,131 @@ namespace glacier
 		 * @brief Unbind the currently bound graphics pipeline configuration.
 		*/
 		GLACIER_API void unbindPipeline();
+
+		/**
+		 * @brief Draw geometry during the current frame only. Must be called from Application::render.
+		 * @param pipeline The pipeline to draw with
+		 * @param vertexBuffer The vertex buffer to draw from
+		 * @param indexBuffer The index buffer to draw with, or nullptr for a non-indexed draw
+		 * @param count How many indices to draw if indexBuffer is set, otherwise how many vertices
+		 * @param depth Distance of the geometry from the camera. Opaque draws sharing state are recorded front to back by this value, translucent draws back to front.
+		*/
+		GLACIER_API void draw(const Pipeline& pipeline, const VertexBuffer& vertexBuffer, const IndexBuffer* indexBuffer, uint32_t count, float depth = 0.0f);
+
+		/**
+		 * @brief Draw a mesh of a geometry pool during the current frame only. Meshes of one pool share its buffers, so they are bound once for all of them.
+		 * @param pipeline The pipeline to draw with, created with the pool's buffers
+		 * @param pool The pool holding the mesh
+		 * @param mesh The handle of the mesh
+		 * @param depth Distance of the geometry from the camera
+		*/
+		GLACIER_API void draw(const Pipeline& pipeline, const GeometryPool& pool, uint32_t mesh, float depth = 0.0f);
+
+		/**
+		 * @brief Set the layer of the draws that follow. Layers are recorded in ascending order, and draws within a layer are sorted to minimize state changes.
+		 * @param layer The layer, 0 by default
+		*/
+		GLACIER_API void setLayer(uint8_t layer);
+
+		/**
+		 * @brief Set the push constants of the draws that follow in the current frame. With bindless resources, this is how a draw passes the indices of its textures and buffers.
+		 * @param data The values, laid out like the shaders' push constant block
+		 * @param size Size of the data in bytes, at most 128. 0 stops pushing constants.
+		*/
+		GLACIER_API void setPushConstants(const void* data, uint32_t size);
+
+		/**
+		 * @brief Set the push constants of the draws that follow in the current frame
+		 * @param data A struct laid out like the shaders' push constant block
+		*/
+		template<typename T>
+		void setPushConstants(const T& data)
+		{
+			static_assert(std::is_trivially_copyable<T>::value, "Push constants must be trivially copyable");
+			setPushConstants(&data, static_cast<uint32_t>(sizeof(T)));
+		}
+
+		/**
+		 * @brief Get the counters of the most recently recorded frame
+		 * @return The render statistics
+		*/
+		GLACIER_API const RenderStatistics& getStatistics() const;
 	private:
+		struct DrawCommand
+		{
+			const Pipeline* pipeline;
+			const VertexBuffer* vertexBuffer;
+			const IndexBuffer* indexBuffer;
+			uint32_t count;
+
+			/* Where the draw starts in the buffers, non-zero for meshes of a geometry pool */
+			uint32_t firstIndex;
+			int32_t vertexOffset;
+
+			/* The geometry pool and handle of the mesh, nullptr for other draws. Its range is looked up when the frame is recorded, as the pool may move it before. */
+			const GeometryPool* pool;
+			uint32_t mesh;
+
+			float depth;
+			uint8_t layer;
+
+			/* Range of m_PushConstants pushed before the draw, size 0 if nothing is pushed */
+			uint32_t pushConstantOffset;
+			uint32_t pushConstantSize;
+		};
+
 		Application* m_Application;
 		void* m_Swapchain;
 		void* m_CommandPool;
 		void* m_GraphicsQueue;
 		void* m_PresentationQueue;
-		void* m_RenderPass;
+		void* m_RenderPass; // nullptr when using dynamic rendering
+
+		/* VkFormat of the swapchain images, which pipelines are created against */
+		uint32_t m_ColorFormat;
+
+		/* One depth attachment per swapchain image */
+		uint32_t m_DepthFormat;
+		std::vector<void*> m_DepthImages;
+		std::vector<void*> m_DepthMemory;
+		std::vector<void*> m_DepthImageViews;
+
+		/* Multisampled colour attachments resolved into the swapchain images, empty without MSAA */
+		uint32_t m_Samples;
+		std::vector<void*> m_MultisampledImages;
+		std::vector<void*> m_MultisampledMemory;
+		std::vector<void*> m_MultisampledImageViews;
 		std::vector<void*> m_CommandBuffers;
 		std::vector<void*> m_Framebuffers;
 		std::vector<void*> m_Images;
 		std::vector<void*> m_ImageViews;
-		std::vector<Pipeline*> m_Pipelines;
 
-		Renderer(Application* application);
+		std::optional<DrawCommand> m_BoundPipeline;
+		std::vector<DrawCommand> m_DrawCommands;
+		uint8_t m_Layer;
+
+		/* Push constants of this frame's draws, and the range set by the last setPushConstants */
+		std::vector<char> m_PushConstants;
+		uint32_t m_PushConstantOffset;
+		uint32_t m_PushConstantSize;
+		RenderQueue* m_RenderQueue;
+		RenderStatistics m_Statistics;
+
+		/**
+		 * @brief Create a renderer for the current window size
+		 * @param application The application to render for
+		 * @param previous The renderer being replaced, whose swapchain is retired by the new one. May be nullptr.
+		*/
+		Renderer(Application* application, const Renderer* previous = nullptr);
 		~Renderer();
 
+		/**
+		 * @brief Record the bound pipeline and this frame's draws into the command buffer of a frame in flight
+		 * @param frameIndex Index of the frame in flight, selects the command buffer
+		 * @param imageIndex Index of the acquired swapchain image to render to
+		*/
+		void recordCommandBuffer(uint32_t frameIndex, uint32_t imageIndex);
+
 		// Delete copy
 		inline Renderer(Renderer&) = delete;
 		Renderer& operator=(Renderer&) = delete;
@@ -49,8 +195,12 @@ namespace glacier
 		Renderer& operator=(Renderer&& other) = delete;
 
 		friend class Application;
+		friend class AssetLoader;
 		friend class Pipeline;
 		friend class VertexBuffer;
 		friend class IndexBuffer;
+		friend class GeometryPool;
+		friend class StorageBuffer;
+		friend class Texture;
 	};
 }
\ No newline at end of file
@@ -2,8 +2,14 @@
 
 #include "common.hpp"
 #include "Buffer.hpp"
+#include "VertexBuffer.hpp"
 
+#include <memory>
+#include <string>
 #include <string_view>
+#include <vector>
+
+class AssetWatcher;
 
 namespace glacier
 {
@@ -17,13 +23,129 @@ namespace glacier
 		Vertex, Tesselation, Geometry, Fragment, Compute
 	};
 
+	/**
+	 * @brief Scalar type of a reflected shader value
+	*/
+	enum class ShaderScalarType
+	{
+		Unknown, Bool, Int, UnsignedInt, Float, Double
+	};
+
+	/**
+	 * @brief A stage input declared with layout(location = ...). Matrices and arrays are split into one input per column and element, so each input is fed by a single vertex attribute.
+	*/
+	struct ShaderInput
+	{
+		std::string name;
+		uint32_t location;
+		ShaderScalarType type;
+		uint32_t components;
+	};
+
+	/**
+	 * @brief Types of descriptors. The order matches VkDescriptorType.
+	*/
+	enum class DescriptorType
+	{
+		Sampler, CombinedImageSampler, SampledImage, StorageImage, UniformTexelBuffer, StorageTexelBuffer, UniformBuffer, StorageBuffer
+	};
+
+	/**
+	 * @brief A resource declared with layout(set = ..., binding = ...)
+	*/
+	struct ShaderBinding
+	{
+		std::string name;
+		uint32_t set;
+		uint32_t binding;
+		DescriptorType type;
+
+		/* Number of array elements, 0 for runtime-sized arrays */
+		uint32_t count;
+	};
+
+	/**
+	 * @brief A constant declared with layout(constant_id = ...)
+	*/
+	struct ShaderSpecializationConstant
+	{
+		std::string name;
+		uint32_t id;
+		ShaderScalarType type;
+
+		/* Size of the value in bytes */
+		uint32_t size;
+	};
+
+	/**
+	 * @brief The interface of a shader, read from its SPIR-V
+	*/
+	struct ShaderReflection
+	{
+		ShaderType stage;
+		std::string entryPoint;
+
+		/* Sorted by location, without built-ins */
+		std::vector<ShaderInput> inputs;
+
+		std::vector<ShaderBinding> bindings;
+
+		/* Size of the push constant block in bytes, 0 if there is none */
+		uint32_t pushConstantSize = 0;
+
+		std::vector<ShaderSpecializationConstant> specializationConstants;
+	};
+
+	/**
+	 * @brief A preprocessor definition for GLSL compiled at runtime
+	*/
+	struct ShaderDefine
+	{
+		std::string name;
+		std::string value;
+	};
+
 	class Shader
 	{
 	public:
+		/**
+		 * @brief Load a shader from a SPIR-V file
+		 * @param application The main glacier application
+		 * @param path Path to the SPIR-V file, relative to the base directory
+		*/
 		GLACIER_API Shader(const Application* application, std::string_view path);
+
+		/**
+		 * @brief Load a shader from SPIR-V in memory
+		 * @param application The main glacier application
+		 * @param buffer The SPIR-V code
+		*/
 		GLACIER_API Shader(const Application* application, const Buffer& buffer);
+
+		/**
+		 * @brief Compile a shader from a GLSL file. The SPIR-V is cached on disk and reused until the source, its includes or the defines change.
+		 * With ApplicationInfo::shaderHotReload, edits are recompiled in the background and the pipelines using this shader are rebuilt.
+		 * @param application The main glacier application
+		 * @param path Path to the GLSL file, relative to the base directory. Quoted includes are searched next to the including file, then in this file's directory.
+		 * @param type The stage to compile for
+		 * @param defines Preprocessor definitions
+		*/
+		GLACIER_API Shader(const Application* application, std::string_view path, ShaderType type, const std::vector<ShaderDefine>& defines = {});
+
 		GLACIER_API ~Shader();
 
+		/**
+		 * @brief Get the interface of this shader, reflected once when it was loaded
+		*/
+		GLACIER_API const ShaderReflection& getReflection() const;
+
+		/**
+		 * @brief Build a tightly packed vertex layout matching the inputs of this vertex shader
+		 * @return One 32-bit element per input, in location order
+		 * @throw std::runtime_error if this isn't a vertex shader or its input locations aren't contiguous from 0
+		*/
+		GLACIER_API VertexBufferLayout createVertexLayout() const;
+
 		// Delete copy
 		Shader(const Shader&) = delete;
 		Shader& operator=(const Shader&) = delete;
@@ -33,8 +155,28 @@ namespace glacier
 		Shader& operator=(Shader&& other) = delete;
 	private:
 		const Application* m_Application;
-		void* m_ShaderModule;
 
+		/* Shared with pending pipeline compile jobs, so replacing it on reload doesn't pull it from under them */
+		std::shared_ptr<void> m_ShaderModule;
+
+		/* Hash of the SPIR-V code, so pipelines built from identical code can be shared */
+		uint64_t m_Hash;
+
+		ShaderReflection m_Reflection;
+
+		/* Where a GLSL shader is recompiled from. The path is empty for shaders loaded from SPIR-V. */
+		std::string m_SourcePath;
+		ShaderType m_SourceType;
+		std::vector<ShaderDefine> m_Defines;
+
+		/**
+		 * @brief Replace the module and reflection with new code. Nothing changes if the code is invalid.
+		 * @param buffer The SPIR-V code
+		 * @param name Named in error messages
+		*/
+		void load(const Buffer& buffer, std::string_view name);
+
+		friend class ::AssetWatcher;
 		friend class Application;
 		friend class Renderer;
 		friend class Pipeline;
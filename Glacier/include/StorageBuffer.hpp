@@ -0,0 +1,52 @@
+#pragma once
+
+#include "common.hpp"
+
+namespace glacier
+{
+	class Application;
+
+	/**
+	 * @brief Read-only data in device-local memory that shaders index into through the bindless storage buffer array
+	*/
+	class StorageBuffer
+	{
+	public:
+		/**
+		 * @brief Upload data into a new storage buffer
+		 * @param application The application
+		 * @param data The data to upload
+		 * @param size Size of the data in bytes
+		*/
+		GLACIER_API StorageBuffer(const Application* application, const void* data, uint64_t size);
+		GLACIER_API ~StorageBuffer();
+
+		// Delete copy
+		StorageBuffer(const StorageBuffer&) = delete;
+		StorageBuffer& operator=(const StorageBuffer&) = delete;
+
+		// Delete move
+		StorageBuffer(StorageBuffer&& other) = delete;
+		StorageBuffer& operator=(StorageBuffer&& other) = delete;
+
+		/**
+		 * @brief Get the index of this buffer in the bindless storage buffer array at set 0, binding 1
+		 * @return The index, or UINT32_MAX if bindless resources are disabled
+		*/
+		GLACIER_API uint32_t getIndex() const;
+
+		GLACIER_API uint64_t getSize() const;
+	private:
+		const Application* m_Application;
+
+		void* m_Handle;
+		void* m_Memory;
+		uint64_t m_Size;
+
+		/* Slot in the bindless storage buffer array, UINT32_MAX if there is none */
+		uint32_t m_Index;
+
+		/* Timeline value of the upload */
+		uint64_t m_LastUsage;
+	};
+}
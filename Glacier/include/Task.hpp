@@ -0,0 +1,214 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace glacier
+{
+	/**
+	 * @brief The part of a task's promise that doesn't depend on its result
+	*/
+	class TaskPromiseBase
+	{
+	public:
+		/* Tasks start running as soon as they are called */
+		std::suspend_never initial_suspend() noexcept
+		{
+			return {};
+		}
+
+		/**
+		 * @brief Resumes the coroutine awaiting the task once it has finished, if there is one
+		*/
+		struct FinalAwaiter
+		{
+			bool await_ready() const noexcept
+			{
+				return false;
+			}
+
+			template<typename Promise>
+			std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> coroutine) const noexcept
+			{
+				std::coroutine_handle<> continuation = coroutine.promise().m_Continuation;
+				return continuation ? continuation : std::noop_coroutine();
+			}
+
+			void await_resume() const noexcept
+			{
+			}
+		};
+
+		// The task destroys the coroutine, so it stays suspended at the end until then
+		FinalAwaiter final_suspend() noexcept
+		{
+			return {};
+		}
+
+		void unhandled_exception()
+		{
+			m_Error = std::current_exception();
+		}
+
+		/**
+		 * @brief Get a token that expires when the coroutine is destroyed, so whatever resumes it later can check that it still exists
+		*/
+		std::weak_ptr<const void> getAliveToken() const
+		{
+			return m_Alive;
+		}
+	protected:
+		/* The coroutine awaiting the task */
+		std::coroutine_handle<> m_Continuation;
+
+		std::exception_ptr m_Error;
+
+		std::shared_ptr<const void> m_Alive = std::make_shared<char>(0);
+
+		template<typename T>
+		friend class Task;
+	};
+
+	template<typename T>
+	class TaskPromise : public TaskPromiseBase
+	{
+	public:
+		template<typename U>
+		void return_value(U&& value)
+		{
+			m_Value.emplace(std::forward<U>(value));
+		}
+
+		/**
+		 * @brief Get the value the coroutine returned, or rethrow what it threw
+		*/
+		T& getResult()
+		{
+			if (m_Error != nullptr)
+				std::rethrow_exception(m_Error);
+
+			return *m_Value;
+		}
+	private:
+		std::optional<T> m_Value;
+	};
+
+	template<>
+	class TaskPromise<void> : public TaskPromiseBase
+	{
+	public:
+		void return_void()
+		{
+		}
+
+		void getResult()
+		{
+			if (m_Error != nullptr)
+				std::rethrow_exception(m_Error);
+		}
+	};
+
+	/**
+	 * @brief A coroutine that runs on the main thread. It starts as soon as it is called and runs until it first waits.
+	 *
+	 * A task can co_await the AssetHandle of a load, which resumes it from AssetLoader::update once the asset has loaded, and other tasks, which resume it once they have finished.
+	 * Destroying the task destroys the coroutine, also while it waits, so keep the task until isDone().
+	 * @tparam T The type of the value it co_returns
+	*/
+	template<typename T = void>
+	class Task
+	{
+	public:
+		struct promise_type : public TaskPromise<T>
+		{
+			Task get_return_object()
+			{
+				return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+			}
+		};
+
+		/**
+		 * @brief Create an empty task, which refers to no coroutine
+		*/
+		Task() = default;
+
+		~Task()
+		{
+			if (m_Coroutine)
+				m_Coroutine.destroy();
+		}
+
+		// Delete copy
+		Task(const Task&) = delete;
+		Task& operator=(const Task&) = delete;
+
+		Task(Task&& other) noexcept
+			: m_Coroutine(std::exchange(other.m_Coroutine, nullptr))
+		{
+		}
+
+		Task& operator=(Task&& other) noexcept
+		{
+			if (this != &other)
+			{
+				if (m_Coroutine)
+					m_Coroutine.destroy();
+
+				m_Coroutine = std::exchange(other.m_Coroutine, nullptr);
+			}
+
+			return *this;
+		}
+
+		bool isValid() const
+		{
+			return static_cast<bool>(m_Coroutine);
+		}
+
+		/**
+		 * @brief Check if the coroutine has returned or thrown
+		*/
+		bool isDone() const
+		{
+			return m_Coroutine && m_Coroutine.done();
+		}
+
+		/**
+		 * @brief Get the value the coroutine returned, or rethrow what it threw. The task must be done.
+		*/
+		decltype(auto) get()
+		{
+			return m_Coroutine.promise().getResult();
+		}
+
+		bool await_ready() const noexcept
+		{
+			return m_Coroutine.done();
+		}
+
+		void await_suspend(std::coroutine_handle<> coroutine) noexcept
+		{
+			m_Coroutine.promise().m_Continuation = coroutine;
+		}
+
+		// Awaiting moves the value out of the task
+		T await_resume()
+		{
+			if constexpr (std::is_void_v<T>)
+				m_Coroutine.promise().getResult();
+			else
+				return std::move(m_Coroutine.promise().getResult());
+		}
+	private:
+		std::coroutine_handle<promise_type> m_Coroutine;
+
+		explicit Task(std::coroutine_handle<promise_type> coroutine)
+			: m_Coroutine(coroutine)
+		{
+		}
+	};
+}
@@ -0,0 +1,175 @@
+#pragma once
+
+#include "common.hpp"
+#include "FileSystem.hpp"
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class TextureUploader;
+struct TextureSource;
+
+namespace glacier
+{
+	class Application;
+
+	enum class TextureFilter
+	{
+		Nearest, Linear
+	};
+
+	enum class TextureWrap
+	{
+		Repeat, MirroredRepeat, ClampToEdge
+	};
+
+	/**
+	 * @brief How a texture is created and sampled
+	*/
+	struct TextureInfo
+	{
+		/* Filter used for magnification, minification and between mip levels */
+		TextureFilter filter = TextureFilter::Linear;
+
+		TextureWrap wrap = TextureWrap::Repeat;
+
+		/**
+		 * @brief Maximum anisotropic filtering. Clamped to what the device supports, 1 disables it.
+		*/
+		float anisotropy = 16.0f;
+
+		/**
+		 * @brief Generate the full mip chain on the GPU when only the base level is given. Block-compressed formats can't be blitted, so they need their levels stored in the file.
+		*/
+		bool generateMips = true;
+
+		/**
+		 * @brief Whether raw pixels are sRGB encoded. KTX2 files carry their own colour space in their format.
+		*/
+		bool srgb = true;
+	};
+
+	/**
+	 * @brief A 2D image in device-local memory with a sampler
+	*/
+	class Texture
+	{
+	public:
+		/**
+		 * @brief Load a KTX2 texture through the file system. Its contents are copied straight into the staging buffer. Block-compressed formats the device can't sample are decoded to RGBA8 on the CPU, except for BC6H.
+		 * With ApplicationInfo::assetHotReload, the texture is reloaded when the file changes.
+		 * @param application The application
+		 * @param path Path to the .ktx2 file, relative to the file base directory
+		 * @param info How to create and sample the texture
+		*/
+		GLACIER_API Texture(const Application* application, std::string_view path, const TextureInfo& info = TextureInfo());
+
+		/**
+		 * @brief Create a texture from 8-bit RGBA pixels
+		 * @param application The application
+		 * @param pixels width * height * 4 bytes, row by row
+		 * @param width Width in pixels
+		 * @param height Height in pixels
+		 * @param info How to create and sample the texture
+		*/
+		GLACIER_API Texture(const Application* application, const void* pixels, uint32_t width, uint32_t height, const TextureInfo& info = TextureInfo());
+
+		GLACIER_API ~Texture();
+
+		// Delete copy
+		Texture(const Texture&) = delete;
+		Texture& operator=(const Texture&) = delete;
+
+		// Delete move
+		Texture(Texture&& other) = delete;
+		Texture& operator=(Texture&& other) = delete;
+
+		/**
+		 * @brief Load several KTX2 textures with a single staging buffer and a single submission
+		 * @param application The application
+		 * @param paths Paths to the .ktx2 files, relative to the file base directory
+		 * @param info How to create and sample the textures
+		 * @return The textures, in the order of their paths
+		*/
+		GLACIER_API static std::vector<std::unique_ptr<Texture>> loadBatch(const Application* application, const std::vector<std::string>& paths, const TextureInfo& info = TextureInfo());
+
+		GLACIER_API uint32_t getWidth() const;
+		GLACIER_API uint32_t getHeight() const;
+		GLACIER_API uint32_t getMipLevels() const;
+
+		/**
+		 * @brief Get the index of this texture in the bindless texture array at set 0, binding 0. It changes when the texture is reloaded, so pass it to draws every frame.
+		 * @return The index, or UINT32_MAX if bindless resources are disabled
+		*/
+		GLACIER_API uint32_t getIndex() const;
+	private:
+		const Application* m_Application;
+
+		void* m_Image;
+		void* m_Memory;
+		void* m_ImageView;
+
+		/* Owned by the application's sampler cache */
+		void* m_Sampler;
+
+		/* Slot in the bindless texture array, UINT32_MAX if there is none */
+		uint32_t m_Index;
+
+		/* VkFormat of the image, which differs from the file's if it was decoded on the CPU */
+		uint32_t m_Format;
+
+		uint32_t m_Width;
+		uint32_t m_Height;
+		uint32_t m_MipLevels;
+
+		/* Timeline value of the last submission that used this texture */
+		mutable uint64_t m_LastUsage;
+
+		Texture(const Application* application);
+
+		/**
+		 * @brief Create the image from a KTX2 file and queue its upload
+		*/
+		void load(std::string_view path, const TextureInfo& info, TextureUploader& uploader);
+
+		/**
+		 * @brief Parse a KTX2 file, and decode it on the CPU if the device can't sample its format. Creates no Vulkan objects, so it may run on any thread.
+		 * @param path Path of the file, for error messages
+		 * @param file The contents of the file, kept alive by the result if its levels point into them
+		*/
+		static TextureSource decode(const Application* application, std::string_view path, const FileContents& file);
+
+		/**
+		 * @brief Create the image for a decoded file and queue its upload
+		*/
+		void upload(TextureSource source, const TextureInfo& info, TextureUploader& uploader);
+
+		/**
+		 * @brief Reload the texture when its file changes, if ApplicationInfo::assetHotReload is set and the file isn't in an archive
+		*/
+		void watch(std::string_view path, const TextureInfo& info);
+
+		/**
+		 * @brief Replace the image with a decoded file and wait for its upload. The old image is destroyed once the GPU is done with it.
+		*/
+		void reload(TextureSource source, const TextureInfo& info);
+
+		/**
+		 * @brief Create the image, its memory and view, get its sampler and add it to the bindless texture array
+		 * @param levels Number of levels the caller provides data for. The image gets the full chain if a single level is provided, mips are requested and the format can be blitted.
+		*/
+		void create(uint32_t format, uint32_t width, uint32_t height, uint32_t levels, const TextureInfo& info);
+
+		/**
+		 * @brief Submit the uploads of every texture created with an uploader and wait for them
+		 * @return The timeline value signalled by the upload
+		*/
+		static uint64_t submit(const Application* application, TextureUploader& uploader);
+
+		friend class Application;
+		friend class AssetLoader;
+		friend class Renderer;
+	};
+}
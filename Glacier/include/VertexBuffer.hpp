@@ -2,36 +2,408 @@
 
 #include "common.hpp"
 
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
 #include <vector>
 
+#include <glm/fwd.hpp>
+
 struct VkVertexInputBindingDescription;
 struct VkVertexInputAttributeDescription;
+class TextureUploader;
 
 namespace glacier
 {
 	class Application;
 
+	/**
+	 * @brief The type of the components of a vertex attribute as stored in the buffer.
+	 *
+	 * Float, Int, UnsignedInt, Byte and UnsignedByte are read as they are, Int and Byte as int and the unsigned ones as uint in the shader.
+	 * The other elements are read as float: Half is a 16-bit float, the Normalized ones map their integer range onto [0, 1] or [-1, 1].
+	 * The Packed1010102 elements hold three 10-bit components and a 2-bit one in 32 bits, so they take 3 or 4 components.
+	*/
 	enum class VertexBufferElement
 	{
-		Float, Int, UnsignedInt, Byte, UnsignedByte
+		Float, Int, UnsignedInt, Byte, UnsignedByte,
+		Half, ByteNormalized, UnsignedByteNormalized, ShortNormalized, UnsignedShortNormalized,
+		Packed1010102Normalized, UnsignedPacked1010102Normalized
+	};
+
+	/**
+	 * @brief Get the size of one component of an element. Packed elements report the size of the whole attribute.
+	 * @return The size in bytes
+	*/
+	constexpr uint32_t getElementSize(VertexBufferElement element)
+	{
+		switch (element)
+		{
+		case VertexBufferElement::Byte:
+		case VertexBufferElement::UnsignedByte:
+		case VertexBufferElement::ByteNormalized:
+		case VertexBufferElement::UnsignedByteNormalized:
+			return 1;
+		case VertexBufferElement::Half:
+		case VertexBufferElement::ShortNormalized:
+		case VertexBufferElement::UnsignedShortNormalized:
+			return 2;
+		default:
+			return 4;
+		}
+	}
+
+	/**
+	 * @brief Whether all components of an element share a single 32-bit value
+	*/
+	constexpr bool isPackedElement(VertexBufferElement element)
+	{
+		return element == VertexBufferElement::Packed1010102Normalized || element == VertexBufferElement::UnsignedPacked1010102Normalized;
+	}
+
+	/**
+	 * @brief Get the size of an attribute
+	 * @param element The type of the components
+	 * @param count The number of components
+	 * @return The size in bytes
+	*/
+	constexpr uint32_t getAttributeSize(VertexBufferElement element, uint32_t count)
+	{
+		return isPackedElement(element) ? getElementSize(element) : getElementSize(element) * count;
+	}
+
+	/**
+	 * @brief Get the format an attribute is fetched with. The values are VkFormats, checked against the Vulkan headers when Glacier is built.
+	 * @param element The type of the components
+	 * @param count The number of components, 1 to 4
+	 * @return The VkFormat, or 0 (VK_FORMAT_UNDEFINED) if there is none
+	*/
+	constexpr uint32_t getVertexFormat(VertexBufferElement element, uint32_t count)
+	{
+		// R, RG, RGB and RGBA formats of each element
+		constexpr uint32_t floatFormats[] = { 100, 103, 106, 109 };
+		constexpr uint32_t intFormats[] = { 99, 102, 105, 108 };
+		constexpr uint32_t unsignedIntFormats[] = { 98, 101, 104, 107 };
+		constexpr uint32_t byteFormats[] = { 14, 21, 28, 42 };
+		constexpr uint32_t unsignedByteFormats[] = { 13, 20, 27, 41 };
+		constexpr uint32_t halfFormats[] = { 76, 83, 90, 97 };
+		constexpr uint32_t byteNormalizedFormats[] = { 10, 17, 24, 38 };
+		constexpr uint32_t unsignedByteNormalizedFormats[] = { 9, 16, 23, 37 };
+		constexpr uint32_t shortNormalizedFormats[] = { 71, 78, 85, 92 };
+		constexpr uint32_t unsignedShortNormalizedFormats[] = { 70, 77, 84, 91 };
+
+		if (count == 0 || count > 4)
+			return 0;
+
+		// A 3 component attribute leaves the 2-bit component unused, the shader reads it as 1
+		if (isPackedElement(element) && count < 3)
+			return 0;
+
+		switch (element)
+		{
+		case VertexBufferElement::Float:
+			return floatFormats[count - 1];
+		case VertexBufferElement::Int:
+			return intFormats[count - 1];
+		case VertexBufferElement::UnsignedInt:
+			return unsignedIntFormats[count - 1];
+		case VertexBufferElement::Byte:
+			return byteFormats[count - 1];
+		case VertexBufferElement::UnsignedByte:
+			return unsignedByteFormats[count - 1];
+		case VertexBufferElement::Half:
+			return halfFormats[count - 1];
+		case VertexBufferElement::ByteNormalized:
+			return byteNormalizedFormats[count - 1];
+		case VertexBufferElement::UnsignedByteNormalized:
+			return unsignedByteNormalizedFormats[count - 1];
+		case VertexBufferElement::ShortNormalized:
+			return shortNormalizedFormats[count - 1];
+		case VertexBufferElement::UnsignedShortNormalized:
+			return unsignedShortNormalizedFormats[count - 1];
+		case VertexBufferElement::Packed1010102Normalized:
+			return 65;
+		case VertexBufferElement::UnsignedPacked1010102Normalized:
+			return 64;
+		default:
+			return 0;
+		}
+	}
+
+	/**
+	 * @brief A vertex attribute with everything the pipeline needs precomputed
+	*/
+	struct VertexAttribute
+	{
+		VertexBufferElement element;
+		uint32_t count;
+
+		/* Offset from the start of the vertex in bytes */
+		uint32_t offset;
+
+		/* Size of all components in bytes */
+		uint32_t size;
+
+		/* VkFormat the attribute is fetched with */
+		uint32_t format;
+	};
+
+	/**
+	 * @brief N 16-bit floats, stored as their bits. Fill them with packVertexAttribute.
+	*/
+	template<size_t N>
+	struct HalfVector
+	{
+		uint16_t components[N];
+	};
+
+	/**
+	 * @brief N normalized integers, read as floats in [0, 1] if T is unsigned and [-1, 1] if it is signed
+	 * @tparam T int8_t, uint8_t, int16_t or uint16_t
+	*/
+	template<typename T, size_t N>
+	struct NormalizedVector
+	{
+		T components[N];
+	};
+
+	/**
+	 * @brief Four normalized components in 10, 10, 10 and 2 bits, x in the lowest bits
+	 * @tparam T int32_t for [-1, 1] or uint32_t for [0, 1]
+	*/
+	template<typename T>
+	struct Packed1010102
+	{
+		uint32_t bits;
+	};
+
+	/**
+	 * @brief Maps a C++ type to the vertex buffer element and component count it is uploaded as. Specialized for the scalar types, glm vectors of them and the quantized vertex types above.
+	*/
+	template<typename T>
+	struct VertexAttributeType;
+
+	template<>
+	struct VertexAttributeType<float>
+	{
+		static constexpr VertexBufferElement element = VertexBufferElement::Float;
+		static constexpr uint32_t count = 1;
+	};
+
+	template<>
+	struct VertexAttributeType<int32_t>
+	{
+		static constexpr VertexBufferElement element = VertexBufferElement::Int;
+		static constexpr uint32_t count = 1;
+	};
+
+	template<>
+	struct VertexAttributeType<uint32_t>
+	{
+		static constexpr VertexBufferElement element = VertexBufferElement::UnsignedInt;
+		static constexpr uint32_t count = 1;
+	};
+
+	template<>
+	struct VertexAttributeType<int8_t>
+	{
+		static constexpr VertexBufferElement element = VertexBufferElement::Byte;
+		static constexpr uint32_t count = 1;
+	};
+
+	template<>
+	struct VertexAttributeType<uint8_t>
+	{
+		static constexpr VertexBufferElement element = VertexBufferElement::UnsignedByte;
+		static constexpr uint32_t count = 1;
+	};
+
+	template<glm::length_t L, typename T, glm::qualifier Q>
+	struct VertexAttributeType<glm::vec<L, T, Q>>
+	{
+		static constexpr VertexBufferElement element = VertexAttributeType<T>::element;
+		static constexpr uint32_t count = static_cast<uint32_t>(L);
+	};
+
+	template<size_t N>
+	struct VertexAttributeType<HalfVector<N>>
+	{
+		static constexpr VertexBufferElement element = VertexBufferElement::Half;
+		static constexpr uint32_t count = static_cast<uint32_t>(N);
 	};
 
+	template<size_t N>
+	struct VertexAttributeType<NormalizedVector<int8_t, N>>
+	{
+		static constexpr VertexBufferElement element = VertexBufferElement::ByteNormalized;
+		static constexpr uint32_t count = static_cast<uint32_t>(N);
+	};
+
+	template<size_t N>
+	struct VertexAttributeType<NormalizedVector<uint8_t, N>>
+	{
+		static constexpr VertexBufferElement element = VertexBufferElement::UnsignedByteNormalized;
+		static constexpr uint32_t count = static_cast<uint32_t>(N);
+	};
+
+	template<size_t N>
+	struct VertexAttributeType<NormalizedVector<int16_t, N>>
+	{
+		static constexpr VertexBufferElement element = VertexBufferElement::ShortNormalized;
+		static constexpr uint32_t count = static_cast<uint32_t>(N);
+	};
+
+	template<size_t N>
+	struct VertexAttributeType<NormalizedVector<uint16_t, N>>
+	{
+		static constexpr VertexBufferElement element = VertexBufferElement::UnsignedShortNormalized;
+		static constexpr uint32_t count = static_cast<uint32_t>(N);
+	};
+
+	template<>
+	struct VertexAttributeType<Packed1010102<int32_t>>
+	{
+		static constexpr VertexBufferElement element = VertexBufferElement::Packed1010102Normalized;
+		static constexpr uint32_t count = 4;
+	};
+
+	template<>
+	struct VertexAttributeType<Packed1010102<uint32_t>>
+	{
+		static constexpr VertexBufferElement element = VertexBufferElement::UnsignedPacked1010102Normalized;
+		static constexpr uint32_t count = 4;
+	};
+
+	/**
+	 * @brief Describe a member of a vertex struct. Use GLACIER_VERTEX_ATTRIBUTE rather than calling this directly.
+	 * @tparam T The type of the member
+	 * @param offset offsetof the member
+	*/
+	template<typename T>
+	constexpr VertexAttribute makeVertexAttribute(uint32_t offset)
+	{
+		static_assert(sizeof(T) == getAttributeSize(VertexAttributeType<T>::element, VertexAttributeType<T>::count), "Vertex attribute type has padding between its components");
+
+		return VertexAttribute{ VertexAttributeType<T>::element, VertexAttributeType<T>::count, offset, static_cast<uint32_t>(sizeof(T)), getVertexFormat(VertexAttributeType<T>::element, VertexAttributeType<T>::count) };
+	}
+
+	/**
+	 * @brief A vertex layout computed at compile time from the members of a vertex struct
+	 * @tparam Vertex The vertex struct
+	 * @tparam N The number of attributes
+	*/
+	template<typename Vertex, size_t N>
+	struct StaticVertexLayout
+	{
+		static constexpr uint32_t stride = static_cast<uint32_t>(sizeof(Vertex));
+
+		/* In location order */
+		std::array<VertexAttribute, N> attributes;
+	};
+
+	/**
+	 * @brief Build a vertex layout from members of a vertex struct. Declare the result constexpr, then a layout that doesn't match the struct fails to compile.
+	 *
+	 * Every byte of the vertex has to belong to exactly one attribute, so the stride is sizeof(Vertex) with no padding or unused members, and every attribute is aligned to its components.
+	 * @param attributes One GLACIER_VERTEX_ATTRIBUTE per member, in location order
+	 * @return The layout
+	*/
+	template<typename Vertex, typename... Attributes>
+	constexpr StaticVertexLayout<Vertex, sizeof...(Attributes)> makeVertexLayout(Attributes... attributes)
+	{
+		static_assert(sizeof...(Attributes) > 0, "A vertex layout needs at least one attribute");
+		static_assert(std::is_standard_layout<Vertex>::value, "Vertex structs must be standard layout, so offsetof is valid");
+		static_assert(std::is_trivially_copyable<Vertex>::value, "Vertex structs must be trivially copyable, they are uploaded with memcpy");
+
+		StaticVertexLayout<Vertex, sizeof...(Attributes)> layout = { { { attributes... } } };
+
+		// Throwing makes the layout not a constant expression, which fails constexpr declarations at compile time
+		uint32_t size = 0;
+		for (size_t i = 0; i < layout.attributes.size(); i++)
+		{
+			const VertexAttribute& attribute = layout.attributes[i];
+
+			if (attribute.offset % getElementSize(attribute.element) != 0)
+				throw std::logic_error("Vertex attribute is not aligned to its components");
+
+			if (attribute.offset + attribute.size > sizeof(Vertex))
+				throw std::logic_error("Vertex attribute lies outside of the vertex");
+
+			for (size_t j = 0; j < i; j++)
+			{
+				const VertexAttribute& other = layout.attributes[j];
+				if (attribute.offset < other.offset + other.size && other.offset < attribute.offset + attribute.size)
+					throw std::logic_error("Vertex attributes overlap");
+			}
+
+			size += attribute.size;
+		}
+
+		if (size != sizeof(Vertex))
+			throw std::logic_error("Vertex struct has padding or members without an attribute");
+
+		return layout;
+	}
+
 	class VertexBufferLayout
 	{
 	public:
-		GLACIER_API VertexBufferLayout() {}
+		GLACIER_API VertexBufferLayout() : m_Stride(0) {}
 		GLACIER_API ~VertexBufferLayout() {}
 
+		/**
+		 * @brief Use a layout computed at compile time from a vertex struct
+		*/
+		template<typename Vertex, size_t N>
+		VertexBufferLayout(const StaticVertexLayout<Vertex, N>& layout)
+			: m_Attributes(layout.attributes.begin(), layout.attributes.end()), m_Stride(layout.stride)
+		{
+		}
+
+		/**
+		 * @brief Append an attribute right after the previous one
+		 * @param elementType The type of the components
+		 * @param count The number of components, 1 to 4, or 3 to 4 for packed elements
+		*/
 		GLACIER_API void push(VertexBufferElement elementType, uint32_t count);
-	private:
-		std::vector<std::pair<VertexBufferElement, uint32_t>> m_Elements;
 
-		VkVertexInputBindingDescription getBindingDescription() const;
-		std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions() const;
+		/**
+		 * @brief Get the distance between consecutive vertices
+		 * @return The stride in bytes
+		*/
+		GLACIER_API uint32_t getStride() const;
+
+		/**
+		 * @brief Get the attributes, in location order
+		*/
+		GLACIER_API const std::vector<VertexAttribute>& getAttributes() const;
+
+		/**
+		 * @brief Generate the Vulkan binding description of this layout
+		 * @return The binding description for binding 0
+		*/
+		GLACIER_API VkVertexInputBindingDescription getBindingDescription() const;
+
+		/**
+		 * @brief Generate the Vulkan attribute descriptions of this layout. Attribute locations are assigned in push order.
+		 * @return One attribute description per pushed element
+		*/
+		GLACIER_API std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions() const;
+	private:
+		/* Offsets, sizes and formats are computed once when an attribute is added */
+		std::vector<VertexAttribute> m_Attributes;
+		uint32_t m_Stride;
 
 		friend class Application;
 		friend class Renderer;
 		friend class Pipeline;
+		friend class VertexBuffer;
+		friend class Mesh;
+		friend class GeometryPool;
 	};
 
 	class VertexBuffer
@@ -48,6 +420,25 @@ namespace glacier
 		VertexBuffer(VertexBuffer&& other) = delete;
 		VertexBuffer& operator=(VertexBuffer&& other) = delete;
 	private:
+		/**
+		 * @brief Create the buffer and let a callback fill the staging memory, so vertices can be decoded straight into it
+		 * @param size Size of the vertices in bytes
+		 * @param write Receives the mapped vertices and, if the depth prepass is enabled, the mapped tightly packed positions, else nullptr. The memory is uncached, only write to it.
+		*/
+		VertexBuffer(const Application* application, uint64_t size, const VertexBufferLayout& layout, const std::function<void(void* vertices, void* positions)>& write);
+
+		/**
+		 * @brief Create the buffer and queue the copy of the vertices on an uploader rather than waiting for it
+		 * @param vertices Kept alive until the upload is submitted
+		 * @param uploader Must be submitted with the application's current timeline value, which the caller takes before creating the buffer
+		*/
+		VertexBuffer(const Application* application, std::shared_ptr<const std::vector<uint8_t>> vertices, const VertexBufferLayout& layout, TextureUploader& uploader);
+
+		/**
+		 * @brief Create a buffer without memory, whose handles a GeometryPool sets
+		*/
+		VertexBuffer(const Application* application, const VertexBufferLayout& layout);
+
 		VertexBufferLayout m_Layout;
 
 		const Application* m_Application;
@@ -55,8 +446,27 @@ namespace glacier
 		void* m_Handle;
 		void* m_Memory;
 
+		/* Tightly packed copy of the first attribute, read by the depth prepass. nullptr if the prepass is disabled. */
+		void* m_PositionHandle;
+		void* m_PositionMemory;
+
+		/* Identifies the buffer in render queue sort keys */
+		uint32_t m_Id;
+
+		/* Timeline value of the last submission that used this buffer */
+		mutable uint64_t m_LastUsage;
+
 		friend class Application;
 		friend class Renderer;
 		friend class Pipeline;
+		friend class Mesh;
+		friend class GeometryPool;
 	};
 }
+
+/**
+ * @brief Describe a member of a vertex struct for glacier::makeVertexLayout
+ * @param Vertex The vertex struct
+ * @param member The name of the member
+*/
+#define GLACIER_VERTEX_ATTRIBUTE(Vertex, member) ::glacier::makeVertexAttribute<decltype(Vertex::member)>(static_cast<uint32_t>(offsetof(Vertex, member)))
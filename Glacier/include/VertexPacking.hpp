@@ -0,0 +1,43 @@
+#pragma once
+
+#include "common.hpp"
+#include "VertexBuffer.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace glacier
+{
+	/**
+	 * @brief Instruction sets the vertex packing kernels can use
+	*/
+	enum class SimdLevel
+	{
+		Scalar, SSE2, AVX2, NEON
+	};
+
+	/**
+	 * @brief Get the instruction set the vertex packing kernels currently use. Defaults to the best one the CPU supports, AVX2 also requires F16C.
+	*/
+	GLACIER_API SimdLevel getVertexPackingSimdLevel();
+
+	/**
+	 * @brief Make the vertex packing kernels use an instruction set, to compare them. Every level gives bit-identical results.
+	 * @param level Scalar, or a level the CPU supports. AVX2 machines also support SSE2.
+	*/
+	GLACIER_API void setVertexPackingSimdLevel(SimdLevel level);
+
+	/**
+	 * @brief Convert a stream of floats into a vertex attribute, usually while loading a mesh.
+	 *
+	 * Normalized elements clamp to [0, 1] or [-1, 1] and round to the nearest value, Half rounds to the nearest 16-bit float.
+	 * Packed1010102 elements with 3 components set the 2-bit component to 1.
+	 * @param src count * components floats
+	 * @param components The number of components per vertex
+	 * @param count The number of vertices
+	 * @param element The element to convert to. Float copies, the integer elements aren't converted from floats and throw.
+	 * @param dst Where the attribute of the first vertex goes
+	 * @param dstStride The distance between the attributes of consecutive vertices in bytes, such as the stride of an interleaved layout. 0 packs them tightly.
+	*/
+	GLACIER_API void packVertexAttribute(const float* src, uint32_t components, size_t count, VertexBufferElement element, void* dst, size_t dstStride = 0);
+}
@@ -21,6 +21,11 @@ namespace glacier
 		unsigned int width;
 		unsigned int height;
 		bool resizable;
+
+		/**
+		 * If true, no native window is created and rendering targets an offscreen Vulkan surface (VK_EXT_headless_surface) of the requested size
+		 */
+		bool headless = false;
 	};
 
 	class Window
@@ -62,8 +67,28 @@ namespace glacier
 		 */
 		GLACIER_API glm::uvec2 getFramebufferSize() const;
 
+		/**
+		 * Get if the window is headless
+		 * @return True if the window has no native window, otherwise false
+		 */
+		GLACIER_API bool isHeadless() const;
+
+		/**
+		 * Process pending window events. Does nothing if the window is headless.
+		 */
+		GLACIER_API void pollEvents();
+
+		/**
+		 * Wait until window events are available and process them. Does nothing if the window is headless.
+		 */
+		GLACIER_API void waitEvents();
+
 		friend class Application;
 	private:
 		void* m_Handle;
+
+		bool m_Headless;
+		bool m_Open;
+		glm::uvec2 m_HeadlessSize;
 	};
 }
\ No newline at end of file
@@ -1,10 +1,19 @@
 #pragma once
 
 #include "Application.hpp"
+#include "AssetLoader.hpp"
 #include "Buffer.hpp"
 #include "File.hpp"
+#include "FileSystem.hpp"
+#include "GeometryPool.hpp"
+#include "Mesh.hpp"
+#include "MeshImporter.hpp"
 #include "Pipeline.hpp"
 #include "Shader.hpp"
+#include "StorageBuffer.hpp"
+#include "Task.hpp"
+#include "Texture.hpp"
 #include "VertexBuffer.hpp"
+#include "VertexPacking.hpp"
 #include "Window.hpp"
 #include "Renderer.hpp"
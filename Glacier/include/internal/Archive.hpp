@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Where a file is inside a .gpak archive. Files are stored uncompressed, so they can be used straight from a mapping of the archive.
+*/
+struct ArchiveEntry
+{
+	/* Offset from the start of the archive, a multiple of 16 */
+	uint64_t offset;
+	uint64_t size;
+};
+
+/**
+ * @brief Read the index of a .gpak archive
+ * @param data The contents of the archive
+ * @param size Size of the archive in bytes
+ * @return Every file, by its path inside the archive
+ * @throw std::runtime_error if the archive is invalid or truncated
+*/
+std::unordered_map<std::string, ArchiveEntry> parseArchive(const void* data, size_t size);
+
+/**
+ * @brief Write a .gpak archive of every file under a directory
+ * @param directory The directory. Paths inside the archive are relative to it and separated by '/'.
+ * @param archive Path of the archive to write
+ * @return Number of files written
+ * @throw std::runtime_error if a file can't be read or the archive can't be written
+*/
+size_t writeArchive(const std::string& directory, const std::string& archive);
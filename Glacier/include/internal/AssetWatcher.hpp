@@ -0,0 +1,135 @@
+#pragma once
+
+#include "internal/FileWatcher.hpp"
+#include "internal/ShaderCompiler.hpp"
+#include "internal/ThreadPool.hpp"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace glacier
+{
+	class Pipeline;
+	class Shader;
+}
+
+/**
+ * @brief Rebuilds shaders, textures and meshes whose files changed on worker threads, and swaps them in at frame boundaries.
+ *
+ * Every asset lists the files it was built from, so a change rebuilds only the assets that depend on the file.
+ * The watcher is only used from the main thread.
+*/
+class AssetWatcher
+{
+public:
+	/**
+	 * @brief Rebuilds an asset from its files. Runs on a worker and must not touch the asset.
+	 * @return The function that swaps the result into the asset between frames. It may throw, which keeps the old asset.
+	*/
+	typedef std::function<std::function<void()>()> Rebuild;
+
+	/**
+	 * @param compiler Compiles the changed shaders
+	 * @param threadPool Runs the rebuilds
+	*/
+	AssetWatcher(const ShaderCompiler* compiler, ThreadPool* threadPool);
+
+	/**
+	 * @brief Cancels rebuilds that haven't started. Must be destroyed before the thread pool.
+	*/
+	~AssetWatcher();
+
+	// Delete copy
+	AssetWatcher(const AssetWatcher&) = delete;
+	AssetWatcher& operator=(const AssetWatcher&) = delete;
+
+	/**
+	 * @brief Start watching an asset, or replace how it is watched
+	 * @param asset Identifies the asset
+	 * @param name Named in the log
+	 * @param files Paths on disk of the files it is built from
+	 * @param rebuild Rebuilds it after one of the files changed
+	*/
+	void watch(const void* asset, std::string_view name, const std::vector<std::string>& files, Rebuild rebuild);
+
+	/**
+	 * @brief Stop watching an asset. A rebuild that finishes afterwards is dropped.
+	*/
+	void unwatch(const void* asset);
+
+	/**
+	 * @brief Start watching a shader compiled from GLSL
+	 * @param shader The shader
+	 * @param dependencies Its source file and every file it includes
+	*/
+	void watchShader(glacier::Shader* shader, const std::vector<std::string>& dependencies);
+
+	/**
+	 * @brief Start rebuilding a pipeline when one of its shaders is reloaded
+	*/
+	void track(glacier::Pipeline* pipeline);
+
+	void untrack(glacier::Pipeline* pipeline);
+
+	/**
+	 * @brief Swap in assets and pipelines that finished rebuilding, and start rebuilding the assets whose files changed. Call between frames.
+	*/
+	void update();
+private:
+	struct WatchedAsset
+	{
+		std::string name;
+
+		/* Absolute paths of the files it is built from */
+		std::vector<std::string> files;
+
+		Rebuild rebuild;
+
+		/* The running rebuild, and where it puts the function that swaps its result in */
+		std::shared_ptr<ThreadPool::Job> job;
+		std::shared_ptr<std::function<void()>> swap;
+
+		/* A file changed while the asset was rebuilding, so it is rebuilt again once it finishes */
+		bool changed = false;
+	};
+
+	const ShaderCompiler* m_Compiler;
+	ThreadPool* m_ThreadPool;
+
+	FileWatcher m_FileWatcher;
+
+	std::unordered_map<const void*, WatchedAsset> m_Assets;
+
+	/* The assets built from each watched file */
+	std::unordered_map<std::string, std::unordered_set<const void*>> m_Dependents;
+
+	std::unordered_set<glacier::Pipeline*> m_Pipelines;
+
+	/* Pipelines rebuilding in the background, swapped in once they are ready */
+	std::unordered_set<glacier::Pipeline*> m_Rebuilding;
+
+	/**
+	 * @brief Replace the files an asset depends on and watch the new ones
+	*/
+	void setFiles(const void* asset, WatchedAsset& watched, const std::vector<std::string>& files);
+
+	/**
+	 * @brief Queue the rebuild of an asset
+	*/
+	void start(WatchedAsset& watched);
+
+	/**
+	 * @brief Swap in a finished rebuild, or log why it failed
+	*/
+	void finish(const void* asset);
+
+	/**
+	 * @brief Start rebuilding the pipelines using a shader that was reloaded
+	*/
+	void rebuildPipelines(glacier::Shader* shader);
+};
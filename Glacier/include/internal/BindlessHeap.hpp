@@ -0,0 +1,110 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief One large descriptor set holding every texture and storage buffer, indexed by shaders instead of bound per draw.
+ *
+ * The set is bound once per command buffer at set 0. Slots are written while the set is in use, which descriptor indexing allows for slots no pending submission reads.
+*/
+class BindlessHeap
+{
+public:
+	static constexpr uint32_t SET = 0;
+
+	/* Array of combined image samplers */
+	static constexpr uint32_t TEXTURE_BINDING = 0;
+
+	/* Array of storage buffers */
+	static constexpr uint32_t BUFFER_BINDING = 1;
+
+	/* Size of the push constant range every bindless pipeline layout shares, the minimum every device supports */
+	static constexpr uint32_t PUSH_CONSTANT_SIZE = 128;
+
+	/**
+	 * @brief Create the descriptor set and the pipeline layout every bindless pipeline is compatible with
+	 * @param device The device, created with the descriptor indexing features
+	 * @param physicalDevice The physical device, whose limits cap the array sizes
+	 * @param timeline The timeline semaphore that decides when released slots can be reused
+	*/
+	BindlessHeap(VkDevice device, VkPhysicalDevice physicalDevice, VkSemaphore timeline);
+
+	/**
+	 * @brief Destroys the set and the layouts. The device must be idle.
+	*/
+	~BindlessHeap();
+
+	// Delete copy
+	BindlessHeap(const BindlessHeap&) = delete;
+	BindlessHeap& operator=(const BindlessHeap&) = delete;
+
+	/**
+	 * @brief Write a texture into a free slot
+	 * @return The index of the texture in the texture array
+	*/
+	uint32_t addTexture(VkImageView imageView, VkSampler sampler);
+
+	/**
+	 * @brief Write a storage buffer into a free slot
+	 * @return The index of the buffer in the buffer array
+	*/
+	uint32_t addBuffer(VkBuffer buffer, VkDeviceSize size);
+
+	/**
+	 * @brief Give a slot back. It is reused once the GPU has passed its last usage.
+	 * @param binding TEXTURE_BINDING or BUFFER_BINDING
+	 * @param index The index returned when the slot was added
+	 * @param lastUsage The timeline value of the last submission that may have read the slot
+	*/
+	void release(uint32_t binding, uint32_t index, uint64_t lastUsage);
+
+	/**
+	 * @brief Make released slots whose last usage has completed available again
+	*/
+	void collect();
+
+	VkDescriptorSetLayout getSetLayout() const;
+	VkPipelineLayout getPipelineLayout() const;
+	VkDescriptorSet getSet() const;
+
+	uint32_t getTextureCapacity() const;
+	uint32_t getBufferCapacity() const;
+private:
+	struct Slots
+	{
+		uint32_t capacity;
+
+		/* Slots below this have been handed out at least once */
+		uint32_t next;
+
+		std::vector<uint32_t> free;
+	};
+
+	struct Release
+	{
+		uint64_t lastUsage;
+		uint32_t binding;
+		uint32_t index;
+	};
+
+	VkDevice m_Device;
+	VkSemaphore m_Timeline;
+
+	VkDescriptorSetLayout m_SetLayout;
+	VkPipelineLayout m_PipelineLayout;
+	VkDescriptorPool m_Pool;
+	VkDescriptorSet m_Set;
+
+	/* Indexed by binding */
+	Slots m_Slots[2];
+	std::vector<Release> m_Releases;
+
+	/* Textures and buffers may be created on loader threads */
+	std::mutex m_Mutex;
+
+	uint32_t allocate(uint32_t binding);
+};
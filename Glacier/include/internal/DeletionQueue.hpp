@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <vector>
+
+/**
+ * @brief Defers the destruction of Vulkan objects until the GPU has passed the timeline value that last used them.
+*/
+class DeletionQueue
+{
+public:
+	DeletionQueue(VkDevice device, VkSemaphore timeline);
+
+	/**
+	 * @brief Destroys every remaining object. The device must be idle.
+	*/
+	~DeletionQueue();
+
+	// Delete copy
+	DeletionQueue(const DeletionQueue&) = delete;
+	DeletionQueue& operator=(const DeletionQueue&) = delete;
+
+	/**
+	 * @brief Destroy an object once the GPU is done with it. Objects the GPU has already finished with are destroyed immediately.
+	 * @param type The type of the object
+	 * @param handle The Vulkan handle of the object
+	 * @param lastUsage The timeline value of the last submission that used the object
+	*/
+	void destroy(VkObjectType type, void* handle, uint64_t lastUsage);
+
+	/**
+	 * @brief Destroy every queued object whose last usage has completed on the GPU
+	*/
+	void collect();
+
+	/**
+	 * @brief Destroy every queued object regardless of GPU progress. The device must be idle.
+	*/
+	void flush();
+private:
+	struct Entry
+	{
+		uint64_t lastUsage;
+		VkObjectType type;
+		void* handle;
+	};
+
+	VkDevice m_Device;
+	VkSemaphore m_Timeline;
+
+	std::vector<Entry> m_Entries;
+
+	uint64_t getCompletedValue() const;
+	void destroyNow(VkObjectType type, void* handle) const;
+};
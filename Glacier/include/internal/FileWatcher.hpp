@@ -0,0 +1,74 @@
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/**
+ * @brief Reports files that were written or replaced.
+ *
+ * On Linux, the directories of the files are watched with inotify, so a change is seen on the next poll without touching the files.
+ * Elsewhere, or where inotify fails, the modification times of the files are polled every 250 ms instead.
+ * Directories rather than files are watched because editors often save by writing a new file and renaming it over the old one.
+*/
+class FileWatcher
+{
+public:
+	FileWatcher();
+	~FileWatcher();
+
+	// Delete copy
+	FileWatcher(const FileWatcher&) = delete;
+	FileWatcher& operator=(const FileWatcher&) = delete;
+
+	/**
+	 * @brief Start watching a file. It doesn't have to exist yet.
+	 * @param path Absolute and lexically normal path of the file
+	*/
+	void watch(const std::string& path);
+
+	void unwatch(const std::string& path);
+
+	/**
+	 * @brief Get the watched files that changed since the last poll. Each appears once, however often it changed.
+	*/
+	std::vector<std::string> poll();
+private:
+	/* The inotify instance, -1 if it isn't available */
+	int m_Inotify;
+
+	struct Directory
+	{
+		int watch;
+
+		/* Names of the watched files in it */
+		std::unordered_set<std::string> files;
+	};
+
+	/* Watched directories by path, and their paths by watch descriptor */
+	std::unordered_map<std::string, Directory> m_Directories;
+	std::unordered_map<int, std::string> m_Watches;
+
+	/* Files that are polled instead, with their last seen modification time */
+	std::unordered_map<std::string, std::filesystem::file_time_type> m_Polled;
+	std::chrono::steady_clock::time_point m_NextPoll;
+
+	/**
+	 * @brief Add a file to the inotify watch of its directory
+	 * @return False if the directory can't be watched
+	*/
+	bool watchDirectory(const std::string& path);
+
+	/**
+	 * @brief Read pending inotify events and add the watched files they name
+	*/
+	void readEvents(std::unordered_set<std::string>& changed);
+
+	/**
+	 * @brief Get the modification time of a file. Missing files get the minimum time.
+	*/
+	static std::filesystem::file_time_type readTime(const std::string& path);
+};
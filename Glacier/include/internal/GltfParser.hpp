@@ -0,0 +1,22 @@
+#pragma once
+
+#include "ImportedGeometry.hpp"
+
+#include <cstddef>
+#include <string>
+
+class ThreadPool;
+
+/**
+ * @brief Parse a glTF 2.0 file, either JSON or binary, into a triangle list.
+ *
+ * The triangle primitives of every mesh are merged in their own space, node transforms and materials are ignored.
+ * Buffers may be external files, base64 data URIs or the binary chunk, they are mapped rather than read. Vertex data is converted in parallel ranges.
+ * @param data The contents of the file
+ * @param size Size of the file in bytes
+ * @param directory Directory external buffers are relative to, ending in a separator or empty
+ * @param threadPool The workers to convert with
+ * @param geometry Receives the mesh
+ * @throw std::runtime_error if the file is invalid or uses a feature that isn't supported, such as sparse accessors or compression extensions
+*/
+void parseGltf(const void* data, size_t size, const std::string& directory, ThreadPool& threadPool, ImportedGeometry& geometry);
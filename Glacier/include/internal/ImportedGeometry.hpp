@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief A mesh read from a source format, before it is converted into a vertex layout
+*/
+struct ImportedGeometry
+{
+	/* 3 floats per vertex */
+	std::vector<float> positions;
+
+	/* 3 floats per vertex, zero for vertices the source gives no normal */
+	std::vector<float> normals;
+
+	/* 2 floats per vertex with the origin at the top left, zero for vertices the source gives no texture coordinates */
+	std::vector<float> uvs;
+
+	/* Triangle list */
+	std::vector<uint32_t> indices;
+
+	/* Whether some vertices have no normal, they are computed from the faces around them */
+	bool missingNormals = false;
+};
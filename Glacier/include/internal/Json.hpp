@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief A parsed JSON value. Only as much of JSON as reading asset descriptions needs, such as glTF files.
+*/
+class JsonValue
+{
+public:
+	enum class Type
+	{
+		Null, Boolean, Number, String, Array, Object
+	};
+
+	JsonValue();
+
+	/**
+	 * @brief Parse a JSON document
+	 * @param data The text, UTF-8
+	 * @param size Size of the text in bytes
+	 * @return The root value
+	 * @throw std::runtime_error with the offset of the first error
+	*/
+	static JsonValue parse(const char* data, size_t size);
+
+	Type getType() const;
+
+	/**
+	 * @throw std::runtime_error if the value isn't of the type
+	*/
+	bool getBoolean() const;
+	double getNumber() const;
+	const std::string& getString() const;
+	const std::vector<JsonValue>& getArray() const;
+
+	/**
+	 * @brief Get a number that has to be a whole number in the range of uint32_t
+	 * @param name Name of the value for the error message
+	 * @throw std::runtime_error if it isn't one
+	*/
+	uint32_t getUint(std::string_view name) const;
+
+	/**
+	 * @brief Look up a member of an object
+	 * @return The member, or nullptr if it doesn't exist or the value isn't an object
+	*/
+	const JsonValue* find(std::string_view key) const;
+
+	/**
+	 * @brief Look up a member that has to exist
+	 * @throw std::runtime_error if it doesn't
+	*/
+	const JsonValue& at(std::string_view key) const;
+
+	/**
+	 * @brief Look up an element of an array that has to exist
+	 * @throw std::runtime_error if the value isn't an array or the index is out of range
+	*/
+	const JsonValue& at(size_t index) const;
+private:
+	Type m_Type;
+
+	bool m_Boolean;
+	double m_Number;
+	std::string m_String;
+
+	std::vector<JsonValue> m_Array;
+
+	/* Members in the order they were written */
+	std::vector<std::pair<std::string, JsonValue>> m_Members;
+
+	friend class JsonParser;
+};
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief A 2D texture stored in a KTX2 container. The levels point into the parsed memory, nothing is copied.
+*/
+struct Ktx2Image
+{
+	struct Level
+	{
+		const void* data;
+		size_t size;
+	};
+
+	VkFormat format;
+	uint32_t width;
+	uint32_t height;
+
+	/* Every stored mip level, starting with the largest */
+	std::vector<Level> levels;
+};
+
+/**
+ * @brief Read the header and level index of a KTX2 file
+ * @param data The contents of the file
+ * @param size Size of the file in bytes
+ * @return The image. Cube maps, arrays, 3D textures and supercompressed files are rejected.
+ * @throw std::runtime_error if the file isn't a supported KTX2 texture
+*/
+Ktx2Image parseKtx2(const void* data, size_t size);
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+/**
+ * @brief A whole file mapped read-only into memory. Pages are only read from disk when they are first touched, so the contents are never copied into an intermediate buffer.
+*/
+class MappedFile
+{
+public:
+	/**
+	 * @param path Path to the file
+	 * @throw std::runtime_error if the file can't be opened or mapped
+	*/
+	MappedFile(const std::string& path);
+	~MappedFile();
+
+	// Delete copy
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	/**
+	 * @brief Get the contents of the file. nullptr if the file is empty.
+	*/
+	const void* data() const;
+
+	/**
+	 * @brief Get the size of the file in bytes
+	*/
+	size_t size() const;
+private:
+	void* m_Data;
+	size_t m_Size;
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+ * Lossless compression of vertex and index streams, built to decode with SIMD at memory speed.
+ *
+ * A stream is split into blocks of 256 elements, and every block into byte planes: plane b holds byte b of each element.
+ * A plane is coded in groups of 16 values, each using 0, 2, 4 or 8 bits per value, chosen by a 2-bit header per group.
+ * Vertex planes store the difference to the same byte of the previous vertex, zigzagged, so slowly changing attributes and
+ * bytes that rarely change cost few bits. Indices store the zigzagged difference to the previous index instead.
+*/
+
+/**
+ * @brief Compress vertices
+ * @param vertices count * stride bytes
+ * @param count Number of vertices
+ * @param stride Size of a vertex in bytes
+ * @param encoded Receives the compressed stream, appended to its contents
+*/
+void encodeVertexStream(const void* vertices, size_t count, uint32_t stride, std::vector<uint8_t>& encoded);
+
+/**
+ * @brief Compress 32-bit indices
+ * @param indices The indices
+ * @param count Number of indices
+ * @param encoded Receives the compressed stream, appended to its contents
+*/
+void encodeIndexStream(const uint32_t* indices, size_t count, std::vector<uint8_t>& encoded);
+
+/**
+ * @brief Decompress vertices. Output is only written, never read, so it can go straight into mapped staging memory.
+ * @param data The compressed stream
+ * @param size Size of the compressed stream in bytes
+ * @param count Number of vertices
+ * @param stride Size of a vertex in bytes
+ * @param vertices Receives count * stride bytes
+ * @param positions If not nullptr, also receives bytes positionOffset to positionOffset + positionSize of every vertex, tightly packed
+ * @throw std::runtime_error if the stream is truncated
+*/
+void decodeVertexStream(const void* data, size_t size, size_t count, uint32_t stride, void* vertices, void* positions = nullptr, uint32_t positionOffset = 0, uint32_t positionSize = 0);
+
+/**
+ * @brief Decompress 32-bit indices. Output is only written, never read.
+ * @param data The compressed stream
+ * @param size Size of the compressed stream in bytes
+ * @param count Number of indices
+ * @param indices Receives the indices
+ * @throw std::runtime_error if the stream is truncated
+*/
+void decodeIndexStream(const void* data, size_t size, size_t count, uint32_t* indices);
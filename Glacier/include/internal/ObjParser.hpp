@@ -0,0 +1,20 @@
+#pragma once
+
+#include "ImportedGeometry.hpp"
+
+#include <cstddef>
+
+class ThreadPool;
+
+/**
+ * @brief Parse a Wavefront OBJ file into a triangle list.
+ *
+ * The text is split at line ends into chunks that are parsed in parallel, then the corners of every chunk's faces are turned into vertices in parallel.
+ * Corners with the same position, texture coordinates and normal share a vertex within a chunk. Polygons are triangulated as fans, lines, points and materials are ignored.
+ * @param data The text of the file
+ * @param size Size of the file in bytes
+ * @param threadPool The workers to parse with
+ * @param geometry Receives the mesh
+ * @throw std::runtime_error if the file is invalid
+*/
+void parseObj(const char* data, size_t size, ThreadPool& threadPool, ImportedGeometry& geometry);
@@ -0,0 +1,156 @@
+#pragma once
+
+#include "internal/ThreadPool.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+class DeletionQueue;
+
+/**
+ * @brief Serialized pipeline state. Two pipelines with equal keys are interchangeable.
+*/
+class PipelineKey
+{
+public:
+	/**
+	 * @brief Append a trivially copyable value to the key
+	 * @param value The value
+	*/
+	template<typename T>
+	void append(const T& value)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "Pipeline key values must be trivially copyable");
+
+		size_t offset = m_Data.size();
+		m_Data.resize(offset + sizeof(T));
+		memcpy(&m_Data[offset], &value, sizeof(T));
+	}
+
+	const std::string& data() const
+	{
+		return m_Data;
+	}
+private:
+	std::string m_Data;
+};
+
+/**
+ * @brief Deduplicates pipelines and pipeline layouts by their full state. Identical requests share one reference-counted Vulkan object.
+*/
+class PipelineRegistry
+{
+public:
+	/**
+	 * @brief Vulkan objects of a registered pipeline
+	*/
+	struct Entry
+	{
+		/* Written by the compile job, only read once the job is done */
+		VkPipeline pipeline;
+		VkPipeline depthPipeline;
+
+		VkPipelineLayout layout;
+
+		/* The push constant range of the layout, with a size of 0 if it has none */
+		VkPushConstantRange pushConstants;
+
+		/* Creates pipeline and depthPipeline, possibly on a worker thread */
+		std::shared_ptr<ThreadPool::Job> job;
+
+		/* Small identifier of the state, used in render queue sort keys */
+		uint32_t id;
+
+		uint32_t references;
+		uint64_t lastUsage;
+
+		/* The key this entry is stored under */
+		const std::string* key;
+	};
+
+	PipelineRegistry(VkDevice device, DeletionQueue* deletionQueue);
+
+	/**
+	 * @brief Destroys every remaining object. Every pipeline should have been released before.
+	*/
+	~PipelineRegistry();
+
+	// Delete copy
+	PipelineRegistry(const PipelineRegistry&) = delete;
+	PipelineRegistry& operator=(const PipelineRegistry&) = delete;
+
+	/**
+	 * @brief Get a pipeline layout, creating it if no layout with the same state exists
+	 * @param key The serialized layout state
+	 * @param create Creates the layout on a miss, and appends the descriptor set layouts it was built from so they are destroyed with it
+	 * @return The shared layout. Must be released with releaseLayout.
+	*/
+	VkPipelineLayout acquireLayout(const PipelineKey& key, const std::function<VkPipelineLayout(std::vector<VkDescriptorSetLayout>&)>& create);
+
+	/**
+	 * @brief Release a reference to a pipeline layout
+	 * @param layout The layout returned by acquireLayout
+	 * @param lastUsage The timeline value of the last submission that used the layout
+	*/
+	void releaseLayout(VkPipelineLayout layout, uint64_t lastUsage);
+
+	/**
+	 * @brief Get a pipeline, creating it if no pipeline with the same state exists
+	 * @param key The serialized pipeline state, including its layout
+	 * @param create Fills in the layout and compile job of the entry on a miss. Nothing is registered if it throws.
+	 * @return The shared entry. Stays valid until it is released.
+	*/
+	Entry* acquire(const PipelineKey& key, const std::function<void(Entry&)>& create);
+
+	/**
+	 * @brief Release a reference to a pipeline. The pipeline is destroyed once the last reference is gone and the GPU is done with it. A compile job that hasn't started yet is cancelled.
+	 * @param entry The entry returned by acquire
+	 * @param lastUsage The timeline value of the last submission that used the pipeline
+	*/
+	void release(Entry* entry, uint64_t lastUsage);
+
+	/**
+	 * @brief Get how many distinct pipelines are alive
+	*/
+	size_t size() const;
+
+	/**
+	 * @brief Get how many acquisitions were served by an existing pipeline
+	*/
+	uint64_t getHits() const;
+private:
+	struct LayoutEntry
+	{
+		VkPipelineLayout layout;
+		std::vector<VkDescriptorSetLayout> setLayouts;
+		uint32_t references;
+		uint64_t lastUsage;
+	};
+
+	VkDevice m_Device;
+	DeletionQueue* m_DeletionQueue;
+
+	std::unordered_map<std::string, Entry> m_Pipelines;
+	std::unordered_map<std::string, LayoutEntry> m_Layouts;
+
+	uint32_t m_NextId;
+	uint64_t m_Hits;
+
+	/**
+	 * @brief Hand a layout and its descriptor set layouts to the deletion queue
+	*/
+	void destroyLayout(const LayoutEntry& entry);
+
+	/**
+	 * @brief Make sure the compile job of an entry is no longer running
+	*/
+	static void stopJob(Entry& entry);
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+
+/**
+ * @brief Hands out ranges of a fixed-size space, such as elements of a buffer. Free ranges are kept sorted by offset and merged with their neighbours when freed.
+*/
+class RangeAllocator
+{
+public:
+	/**
+	 * @param capacity Size of the space, all of it free
+	*/
+	RangeAllocator(uint32_t capacity);
+
+	/**
+	 * @brief Take the first free range large enough
+	 * @param size Size of the range, greater than 0
+	 * @param offset Receives the start of the range
+	 * @return False if no free range is large enough
+	*/
+	bool allocate(uint32_t size, uint32_t& offset);
+
+	/**
+	 * @brief Return a range taken with allocate
+	*/
+	void free(uint32_t offset, uint32_t size);
+
+	/**
+	 * @brief Mark the start of the space as used and the rest as free, after its contents were moved to the start
+	 * @param used Size of the used part
+	 * @param capacity The new size of the space
+	*/
+	void reset(uint32_t used, uint32_t capacity);
+
+	uint32_t getCapacity() const;
+
+	/**
+	 * @brief Get the total size of the free ranges
+	*/
+	uint32_t getFreeSize() const;
+
+	/**
+	 * @brief Get the size of the largest free range, the largest allocation that would succeed
+	*/
+	uint32_t getLargestFreeRange() const;
+private:
+	uint32_t m_Capacity;
+	uint32_t m_FreeSize;
+
+	/* Size of every free range by offset */
+	std::map<uint32_t, uint32_t> m_FreeRanges;
+};
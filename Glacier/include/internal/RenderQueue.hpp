@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Orders the draws of a frame by 64-bit sort keys to minimize state changes.
+ *
+ * Opaque keys are laid out as layer (8) | 0 (1) | pipeline (16) | material (16) | depth (23), so draws are grouped by state and front to back within a group.
+ * Translucent keys are laid out as layer (8) | 1 (1) | inverted depth (23) | pipeline (16) | material (16), so they are drawn back to front after the opaque draws of their layer.
+*/
+class RenderQueue
+{
+public:
+	/**
+	 * @brief Build a sort key
+	 * @param layer Layers are drawn in ascending order
+	 * @param translucent Translucent draws follow the opaque draws of their layer and are sorted back to front
+	 * @param pipeline Index of the pipeline from pipelineIndex
+	 * @param material Index of the bound resources from materialIndex
+	 * @param depth Distance from the camera. Negative values are clamped to 0.
+	 * @return The key
+	*/
+	static uint64_t makeKey(uint8_t layer, bool translucent, uint16_t pipeline, uint16_t material, float depth);
+
+	/**
+	 * @brief Map the id of a pipeline's state to an index for its sort keys.
+	 *
+	 * Ids are never reused, so they outgrow the 16 bits of the key in a long session. Indices are assigned in order of first use since the last clear instead.
+	 * Past 65535 distinct pipelines in a frame the rest share the last index, which only loosens their grouping.
+	*/
+	uint16_t pipelineIndex(uint32_t id);
+
+	/**
+	 * @brief Map the id of a draw's resources to an index for its sort keys, like pipelineIndex
+	*/
+	uint16_t materialIndex(uint32_t id);
+
+	/**
+	 * @brief Remove every queued draw and forget the assigned indices
+	*/
+	void clear();
+
+	/**
+	 * @brief Queue a draw
+	 * @param key The sort key of the draw
+	 * @param index Index of the draw in the caller's list
+	*/
+	void push(uint64_t key, uint32_t index);
+
+	/**
+	 * @brief Sort the queued draws by key. Draws with equal keys keep their submission order.
+	 * @return Indices of the queued draws in sorted order, valid until the queue is modified
+	*/
+	const std::vector<uint32_t>& sort();
+
+	size_t size() const;
+private:
+	struct Item
+	{
+		uint64_t key;
+		uint32_t index;
+	};
+
+	std::vector<Item> m_Items;
+	std::vector<Item> m_Scratch;
+	std::vector<uint32_t> m_Sorted;
+
+	std::unordered_map<uint32_t, uint16_t> m_PipelineIndices;
+	std::unordered_map<uint32_t, uint16_t> m_MaterialIndices;
+
+	static uint16_t denseIndex(std::unordered_map<uint32_t, uint16_t>& indices, uint32_t id);
+};
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/**
+ * @brief Shares one VkSampler between every texture sampled the same way. Devices only guarantee 4000 live samplers, far fewer than textures.
+*/
+class SamplerCache
+{
+public:
+	SamplerCache(VkDevice device);
+
+	/**
+	 * @brief Destroys every sampler. The device must be idle.
+	*/
+	~SamplerCache();
+
+	// Delete copy
+	SamplerCache(const SamplerCache&) = delete;
+	SamplerCache& operator=(const SamplerCache&) = delete;
+
+	/**
+	 * @brief Get a sampler with the given state, creating it if there is none yet
+	 * @param createInfo The sampler state. Extension structures in pNext aren't part of the cache key and are not supported.
+	 * @return The shared sampler. It stays alive as long as the cache.
+	*/
+	VkSampler acquire(const VkSamplerCreateInfo& createInfo);
+
+	/**
+	 * @brief Get how many distinct samplers were created
+	*/
+	size_t size() const;
+private:
+	VkDevice m_Device;
+
+	std::unordered_map<std::string, VkSampler> m_Samplers;
+
+	/* Textures may be created on loader threads */
+	mutable std::mutex m_Mutex;
+};
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "Buffer.hpp"
+#include "Shader.hpp"
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief Compiles GLSL to SPIR-V. Results are cached on disk by a hash of everything that affects them, so unchanged shaders never recompile.
+*/
+class ShaderCompiler
+{
+public:
+	/**
+	 * @brief SPIR-V produced from a GLSL source
+	*/
+	struct Result
+	{
+		glacier::Buffer code = glacier::Buffer(0);
+
+		/* The source file followed by every file it includes, directly or not */
+		std::vector<std::string> dependencies;
+
+		/* Whether the code was read from the cache instead of compiled */
+		bool cached = false;
+	};
+
+	/**
+	 * @brief Create a compiler
+	 * @param cacheDirectory Directory for compiled SPIR-V, created on first use. Empty to disable the cache.
+	*/
+	ShaderCompiler(std::string cacheDirectory);
+
+	/**
+	 * @brief Compile a GLSL file, or load it from the cache. Safe to call from any thread.
+	 * @param path Path of the source file
+	 * @param type The stage the source is compiled for
+	 * @param defines Preprocessor definitions
+	 * @return The SPIR-V and the files it was built from
+	 * @throw std::runtime_error if a file can't be read or the source doesn't compile
+	*/
+	Result compile(const std::string& path, glacier::ShaderType type, const std::vector<glacier::ShaderDefine>& defines) const;
+
+	/**
+	 * @brief Check if GLSL can be compiled. Without a compiler only cached shaders can be loaded.
+	*/
+	static bool isAvailable();
+private:
+	std::string m_CacheDirectory;
+};
@@ -0,0 +1,17 @@
+#pragma once
+
+// SSE2 is part of every x86-64 CPU, and NEON of every AArch64 one, so neither needs checking at runtime
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GLACIER_SIMD_SSE2
+#include <immintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define GLACIER_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+// MSVC compiles any intrinsic, GCC and Clang only allow AVX2 and F16C in functions marked for them. They may only run after the CPU was checked.
+#if defined(GLACIER_SIMD_SSE2) && (defined(__GNUC__) || defined(__clang__))
+#define GLACIER_TARGET_AVX2 __attribute__((target("avx2,f16c")))
+#else
+#define GLACIER_TARGET_AVX2
+#endif
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "Shader.hpp"
+
+#include <cstddef>
+
+/**
+ * @brief Read the interface of a SPIR-V module: stage, vertex inputs, descriptor bindings, push constants and specialization constants
+ * @param code The SPIR-V words
+ * @param size Size of the code in bytes
+ * @return The reflection of the module's first entry point
+ * @throw std::runtime_error if the code isn't valid SPIR-V
+*/
+glacier::ShaderReflection reflectSpirv(const void* code, size_t size);
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstddef>
+
+/**
+ * @brief Size of the smallest addressable unit of a format. Uncompressed formats have 1x1 blocks, block-compressed formats 4x4.
+*/
+struct TexelBlock
+{
+	uint32_t size;
+	uint32_t extent;
+};
+
+/**
+ * @brief Get the texel block of a format textures can be created with
+ * @param format The format
+ * @param block Receives the block, if the format is supported
+ * @return False if textures don't support the format
+*/
+bool getTexelBlock(VkFormat format, TexelBlock& block);
+
+/**
+ * @brief Get the size in bytes of an image in a format
+*/
+size_t getImageSize(const TexelBlock& block, uint32_t width, uint32_t height);
+
+/**
+ * @brief Get the format decodeBlocks() turns a block-compressed format into
+ * @return An 8-bit RGBA format, or VK_FORMAT_UNDEFINED if the format can't be decoded on the CPU
+*/
+VkFormat getDecodedFormat(VkFormat format);
+
+/**
+ * @brief Decode a block-compressed image to 8-bit RGBA pixels. BC4 and BC5 decode to red and red-green, like sampling them would.
+ * @param format The compressed format, getDecodedFormat() must support it
+ * @param blocks The compressed blocks, row by row
+ * @param width Width of the image in pixels
+ * @param height Height of the image in pixels
+ * @param pixels Receives width * height * 4 bytes
+*/
+void decodeBlocks(VkFormat format, const void* blocks, uint32_t width, uint32_t height, void* pixels);
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief Uploads any number of images and buffers through a single staging buffer and command buffer, generating missing mip levels with blits on the way
+*/
+class TextureUploader
+{
+public:
+	struct Level
+	{
+		const void* data;
+		size_t size;
+	};
+
+	/**
+	 * @brief What a submitted upload uses until the GPU has finished it
+	*/
+	struct Submission
+	{
+		VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+		VkBuffer stagingBuffer = VK_NULL_HANDLE;
+		VkDeviceMemory stagingMemory = VK_NULL_HANDLE;
+	};
+
+	TextureUploader(VkDevice device, VkPhysicalDevice physicalDevice);
+
+	// Delete copy
+	TextureUploader(const TextureUploader&) = delete;
+	TextureUploader& operator=(const TextureUploader&) = delete;
+
+	/**
+	 * @brief Queue an image for upload. Every level of the image ends up in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL.
+	 * @param image The image, created with transfer destination usage, and transfer source usage if levels are generated
+	 * @param width Width of the largest level
+	 * @param height Height of the largest level
+	 * @param mipLevels Number of levels of the image. Levels after the given ones are blitted from the last given level.
+	 * @param levels Data of the first levels, tightly packed
+	 * @param owner Keeps the level data alive until the upload is submitted
+	*/
+	void add(VkImage image, uint32_t width, uint32_t height, uint32_t mipLevels, std::vector<Level> levels, std::shared_ptr<const void> owner);
+
+	/**
+	 * @brief Queue a copy into a buffer. It is made visible to vertex and index fetches.
+	 * @param buffer The buffer, created with transfer destination usage
+	 * @param data The bytes to copy to the start of the buffer
+	 * @param owner Keeps the data alive until the upload is submitted
+	*/
+	void addBuffer(VkBuffer buffer, const void* data, size_t size, std::shared_ptr<const void> owner);
+
+	/**
+	 * @brief Copy every queued image and buffer to the GPU without waiting for it. The queued data is no longer needed afterwards.
+	 * @param signalValue The timeline value signalled once the copies are done
+	 * @return What the upload uses, to be released once the timeline has reached signalValue. Empty if nothing was queued.
+	*/
+	Submission submit(VkCommandPool commandPool, VkQueue queue, VkSemaphore timeline, uint64_t signalValue);
+
+	/**
+	 * @brief Free what a finished upload used
+	*/
+	static void release(VkDevice device, VkCommandPool commandPool, const Submission& submission);
+private:
+	struct Upload
+	{
+		VkImage image;
+		uint32_t width;
+		uint32_t height;
+		uint32_t mipLevels;
+		std::vector<Level> levels;
+		std::shared_ptr<const void> owner;
+	};
+
+	struct BufferUpload
+	{
+		VkBuffer buffer;
+		const void* data;
+		size_t size;
+		std::shared_ptr<const void> owner;
+	};
+
+	VkDevice m_Device;
+	VkPhysicalDevice m_PhysicalDevice;
+
+	std::vector<Upload> m_Uploads;
+	std::vector<BufferUpload> m_BufferUploads;
+
+	/**
+	 * @brief Record the blits generating the missing levels of an upload. Leaves the levels before the last given one in transfer destination layout, the rest in transfer source layout except for the last.
+	*/
+	static void recordMipGeneration(VkCommandBuffer commandBuffer, const Upload& upload);
+};
+
+/**
+ * @brief The levels of a texture read from a file, ready to be uploaded
+*/
+struct TextureSource
+{
+	/* The format of the levels, which differs from the file's if they were decoded on the CPU */
+	VkFormat format;
+
+	uint32_t width;
+	uint32_t height;
+
+	std::vector<TextureUploader::Level> levels;
+
+	/* Keeps the level data alive */
+	std::shared_ptr<const void> owner;
+};
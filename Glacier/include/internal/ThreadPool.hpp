@@ -0,0 +1,122 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief A fixed set of worker threads running jobs from a normal and a high priority queue
+*/
+class ThreadPool
+{
+public:
+	/**
+	 * @brief A unit of work. Runs at most once, either on a worker or on a thread that waits for it.
+	*/
+	class Job
+	{
+	public:
+		Job(std::function<void()> function);
+
+		// Delete copy
+		Job(const Job&) = delete;
+		Job& operator=(const Job&) = delete;
+
+		/**
+		 * @brief Check if the job has finished running, successfully or not
+		*/
+		bool isDone() const;
+
+		/**
+		 * @brief Check if the job threw
+		 * @return True if the job has finished with an exception
+		*/
+		bool hasFailed() const;
+
+		/**
+		 * @brief Block until the job has finished. A job no worker has started yet runs on the calling thread instead.
+		 * @throw The exception the job threw, if any
+		*/
+		void wait();
+
+		/**
+		 * @brief Prevent the job from running if no thread has started it yet
+		 * @return True if the job will never run
+		*/
+		bool cancel();
+	private:
+		std::function<void()> m_Function;
+		std::exception_ptr m_Exception;
+
+		std::atomic<bool> m_Claimed;
+		std::atomic<bool> m_Done;
+
+		std::mutex m_Mutex;
+		std::condition_variable m_Condition;
+
+		/**
+		 * @brief Run the job if nobody has claimed it yet
+		 * @return True if this call ran it
+		*/
+		bool tryRun();
+
+		friend class ThreadPool;
+	};
+
+	/**
+	 * @brief Start the workers
+	 * @param threadCount Number of workers, 0 to use one less than the number of hardware threads
+	*/
+	ThreadPool(unsigned int threadCount = 0);
+
+	/**
+	 * @brief Stop the workers. Jobs still queued are cancelled.
+	*/
+	~ThreadPool();
+
+	// Delete copy
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	/**
+	 * @brief Queue a job
+	 * @param job The job
+	 * @param priority Whether the job is taken before every normal priority job
+	*/
+	void submit(const std::shared_ptr<Job>& job, bool priority = false);
+
+	/**
+	 * @brief Move a queued job to the high priority queue. Does nothing if the job has already started.
+	 * @param job The job
+	*/
+	void prioritize(const std::shared_ptr<Job>& job);
+
+	/**
+	 * @brief Run a function for every index from 0 to count on the workers and the calling thread, and wait for all of them
+	 * @param count Number of calls, each one is a job
+	 * @param function Called with the index
+	 * @throw An exception one of the calls threw, once every call has finished
+	*/
+	void parallelFor(size_t count, const std::function<void(size_t)>& function);
+
+	size_t getThreadCount() const;
+private:
+	std::vector<std::thread> m_Threads;
+
+	std::mutex m_Mutex;
+	std::condition_variable m_Condition;
+
+	// A prioritized job stays in the normal queue too, whichever copy is reached first runs and the other is skipped
+	std::deque<std::shared_ptr<Job>> m_PriorityQueue;
+	std::deque<std::shared_ptr<Job>> m_Queue;
+
+	bool m_Stopping;
+
+	void work();
+};
@@ -32,11 +32,33 @@ struct SwapchainSupportDetails
 	}
 };
 
+/**
+ * @brief Hash bytes with 64-bit FNV-1a
+*/
+uint64_t hashBytes(const void* data, size_t size);
+
 uint32_t findMemoryType(const VkPhysicalDevice& physicalDevice, uint32_t typeFilter, VkMemoryPropertyFlags flags);
 
 void createBuffer(const VkDevice& device, const VkPhysicalDevice& physicalDevice, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags flags, VkBuffer* buffer, VkDeviceMemory* memory);
 
-void copyBuffers(const VkDevice& device, const VkCommandPool& commandPool, const VkQueue& graphicsQueue, const VkBuffer* srcBuffers, const VkBuffer* dstBuffers, const VkDeviceSize* bufferSizes, unsigned int bufferCount);
+/**
+ * @brief A region to copy from one buffer to another
+*/
+struct BufferCopy
+{
+	VkBuffer src;
+	VkBuffer dst;
+	VkBufferCopy region;
+};
+
+void copyBuffers(const VkDevice& device, const VkCommandPool& commandPool, const VkQueue& graphicsQueue, const VkSemaphore& timeline, uint64_t signalValue, const VkBuffer* srcBuffers, const VkBuffer* dstBuffers, const VkDeviceSize* bufferSizes, unsigned int bufferCount);
+
+/**
+ * @brief Copy regions between buffers in one submission that signals signalValue, and wait for it
+*/
+void copyBufferRegions(const VkDevice& device, const VkCommandPool& commandPool, const VkQueue& graphicsQueue, const VkSemaphore& timeline, uint64_t signalValue, const BufferCopy* copies, size_t copyCount);
+
+void waitTimeline(const VkDevice& device, const VkSemaphore& timeline, uint64_t value);
 
 QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device, VkSurfaceKHR surface);
 
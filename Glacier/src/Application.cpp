@@ -5,16 +5,24 @@
 #include "VertexBuffer.hpp"
 #include "Renderer.hpp"
 #include "internal/utility.hpp"
+#include "internal/AssetWatcher.hpp"
+#include "internal/BindlessHeap.hpp"
+#include "internal/DeletionQueue.hpp"
+#include "internal/PipelineRegistry.hpp"
+#include "internal/SamplerCache.hpp"
+#include "internal/ShaderCompiler.hpp"
+#include "internal/ThreadPool.hpp"
 
 #include <vector>
 #include <iostream>
 #include <set>
+#include <chrono>
+#include <thread>
+#include <algorithm>
 
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
-constexpr unsigned int MAX_BUFFERED_FRAMES = 2;
-
 static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(VkDebugUtilsMessageSeverityFlagBitsEXT severity, VkDebugUtilsMessageTypeFlagsEXT type, const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData, void* pUserData)
 {
 	spdlog::level::level_enum level;
@@ -62,6 +70,30 @@ void vkDestroyDebugUtilsMessengerEXT(VkInstance instance, VkDebugUtilsMessengerE
 		return function(instance, debugMessenger, pAllocator);
 }
 
+VkResult createHeadlessSurface(VkInstance instance, const VkHeadlessSurfaceCreateInfoEXT* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkSurfaceKHR* pSurface)
+{
+	PFN_vkCreateHeadlessSurfaceEXT function = reinterpret_cast<PFN_vkCreateHeadlessSurfaceEXT>(vkGetInstanceProcAddr(instance, "vkCreateHeadlessSurfaceEXT"));
+
+	if (function == nullptr)
+		return VK_ERROR_EXTENSION_NOT_PRESENT;
+	else
+		return function(instance, pCreateInfo, pAllocator, pSurface);
+}
+
+/**
+ * @brief Sleep until a point in time. Sleeps coarsely and spins for the last millisecond, since sleeps routinely overshoot.
+*/
+void waitUntil(std::chrono::steady_clock::time_point time)
+{
+	constexpr std::chrono::milliseconds SPIN_THRESHOLD(1);
+
+	if (time - std::chrono::steady_clock::now() > SPIN_THRESHOLD)
+		std::this_thread::sleep_until(time - SPIN_THRESHOLD);
+
+	while (std::chrono::steady_clock::now() < time)
+		std::this_thread::yield();
+}
+
 bool isDeviceSuitable(VkPhysicalDevice device, VkSurfaceKHR surface)
 {
 	VkPhysicalDeviceProperties deviceProperties;
@@ -79,14 +111,69 @@ bool isDeviceSuitable(VkPhysicalDevice device, VkSurfaceKHR surface)
 	if (!details.isAdequate())
 		return false;
 
+	// Frame synchronization is built on timeline semaphores, which are core in Vulkan 1.2
+	if (deviceProperties.apiVersion < VK_API_VERSION_1_2)
+		return false;
+
+	VkPhysicalDeviceVulkan12Features vulkan12Features = {};
+	vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+	VkPhysicalDeviceFeatures2 features2 = {};
+	features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	features2.pNext = &vulkan12Features;
+
+	vkGetPhysicalDeviceFeatures2(device, &features2);
+
+	if (!vulkan12Features.timelineSemaphore)
+		return false;
+
 	return true;
 }
 
+bool supportsDynamicRendering(VkPhysicalDevice device)
+{
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(device, &deviceProperties);
+
+	if (deviceProperties.apiVersion < VK_API_VERSION_1_3)
+		return false;
+
+	VkPhysicalDeviceVulkan13Features vulkan13Features = {};
+	vulkan13Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+
+	VkPhysicalDeviceFeatures2 features2 = {};
+	features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	features2.pNext = &vulkan13Features;
+
+	vkGetPhysicalDeviceFeatures2(device, &features2);
+
+	return vulkan13Features.dynamicRendering && vulkan13Features.synchronization2;
+}
+
+bool supportsDescriptorIndexing(VkPhysicalDevice device)
+{
+	VkPhysicalDeviceVulkan12Features vulkan12Features = {};
+	vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+	VkPhysicalDeviceFeatures2 features2 = {};
+	features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	features2.pNext = &vulkan12Features;
+
+	vkGetPhysicalDeviceFeatures2(device, &features2);
+
+	return vulkan12Features.runtimeDescriptorArray && vulkan12Features.descriptorBindingPartiallyBound && vulkan12Features.descriptorBindingUpdateUnusedWhilePending
+		&& vulkan12Features.descriptorBindingSampledImageUpdateAfterBind && vulkan12Features.descriptorBindingStorageBufferUpdateAfterBind
+		&& vulkan12Features.shaderSampledImageArrayNonUniformIndexing && vulkan12Features.shaderStorageBufferArrayNonUniformIndexing;
+}
+
 glacier::Application::Application(const ApplicationInfo& info)
-	: m_Info(info), m_FramebufferResized(false), m_Renderer(nullptr)
+	: m_Info(info), m_DynamicRendering(false), m_Samples(1), m_MaxAnisotropy(1.0f), m_FramebufferResized(false), m_Renderer(nullptr)
 {
 	g_Logger->info("Initializing application...");
 
+	if (m_Info.framesInFlight == 0)
+		throw std::runtime_error("At least one frame must be in flight");
+
 	g_Logger->debug("Creating window...");
 	m_Window = new glacier::Window(m_Info.windowInfo);
 
@@ -99,17 +186,28 @@ glacier::Application::Application(const ApplicationInfo& info)
 	applicationInfo.applicationVersion = VK_MAKE_VERSION(m_Info.major, m_Info.minor, m_Info.patch);
 	applicationInfo.pEngineName = "Glacier Engine";
 	applicationInfo.engineVersion = VK_MAKE_VERSION(0, 1, 0);
-	applicationInfo.apiVersion = VK_API_VERSION_1_0;
+	// Devices below 1.3 are still accepted, and fall back to render passes
+	applicationInfo.apiVersion = VK_API_VERSION_1_3;
 
 	VkInstanceCreateInfo instanceCreateInfo = {};
 	instanceCreateInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
 	instanceCreateInfo.pApplicationInfo = &applicationInfo;
 
 	// Extensions
-	unsigned int glfwExtensionCount = 0;
-	const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+	std::vector<const char*> extensions;
 
-	std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+	if (m_Window->isHeadless())
+	{
+		extensions.push_back(VK_KHR_SURFACE_EXTENSION_NAME);
+		extensions.push_back(VK_EXT_HEADLESS_SURFACE_EXTENSION_NAME);
+	}
+	else
+	{
+		unsigned int glfwExtensionCount = 0;
+		const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+
+		extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+	}
 
 #ifndef NDEBUG
 	extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -154,7 +252,17 @@ glacier::Application::Application(const ApplicationInfo& info)
 
 	/* Create a window surface */
 	g_Logger->debug("Creating window surface...");
-	if (glfwCreateWindowSurface(static_cast<VkInstance>(m_VulkanInstance), static_cast<GLFWwindow*>(m_Window->m_Handle), nullptr, reinterpret_cast<VkSurfaceKHR*>(&m_Surface)) != VK_SUCCESS)
+	if (m_Window->isHeadless())
+	{
+		VkHeadlessSurfaceCreateInfoEXT headlessSurfaceCreateInfo = {};
+		headlessSurfaceCreateInfo.sType = VK_STRUCTURE_TYPE_HEADLESS_SURFACE_CREATE_INFO_EXT;
+
+		if (createHeadlessSurface(static_cast<VkInstance>(m_VulkanInstance), &headlessSurfaceCreateInfo, nullptr, reinterpret_cast<VkSurfaceKHR*>(&m_Surface)) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create headless surface");
+		}
+	}
+	else if (glfwCreateWindowSurface(static_cast<VkInstance>(m_VulkanInstance), static_cast<GLFWwindow*>(m_Window->m_Handle), nullptr, reinterpret_cast<VkSurfaceKHR*>(&m_Surface)) != VK_SUCCESS)
 	{
 		throw std::runtime_error("Failed to create window surface");
 	}
@@ -181,6 +289,18 @@ glacier::Application::Application(const ApplicationInfo& info)
 		g_Logger->info("Vulkan version: {}.{}.{}", VK_VERSION_MAJOR(deviceProperties.apiVersion), VK_VERSION_MINOR(deviceProperties.apiVersion), VK_VERSION_PATCH(deviceProperties.apiVersion));
 
 		m_PhysicalDevice = device;
+		m_DeviceName = deviceProperties.deviceName;
+
+		// Colour and depth are multisampled together, so both have to support the count
+		VkSampleCountFlags supportedSamples = deviceProperties.limits.framebufferColorSampleCounts & deviceProperties.limits.framebufferDepthSampleCounts;
+
+		m_Samples = 1;
+		while (m_Samples * 2 <= m_Info.samples && (supportedSamples & (m_Samples * 2)))
+			m_Samples *= 2;
+
+		if (m_Samples != m_Info.samples)
+			g_Logger->warn("{} samples requested, using {}", m_Info.samples, m_Samples);
+
 		break;
 	}
 
@@ -211,10 +331,57 @@ glacier::Application::Application(const ApplicationInfo& info)
 		queueCreateInfos.push_back(queueCreateInfo);
 	}
 
+	VkPhysicalDeviceFeatures supportedFeatures;
+	vkGetPhysicalDeviceFeatures(static_cast<VkPhysicalDevice>(m_PhysicalDevice), &supportedFeatures);
+
+	// Textures are decoded on the CPU when block compression is missing, and sampled without anisotropy
 	VkPhysicalDeviceFeatures deviceFeatures = {};
+	deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+	deviceFeatures.samplerAnisotropy = supportedFeatures.samplerAnisotropy;
+
+	if (supportedFeatures.samplerAnisotropy)
+	{
+		VkPhysicalDeviceProperties deviceProperties;
+		vkGetPhysicalDeviceProperties(static_cast<VkPhysicalDevice>(m_PhysicalDevice), &deviceProperties);
+
+		m_MaxAnisotropy = deviceProperties.limits.maxSamplerAnisotropy;
+	}
+
+	VkPhysicalDeviceVulkan12Features vulkan12Features = {};
+	vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	vulkan12Features.timelineSemaphore = VK_TRUE;
+
+	bool bindless = m_Info.bindless && supportsDescriptorIndexing(static_cast<VkPhysicalDevice>(m_PhysicalDevice));
+	if (bindless)
+	{
+		vulkan12Features.runtimeDescriptorArray = VK_TRUE;
+		vulkan12Features.descriptorBindingPartiallyBound = VK_TRUE;
+		vulkan12Features.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+		vulkan12Features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+		vulkan12Features.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+		vulkan12Features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+		vulkan12Features.shaderStorageBufferArrayNonUniformIndexing = VK_TRUE;
+	}
+	else if (m_Info.bindless)
+	{
+		g_Logger->warn("The device doesn't support descriptor indexing, bindless resources are disabled");
+	}
+
+	m_DynamicRendering = m_Info.dynamicRendering && supportsDynamicRendering(static_cast<VkPhysicalDevice>(m_PhysicalDevice));
+
+	VkPhysicalDeviceVulkan13Features vulkan13Features = {};
+	vulkan13Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+	vulkan13Features.dynamicRendering = VK_TRUE;
+	vulkan13Features.synchronization2 = VK_TRUE;
+
+	if (m_DynamicRendering)
+		vulkan12Features.pNext = &vulkan13Features;
+
+	g_Logger->info("Render path: {}", m_DynamicRendering ? "dynamic rendering" : "render pass");
 
 	VkDeviceCreateInfo deviceCreateInfo = {};
 	deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+	deviceCreateInfo.pNext = &vulkan12Features;
 	deviceCreateInfo.pQueueCreateInfos = queueCreateInfos.data();
 	deviceCreateInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
 	deviceCreateInfo.pEnabledFeatures = &deviceFeatures;
@@ -237,6 +404,37 @@ glacier::Application::Application(const ApplicationInfo& info)
 		throw std::runtime_error("Failed to create logical device");
 	}
 
+	/* Create the frame timeline */
+	VkSemaphoreTypeCreateInfo semaphoreTypeCreateInfo = {};
+	semaphoreTypeCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+	semaphoreTypeCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+	semaphoreTypeCreateInfo.initialValue = 0;
+
+	VkSemaphoreCreateInfo timelineCreateInfo = {};
+	timelineCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	timelineCreateInfo.pNext = &semaphoreTypeCreateInfo;
+
+	if (vkCreateSemaphore(static_cast<VkDevice>(m_Device), &timelineCreateInfo, nullptr, reinterpret_cast<VkSemaphore*>(&m_Timeline)) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create timeline semaphore");
+	}
+
+	m_TimelineValue = 0;
+
+	m_DeletionQueue = new DeletionQueue(static_cast<VkDevice>(m_Device), static_cast<VkSemaphore>(m_Timeline));
+	m_PipelineRegistry = new PipelineRegistry(static_cast<VkDevice>(m_Device), m_DeletionQueue);
+	m_ThreadPool = new ThreadPool();
+	m_BindlessHeap = bindless ? new BindlessHeap(static_cast<VkDevice>(m_Device), static_cast<VkPhysicalDevice>(m_PhysicalDevice), static_cast<VkSemaphore>(m_Timeline)) : nullptr;
+	m_SamplerCache = new SamplerCache(static_cast<VkDevice>(m_Device));
+
+	g_Logger->debug("Started {} worker threads", m_ThreadPool->getThreadCount());
+
+	m_ShaderCompiler = new ShaderCompiler(m_Info.shaderCacheDirectory != nullptr ? m_Info.shaderCacheDirectory : "");
+	m_AssetWatcher = m_Info.shaderHotReload || m_Info.assetHotReload ? new AssetWatcher(m_ShaderCompiler, m_ThreadPool) : nullptr;
+
+	if (m_Info.shaderHotReload && !ShaderCompiler::isAvailable())
+		g_Logger->warn("Shader hot reload is enabled, but Glacier was built without a GLSL compiler");
+
 	g_Logger->info("Application initialized.");
 }
 
@@ -244,6 +442,18 @@ glacier::Application::~Application()
 {
 	g_Logger->info("Terminating application...");
 
+	// Release everything that was still waiting for the GPU
+	vkDeviceWaitIdle(static_cast<VkDevice>(m_Device));
+	// The watcher and the registry finish or cancel their jobs, so they go before the workers, which may still be running a compiler
+	delete m_AssetWatcher;
+	delete m_PipelineRegistry;
+	delete m_ThreadPool;
+	delete m_ShaderCompiler;
+	delete m_BindlessHeap;
+	delete m_SamplerCache;
+	delete m_DeletionQueue;
+
+	vkDestroySemaphore(static_cast<VkDevice>(m_Device), static_cast<VkSemaphore>(m_Timeline), nullptr);
 	vkDestroyDevice(static_cast<VkDevice>(m_Device), nullptr);
 	vkDestroySurfaceKHR(static_cast<VkInstance>(m_VulkanInstance), static_cast<VkSurfaceKHR>(m_Surface), nullptr);
 	vkDestroyDebugUtilsMessengerEXT(static_cast<VkInstance>(m_VulkanInstance), static_cast<VkDebugUtilsMessengerEXT>(m_DebugMessenger), nullptr);
@@ -265,20 +475,21 @@ void glacier::Application::run()
 	m_Renderer = new Renderer(this);
 	initializeRenderer(m_Renderer);
 
+	g_Logger->info("Frames in flight: {}, swapchain images: {}", m_Info.framesInFlight, m_Renderer->m_Images.size());
+
 	/* Create semaphores */
-	std::vector<VkSemaphore> imageAvailableSemaphores(MAX_BUFFERED_FRAMES);
-	std::vector<VkSemaphore> renderFinishedSemaphores(MAX_BUFFERED_FRAMES);
-	std::vector<VkFence> bufferedFences(MAX_BUFFERED_FRAMES);
-	std::vector<VkFence> bufferedImageFences(m_Renderer->m_Images.size(), VK_NULL_HANDLE);
+	// Binary semaphores are still required to order acquire, render and present. Everything the CPU waits for is tracked with the timeline.
+	std::vector<VkSemaphore> imageAvailableSemaphores(m_Info.framesInFlight);
+	std::vector<VkSemaphore> renderFinishedSemaphores(m_Info.framesInFlight);
+
+	// The timeline value signaled by the last submission of each frame in flight and to each swapchain image
+	std::vector<uint64_t> frameTimelineValues(m_Info.framesInFlight, 0);
+	std::vector<uint64_t> imageTimelineValues(m_Renderer->m_Images.size(), 0);
 
 	VkSemaphoreCreateInfo semaphoreCreateInfo = {};
 	semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-	VkFenceCreateInfo fenceCreateInfo = {};
-	fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-	fenceCreateInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
-	for (size_t i = 0; i < MAX_BUFFERED_FRAMES; i++)
+	for (size_t i = 0; i < m_Info.framesInFlight; i++)
 	{
 		result = vkCreateSemaphore(static_cast<VkDevice>(m_Device), &semaphoreCreateInfo, nullptr, &(imageAvailableSemaphores[i]));
 		if (result != VK_SUCCESS)
@@ -291,12 +502,6 @@ void glacier::Application::run()
 		{
 			throw std::runtime_error(fmt::format("Failed to create render finished semaphore (Returned {})", result));
 		}
-
-		result = vkCreateFence(static_cast<VkDevice>(m_Device), &fenceCreateInfo, nullptr, &(bufferedFences[i]));
-		if (result != VK_SUCCESS)
-		{
-			throw std::runtime_error(fmt::format("Failed to create fence (Returned {})", result));
-		}
 	}
 
 	/* Start game loop */
@@ -305,81 +510,100 @@ void glacier::Application::run()
 	size_t currentFrame = 0;
 	bool suboptimal_flag = false;
 
-	glfwSetWindowUserPointer(static_cast<GLFWwindow*>(m_Window->m_Handle), &m_FramebufferResized);
-	glfwSetFramebufferSizeCallback(static_cast<GLFWwindow*>(m_Window->m_Handle), [](GLFWwindow* window, int width, int height) -> void
-		{
-			bool* framebufferResized = reinterpret_cast<bool*>(glfwGetWindowUserPointer(window));
-			*framebufferResized = true;
-		});
+	if (!m_Window->isHeadless())
+	{
+		glfwSetWindowUserPointer(static_cast<GLFWwindow*>(m_Window->m_Handle), &m_FramebufferResized);
+		glfwSetFramebufferSizeCallback(static_cast<GLFWwindow*>(m_Window->m_Handle), [](GLFWwindow* window, int width, int height) -> void
+			{
+				bool* framebufferResized = reinterpret_cast<bool*>(glfwGetWindowUserPointer(window));
+				*framebufferResized = true;
+			});
+	}
 
-	double lastTime = glfwGetTime();
-	while (m_Window->isOpen())
+	auto recreateRenderer = [&]() -> void
 	{
-		double deltaTime = glfwGetTime() - lastTime;
-		lastTime = glfwGetTime();
+		/* Check if the window was minimized */
+		glm::uvec2 size = m_Window->getFramebufferSize();
+		if (size.x == 0 || size.y == 0)
+		{
+			glacier::g_Logger->trace("Window is minimized");
 
-		update(deltaTime);
+			while (size.x == 0 || size.y == 0)
+			{
+				size = m_Window->getFramebufferSize();
+				m_Window->waitEvents();
+			}
 
-		/* Draw frame */
-		// Wait until the next frame should be drawn
-		vkWaitForFences(static_cast<VkDevice>(m_Device), 1, &(bufferedFences[currentFrame]), VK_TRUE, UINT64_MAX);
+			glacier::g_Logger->trace("Window is no longer minimized");
+		}
 
-		uint32_t imageIndex;
-		result = vkAcquireNextImageKHR(static_cast<VkDevice>(m_Device), static_cast<VkSwapchainKHR>(m_Renderer->m_Swapchain), UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+		/* Recreate the swapchain */
+		glacier::g_Logger->trace("Swapchain is outdated.");
 
-		if (result == VK_ERROR_OUT_OF_DATE_KHR || m_FramebufferResized)
-		{
-			if (m_FramebufferResized)
-			{
-				glacier::g_Logger->debug("Framebuffer was resized");
-				m_FramebufferResized = false;
-			}
+		terminateRenderer(m_Renderer);
 
-			/* Check if the window was minimized */
-			glm::uvec2 size = m_Window->getFramebufferSize();
-			if (size.x == 0 || size.y == 0)
-			{
-				glacier::g_Logger->trace("Window is minimized");
+		// The old swapchain is retired by the new one, then destroyed once the GPU is done with it
+		Renderer* oldRenderer = m_Renderer;
+		m_Renderer = new Renderer(this, oldRenderer);
+		delete oldRenderer;
 
-				while (size.x == 0 || size.y == 0)
-				{
-					size = m_Window->getFramebufferSize();
-					glfwWaitEvents();
-				}
+		initializeRenderer(m_Renderer);
 
-				glacier::g_Logger->trace("Window is no longer minimized");
-			}
+		// The new swapchain may have a different number of images
+		imageTimelineValues.assign(m_Renderer->m_Images.size(), 0);
+	};
 
-			/* Recreate the swapchain */
-			glacier::g_Logger->trace("Swapchain is outdated.");
+	std::chrono::steady_clock::time_point lastTime = std::chrono::steady_clock::now();
+	std::chrono::steady_clock::time_point nextFrameTime = lastTime;
 
-			terminateRenderer(m_Renderer);
+	std::chrono::steady_clock::duration minFrameDuration = std::chrono::steady_clock::duration::zero();
+	if (m_Info.maxFrameRate > 0.0)
+		minFrameDuration = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / m_Info.maxFrameRate));
 
-			delete m_Renderer;
-			m_Renderer = new Renderer(this);
+	auto tick = [&]() -> void
+	{
+		std::chrono::steady_clock::time_point currentTime = std::chrono::steady_clock::now();
+		double deltaTime = std::chrono::duration<double>(currentTime - lastTime).count();
+		lastTime = currentTime;
 
-			initializeRenderer(m_Renderer);
+		update(deltaTime);
+	};
 
-			/* Recreate semaphores */
-			for (size_t i = 0; i < MAX_BUFFERED_FRAMES; i++)
-			{
-				vkDestroySemaphore(static_cast<VkDevice>(m_Device), imageAvailableSemaphores[i], nullptr);
+	while (m_Window->isOpen())
+	{
+		/* Limit the frame rate */
+		if (minFrameDuration != std::chrono::steady_clock::duration::zero())
+		{
+			waitUntil(nextFrameTime);
 
-				result = vkCreateSemaphore(static_cast<VkDevice>(m_Device), &semaphoreCreateInfo, nullptr, &(imageAvailableSemaphores[i]));
-				if (result != VK_SUCCESS)
-				{
-					throw std::runtime_error(fmt::format("Failed to create image available semaphore (Returned {})", result));
-				}
+			// Don't try to catch up on frames that were missed
+			nextFrameTime = std::max(nextFrameTime + minFrameDuration, std::chrono::steady_clock::now());
+		}
 
-				vkDestroySemaphore(static_cast<VkDevice>(m_Device), renderFinishedSemaphores[i], nullptr);
+		if (!m_Info.justInTime)
+			tick();
 
-				result = vkCreateSemaphore(static_cast<VkDevice>(m_Device), &semaphoreCreateInfo, nullptr, &(renderFinishedSemaphores[i]));
-				if (result != VK_SUCCESS)
-				{
-					throw std::runtime_error(fmt::format("Failed to create render finished semaphore (Returned {})", result));
-				}
-			}
+		/* Draw frame */
+		// Wait until the GPU has finished the last frame that used this frame's resources
+		waitTimeline(static_cast<VkDevice>(m_Device), static_cast<VkSemaphore>(m_Timeline), frameTimelineValues[currentFrame]);
+
+		// Release objects whose last usage has completed
+		m_DeletionQueue->collect();
+
+		if (m_BindlessHeap != nullptr)
+			m_BindlessHeap->collect();
 
+		// Swap in reloaded assets and pipelines before anything is recorded with them
+		if (m_AssetWatcher != nullptr)
+			m_AssetWatcher->update();
+
+		uint32_t imageIndex;
+		result = vkAcquireNextImageKHR(static_cast<VkDevice>(m_Device), static_cast<VkSwapchainKHR>(m_Renderer->m_Swapchain), UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+
+		if (result == VK_ERROR_OUT_OF_DATE_KHR)
+		{
+			// No image was acquired, so the semaphore remains unsignaled and can be reused as-is
+			recreateRenderer();
 			continue;
 		}
 		else if (result == VK_SUBOPTIMAL_KHR)
@@ -399,15 +623,21 @@ void glacier::Application::run()
 			throw std::runtime_error(fmt::format("Failed to acquire swapchain image (Returned {})", result));
 		}
 
-		if (bufferedImageFences[imageIndex] != VK_NULL_HANDLE)
+		// Wait until the GPU has finished the last frame that rendered to this image
+		waitTimeline(static_cast<VkDevice>(m_Device), static_cast<VkSemaphore>(m_Timeline), imageTimelineValues[imageIndex]);
+
+		// The GPU is ready for this frame, so sample input as late as possible
+		if (m_Info.justInTime)
 		{
-			vkWaitForFences(static_cast<VkDevice>(m_Device), 1, &(bufferedImageFences[imageIndex]), VK_TRUE, UINT64_MAX);
+			m_Window->pollEvents();
+			tick();
 		}
 
-		bufferedImageFences[imageIndex] = bufferedFences[currentFrame];
-
-		// Render the frame <ERROR HERE>
+		// Render the frame
 		render(m_Renderer);
+		m_Renderer->recordCommandBuffer(static_cast<uint32_t>(currentFrame), imageIndex);
+
+		uint64_t frameValue = ++m_TimelineValue;
 
 		VkSubmitInfo submitInfo = {};
 		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
@@ -418,92 +648,68 @@ void glacier::Application::run()
 		submitInfo.pWaitSemaphores = waitSemaphores;
 		submitInfo.pWaitDstStageMask = waitStages;
 
-		// Renderer needs to have a pipeline bound
-		if (m_Renderer->m_CommandBuffers.empty())
-			throw std::runtime_error("Renderer has no pipeline bound");
-
 		submitInfo.commandBufferCount = 1;
-		submitInfo.pCommandBuffers = reinterpret_cast<VkCommandBuffer*>(&m_Renderer->m_CommandBuffers[imageIndex]); //&commandBuffers[imageIndex];
+		submitInfo.pCommandBuffers = reinterpret_cast<VkCommandBuffer*>(&m_Renderer->m_CommandBuffers[currentFrame]);
 
-		VkSemaphore signalSemaphores[] = { renderFinishedSemaphores[currentFrame] };
-		submitInfo.signalSemaphoreCount = 1;
+		VkSemaphore signalSemaphores[] = { renderFinishedSemaphores[currentFrame], static_cast<VkSemaphore>(m_Timeline) };
+		submitInfo.signalSemaphoreCount = 2;
 		submitInfo.pSignalSemaphores = signalSemaphores;
 
-		vkResetFences(static_cast<VkDevice>(m_Device), 1, &(bufferedFences[currentFrame]));
-		result = vkQueueSubmit(static_cast<VkQueue>(m_Renderer->m_GraphicsQueue), 1, &submitInfo, bufferedFences[currentFrame]);
+		// Values for binary semaphores are ignored
+		uint64_t waitValues[] = { 0 };
+		uint64_t signalValues[] = { 0, frameValue };
+
+		VkTimelineSemaphoreSubmitInfo timelineSubmitInfo = {};
+		timelineSubmitInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+		timelineSubmitInfo.waitSemaphoreValueCount = 1;
+		timelineSubmitInfo.pWaitSemaphoreValues = waitValues;
+		timelineSubmitInfo.signalSemaphoreValueCount = 2;
+		timelineSubmitInfo.pSignalSemaphoreValues = signalValues;
+
+		submitInfo.pNext = &timelineSubmitInfo;
+
+		result = vkQueueSubmit(static_cast<VkQueue>(m_Renderer->m_GraphicsQueue), 1, &submitInfo, VK_NULL_HANDLE);
 		if (result != VK_SUCCESS)
 		{
 			throw std::runtime_error(fmt::format("Failed to submit draw command buffer (Returned {})", result));
 		}
 
+		frameTimelineValues[currentFrame] = frameValue;
+		imageTimelineValues[imageIndex] = frameValue;
+
 		VkPresentInfoKHR presentInfo = {};
 		presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 		presentInfo.waitSemaphoreCount = 1;
-		presentInfo.pWaitSemaphores = signalSemaphores;
+		presentInfo.pWaitSemaphores = &(renderFinishedSemaphores[currentFrame]);
 
 		VkSwapchainKHR swapchains[] = { static_cast<VkSwapchainKHR>(m_Renderer->m_Swapchain) };
 		presentInfo.swapchainCount = 1;
-		presentInfo.pSwapchains = swapchains; // TODO: &swapchain ?
+		presentInfo.pSwapchains = swapchains;
 		presentInfo.pImageIndices = &imageIndex;
 
 		result = vkQueuePresentKHR(static_cast<VkQueue>(m_Renderer->m_PresentationQueue), &presentInfo);
-		if (result == VK_ERROR_OUT_OF_DATE_KHR)
-		{
-			/* Check if the window was minimized */
-			glm::uvec2 size = m_Window->getFramebufferSize();
-			if (size.x == 0 || size.y == 0)
-			{
-				glacier::g_Logger->trace("Window is minimized");
-
-				while (size.x == 0 || size.y == 0)
-				{
-					size = m_Window->getFramebufferSize();
-					glfwWaitEvents();
-				}
-
-				glacier::g_Logger->trace("Window is no longer minimized");
-			}
-
-			/* Recreate the swapchain */
-			glacier::g_Logger->trace("Swapchain is outdated.");
-
-			terminateRenderer(m_Renderer);
 
-			delete m_Renderer;
-			m_Renderer = new Renderer(this);
+		currentFrame = (currentFrame + 1) % m_Info.framesInFlight;
 
-			initializeRenderer(m_Renderer);
-
-			/* Recreate semaphores */
-			for (size_t i = 0; i < MAX_BUFFERED_FRAMES; i++)
+		// Rebuild after presenting, so that every acquired image is presented and no semaphore is left signaled
+		if (result == VK_ERROR_OUT_OF_DATE_KHR || m_FramebufferResized)
+		{
+			if (m_FramebufferResized)
 			{
-				vkDestroySemaphore(static_cast<VkDevice>(m_Device), imageAvailableSemaphores[i], nullptr);
-
-				result = vkCreateSemaphore(static_cast<VkDevice>(m_Device), &semaphoreCreateInfo, nullptr, &(imageAvailableSemaphores[i]));
-				if (result != VK_SUCCESS)
-				{
-					throw std::runtime_error(fmt::format("Failed to create image available semaphore (Returned {})", result));
-				}
-
-				vkDestroySemaphore(static_cast<VkDevice>(m_Device), renderFinishedSemaphores[i], nullptr);
-
-				result = vkCreateSemaphore(static_cast<VkDevice>(m_Device), &semaphoreCreateInfo, nullptr, &(renderFinishedSemaphores[i]));
-				if (result != VK_SUCCESS)
-				{
-					throw std::runtime_error(fmt::format("Failed to create render finished semaphore (Returned {})", result));
-				}
+				glacier::g_Logger->debug("Framebuffer was resized");
+				m_FramebufferResized = false;
 			}
 
+			recreateRenderer();
 			continue;
 		}
-		else if (result != VK_SUCCESS)
+		else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
 		{
 			throw std::runtime_error(fmt::format("Failed to present queue (Returned {})", result));
 		}
 
-		currentFrame = (currentFrame + 1) % MAX_BUFFERED_FRAMES;
-
-		glfwPollEvents();
+		if (!m_Info.justInTime)
+			m_Window->pollEvents();
 	}
 
 	g_Logger->debug("Game loop stopped.");
@@ -515,11 +721,10 @@ void glacier::Application::run()
 	g_Logger->debug("Destroying renderer...");
 
 	// Destroy this shit last
-	for (size_t i = 0; i < MAX_BUFFERED_FRAMES; i++)
+	for (size_t i = 0; i < m_Info.framesInFlight; i++)
 	{
 		vkDestroySemaphore(static_cast<VkDevice>(m_Device), imageAvailableSemaphores[i], nullptr);
 		vkDestroySemaphore(static_cast<VkDevice>(m_Device), renderFinishedSemaphores[i], nullptr);
-		vkDestroyFence(static_cast<VkDevice>(m_Device), bufferedFences[i], nullptr);
 	}
 
 	terminateRenderer(m_Renderer);
@@ -533,4 +738,22 @@ void glacier::Application::stop()
 	m_Window->close();
 }
 
+const std::string& glacier::Application::getDeviceName() const
+{
+	return m_DeviceName;
+}
+
+uint64_t glacier::Application::getSubmittedTimelineValue() const
+{
+	return m_TimelineValue;
+}
+
+uint64_t glacier::Application::getCompletedTimelineValue() const
+{
+	uint64_t value = 0;
+	vkGetSemaphoreCounterValue(static_cast<VkDevice>(m_Device), static_cast<VkSemaphore>(m_Timeline), &value);
+
+	return value;
+}
+
 #pragma warning(pop)
@@ -0,0 +1,181 @@
+#include "internal/Archive.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+#include <spdlog/fmt/fmt.h>
+
+namespace
+{
+	constexpr uint8_t ARCHIVE_MAGIC[4] = { 'G', 'P', 'A', 'K' };
+	constexpr uint32_t ARCHIVE_VERSION = 1;
+
+	/*
+	 * Little-endian and packed without padding:
+	 * magic, version, file count, index size, then the offset (64-bit), size (64-bit), path length and path of every file,
+	 * then the contents of the files, each starting at a multiple of 16 bytes
+	*/
+	constexpr size_t HEADER_SIZE = 16;
+	constexpr size_t ENTRY_SIZE = 20;
+	constexpr uint64_t ALIGNMENT = 16;
+
+	template<typename T>
+	T readValue(const uint8_t* data, size_t offset)
+	{
+		T value;
+		memcpy(&value, data + offset, sizeof(T));
+
+		return value;
+	}
+
+	template<typename T>
+	void writeValue(std::vector<uint8_t>& data, T value)
+	{
+		size_t offset = data.size();
+		data.resize(offset + sizeof(T));
+		memcpy(data.data() + offset, &value, sizeof(T));
+	}
+
+	uint64_t align(uint64_t offset)
+	{
+		return (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+	}
+}
+
+std::unordered_map<std::string, ArchiveEntry> parseArchive(const void* data, size_t size)
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+
+	if (size < HEADER_SIZE || memcmp(bytes, ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC)) != 0)
+		throw std::runtime_error("Not a .gpak archive");
+
+	uint32_t version = readValue<uint32_t>(bytes, 4);
+	if (version != ARCHIVE_VERSION)
+		throw std::runtime_error(fmt::format(".gpak version {} is not supported, expected {}", version, ARCHIVE_VERSION));
+
+	uint32_t fileCount = readValue<uint32_t>(bytes, 8);
+	uint32_t indexSize = readValue<uint32_t>(bytes, 12);
+
+	if (indexSize > size - HEADER_SIZE || fileCount > indexSize / ENTRY_SIZE)
+		throw std::runtime_error("Archive index is truncated");
+
+	std::unordered_map<std::string, ArchiveEntry> entries;
+	entries.reserve(fileCount);
+
+	size_t position = HEADER_SIZE;
+	size_t indexEnd = HEADER_SIZE + indexSize;
+
+	for (uint32_t i = 0; i < fileCount; i++)
+	{
+		if (indexEnd - position < ENTRY_SIZE)
+			throw std::runtime_error("Archive index is truncated");
+
+		ArchiveEntry entry;
+		entry.offset = readValue<uint64_t>(bytes, position);
+		entry.size = readValue<uint64_t>(bytes, position + 8);
+		uint32_t pathLength = readValue<uint32_t>(bytes, position + 16);
+		position += ENTRY_SIZE;
+
+		if (pathLength > indexEnd - position)
+			throw std::runtime_error("Archive index is truncated");
+
+		std::string path(reinterpret_cast<const char*>(bytes + position), pathLength);
+		position += pathLength;
+
+		if (entry.offset < indexEnd || entry.offset > size || entry.size > size - entry.offset)
+			throw std::runtime_error(fmt::format("Archive file {} lies outside the archive", path));
+
+		if (entries.count(path) != 0)
+			throw std::runtime_error(fmt::format("Archive holds file {} twice", path));
+
+		entries.emplace(std::move(path), entry);
+	}
+
+	return entries;
+}
+
+size_t writeArchive(const std::string& directory, const std::string& archive)
+{
+	// An archive written into the directory it packs doesn't contain itself
+	std::filesystem::path output = std::filesystem::weakly_canonical(archive);
+
+	// Sorted, so the same directory always gives the same archive
+	std::vector<std::filesystem::path> files;
+	for (const std::filesystem::directory_entry& entry : std::filesystem::recursive_directory_iterator(directory))
+	{
+		if (entry.is_regular_file() && std::filesystem::weakly_canonical(entry.path()) != output)
+			files.push_back(entry.path());
+	}
+
+	std::sort(files.begin(), files.end());
+
+	std::vector<std::string> paths;
+	std::vector<uint64_t> sizes;
+	size_t indexSize = 0;
+
+	for (const std::filesystem::path& file : files)
+	{
+		paths.push_back(file.lexically_relative(directory).generic_string());
+		sizes.push_back(std::filesystem::file_size(file));
+		indexSize += ENTRY_SIZE + paths.back().size();
+	}
+
+	if (files.size() > UINT32_MAX || indexSize > UINT32_MAX)
+		throw std::runtime_error(fmt::format("Directory {} has too many files for an archive", directory));
+
+	/* The header and index, with the files laid out after them */
+	std::vector<uint8_t> index(sizeof(ARCHIVE_MAGIC));
+	memcpy(index.data(), ARCHIVE_MAGIC, sizeof(ARCHIVE_MAGIC));
+	writeValue<uint32_t>(index, ARCHIVE_VERSION);
+	writeValue<uint32_t>(index, static_cast<uint32_t>(files.size()));
+	writeValue<uint32_t>(index, static_cast<uint32_t>(indexSize));
+
+	std::vector<uint64_t> offsets;
+	uint64_t offset = align(HEADER_SIZE + indexSize);
+
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		offsets.push_back(offset);
+
+		writeValue<uint64_t>(index, offset);
+		writeValue<uint64_t>(index, sizes[i]);
+		writeValue<uint32_t>(index, static_cast<uint32_t>(paths[i].size()));
+		index.insert(index.end(), paths[i].begin(), paths[i].end());
+
+		offset = align(offset + sizes[i]);
+	}
+
+	std::ofstream stream(archive, std::ios::binary | std::ios::trunc);
+	if (!stream)
+		throw std::runtime_error(fmt::format("Failed to write archive {}", archive));
+
+	stream.write(reinterpret_cast<const char*>(index.data()), static_cast<std::streamsize>(index.size()));
+
+	std::vector<char> contents;
+	uint64_t written = index.size();
+
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		// Pad up to the file's offset
+		contents.assign(static_cast<size_t>(offsets[i] - written), 0);
+		stream.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+
+		std::ifstream file(files[i], std::ios::binary);
+		contents.resize(static_cast<size_t>(sizes[i]));
+
+		if (!file || !file.read(contents.data(), static_cast<std::streamsize>(contents.size())))
+			throw std::runtime_error(fmt::format("Failed to read file {}", files[i].string()));
+
+		stream.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+		written = offsets[i] + sizes[i];
+	}
+
+	stream.close();
+	if (!stream)
+		throw std::runtime_error(fmt::format("Failed to write archive {}", archive));
+
+	return files.size();
+}
@@ -0,0 +1,538 @@
+#include "AssetLoader.hpp"
+#include "Application.hpp"
+#include "Buffer.hpp"
+#include "FileSystem.hpp"
+#include "Renderer.hpp"
+#include "internal/utility.hpp"
+#include "internal/TextureUploader.hpp"
+#include "internal/ThreadPool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+#include <vulkan/vulkan.h>
+
+#include <spdlog/fmt/fmt.h>
+
+/**
+ * @brief One load, moving from its reading stage to its decoding stage to its upload
+*/
+struct glacier::AssetLoader::Request
+{
+	/* Virtual path of the file */
+	std::string name;
+
+	/* The state of the handle, which identifies the load */
+	const void* state = nullptr;
+
+	/* Set by the reading stage, released once the load is uploaded */
+	FileContents file;
+
+	/* Runs on a worker after the file was read */
+	std::function<void(const Request& request)> decode;
+
+	/**
+	 * Runs on the main thread after decoding.
+	 * Returns true if it queued copies on the uploader, in which case the load completes once the GPU has finished them.
+	*/
+	std::function<bool(TextureUploader& uploader)> upload;
+
+	/* Moves the handle to Ready, or to Failed if there is an exception, and calls its callbacks */
+	std::function<void(std::exception_ptr error)> complete;
+
+	std::shared_ptr<ThreadPool::Job> readJob;
+
+	/* Set by the reading stage before it finishes, so it can be read once the reading job is done */
+	std::shared_ptr<ThreadPool::Job> decodeJob;
+
+	/* Keeps the reading stage from queueing the decoding stage while the loader is destroyed */
+	std::atomic<bool> cancelled{ false };
+
+	/**
+	 * @brief Check if both stages have finished, or one of them has failed
+	*/
+	bool isDecoded() const
+	{
+		if (!readJob->isDone())
+			return false;
+
+		return readJob->hasFailed() || decodeJob == nullptr || decodeJob->isDone();
+	}
+
+	/**
+	 * @brief Get the exception the reading or decoding stage threw. Both must have finished.
+	*/
+	std::exception_ptr getError() const
+	{
+		try
+		{
+			readJob->wait();
+
+			if (decodeJob != nullptr)
+				decodeJob->wait();
+		}
+		catch (...)
+		{
+			return std::current_exception();
+		}
+
+		return nullptr;
+	}
+};
+
+/**
+ * @brief The copies submitted by one update, and the loads that complete once the GPU has finished them
+*/
+struct glacier::AssetLoader::Upload
+{
+	/* Signalled on the application's timeline once the copies are done */
+	uint64_t signalValue = 0;
+
+	TextureUploader::Submission submission;
+
+	std::vector<std::shared_ptr<Request>> requests;
+};
+
+namespace
+{
+	std::string describe(std::exception_ptr error)
+	{
+		try
+		{
+			std::rethrow_exception(error);
+		}
+		catch (const std::exception& e)
+		{
+			return e.what();
+		}
+		catch (...)
+		{
+			return "Unknown error";
+		}
+	}
+}
+
+glacier::AssetLoader::AssetLoader(const Application* application, unsigned int ioThreads)
+	: m_Application(application), m_IoThreads(new ThreadPool(std::max(ioThreads, 1u))), m_CommandPool(nullptr)
+{
+}
+
+glacier::AssetLoader::~AssetLoader()
+{
+	for (const std::shared_ptr<Request>& request : m_Requests)
+		request->cancelled = true;
+
+	// Stages that have started still use their request, so they are waited for
+	for (const std::shared_ptr<Request>& request : m_Requests)
+	{
+		if (!request->readJob->cancel())
+		{
+			try
+			{
+				request->readJob->wait();
+			}
+			catch (...)
+			{
+			}
+
+			if (request->decodeJob != nullptr && !request->decodeJob->cancel())
+			{
+				try
+				{
+					request->decodeJob->wait();
+				}
+				catch (...)
+				{
+				}
+			}
+		}
+	}
+
+	VkDevice device = static_cast<VkDevice>(m_Application->m_Device);
+
+	// The GPU may still read the staging buffers
+	if (!m_Uploads.empty())
+	{
+		waitTimeline(device, static_cast<VkSemaphore>(m_Application->m_Timeline), m_Uploads.back()->signalValue);
+
+		for (const std::shared_ptr<Upload>& upload : m_Uploads)
+			TextureUploader::release(device, static_cast<VkCommandPool>(m_CommandPool), upload->submission);
+	}
+
+	if (m_CommandPool != nullptr)
+		vkDestroyCommandPool(device, static_cast<VkCommandPool>(m_CommandPool), nullptr);
+
+	delete m_IoThreads;
+}
+
+glacier::AssetHandle<glacier::Mesh> glacier::AssetLoader::loadMesh(std::string_view path)
+{
+	std::shared_ptr<AssetHandle<Mesh>::State> state = std::make_shared<AssetHandle<Mesh>::State>();
+	std::shared_ptr<Request> request = createRequest<Mesh>(path, state);
+
+	struct Decoded
+	{
+		VertexBufferLayout layout;
+		std::vector<uint8_t> vertices;
+		std::vector<uint32_t> indices;
+	};
+
+	std::shared_ptr<Decoded> decoded = std::make_shared<Decoded>();
+
+	request->decode = [decoded](const Request& request)
+	{
+		try
+		{
+			Mesh::decode(request.file.data(), request.file.size(), decoded->layout, decoded->vertices, decoded->indices);
+
+			if (decoded->vertices.empty() || decoded->indices.empty())
+				throw std::runtime_error("Mesh has no vertices or no indices");
+		}
+		catch (const std::exception& e)
+		{
+			throw std::runtime_error(fmt::format("Failed to load mesh {}: {}", request.name, e.what()));
+		}
+	};
+
+	std::string name = request->name;
+
+	request->upload = [this, state, decoded, name](TextureUploader& uploader) -> bool
+	{
+		// The uploader keeps the decoded copies until they are in the staging buffer
+		std::shared_ptr<const std::vector<uint8_t>> vertices = std::make_shared<const std::vector<uint8_t>>(std::move(decoded->vertices));
+		std::shared_ptr<const std::vector<uint32_t>> indices = std::make_shared<const std::vector<uint32_t>>(std::move(decoded->indices));
+
+		state->asset = std::unique_ptr<Mesh>(new Mesh(m_Application, decoded->layout, std::move(vertices), std::move(indices), uploader));
+		state->asset->watch(name);
+
+		return true;
+	};
+
+	start(request);
+	return AssetHandle<Mesh>(state);
+}
+
+glacier::AssetHandle<glacier::Texture> glacier::AssetLoader::loadTexture(std::string_view path, const TextureInfo& info)
+{
+	std::shared_ptr<AssetHandle<Texture>::State> state = std::make_shared<AssetHandle<Texture>::State>();
+	std::shared_ptr<Request> request = createRequest<Texture>(path, state);
+
+	std::shared_ptr<TextureSource> source = std::make_shared<TextureSource>();
+	const Application* application = m_Application;
+
+	request->decode = [source, application](const Request& request)
+	{
+		*source = Texture::decode(application, request.name, request.file);
+	};
+
+	std::string name = request->name;
+
+	request->upload = [this, state, source, info, name](TextureUploader& uploader) -> bool
+	{
+		std::unique_ptr<Texture> texture(new Texture(m_Application));
+		texture->upload(std::move(*source), info, uploader);
+		texture->watch(name, info);
+
+		state->asset = std::move(texture);
+		return true;
+	};
+
+	start(request);
+	return AssetHandle<Texture>(state);
+}
+
+glacier::AssetHandle<glacier::Shader> glacier::AssetLoader::loadShader(std::string_view path)
+{
+	std::shared_ptr<AssetHandle<Shader>::State> state = std::make_shared<AssetHandle<Shader>::State>();
+	std::shared_ptr<Request> request = createRequest<Shader>(path, state);
+
+	// SPIR-V needs no decoding, the code is only copied into a buffer
+	std::shared_ptr<Buffer> code = std::make_shared<Buffer>(0);
+
+	request->decode = [code](const Request& request)
+	{
+		Buffer buffer(request.file.size());
+		memcpy(buffer.data(), request.file.data(), request.file.size());
+
+		*code = std::move(buffer);
+	};
+
+	request->upload = [this, state, code](TextureUploader& uploader) -> bool
+	{
+		state->asset = std::unique_ptr<Shader>(new Shader(m_Application, *code));
+		*code = Buffer(0);
+
+		return false;
+	};
+
+	start(request);
+	return AssetHandle<Shader>(state);
+}
+
+void glacier::AssetLoader::update()
+{
+	VkDevice device = static_cast<VkDevice>(m_Application->m_Device);
+	VkSemaphore timeline = static_cast<VkSemaphore>(m_Application->m_Timeline);
+
+	/* Complete the loads whose copies the GPU has finished */
+	if (!m_Uploads.empty())
+	{
+		uint64_t completedValue = 0;
+		vkGetSemaphoreCounterValue(device, timeline, &completedValue);
+
+		finishUploads(completedValue);
+	}
+
+	std::vector<std::shared_ptr<Request>> decoded;
+
+	for (std::vector<std::shared_ptr<Request>>::iterator it = m_Requests.begin(); it != m_Requests.end();)
+	{
+		if ((*it)->isDecoded())
+		{
+			decoded.push_back(std::move(*it));
+			it = m_Requests.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+
+	if (decoded.empty())
+		return;
+
+	/* Queue the copies of everything, they share a single staging buffer and submission */
+	// The copies signal the next timeline value. It is taken first, so objects destroyed by a failing upload wait for the copies already queued into them.
+	// Nothing else submits before the copies, so the timeline is still signalled in order.
+	uint64_t signalValue = ++m_Application->m_TimelineValue;
+
+	TextureUploader uploader(device, static_cast<VkPhysicalDevice>(m_Application->m_PhysicalDevice));
+	std::shared_ptr<Upload> upload = std::make_shared<Upload>();
+	upload->signalValue = signalValue;
+
+	std::vector<std::exception_ptr> errors(decoded.size());
+
+	for (size_t i = 0; i < decoded.size(); i++)
+	{
+		errors[i] = decoded[i]->getError();
+		if (errors[i] != nullptr)
+			continue;
+
+		try
+		{
+			if (decoded[i]->upload(uploader))
+			{
+				upload->requests.push_back(std::move(decoded[i]));
+				decoded[i] = nullptr;
+			}
+		}
+		catch (...)
+		{
+			errors[i] = std::current_exception();
+		}
+	}
+
+	// The GPU copies in the background, the loads complete in a later update once it is done
+	try
+	{
+		if (m_CommandPool == nullptr)
+		{
+			QueueFamilyIndices queueFamilyIndices = findQueueFamilies(static_cast<VkPhysicalDevice>(m_Application->m_PhysicalDevice), static_cast<VkSurfaceKHR>(m_Application->m_Surface));
+
+			VkCommandPoolCreateInfo commandPoolCreateInfo = {};
+			commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+			commandPoolCreateInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
+			// Each command buffer is recorded once and freed after its copies
+			commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+			if (vkCreateCommandPool(device, &commandPoolCreateInfo, nullptr, reinterpret_cast<VkCommandPool*>(&m_CommandPool)) != VK_SUCCESS)
+				throw std::runtime_error("Failed to create the asset upload command pool");
+		}
+
+		upload->submission = uploader.submit(static_cast<VkCommandPool>(m_CommandPool), static_cast<VkQueue>(m_Application->m_Renderer->m_GraphicsQueue), timeline, signalValue);
+
+		// The copies were staged, the files aren't needed any more
+		for (const std::shared_ptr<Request>& request : upload->requests)
+			request->file = FileContents();
+
+		if (!upload->requests.empty())
+			m_Uploads.push_back(upload);
+	}
+	catch (...)
+	{
+		for (std::shared_ptr<Request>& request : upload->requests)
+		{
+			decoded.push_back(std::move(request));
+			errors.push_back(std::current_exception());
+		}
+	}
+
+	/* Callbacks may start new loads, so they run after the finished loads were taken out */
+	for (size_t i = 0; i < decoded.size(); i++)
+	{
+		if (decoded[i] == nullptr)
+			continue;
+
+		decoded[i]->file = FileContents();
+		decoded[i]->complete(errors[i]);
+	}
+}
+
+void glacier::AssetLoader::waitAll()
+{
+	for (const std::shared_ptr<Request>& request : m_Requests)
+	{
+		// Failures are reported through the handles once update takes the load
+		try
+		{
+			request->readJob->wait();
+
+			if (request->decodeJob != nullptr)
+				request->decodeJob->wait();
+		}
+		catch (...)
+		{
+		}
+	}
+
+	update();
+
+	if (!m_Uploads.empty())
+	{
+		uint64_t signalValue = m_Uploads.back()->signalValue;
+		waitTimeline(static_cast<VkDevice>(m_Application->m_Device), static_cast<VkSemaphore>(m_Application->m_Timeline), signalValue);
+
+		finishUploads(signalValue);
+	}
+}
+
+size_t glacier::AssetLoader::getPendingCount() const
+{
+	size_t count = m_Requests.size();
+	for (const std::shared_ptr<Upload>& upload : m_Uploads)
+		count += upload->requests.size();
+
+	return count;
+}
+
+template<typename T>
+std::shared_ptr<glacier::AssetLoader::Request> glacier::AssetLoader::createRequest(std::string_view path, const std::shared_ptr<typename AssetHandle<T>::State>& state)
+{
+	std::shared_ptr<Request> request = std::make_shared<Request>();
+	request->name = std::string(path);
+	request->state = state.get();
+
+	request->complete = [state](std::exception_ptr error)
+	{
+		if (error != nullptr)
+		{
+			state->asset.reset();
+			state->status = AssetStatus::Failed;
+			state->error = describe(error);
+
+			g_Logger->error("{}", state->error);
+		}
+		else
+		{
+			state->status = AssetStatus::Ready;
+		}
+
+		std::vector<std::function<void(T*)>> callbacks = std::move(state->callbacks);
+		for (const std::function<void(T*)>& callback : callbacks)
+			callback(state->asset.get());
+	};
+
+	return request;
+}
+
+void glacier::AssetLoader::start(const std::shared_ptr<Request>& request)
+{
+	// The jobs only outlive their request when the loader is destroyed, which waits for them first
+	Request* pending = request.get();
+	ThreadPool* workers = m_Application->m_ThreadPool;
+
+	request->readJob = std::make_shared<ThreadPool::Job>([pending, workers]()
+		{
+			pending->file = FileSystem::read(pending->name);
+
+			if (pending->cancelled)
+				return;
+
+			pending->decodeJob = std::make_shared<ThreadPool::Job>([pending]()
+				{
+					pending->decode(*pending);
+				});
+
+			workers->submit(pending->decodeJob);
+		});
+
+	m_IoThreads->submit(request->readJob);
+	m_Requests.push_back(request);
+}
+
+void glacier::AssetLoader::finishUploads(uint64_t completedValue)
+{
+	std::vector<std::shared_ptr<Upload>> finished;
+
+	for (std::vector<std::shared_ptr<Upload>>::iterator it = m_Uploads.begin(); it != m_Uploads.end();)
+	{
+		if ((*it)->signalValue <= completedValue)
+		{
+			finished.push_back(std::move(*it));
+			it = m_Uploads.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+
+	/* Callbacks may start new loads, so they run after the finished uploads were taken out */
+	for (const std::shared_ptr<Upload>& upload : finished)
+	{
+		TextureUploader::release(static_cast<VkDevice>(m_Application->m_Device), static_cast<VkCommandPool>(m_CommandPool), upload->submission);
+
+		for (const std::shared_ptr<Request>& request : upload->requests)
+			request->complete(nullptr);
+	}
+}
+
+void glacier::AssetLoader::waitFor(const void* state)
+{
+	for (const std::shared_ptr<Request>& request : m_Requests)
+	{
+		if (request->state != state)
+			continue;
+
+		try
+		{
+			request->readJob->wait();
+
+			if (request->decodeJob != nullptr)
+				request->decodeJob->wait();
+		}
+		catch (...)
+		{
+		}
+
+		update();
+		break;
+	}
+
+	// Its copies may have been submitted, by the update above or an earlier one
+	for (const std::shared_ptr<Upload>& upload : m_Uploads)
+	{
+		for (const std::shared_ptr<Request>& request : upload->requests)
+		{
+			if (request->state != state)
+				continue;
+
+			uint64_t signalValue = upload->signalValue;
+			waitTimeline(static_cast<VkDevice>(m_Application->m_Device), static_cast<VkSemaphore>(m_Application->m_Timeline), signalValue);
+
+			finishUploads(signalValue);
+			return;
+		}
+	}
+}
@@ -0,0 +1,237 @@
+#include "internal/AssetWatcher.hpp"
+#include "Pipeline.hpp"
+#include "Shader.hpp"
+#include "common.hpp"
+
+#include <filesystem>
+
+#include <spdlog/spdlog.h>
+
+AssetWatcher::AssetWatcher(const ShaderCompiler* compiler, ThreadPool* threadPool)
+	: m_Compiler(compiler), m_ThreadPool(threadPool)
+{
+}
+
+AssetWatcher::~AssetWatcher()
+{
+	// Rebuilds only touch their own copies, but those may point into the application, so the ones that started are waited for
+	for (std::pair<const void* const, WatchedAsset>& pair : m_Assets)
+	{
+		if (!pair.second.job || pair.second.job->cancel())
+			continue;
+
+		try
+		{
+			pair.second.job->wait();
+		}
+		catch (...)
+		{
+		}
+	}
+}
+
+void AssetWatcher::watch(const void* asset, std::string_view name, const std::vector<std::string>& files, Rebuild rebuild)
+{
+	WatchedAsset& watched = m_Assets[asset];
+	watched.name = std::string(name);
+	watched.rebuild = std::move(rebuild);
+
+	setFiles(asset, watched, files);
+}
+
+void AssetWatcher::unwatch(const void* asset)
+{
+	std::unordered_map<const void*, WatchedAsset>::iterator it = m_Assets.find(asset);
+	if (it == m_Assets.end())
+		return;
+
+	if (it->second.job)
+		it->second.job->cancel();
+
+	setFiles(asset, it->second, {});
+	m_Assets.erase(it);
+}
+
+void AssetWatcher::watchShader(glacier::Shader* shader, const std::vector<std::string>& dependencies)
+{
+	// The rebuild gets copies of everything it needs, so the shader can be destroyed while it runs
+	const ShaderCompiler* compiler = m_Compiler;
+	std::string path = shader->m_SourcePath;
+	glacier::ShaderType type = shader->m_SourceType;
+	std::vector<glacier::ShaderDefine> defines = shader->m_Defines;
+
+	watch(shader, fmt::format("shader {}", path), dependencies, [this, shader, compiler, path, type, defines]() -> std::function<void()>
+		{
+			std::shared_ptr<ShaderCompiler::Result> result = std::make_shared<ShaderCompiler::Result>(compiler->compile(path, type, defines));
+
+			return [this, shader, result]()
+			{
+				shader->load(result->code, shader->m_SourcePath);
+
+				// Includes may have been added or removed
+				setFiles(shader, m_Assets.at(shader), result->dependencies);
+				rebuildPipelines(shader);
+			};
+		});
+}
+
+void AssetWatcher::track(glacier::Pipeline* pipeline)
+{
+	m_Pipelines.insert(pipeline);
+}
+
+void AssetWatcher::untrack(glacier::Pipeline* pipeline)
+{
+	m_Pipelines.erase(pipeline);
+	m_Rebuilding.erase(pipeline);
+}
+
+void AssetWatcher::update()
+{
+	/* Swap in finished rebuilds */
+	std::vector<const void*> finished;
+	for (const std::pair<const void* const, WatchedAsset>& pair : m_Assets)
+	{
+		if (pair.second.job && pair.second.job->isDone())
+			finished.push_back(pair.first);
+	}
+
+	for (const void* asset : finished)
+		finish(asset);
+
+	/* Swap in rebuilt pipelines */
+	// Until then they keep drawing with their old state, so rendering never waits for a rebuild
+	for (std::unordered_set<glacier::Pipeline*>::iterator it = m_Rebuilding.begin(); it != m_Rebuilding.end();)
+	{
+		if ((*it)->swapPending())
+			it = m_Rebuilding.erase(it);
+		else
+			++it;
+	}
+
+	/* Rebuild the assets built from changed files, each once however many of its files changed */
+	std::unordered_set<const void*> changed;
+	for (const std::string& path : m_FileWatcher.poll())
+	{
+		std::unordered_map<std::string, std::unordered_set<const void*>>::const_iterator it = m_Dependents.find(path);
+		if (it != m_Dependents.end())
+			changed.insert(it->second.begin(), it->second.end());
+	}
+
+	for (const void* asset : changed)
+	{
+		WatchedAsset& watched = m_Assets.at(asset);
+
+		// Rebuilding twice at once could swap the older result in last
+		if (watched.job)
+			watched.changed = true;
+		else
+			start(watched);
+	}
+}
+
+void AssetWatcher::setFiles(const void* asset, WatchedAsset& watched, const std::vector<std::string>& files)
+{
+	// Events name absolute paths, so every path is made absolute the same way
+	std::unordered_set<std::string> paths;
+	for (const std::string& file : files)
+	{
+		std::error_code error;
+		std::filesystem::path path = std::filesystem::absolute(file, error);
+
+		paths.insert(error ? file : path.lexically_normal().string());
+	}
+
+	/* Watch the new files before dropping the old ones, so files in both stay watched */
+	for (const std::string& path : paths)
+	{
+		std::unordered_set<const void*>& dependents = m_Dependents[path];
+		if (dependents.empty())
+			m_FileWatcher.watch(path);
+
+		dependents.insert(asset);
+	}
+
+	for (const std::string& path : watched.files)
+	{
+		if (paths.count(path) != 0)
+			continue;
+
+		std::unordered_map<std::string, std::unordered_set<const void*>>::iterator it = m_Dependents.find(path);
+		it->second.erase(asset);
+
+		if (it->second.empty())
+		{
+			m_FileWatcher.unwatch(path);
+			m_Dependents.erase(it);
+		}
+	}
+
+	watched.files.assign(paths.begin(), paths.end());
+}
+
+void AssetWatcher::start(WatchedAsset& watched)
+{
+	glacier::g_Logger->info("Reloading {}", watched.name);
+
+	std::shared_ptr<std::function<void()>> swap = std::make_shared<std::function<void()>>();
+	Rebuild rebuild = watched.rebuild;
+
+	watched.swap = swap;
+	watched.job = std::make_shared<ThreadPool::Job>([rebuild, swap]()
+		{
+			*swap = rebuild();
+		});
+
+	m_ThreadPool->submit(watched.job);
+}
+
+void AssetWatcher::finish(const void* asset)
+{
+	WatchedAsset& watched = m_Assets.at(asset);
+
+	std::shared_ptr<ThreadPool::Job> job = std::move(watched.job);
+	std::shared_ptr<std::function<void()>> swap = std::move(watched.swap);
+
+	// Keep the old asset on any failure, the next edit tries again
+	try
+	{
+		job->wait();
+		(*swap)();
+
+		glacier::g_Logger->info("Reloaded {}", watched.name);
+	}
+	catch (const std::exception& e)
+	{
+		glacier::g_Logger->error("Failed to reload {}: {}", watched.name, e.what());
+	}
+
+	if (watched.changed)
+	{
+		watched.changed = false;
+		start(watched);
+	}
+}
+
+void AssetWatcher::rebuildPipelines(glacier::Shader* shader)
+{
+	for (glacier::Pipeline* pipeline : m_Pipelines)
+	{
+		bool usesShader = false;
+		for (const std::pair<const glacier::ShaderType, glacier::Shader*>& pair : pipeline->m_Shaders)
+			usesShader = usesShader || pair.second == shader;
+
+		if (!usesShader)
+			continue;
+
+		try
+		{
+			pipeline->rebuild();
+			m_Rebuilding.insert(pipeline);
+		}
+		catch (const std::exception& e)
+		{
+			glacier::g_Logger->error("Failed to rebuild a pipeline after reloading {}: {}", shader->m_SourcePath, e.what());
+		}
+	}
+}
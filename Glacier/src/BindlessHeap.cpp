@@ -0,0 +1,276 @@
+#include "internal/BindlessHeap.hpp"
+#include "common.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <spdlog/spdlog.h>
+
+BindlessHeap::BindlessHeap(VkDevice device, VkPhysicalDevice physicalDevice, VkSemaphore timeline)
+	: m_Device(device), m_Timeline(timeline), m_SetLayout(VK_NULL_HANDLE), m_PipelineLayout(VK_NULL_HANDLE), m_Pool(VK_NULL_HANDLE), m_Set(VK_NULL_HANDLE), m_Slots()
+{
+	/* Size the arrays within the update-after-bind limits */
+	VkPhysicalDeviceVulkan12Properties vulkan12Properties = {};
+	vulkan12Properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES;
+
+	VkPhysicalDeviceProperties2 properties2 = {};
+	properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+	properties2.pNext = &vulkan12Properties;
+
+	vkGetPhysicalDeviceProperties2(physicalDevice, &properties2);
+
+	// Every graphics stage sees both arrays, so the per-stage limits apply
+	uint32_t textures = std::min({ 16384u,
+		vulkan12Properties.maxPerStageDescriptorUpdateAfterBindSampledImages, vulkan12Properties.maxPerStageDescriptorUpdateAfterBindSamplers,
+		vulkan12Properties.maxDescriptorSetUpdateAfterBindSampledImages, vulkan12Properties.maxDescriptorSetUpdateAfterBindSamplers });
+
+	uint32_t buffers = std::min({ 4096u,
+		vulkan12Properties.maxPerStageDescriptorUpdateAfterBindStorageBuffers, vulkan12Properties.maxDescriptorSetUpdateAfterBindStorageBuffers });
+
+	// Textures get priority if the stage can't hold both in full
+	uint32_t resources = vulkan12Properties.maxPerStageUpdateAfterBindResources;
+	textures = std::min(textures, resources);
+	buffers = std::min(buffers, resources - textures);
+
+	if (textures == 0 || buffers == 0)
+		throw std::runtime_error("The device can't hold any bindless textures or buffers");
+
+	m_Slots[TEXTURE_BINDING].capacity = textures;
+	m_Slots[BUFFER_BINDING].capacity = buffers;
+
+	glacier::g_Logger->debug("Bindless heap: {} textures, {} storage buffers", textures, buffers);
+
+	/* Create the set layout */
+	VkDescriptorSetLayoutBinding bindings[2] = {};
+	bindings[0].binding = TEXTURE_BINDING;
+	bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	bindings[0].descriptorCount = textures;
+	bindings[0].stageFlags = VK_SHADER_STAGE_ALL_GRAPHICS;
+
+	bindings[1].binding = BUFFER_BINDING;
+	bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	bindings[1].descriptorCount = buffers;
+	bindings[1].stageFlags = VK_SHADER_STAGE_ALL_GRAPHICS;
+
+	// Most slots are empty, and slots are written while earlier frames are still reading others
+	VkDescriptorBindingFlags flags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+	VkDescriptorBindingFlags bindingFlags[2] = { flags, flags };
+
+	VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsCreateInfo = {};
+	bindingFlagsCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+	bindingFlagsCreateInfo.bindingCount = 2;
+	bindingFlagsCreateInfo.pBindingFlags = bindingFlags;
+
+	VkDescriptorSetLayoutCreateInfo setLayoutCreateInfo = {};
+	setLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	setLayoutCreateInfo.pNext = &bindingFlagsCreateInfo;
+	setLayoutCreateInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+	setLayoutCreateInfo.bindingCount = 2;
+	setLayoutCreateInfo.pBindings = bindings;
+
+	if (vkCreateDescriptorSetLayout(m_Device, &setLayoutCreateInfo, nullptr, &m_SetLayout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create bindless descriptor set layout");
+	}
+
+	/* Create the pipeline layout */
+	// Pipeline layouts only stay compatible for set 0 if their push constant ranges are identical, so every bindless layout uses this one range
+	VkPushConstantRange pushConstantRange = {};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_ALL_GRAPHICS;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = PUSH_CONSTANT_SIZE;
+
+	VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
+	pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutCreateInfo.setLayoutCount = 1;
+	pipelineLayoutCreateInfo.pSetLayouts = &m_SetLayout;
+	pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+	pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (vkCreatePipelineLayout(m_Device, &pipelineLayoutCreateInfo, nullptr, &m_PipelineLayout) != VK_SUCCESS)
+	{
+		vkDestroyDescriptorSetLayout(m_Device, m_SetLayout, nullptr);
+		throw std::runtime_error("Failed to create bindless pipeline layout");
+	}
+
+	/* Allocate the set */
+	VkDescriptorPoolSize poolSizes[2] = {};
+	poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	poolSizes[0].descriptorCount = textures;
+	poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSizes[1].descriptorCount = buffers;
+
+	VkDescriptorPoolCreateInfo poolCreateInfo = {};
+	poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolCreateInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+	poolCreateInfo.maxSets = 1;
+	poolCreateInfo.poolSizeCount = 2;
+	poolCreateInfo.pPoolSizes = poolSizes;
+
+	if (vkCreateDescriptorPool(m_Device, &poolCreateInfo, nullptr, &m_Pool) != VK_SUCCESS)
+	{
+		vkDestroyPipelineLayout(m_Device, m_PipelineLayout, nullptr);
+		vkDestroyDescriptorSetLayout(m_Device, m_SetLayout, nullptr);
+		throw std::runtime_error("Failed to create bindless descriptor pool");
+	}
+
+	VkDescriptorSetAllocateInfo setAllocateInfo = {};
+	setAllocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	setAllocateInfo.descriptorPool = m_Pool;
+	setAllocateInfo.descriptorSetCount = 1;
+	setAllocateInfo.pSetLayouts = &m_SetLayout;
+
+	if (vkAllocateDescriptorSets(m_Device, &setAllocateInfo, &m_Set) != VK_SUCCESS)
+	{
+		vkDestroyDescriptorPool(m_Device, m_Pool, nullptr);
+		vkDestroyPipelineLayout(m_Device, m_PipelineLayout, nullptr);
+		vkDestroyDescriptorSetLayout(m_Device, m_SetLayout, nullptr);
+		throw std::runtime_error("Failed to allocate bindless descriptor set");
+	}
+}
+
+BindlessHeap::~BindlessHeap()
+{
+	uint32_t textures = m_Slots[TEXTURE_BINDING].next - static_cast<uint32_t>(m_Slots[TEXTURE_BINDING].free.size());
+	uint32_t buffers = m_Slots[BUFFER_BINDING].next - static_cast<uint32_t>(m_Slots[BUFFER_BINDING].free.size());
+
+	// Released slots still waiting for the GPU count as free, the device is idle
+	for (const Release& release : m_Releases)
+	{
+		if (release.binding == TEXTURE_BINDING)
+			textures--;
+		else
+			buffers--;
+	}
+
+	if (textures > 0 || buffers > 0)
+		glacier::g_Logger->warn("{} textures and {} storage buffers were not destroyed before the application terminated", textures, buffers);
+
+	// Destroying the pool frees the set
+	vkDestroyDescriptorPool(m_Device, m_Pool, nullptr);
+	vkDestroyPipelineLayout(m_Device, m_PipelineLayout, nullptr);
+	vkDestroyDescriptorSetLayout(m_Device, m_SetLayout, nullptr);
+}
+
+uint32_t BindlessHeap::addTexture(VkImageView imageView, VkSampler sampler)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	uint32_t index = allocate(TEXTURE_BINDING);
+
+	VkDescriptorImageInfo imageInfo = {};
+	imageInfo.sampler = sampler;
+	imageInfo.imageView = imageView;
+	imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+	VkWriteDescriptorSet write = {};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = m_Set;
+	write.dstBinding = TEXTURE_BINDING;
+	write.dstArrayElement = index;
+	write.descriptorCount = 1;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	write.pImageInfo = &imageInfo;
+
+	vkUpdateDescriptorSets(m_Device, 1, &write, 0, nullptr);
+
+	return index;
+}
+
+uint32_t BindlessHeap::addBuffer(VkBuffer buffer, VkDeviceSize size)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	uint32_t index = allocate(BUFFER_BINDING);
+
+	VkDescriptorBufferInfo bufferInfo = {};
+	bufferInfo.buffer = buffer;
+	bufferInfo.offset = 0;
+	bufferInfo.range = size;
+
+	VkWriteDescriptorSet write = {};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = m_Set;
+	write.dstBinding = BUFFER_BINDING;
+	write.dstArrayElement = index;
+	write.descriptorCount = 1;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	write.pBufferInfo = &bufferInfo;
+
+	vkUpdateDescriptorSets(m_Device, 1, &write, 0, nullptr);
+
+	return index;
+}
+
+void BindlessHeap::release(uint32_t binding, uint32_t index, uint64_t lastUsage)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	// The descriptor is left as it is, partially bound slots may hold stale descriptors as long as no shader reads them
+	m_Releases.push_back(Release{ lastUsage, binding, index });
+}
+
+void BindlessHeap::collect()
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	if (m_Releases.empty())
+		return;
+
+	uint64_t completedValue = 0;
+	vkGetSemaphoreCounterValue(m_Device, m_Timeline, &completedValue);
+
+	std::vector<Release>::iterator end = std::remove_if(m_Releases.begin(), m_Releases.end(), [this, completedValue](const Release& release) -> bool
+		{
+			if (release.lastUsage > completedValue)
+				return false;
+
+			m_Slots[release.binding].free.push_back(release.index);
+			return true;
+		});
+
+	m_Releases.erase(end, m_Releases.end());
+}
+
+VkDescriptorSetLayout BindlessHeap::getSetLayout() const
+{
+	return m_SetLayout;
+}
+
+VkPipelineLayout BindlessHeap::getPipelineLayout() const
+{
+	return m_PipelineLayout;
+}
+
+VkDescriptorSet BindlessHeap::getSet() const
+{
+	return m_Set;
+}
+
+uint32_t BindlessHeap::getTextureCapacity() const
+{
+	return m_Slots[TEXTURE_BINDING].capacity;
+}
+
+uint32_t BindlessHeap::getBufferCapacity() const
+{
+	return m_Slots[BUFFER_BINDING].capacity;
+}
+
+uint32_t BindlessHeap::allocate(uint32_t binding)
+{
+	Slots& slots = m_Slots[binding];
+
+	if (!slots.free.empty())
+	{
+		uint32_t index = slots.free.back();
+		slots.free.pop_back();
+
+		return index;
+	}
+
+	if (slots.next == slots.capacity)
+		throw std::runtime_error(fmt::format("The bindless heap is full, it holds at most {} {}", slots.capacity, binding == TEXTURE_BINDING ? "textures" : "storage buffers"));
+
+	return slots.next++;
+}
@@ -0,0 +1,108 @@
+#include "internal/DeletionQueue.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+DeletionQueue::DeletionQueue(VkDevice device, VkSemaphore timeline)
+	: m_Device(device), m_Timeline(timeline)
+{
+}
+
+DeletionQueue::~DeletionQueue()
+{
+	flush();
+}
+
+void DeletionQueue::destroy(VkObjectType type, void* handle, uint64_t lastUsage)
+{
+	if (handle == nullptr)
+		return;
+
+	if (lastUsage <= getCompletedValue())
+	{
+		destroyNow(type, handle);
+		return;
+	}
+
+	m_Entries.push_back(Entry{ lastUsage, type, handle });
+}
+
+void DeletionQueue::collect()
+{
+	if (m_Entries.empty())
+		return;
+
+	uint64_t completedValue = getCompletedValue();
+
+	std::vector<Entry>::iterator end = std::remove_if(m_Entries.begin(), m_Entries.end(), [this, completedValue](const Entry& entry) -> bool
+		{
+			if (entry.lastUsage > completedValue)
+				return false;
+
+			destroyNow(entry.type, entry.handle);
+			return true;
+		});
+
+	m_Entries.erase(end, m_Entries.end());
+}
+
+void DeletionQueue::flush()
+{
+	for (const Entry& entry : m_Entries)
+		destroyNow(entry.type, entry.handle);
+
+	m_Entries.clear();
+}
+
+uint64_t DeletionQueue::getCompletedValue() const
+{
+	uint64_t value = 0;
+	vkGetSemaphoreCounterValue(m_Device, m_Timeline, &value);
+
+	return value;
+}
+
+void DeletionQueue::destroyNow(VkObjectType type, void* handle) const
+{
+	switch (type)
+	{
+	case VK_OBJECT_TYPE_BUFFER:
+		vkDestroyBuffer(m_Device, static_cast<VkBuffer>(handle), nullptr);
+		break;
+	case VK_OBJECT_TYPE_DEVICE_MEMORY:
+		vkFreeMemory(m_Device, static_cast<VkDeviceMemory>(handle), nullptr);
+		break;
+	case VK_OBJECT_TYPE_PIPELINE:
+		vkDestroyPipeline(m_Device, static_cast<VkPipeline>(handle), nullptr);
+		break;
+	case VK_OBJECT_TYPE_PIPELINE_LAYOUT:
+		vkDestroyPipelineLayout(m_Device, static_cast<VkPipelineLayout>(handle), nullptr);
+		break;
+	case VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT:
+		vkDestroyDescriptorSetLayout(m_Device, static_cast<VkDescriptorSetLayout>(handle), nullptr);
+		break;
+	case VK_OBJECT_TYPE_FRAMEBUFFER:
+		vkDestroyFramebuffer(m_Device, static_cast<VkFramebuffer>(handle), nullptr);
+		break;
+	case VK_OBJECT_TYPE_RENDER_PASS:
+		vkDestroyRenderPass(m_Device, static_cast<VkRenderPass>(handle), nullptr);
+		break;
+	case VK_OBJECT_TYPE_IMAGE:
+		vkDestroyImage(m_Device, static_cast<VkImage>(handle), nullptr);
+		break;
+	case VK_OBJECT_TYPE_IMAGE_VIEW:
+		vkDestroyImageView(m_Device, static_cast<VkImageView>(handle), nullptr);
+		break;
+	case VK_OBJECT_TYPE_SAMPLER:
+		vkDestroySampler(m_Device, static_cast<VkSampler>(handle), nullptr);
+		break;
+	case VK_OBJECT_TYPE_COMMAND_POOL:
+		vkDestroyCommandPool(m_Device, static_cast<VkCommandPool>(handle), nullptr);
+		break;
+	case VK_OBJECT_TYPE_SWAPCHAIN_KHR:
+		vkDestroySwapchainKHR(m_Device, static_cast<VkSwapchainKHR>(handle), nullptr);
+		break;
+	default:
+		throw std::runtime_error("Unsupported object type in deletion queue");
+	}
+}
@@ -1,12 +1,12 @@
 #include "File.hpp"
+#include "FileSystem.hpp"
 
-#include <fstream>
-#include <spdlog/fmt/fmt.h>
+#include <cstring>
 
 std::string glacier::File::s_BaseDirectory = ".";
 
 glacier::File::File(std::string_view path)
-	: m_Path(s_BaseDirectory + "/" + path.data()) // std::string(s_BaseDirectory).append(path)
+	: m_Name(path), m_Path(s_BaseDirectory + "/" + m_Name)
 {
 }
 
@@ -16,40 +16,25 @@ glacier::File::~File()
 
 glacier::Buffer glacier::File::read() const
 {
-	std::ifstream stream(m_Path.data(), std::ios::ate | std::ios::binary);
+	FileContents contents = FileSystem::read(m_Name);
 
-	if (!stream)
-	{
-		throw std::runtime_error(fmt::format("Failed to read file {}", m_Path));
-	}
-
-	size_t size = stream.tellg();
-	stream.seekg(0);
-
-	Buffer buffer(size);
-	stream.read(buffer.data(), size);
-
-	stream.close();
+	Buffer buffer(contents.size());
+	memcpy(buffer.data(), contents.data(), contents.size());
 
 	return buffer;
 }
 
 GLACIER_API glacier::Buffer* glacier::File::read_ptr() const
 {
-	std::ifstream stream(m_Path.data(), std::ios::ate | std::ios::binary);
-
-	if (!stream)
-	{
-		throw std::runtime_error(fmt::format("Failed to read file {}", m_Path));
-	}
-
-	size_t size = stream.tellg();
-	stream.seekg(0);
+	FileContents contents = FileSystem::read(m_Name);
 
-	Buffer* buffer = new Buffer(size);
-	stream.read(buffer->data(), size);
-
-	stream.close();
+	Buffer* buffer = new Buffer(contents.size());
+	memcpy(buffer->data(), contents.data(), contents.size());
 
 	return buffer;
 }
+
+const std::string& glacier::File::getPath() const
+{
+	return m_Path;
+}
@@ -0,0 +1,452 @@
+#include "FileSystem.hpp"
+#include "File.hpp"
+#include "internal/Archive.hpp"
+#include "internal/MappedFile.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <list>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+namespace
+{
+	constexpr size_t DEFAULT_CACHE_BUDGET = 64ull << 20;
+
+	struct Mount
+	{
+		/* The path it was mounted with */
+		std::string source;
+
+		/* Prefix of the virtual paths it holds, empty or ending with '/' */
+		std::string mountPoint;
+
+		int priority;
+
+		/* The directory on disk, empty for an archive */
+		std::string directory;
+
+		/* The mapped archive and where its files are */
+		std::shared_ptr<MappedFile> archive;
+		std::unordered_map<std::string, ArchiveEntry> entries;
+	};
+
+	/**
+	 * @brief Where a virtual path was found. Either a file on disk, or contents in an archive.
+	*/
+	struct Location
+	{
+		bool found = false;
+
+		std::string path;
+		std::filesystem::file_time_type time;
+
+		glacier::FileContents contents;
+	};
+
+	struct CacheEntry
+	{
+		glacier::FileContents contents;
+
+		/* Modification time of the file when it was read */
+		std::filesystem::file_time_type time;
+
+		/* Position in the recency list */
+		std::list<std::string>::iterator recency;
+	};
+
+	/**
+	 * @brief Mounts and cached contents, shared by every thread
+	*/
+	struct FileSystemState
+	{
+		std::mutex mutex;
+
+		/* Ordered from the first to the last searched */
+		std::vector<std::shared_ptr<const Mount>> mounts;
+
+		/* Cached files by their path on disk, and those paths from the most to the least recently used */
+		std::unordered_map<std::string, CacheEntry> cache;
+		std::list<std::string> recency;
+
+		size_t budget = DEFAULT_CACHE_BUDGET;
+		glacier::FileSystemStatistics statistics;
+	};
+
+	FileSystemState& getState()
+	{
+		static FileSystemState state;
+		return state;
+	}
+
+	/**
+	 * @brief Join the components of a virtual path with '/', dropping empty and '.' components and resolving '..'
+	 * @throw std::runtime_error if the path leaves the root
+	*/
+	std::string normalize(std::string_view path)
+	{
+		std::vector<std::string_view> components;
+
+		size_t start = 0;
+		while (start <= path.size())
+		{
+			size_t end = path.find_first_of("/\\", start);
+			if (end == std::string_view::npos)
+				end = path.size();
+
+			std::string_view component = path.substr(start, end - start);
+			if (component == "..")
+			{
+				if (components.empty())
+					throw std::runtime_error(fmt::format("Path {} leaves the root of the file system", path));
+
+				components.pop_back();
+			}
+			else if (!component.empty() && component != ".")
+			{
+				components.push_back(component);
+			}
+
+			start = end + 1;
+		}
+
+		std::string normalized;
+		for (std::string_view component : components)
+		{
+			if (!normalized.empty())
+				normalized.push_back('/');
+
+			normalized.append(component);
+		}
+
+		return normalized;
+	}
+
+	/**
+	 * @brief Check if a path is a regular file on disk and get its modification time
+	*/
+	bool statFile(const std::string& path, std::filesystem::file_time_type& time)
+	{
+		std::error_code error;
+		if (!std::filesystem::is_regular_file(path, error))
+			return false;
+
+		time = std::filesystem::last_write_time(path, error);
+		return !error;
+	}
+
+	/**
+	 * @brief Find a file in the mounts, or under File's base directory if nothing is mounted
+	*/
+	Location locate(std::string_view path)
+	{
+		std::vector<std::shared_ptr<const Mount>> mounts;
+		{
+			FileSystemState& state = getState();
+			std::lock_guard<std::mutex> lock(state.mutex);
+
+			mounts = state.mounts;
+		}
+
+		Location location;
+
+		if (mounts.empty())
+		{
+			location.path = glacier::File(path).getPath();
+			location.found = statFile(location.path, location.time);
+
+			return location;
+		}
+
+		std::string normalized = normalize(path);
+
+		for (const std::shared_ptr<const Mount>& mount : mounts)
+		{
+			if (normalized.compare(0, mount->mountPoint.size(), mount->mountPoint) != 0)
+				continue;
+
+			std::string relative = normalized.substr(mount->mountPoint.size());
+
+			if (mount->archive != nullptr)
+			{
+				std::unordered_map<std::string, ArchiveEntry>::const_iterator it = mount->entries.find(relative);
+				if (it == mount->entries.end())
+					continue;
+
+				// The contents share ownership of the mapping, which outlives the mount if they do
+				const uint8_t* data = static_cast<const uint8_t*>(mount->archive->data()) + it->second.offset;
+				std::shared_ptr<const uint8_t> contents(mount->archive, data);
+
+				location.found = true;
+				location.contents = glacier::FileContents(std::move(contents), static_cast<size_t>(it->second.size));
+
+				return location;
+			}
+
+			std::string candidate = mount->directory + "/" + relative;
+			if (statFile(candidate, location.time))
+			{
+				location.found = true;
+				location.path = std::move(candidate);
+
+				return location;
+			}
+		}
+
+		return location;
+	}
+
+	glacier::FileContents readFile(const std::string& path)
+	{
+		std::ifstream stream(path, std::ios::ate | std::ios::binary);
+		if (!stream)
+			throw std::runtime_error(fmt::format("Failed to read file {}", path));
+
+		size_t size = static_cast<size_t>(stream.tellg());
+		stream.seekg(0);
+
+		std::shared_ptr<uint8_t> data(new uint8_t[size], std::default_delete<uint8_t[]>());
+		if (!stream.read(reinterpret_cast<char*>(data.get()), static_cast<std::streamsize>(size)))
+			throw std::runtime_error(fmt::format("Failed to read file {}", path));
+
+		return glacier::FileContents(std::move(data), size);
+	}
+
+	/**
+	 * @brief Drop the least recently used files until the cache fits its budget. The state must be locked.
+	*/
+	void evict(FileSystemState& state)
+	{
+		while (state.statistics.cachedBytes > state.budget && !state.recency.empty())
+		{
+			std::unordered_map<std::string, CacheEntry>::iterator it = state.cache.find(state.recency.back());
+
+			state.statistics.cachedBytes -= it->second.contents.size();
+			state.statistics.cachedFiles--;
+
+			state.cache.erase(it);
+			state.recency.pop_back();
+		}
+	}
+
+	/**
+	 * @brief Remove a file from the cache. The state must be locked.
+	*/
+	void erase(FileSystemState& state, const std::string& path)
+	{
+		std::unordered_map<std::string, CacheEntry>::iterator it = state.cache.find(path);
+		if (it == state.cache.end())
+			return;
+
+		state.statistics.cachedBytes -= it->second.contents.size();
+		state.statistics.cachedFiles--;
+
+		state.recency.erase(it->second.recency);
+		state.cache.erase(it);
+	}
+}
+
+void glacier::FileSystem::mount(std::string_view path, int priority, std::string_view mountPoint)
+{
+	std::shared_ptr<Mount> mount = std::make_shared<Mount>();
+	mount->source = std::string(path);
+	mount->priority = priority;
+	mount->mountPoint = normalize(mountPoint);
+
+	if (!mount->mountPoint.empty())
+		mount->mountPoint.push_back('/');
+
+	std::error_code error;
+	if (std::filesystem::is_directory(mount->source, error))
+	{
+		mount->directory = mount->source;
+	}
+	else if (std::filesystem::is_regular_file(mount->source, error))
+	{
+		try
+		{
+			mount->archive = std::make_shared<MappedFile>(mount->source);
+			mount->entries = parseArchive(mount->archive->data(), mount->archive->size());
+		}
+		catch (const std::exception& e)
+		{
+			throw std::runtime_error(fmt::format("Failed to mount archive {}: {}", path, e.what()));
+		}
+	}
+	else
+	{
+		throw std::runtime_error(fmt::format("Failed to mount {}, it is neither a directory nor an archive", path));
+	}
+
+	FileSystemState& state = getState();
+	std::lock_guard<std::mutex> lock(state.mutex);
+
+	// Before every mount with a lower priority, and the same priority, so the newest is searched first
+	std::vector<std::shared_ptr<const Mount>>::iterator position = std::find_if(state.mounts.begin(), state.mounts.end(), [priority](const std::shared_ptr<const Mount>& other)
+		{
+			return other->priority <= priority;
+		});
+
+	state.mounts.insert(position, std::move(mount));
+
+	g_Logger->debug("Mounted {} at /{} with priority {}", path, mountPoint, priority);
+}
+
+bool glacier::FileSystem::unmount(std::string_view path)
+{
+	FileSystemState& state = getState();
+	std::lock_guard<std::mutex> lock(state.mutex);
+
+	size_t count = state.mounts.size();
+	state.mounts.erase(std::remove_if(state.mounts.begin(), state.mounts.end(), [path](const std::shared_ptr<const Mount>& mount)
+		{
+			return mount->source == path;
+		}), state.mounts.end());
+
+	return state.mounts.size() != count;
+}
+
+void glacier::FileSystem::unmountAll()
+{
+	FileSystemState& state = getState();
+	std::lock_guard<std::mutex> lock(state.mutex);
+
+	state.mounts.clear();
+	state.cache.clear();
+	state.recency.clear();
+	state.statistics.cachedBytes = 0;
+	state.statistics.cachedFiles = 0;
+}
+
+bool glacier::FileSystem::exists(std::string_view path)
+{
+	return locate(path).found;
+}
+
+glacier::FileContents glacier::FileSystem::read(std::string_view path)
+{
+	Location location = locate(path);
+	FileSystemState& state = getState();
+
+	if (!location.found)
+	{
+		if (location.path.empty())
+			throw std::runtime_error(fmt::format("Failed to read file {}, no mount has it", path));
+
+		throw std::runtime_error(fmt::format("Failed to read file {}", location.path));
+	}
+
+	// Archive contents are already in memory
+	if (location.path.empty())
+	{
+		std::lock_guard<std::mutex> lock(state.mutex);
+		state.statistics.misses++;
+
+		return location.contents;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(state.mutex);
+
+		std::unordered_map<std::string, CacheEntry>::iterator it = state.cache.find(location.path);
+		if (it != state.cache.end())
+		{
+			if (it->second.time == location.time)
+			{
+				state.statistics.hits++;
+				state.recency.splice(state.recency.begin(), state.recency, it->second.recency);
+
+				return it->second.contents;
+			}
+
+			// The file changed since it was cached
+			erase(state, location.path);
+		}
+	}
+
+	// Read without holding the lock, so other threads can use the cache meanwhile
+	FileContents contents = readFile(location.path);
+
+	std::lock_guard<std::mutex> lock(state.mutex);
+	state.statistics.misses++;
+
+	if (contents.size() <= state.budget)
+	{
+		// Another thread may have read the same file meanwhile
+		erase(state, location.path);
+
+		state.recency.push_front(location.path);
+		state.cache.emplace(location.path, CacheEntry{ contents, location.time, state.recency.begin() });
+
+		state.statistics.cachedBytes += contents.size();
+		state.statistics.cachedFiles++;
+
+		evict(state);
+	}
+
+	return contents;
+}
+
+std::string glacier::FileSystem::resolve(std::string_view path)
+{
+	Location location = locate(path);
+	return location.found ? location.path : std::string();
+}
+
+void glacier::FileSystem::invalidate(std::string_view path)
+{
+	Location location = locate(path);
+	if (location.path.empty())
+		return;
+
+	FileSystemState& state = getState();
+	std::lock_guard<std::mutex> lock(state.mutex);
+
+	erase(state, location.path);
+}
+
+void glacier::FileSystem::setCacheBudget(size_t bytes)
+{
+	FileSystemState& state = getState();
+	std::lock_guard<std::mutex> lock(state.mutex);
+
+	state.budget = bytes;
+	evict(state);
+}
+
+size_t glacier::FileSystem::getCacheBudget()
+{
+	FileSystemState& state = getState();
+	std::lock_guard<std::mutex> lock(state.mutex);
+
+	return state.budget;
+}
+
+void glacier::FileSystem::clearCache()
+{
+	FileSystemState& state = getState();
+	std::lock_guard<std::mutex> lock(state.mutex);
+
+	state.cache.clear();
+	state.recency.clear();
+	state.statistics.cachedBytes = 0;
+	state.statistics.cachedFiles = 0;
+}
+
+glacier::FileSystemStatistics glacier::FileSystem::getStatistics()
+{
+	FileSystemState& state = getState();
+	std::lock_guard<std::mutex> lock(state.mutex);
+
+	return state.statistics;
+}
+
+size_t glacier::FileSystem::createArchive(std::string_view directory, std::string_view archive)
+{
+	return writeArchive(std::string(directory), std::string(archive));
+}
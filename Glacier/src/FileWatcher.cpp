@@ -0,0 +1,182 @@
+#include "internal/FileWatcher.hpp"
+#include "common.hpp"
+
+#ifdef __linux__
+#include <cerrno>
+#include <cstring>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include <spdlog/spdlog.h>
+
+FileWatcher::FileWatcher()
+	: m_Inotify(-1), m_NextPoll(std::chrono::steady_clock::now())
+{
+#ifdef __linux__
+	m_Inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+	if (m_Inotify < 0)
+		glacier::g_Logger->warn("Failed to start inotify, polling watched files instead: {}", strerror(errno));
+#endif
+}
+
+FileWatcher::~FileWatcher()
+{
+#ifdef __linux__
+	// Closing the instance removes its watches
+	if (m_Inotify >= 0)
+		close(m_Inotify);
+#endif
+}
+
+void FileWatcher::watch(const std::string& path)
+{
+	if (m_Inotify >= 0 && watchDirectory(path))
+		return;
+
+	m_Polled[path] = readTime(path);
+}
+
+void FileWatcher::unwatch(const std::string& path)
+{
+	if (m_Polled.erase(path) != 0)
+		return;
+
+	std::filesystem::path file(path);
+	std::unordered_map<std::string, Directory>::iterator it = m_Directories.find(file.parent_path().string());
+	if (it == m_Directories.end())
+		return;
+
+	it->second.files.erase(file.filename().string());
+	if (!it->second.files.empty())
+		return;
+
+#ifdef __linux__
+	inotify_rm_watch(m_Inotify, it->second.watch);
+#endif
+
+	m_Watches.erase(it->second.watch);
+	m_Directories.erase(it);
+}
+
+std::vector<std::string> FileWatcher::poll()
+{
+	std::unordered_set<std::string> changed;
+
+	if (m_Inotify >= 0)
+		readEvents(changed);
+
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	if (!m_Polled.empty() && now >= m_NextPoll)
+	{
+		m_NextPoll = now + std::chrono::milliseconds(250);
+
+		for (std::pair<const std::string, std::filesystem::file_time_type>& pair : m_Polled)
+		{
+			std::filesystem::file_time_type time = readTime(pair.first);
+			if (time == pair.second)
+				continue;
+
+			pair.second = time;
+			changed.insert(pair.first);
+		}
+	}
+
+	return std::vector<std::string>(changed.begin(), changed.end());
+}
+
+bool FileWatcher::watchDirectory(const std::string& path)
+{
+#ifdef __linux__
+	std::filesystem::path file(path);
+	std::string directory = file.parent_path().string();
+
+	std::unordered_map<std::string, Directory>::iterator it = m_Directories.find(directory);
+	if (it == m_Directories.end())
+	{
+		// Writes are reported once the writer closes the file, so a half-written file is never reloaded
+		int watch = inotify_add_watch(m_Inotify, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+		if (watch < 0)
+		{
+			glacier::g_Logger->debug("Failed to watch directory {} with inotify, polling {} instead: {}", directory, path, strerror(errno));
+			return false;
+		}
+
+		// Two paths may name the same directory, through a link for instance, and then share its watch
+		std::unordered_map<int, std::string>::iterator existing = m_Watches.find(watch);
+		if (existing != m_Watches.end())
+		{
+			glacier::g_Logger->debug("Directory {} is already watched as {}, polling {} instead", directory, existing->second, path);
+			return false;
+		}
+
+		it = m_Directories.emplace(directory, Directory{ watch, {} }).first;
+		m_Watches.emplace(watch, directory);
+	}
+
+	it->second.files.insert(file.filename().string());
+	return true;
+#else
+	return false;
+#endif
+}
+
+void FileWatcher::readEvents(std::unordered_set<std::string>& changed)
+{
+#ifdef __linux__
+	alignas(inotify_event) char buffer[4096];
+
+	while (true)
+	{
+		ssize_t length = read(m_Inotify, buffer, sizeof(buffer));
+		if (length <= 0)
+		{
+			if (length < 0 && errno != EAGAIN && errno != EINTR)
+				glacier::g_Logger->warn("Failed to read inotify events: {}", strerror(errno));
+
+			return;
+		}
+
+		for (ssize_t offset = 0; offset < length;)
+		{
+			const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+			offset += sizeof(inotify_event) + event->len;
+
+			if (event->mask & IN_Q_OVERFLOW)
+			{
+				// Events were dropped, so any watched file may have changed
+				for (const std::pair<const std::string, Directory>& directory : m_Directories)
+				{
+					for (const std::string& name : directory.second.files)
+						changed.insert(directory.first + "/" + name);
+				}
+
+				continue;
+			}
+
+			if (event->len == 0)
+				continue;
+
+			std::unordered_map<int, std::string>::const_iterator watch = m_Watches.find(event->wd);
+			if (watch == m_Watches.end())
+				continue;
+
+			const Directory& directory = m_Directories.at(watch->second);
+
+			std::string name(event->name);
+			if (directory.files.count(name) != 0)
+				changed.insert(watch->second + "/" + name);
+		}
+	}
+#endif
+}
+
+std::filesystem::file_time_type FileWatcher::readTime(const std::string& path)
+{
+	// Editors often replace a file by deleting and renaming, so a missing file is expected now and then
+	std::error_code error;
+	std::filesystem::file_time_type time = std::filesystem::last_write_time(path, error);
+
+	return error ? std::filesystem::file_time_type::min() : time;
+}
@@ -0,0 +1,311 @@
+#include "GeometryPool.hpp"
+#include "Application.hpp"
+#include "Renderer.hpp"
+#include "internal/utility.hpp"
+#include "internal/DeletionQueue.hpp"
+#include "internal/RangeAllocator.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <vulkan/vulkan.h>
+
+#include <spdlog/fmt/fmt.h>
+
+glacier::GeometryPool::GeometryPool(const Application* application, const VertexBufferLayout& layout, uint32_t vertexCapacity, uint32_t indexCapacity)
+	: m_Application(application), m_PositionSize(0), m_Compactions(0)
+{
+	if (layout.m_Attributes.empty() || layout.m_Stride == 0)
+		throw std::runtime_error("Geometry pools need a vertex layout with attributes");
+
+	if (vertexCapacity == 0 || indexCapacity == 0)
+		throw std::runtime_error("Geometry pools need room for at least one vertex and one index");
+
+	m_VertexBuffer = std::unique_ptr<VertexBuffer>(new VertexBuffer(m_Application, layout));
+	m_IndexBuffer = std::unique_ptr<IndexBuffer>(new IndexBuffer(m_Application));
+
+	if (m_Application->m_Info.depthPrepass)
+		m_PositionSize = layout.m_Attributes[0].size;
+
+	m_Vertices = std::make_unique<RangeAllocator>(vertexCapacity);
+	m_Indices = std::make_unique<RangeAllocator>(indexCapacity);
+
+	void* buffers[3];
+	void* memory[3];
+	createBuffers(vertexCapacity, indexCapacity, buffers, memory);
+
+	m_VertexBuffer->m_Handle = buffers[0];
+	m_VertexBuffer->m_Memory = memory[0];
+	m_VertexBuffer->m_PositionHandle = buffers[1];
+	m_VertexBuffer->m_PositionMemory = memory[1];
+	m_IndexBuffer->m_Handle = buffers[2];
+	m_IndexBuffer->m_Memory = memory[2];
+}
+
+glacier::GeometryPool::~GeometryPool()
+{
+	// The buffers destroy their handles through the deletion queue
+}
+
+uint32_t glacier::GeometryPool::allocate(const void* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount)
+{
+	if (vertexCount == 0 || indexCount == 0)
+		throw std::runtime_error("Meshes in a geometry pool need vertices and indices");
+
+	reclaim();
+
+	uint32_t firstVertex = 0;
+	uint32_t firstIndex = 0;
+	bool fits = m_Vertices->allocate(vertexCount, firstVertex);
+	if (fits && !m_Indices->allocate(indexCount, firstIndex))
+	{
+		m_Vertices->free(firstVertex, vertexCount);
+		fits = false;
+	}
+
+	if (!fits)
+	{
+		// Compacting is enough if the free space only needs to be put in one piece, otherwise grow to at least twice the size
+		uint32_t vertexCapacity = m_Vertices->getCapacity();
+		uint32_t indexCapacity = m_Indices->getCapacity();
+
+		uint32_t usedVertices = vertexCapacity - m_Vertices->getFreeSize();
+		uint32_t usedIndices = indexCapacity - m_Indices->getFreeSize();
+
+		if (static_cast<uint64_t>(usedVertices) + vertexCount > UINT32_MAX || static_cast<uint64_t>(usedIndices) + indexCount > UINT32_MAX)
+			throw std::runtime_error("Geometry pool is limited to 2^32 vertices and indices");
+
+		if (usedVertices + vertexCount > vertexCapacity)
+			vertexCapacity = static_cast<uint32_t>(std::min<uint64_t>(UINT32_MAX, std::max<uint64_t>(2ull * vertexCapacity, usedVertices + vertexCount)));
+
+		if (usedIndices + indexCount > indexCapacity)
+			indexCapacity = static_cast<uint32_t>(std::min<uint64_t>(UINT32_MAX, std::max<uint64_t>(2ull * indexCapacity, usedIndices + indexCount)));
+
+		rebuild(vertexCapacity, indexCapacity);
+
+		m_Vertices->allocate(vertexCount, firstVertex);
+		m_Indices->allocate(indexCount, firstIndex);
+	}
+
+	VkDevice device = static_cast<VkDevice>(m_Application->m_Device);
+	VkPhysicalDevice physicalDevice = static_cast<VkPhysicalDevice>(m_Application->m_PhysicalDevice);
+
+	uint32_t stride = m_VertexBuffer->m_Layout.m_Stride;
+	VkDeviceSize vertexSize = static_cast<VkDeviceSize>(vertexCount) * stride;
+	VkDeviceSize positionSize = static_cast<VkDeviceSize>(vertexCount) * m_PositionSize;
+	VkDeviceSize indexSize = static_cast<VkDeviceSize>(indexCount) * sizeof(uint32_t);
+
+	/* Stage vertices, positions and indices in one buffer */
+	VkBuffer stagingBuffer;
+	VkDeviceMemory stagingBufferMemory;
+	createBuffer(device, physicalDevice, vertexSize + positionSize + indexSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &stagingBuffer, &stagingBufferMemory);
+
+	void* tmp;
+	vkMapMemory(device, stagingBufferMemory, 0, vertexSize + positionSize + indexSize, 0, &tmp);
+
+	char* staging = static_cast<char*>(tmp);
+	memcpy(staging, vertices, vertexSize);
+
+	if (m_PositionSize > 0)
+	{
+		const char* src = static_cast<const char*>(vertices) + m_VertexBuffer->m_Layout.m_Attributes[0].offset;
+		for (uint32_t i = 0; i < vertexCount; i++)
+			memcpy(staging + vertexSize + static_cast<size_t>(i) * m_PositionSize, src + static_cast<size_t>(i) * stride, m_PositionSize);
+	}
+
+	memcpy(staging + vertexSize + positionSize, indices, indexSize);
+	vkUnmapMemory(device, stagingBufferMemory);
+
+	/* Copy each part to the mesh's place in the pool */
+	std::vector<BufferCopy> copies;
+	copies.push_back(BufferCopy{ stagingBuffer, static_cast<VkBuffer>(m_VertexBuffer->m_Handle), VkBufferCopy{ 0, static_cast<VkDeviceSize>(firstVertex) * stride, vertexSize } });
+	copies.push_back(BufferCopy{ stagingBuffer, static_cast<VkBuffer>(m_IndexBuffer->m_Handle), VkBufferCopy{ vertexSize + positionSize, static_cast<VkDeviceSize>(firstIndex) * sizeof(uint32_t), indexSize } });
+
+	if (m_PositionSize > 0)
+		copies.push_back(BufferCopy{ stagingBuffer, static_cast<VkBuffer>(m_VertexBuffer->m_PositionHandle), VkBufferCopy{ vertexSize, static_cast<VkDeviceSize>(firstVertex) * m_PositionSize, positionSize } });
+
+	uint64_t value = ++m_Application->m_TimelineValue;
+	copyBufferRegions(device, static_cast<VkCommandPool>(m_Application->m_Renderer->m_CommandPool), static_cast<VkQueue>(m_Application->m_Renderer->m_GraphicsQueue), static_cast<VkSemaphore>(m_Application->m_Timeline), value, copies.data(), copies.size());
+
+	m_VertexBuffer->m_LastUsage = value;
+	m_IndexBuffer->m_LastUsage = value;
+
+	vkDestroyBuffer(device, stagingBuffer, nullptr);
+	vkFreeMemory(device, stagingBufferMemory, nullptr);
+
+	Entry entry = { GeometryRange{ firstIndex, static_cast<int32_t>(firstVertex), indexCount, vertexCount }, true };
+
+	if (!m_FreeHandles.empty())
+	{
+		uint32_t handle = m_FreeHandles.back();
+		m_FreeHandles.pop_back();
+
+		m_Entries[handle] = entry;
+		return handle;
+	}
+
+	m_Entries.push_back(entry);
+	return static_cast<uint32_t>(m_Entries.size() - 1);
+}
+
+void glacier::GeometryPool::free(uint32_t handle)
+{
+	if (handle >= m_Entries.size() || !m_Entries[handle].allocated)
+		throw std::runtime_error(fmt::format("Geometry pool has no mesh {}", handle));
+
+	Entry& entry = m_Entries[handle];
+	entry.allocated = false;
+	m_FreeHandles.push_back(handle);
+
+	// Frames still in flight may draw the mesh, so its space waits for them. The buffers only know the last recorded frame, so it also waits for the frame being built.
+	uint64_t lastUsage = std::max({ m_VertexBuffer->m_LastUsage, m_IndexBuffer->m_LastUsage, m_Application->m_TimelineValue + 1 });
+	m_PendingFrees.push_back(PendingFree{ lastUsage, static_cast<uint32_t>(entry.range.vertexOffset), entry.range.vertexCount, entry.range.firstIndex, entry.range.indexCount });
+}
+
+void glacier::GeometryPool::compact()
+{
+	rebuild(m_Vertices->getCapacity(), m_Indices->getCapacity());
+}
+
+const glacier::GeometryRange& glacier::GeometryPool::getRange(uint32_t handle) const
+{
+	if (handle >= m_Entries.size() || !m_Entries[handle].allocated)
+		throw std::runtime_error(fmt::format("Geometry pool has no mesh {}", handle));
+
+	return m_Entries[handle].range;
+}
+
+const glacier::VertexBuffer& glacier::GeometryPool::getVertexBuffer() const
+{
+	return *m_VertexBuffer;
+}
+
+const glacier::IndexBuffer& glacier::GeometryPool::getIndexBuffer() const
+{
+	return *m_IndexBuffer;
+}
+
+glacier::GeometryPoolStatistics glacier::GeometryPool::getStatistics() const
+{
+	GeometryPoolStatistics statistics;
+	statistics.meshes = static_cast<uint32_t>(m_Entries.size() - m_FreeHandles.size());
+	statistics.vertexCapacity = m_Vertices->getCapacity();
+	statistics.freeVertices = m_Vertices->getFreeSize();
+	statistics.indexCapacity = m_Indices->getCapacity();
+	statistics.freeIndices = m_Indices->getFreeSize();
+	statistics.compactions = m_Compactions;
+
+	return statistics;
+}
+
+void glacier::GeometryPool::reclaim()
+{
+	if (m_PendingFrees.empty())
+		return;
+
+	uint64_t completedValue = 0;
+	vkGetSemaphoreCounterValue(static_cast<VkDevice>(m_Application->m_Device), static_cast<VkSemaphore>(m_Application->m_Timeline), &completedValue);
+
+	std::vector<PendingFree>::iterator end = std::remove_if(m_PendingFrees.begin(), m_PendingFrees.end(), [this, completedValue](const PendingFree& pending) -> bool
+		{
+			if (pending.lastUsage > completedValue)
+				return false;
+
+			m_Vertices->free(pending.firstVertex, pending.vertexCount);
+			m_Indices->free(pending.firstIndex, pending.indexCount);
+			return true;
+		});
+
+	m_PendingFrees.erase(end, m_PendingFrees.end());
+}
+
+void glacier::GeometryPool::rebuild(uint32_t vertexCapacity, uint32_t indexCapacity)
+{
+	VkDevice device = static_cast<VkDevice>(m_Application->m_Device);
+
+	void* buffers[3];
+	void* memory[3];
+	createBuffers(vertexCapacity, indexCapacity, buffers, memory);
+
+	/* Copy the meshes in order of their vertices, packed at the start of the new buffers */
+	std::vector<uint32_t> order;
+	for (uint32_t i = 0; i < m_Entries.size(); i++)
+	{
+		if (m_Entries[i].allocated)
+			order.push_back(i);
+	}
+
+	std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) { return m_Entries[a].range.vertexOffset < m_Entries[b].range.vertexOffset; });
+
+	uint32_t stride = m_VertexBuffer->m_Layout.m_Stride;
+	uint32_t vertexCount = 0;
+	uint32_t indexCount = 0;
+
+	std::vector<BufferCopy> copies;
+	copies.reserve(order.size() * 3);
+
+	for (uint32_t handle : order)
+	{
+		GeometryRange& range = m_Entries[handle].range;
+		VkDeviceSize firstVertex = static_cast<VkDeviceSize>(range.vertexOffset);
+
+		copies.push_back(BufferCopy{ static_cast<VkBuffer>(m_VertexBuffer->m_Handle), static_cast<VkBuffer>(buffers[0]), VkBufferCopy{ firstVertex * stride, static_cast<VkDeviceSize>(vertexCount) * stride, static_cast<VkDeviceSize>(range.vertexCount) * stride } });
+		copies.push_back(BufferCopy{ static_cast<VkBuffer>(m_IndexBuffer->m_Handle), static_cast<VkBuffer>(buffers[2]), VkBufferCopy{ range.firstIndex * sizeof(uint32_t), static_cast<VkDeviceSize>(indexCount) * sizeof(uint32_t), range.indexCount * sizeof(uint32_t) } });
+
+		if (m_PositionSize > 0)
+			copies.push_back(BufferCopy{ static_cast<VkBuffer>(m_VertexBuffer->m_PositionHandle), static_cast<VkBuffer>(buffers[1]), VkBufferCopy{ firstVertex * m_PositionSize, static_cast<VkDeviceSize>(vertexCount) * m_PositionSize, static_cast<VkDeviceSize>(range.vertexCount) * m_PositionSize } });
+
+		range.vertexOffset = static_cast<int32_t>(vertexCount);
+		range.firstIndex = indexCount;
+
+		vertexCount += range.vertexCount;
+		indexCount += range.indexCount;
+	}
+
+	uint64_t value = ++m_Application->m_TimelineValue;
+	if (!copies.empty())
+		copyBufferRegions(device, static_cast<VkCommandPool>(m_Application->m_Renderer->m_CommandPool), static_cast<VkQueue>(m_Application->m_Renderer->m_GraphicsQueue), static_cast<VkSemaphore>(m_Application->m_Timeline), value, copies.data(), copies.size());
+
+	/* Frames in flight still read the old buffers */
+	uint64_t lastUsage = std::max({ m_VertexBuffer->m_LastUsage, m_IndexBuffer->m_LastUsage, copies.empty() ? 0 : value });
+	DeletionQueue* deletionQueue = m_Application->m_DeletionQueue;
+	deletionQueue->destroy(VK_OBJECT_TYPE_BUFFER, m_VertexBuffer->m_Handle, lastUsage);
+	deletionQueue->destroy(VK_OBJECT_TYPE_DEVICE_MEMORY, m_VertexBuffer->m_Memory, lastUsage);
+	deletionQueue->destroy(VK_OBJECT_TYPE_BUFFER, m_VertexBuffer->m_PositionHandle, lastUsage);
+	deletionQueue->destroy(VK_OBJECT_TYPE_DEVICE_MEMORY, m_VertexBuffer->m_PositionMemory, lastUsage);
+	deletionQueue->destroy(VK_OBJECT_TYPE_BUFFER, m_IndexBuffer->m_Handle, lastUsage);
+	deletionQueue->destroy(VK_OBJECT_TYPE_DEVICE_MEMORY, m_IndexBuffer->m_Memory, lastUsage);
+
+	m_VertexBuffer->m_Handle = buffers[0];
+	m_VertexBuffer->m_Memory = memory[0];
+	m_VertexBuffer->m_PositionHandle = buffers[1];
+	m_VertexBuffer->m_PositionMemory = memory[1];
+	m_IndexBuffer->m_Handle = buffers[2];
+	m_IndexBuffer->m_Memory = memory[2];
+
+	m_VertexBuffer->m_LastUsage = copies.empty() ? 0 : value;
+	m_IndexBuffer->m_LastUsage = copies.empty() ? 0 : value;
+
+	// Freed meshes weren't copied, so their space is free at once
+	m_PendingFrees.clear();
+	m_Vertices->reset(vertexCount, vertexCapacity);
+	m_Indices->reset(indexCount, indexCapacity);
+
+	m_Compactions++;
+}
+
+void glacier::GeometryPool::createBuffers(uint32_t vertexCapacity, uint32_t indexCapacity, void* buffers[3], void* memory[3]) const
+{
+	VkDevice device = static_cast<VkDevice>(m_Application->m_Device);
+	VkPhysicalDevice physicalDevice = static_cast<VkPhysicalDevice>(m_Application->m_PhysicalDevice);
+
+	// Buffers are both copied into and out of, when the pool is rebuilt
+	createBuffer(device, physicalDevice, static_cast<VkDeviceSize>(vertexCapacity) * m_VertexBuffer->m_Layout.m_Stride, VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, reinterpret_cast<VkBuffer*>(&buffers[0]), reinterpret_cast<VkDeviceMemory*>(&memory[0]));
+	createBuffer(device, physicalDevice, static_cast<VkDeviceSize>(indexCapacity) * sizeof(uint32_t), VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, reinterpret_cast<VkBuffer*>(&buffers[2]), reinterpret_cast<VkDeviceMemory*>(&memory[2]));
+
+	buffers[1] = nullptr;
+	memory[1] = nullptr;
+
+	if (m_PositionSize > 0)
+		createBuffer(device, physicalDevice, static_cast<VkDeviceSize>(vertexCapacity) * m_PositionSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, reinterpret_cast<VkBuffer*>(&buffers[1]), reinterpret_cast<VkDeviceMemory*>(&memory[1]));
+}
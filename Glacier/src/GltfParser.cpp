@@ -0,0 +1,583 @@
+#include "internal/GltfParser.hpp"
+#include "internal/Json.hpp"
+#include "internal/MappedFile.hpp"
+#include "internal/ThreadPool.hpp"
+#include "common.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string_view>
+
+#include <spdlog/spdlog.h>
+
+namespace
+{
+	constexpr uint32_t GLB_MAGIC = 0x46546c67;
+	constexpr uint32_t GLB_VERSION = 2;
+	constexpr uint32_t GLB_CHUNK_JSON = 0x4e4f534a;
+	constexpr uint32_t GLB_CHUNK_BIN = 0x004e4942;
+
+	constexpr uint32_t COMPONENT_BYTE = 5120;
+	constexpr uint32_t COMPONENT_UNSIGNED_BYTE = 5121;
+	constexpr uint32_t COMPONENT_SHORT = 5122;
+	constexpr uint32_t COMPONENT_UNSIGNED_SHORT = 5123;
+	constexpr uint32_t COMPONENT_UNSIGNED_INT = 5125;
+	constexpr uint32_t COMPONENT_FLOAT = 5126;
+
+	constexpr uint32_t MODE_TRIANGLES = 4;
+
+	/* Vertices or indices converted per job */
+	constexpr uint32_t RANGE_SIZE = 1 << 16;
+
+	/**
+	 * @brief The contents of a buffer, owned by the file, a mapping or a decoded data URI
+	*/
+	struct BufferData
+	{
+		const uint8_t* data;
+		size_t size;
+	};
+
+	/**
+	 * @brief An accessor resolved to the memory of its buffer
+	*/
+	struct Accessor
+	{
+		/* The first element */
+		const uint8_t* data;
+		size_t stride;
+
+		uint32_t count;
+		uint32_t componentType;
+		uint32_t components;
+		bool normalized;
+	};
+
+	struct Primitive
+	{
+		Accessor positions;
+		Accessor normals;
+		Accessor uvs;
+		Accessor indices;
+
+		bool hasNormals;
+		bool hasUvs;
+		bool hasIndices;
+
+		uint32_t vertexCount;
+		uint32_t indexCount;
+
+		size_t firstVertex;
+		size_t firstIndex;
+	};
+
+	/**
+	 * @brief A part of a primitive converted by one job
+	*/
+	struct Range
+	{
+		size_t primitive;
+		bool indices;
+		uint32_t first;
+		uint32_t count;
+	};
+
+	uint32_t readUint32(const uint8_t* data)
+	{
+		uint32_t value;
+		memcpy(&value, data, sizeof(value));
+
+		return value;
+	}
+
+	uint32_t getComponentSize(uint32_t componentType)
+	{
+		switch (componentType)
+		{
+		case COMPONENT_BYTE:
+		case COMPONENT_UNSIGNED_BYTE:
+			return 1;
+		case COMPONENT_SHORT:
+		case COMPONENT_UNSIGNED_SHORT:
+			return 2;
+		case COMPONENT_UNSIGNED_INT:
+		case COMPONENT_FLOAT:
+			return 4;
+		default:
+			throw std::runtime_error(fmt::format("Unknown glTF component type {}", componentType));
+		}
+	}
+
+	uint32_t getTypeComponents(const std::string& type)
+	{
+		if (type == "SCALAR")
+			return 1;
+		else if (type == "VEC2")
+			return 2;
+		else if (type == "VEC3")
+			return 3;
+		else if (type == "VEC4")
+			return 4;
+
+		throw std::runtime_error(fmt::format("glTF accessors of type {} aren't supported", type));
+	}
+
+	uint32_t getUint(const JsonValue& object, std::string_view key, uint32_t fallback)
+	{
+		const JsonValue* value = object.find(key);
+		return value == nullptr ? fallback : value->getUint(key);
+	}
+
+	std::vector<uint8_t> decodeBase64(std::string_view text)
+	{
+		std::vector<uint8_t> data;
+		data.reserve(text.size() / 4 * 3);
+
+		uint32_t bits = 0;
+		uint32_t bitCount = 0;
+
+		for (char c : text)
+		{
+			uint32_t value;
+			if (c >= 'A' && c <= 'Z')
+				value = c - 'A';
+			else if (c >= 'a' && c <= 'z')
+				value = c - 'a' + 26;
+			else if (c >= '0' && c <= '9')
+				value = c - '0' + 52;
+			else if (c == '+')
+				value = 62;
+			else if (c == '/')
+				value = 63;
+			else if (c == '=')
+				break;
+			else
+				throw std::runtime_error("Invalid base64 in a glTF data URI");
+
+			bits = (bits << 6) | value;
+			bitCount += 6;
+
+			if (bitCount >= 8)
+			{
+				bitCount -= 8;
+				data.push_back(static_cast<uint8_t>(bits >> bitCount));
+			}
+		}
+
+		return data;
+	}
+
+	/**
+	 * @brief Undo the percent-encoding of a relative URI
+	*/
+	std::string decodeUri(std::string_view uri)
+	{
+		std::string path;
+		path.reserve(uri.size());
+
+		for (size_t i = 0; i < uri.size(); i++)
+		{
+			uint32_t value = 0;
+			if (uri[i] == '%' && i + 2 < uri.size() && std::from_chars(uri.data() + i + 1, uri.data() + i + 3, value, 16).ptr == uri.data() + i + 3)
+			{
+				path.push_back(static_cast<char>(value));
+				i += 2;
+			}
+			else
+			{
+				path.push_back(uri[i]);
+			}
+		}
+
+		return path;
+	}
+
+	Accessor resolveAccessor(const JsonValue& root, const std::vector<BufferData>& buffers, uint32_t index)
+	{
+		const JsonValue& accessor = root.at("accessors").at(index);
+
+		if (accessor.find("sparse") != nullptr)
+			throw std::runtime_error(fmt::format("glTF accessor {} is sparse, sparse accessors aren't supported", index));
+
+		if (accessor.find("bufferView") == nullptr)
+			throw std::runtime_error(fmt::format("glTF accessor {} has no buffer view", index));
+
+		Accessor result;
+		result.count = accessor.at("count").getUint("accessor count");
+		result.componentType = accessor.at("componentType").getUint("accessor componentType");
+		result.components = getTypeComponents(accessor.at("type").getString());
+
+		const JsonValue* normalized = accessor.find("normalized");
+		result.normalized = normalized != nullptr && normalized->getBoolean();
+
+		const JsonValue& view = root.at("bufferViews").at(accessor.at("bufferView").getUint("accessor bufferView"));
+		uint32_t buffer = view.at("buffer").getUint("bufferView buffer");
+		if (buffer >= buffers.size())
+			throw std::runtime_error(fmt::format("glTF accessor {} uses missing buffer {}", index, buffer));
+
+		uint64_t viewOffset = getUint(view, "byteOffset", 0);
+		uint64_t viewLength = view.at("byteLength").getUint("bufferView byteLength");
+		uint64_t offset = getUint(accessor, "byteOffset", 0);
+
+		uint64_t elementSize = static_cast<uint64_t>(getComponentSize(result.componentType)) * result.components;
+		result.stride = getUint(view, "byteStride", static_cast<uint32_t>(elementSize));
+
+		if (result.stride < elementSize)
+			throw std::runtime_error(fmt::format("glTF accessor {} has a stride of {} for elements of {} bytes", index, result.stride, elementSize));
+
+		uint64_t end = result.count == 0 ? offset : offset + result.stride * (result.count - 1ull) + elementSize;
+		if (viewOffset + viewLength > buffers[buffer].size || end > viewLength)
+			throw std::runtime_error(fmt::format("glTF accessor {} reaches past the end of its buffer", index));
+
+		result.data = buffers[buffer].data + viewOffset + offset;
+		return result;
+	}
+
+	float readComponent(const uint8_t* data, uint32_t componentType, bool normalized)
+	{
+		// The normalized conversions follow the glTF specification, integers that aren't normalized keep their value
+		switch (componentType)
+		{
+		case COMPONENT_BYTE:
+		{
+			int8_t value = static_cast<int8_t>(*data);
+			return normalized ? std::max(value / 127.0f, -1.0f) : value;
+		}
+		case COMPONENT_UNSIGNED_BYTE:
+			return normalized ? *data / 255.0f : *data;
+		case COMPONENT_SHORT:
+		{
+			int16_t value;
+			memcpy(&value, data, sizeof(value));
+			return normalized ? std::max(value / 32767.0f, -1.0f) : value;
+		}
+		case COMPONENT_UNSIGNED_SHORT:
+		{
+			uint16_t value;
+			memcpy(&value, data, sizeof(value));
+			return normalized ? value / 65535.0f : value;
+		}
+		case COMPONENT_UNSIGNED_INT:
+			return static_cast<float>(readUint32(data));
+		default:
+		{
+			float value;
+			memcpy(&value, data, sizeof(value));
+			return value;
+		}
+		}
+	}
+
+	/**
+	 * @brief Convert elements of an accessor into tightly packed floats
+	 * @param components Floats per element written, missing components are 0 and extra ones are dropped
+	*/
+	void readFloats(const Accessor& accessor, uint32_t first, uint32_t count, uint32_t components, float* out)
+	{
+		const uint8_t* data = accessor.data + accessor.stride * first;
+
+		if (accessor.componentType == COMPONENT_FLOAT && accessor.components == components)
+		{
+			size_t size = components * sizeof(float);
+			if (accessor.stride == size)
+			{
+				memcpy(out, data, size * count);
+				return;
+			}
+
+			for (uint32_t i = 0; i < count; i++)
+				memcpy(out + static_cast<size_t>(i) * components, data + accessor.stride * i, size);
+
+			return;
+		}
+
+		uint32_t componentSize = getComponentSize(accessor.componentType);
+		uint32_t read = std::min(accessor.components, components);
+
+		for (uint32_t i = 0; i < count; i++)
+		{
+			const uint8_t* element = data + accessor.stride * i;
+			float* value = out + static_cast<size_t>(i) * components;
+
+			for (uint32_t c = 0; c < read; c++)
+				value[c] = readComponent(element + c * componentSize, accessor.componentType, accessor.normalized);
+
+			for (uint32_t c = read; c < components; c++)
+				value[c] = 0.0f;
+		}
+	}
+
+	/**
+	 * @brief Read indices of a primitive and offset them to the primitive's first vertex
+	*/
+	void readIndices(const Primitive& primitive, uint32_t first, uint32_t count, uint32_t* out)
+	{
+		const Accessor& accessor = primitive.indices;
+		uint32_t base = static_cast<uint32_t>(primitive.firstVertex);
+
+		for (uint32_t i = 0; i < count; i++)
+		{
+			const uint8_t* element = accessor.data + accessor.stride * (first + i);
+
+			uint32_t index;
+			if (accessor.componentType == COMPONENT_UNSIGNED_BYTE)
+			{
+				index = *element;
+			}
+			else if (accessor.componentType == COMPONENT_UNSIGNED_SHORT)
+			{
+				uint16_t value;
+				memcpy(&value, element, sizeof(value));
+				index = value;
+			}
+			else
+			{
+				index = readUint32(element);
+			}
+
+			if (index >= primitive.vertexCount)
+				throw std::runtime_error(fmt::format("glTF index {} is out of range, the primitive has {} vertices", index, primitive.vertexCount));
+
+			out[i] = base + index;
+		}
+	}
+
+	/**
+	 * @brief Find the JSON and binary chunks of a .glb file
+	*/
+	void splitGlb(const uint8_t* data, size_t size, std::string_view& json, BufferData& binary)
+	{
+		if (size < 20 || readUint32(data + 4) != GLB_VERSION)
+			throw std::runtime_error(fmt::format("Only version {} binary glTF files are supported", GLB_VERSION));
+
+		size_t length = std::min<size_t>(readUint32(data + 8), size);
+		size_t offset = 12;
+
+		binary = BufferData{ nullptr, 0 };
+		bool hasJson = false;
+
+		while (offset + 8 <= length)
+		{
+			uint32_t chunkLength = readUint32(data + offset);
+			uint32_t chunkType = readUint32(data + offset + 4);
+			offset += 8;
+
+			if (chunkLength > length - offset)
+				throw std::runtime_error("Binary glTF chunk is truncated");
+
+			if (chunkType == GLB_CHUNK_JSON && !hasJson)
+			{
+				json = std::string_view(reinterpret_cast<const char*>(data + offset), chunkLength);
+				hasJson = true;
+			}
+			else if (chunkType == GLB_CHUNK_BIN && binary.data == nullptr)
+			{
+				binary = BufferData{ data + offset, chunkLength };
+			}
+
+			// Chunks are padded to 4 bytes
+			offset += (static_cast<size_t>(chunkLength) + 3) & ~static_cast<size_t>(3);
+		}
+
+		if (!hasJson)
+			throw std::runtime_error("Binary glTF file has no JSON chunk");
+	}
+}
+
+void parseGltf(const void* data, size_t size, const std::string& directory, ThreadPool& threadPool, ImportedGeometry& geometry)
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+
+	std::string_view json(static_cast<const char*>(data), size);
+	BufferData binary = { nullptr, 0 };
+
+	if (size >= 4 && readUint32(bytes) == GLB_MAGIC)
+		splitGlb(bytes, size, json, binary);
+
+	JsonValue root = JsonValue::parse(json.data(), json.size());
+
+	const std::string& version = root.at("asset").at("version").getString();
+	if (version.empty() || version[0] != '2')
+		throw std::runtime_error(fmt::format("glTF version {} isn't supported, expected 2.0", version));
+
+	// Quantized attributes are converted like any other integer attribute, everything else changes how the data has to be read
+	if (const JsonValue* required = root.find("extensionsRequired"))
+	{
+		for (const JsonValue& extension : required->getArray())
+		{
+			if (extension.getString() != "KHR_mesh_quantization")
+				throw std::runtime_error(fmt::format("glTF file requires the unsupported extension {}", extension.getString()));
+		}
+	}
+
+	/* Load the buffers */
+	std::vector<BufferData> buffers;
+	std::vector<std::vector<uint8_t>> decodedBuffers;
+	std::vector<std::unique_ptr<MappedFile>> mappedBuffers;
+
+	if (const JsonValue* bufferArray = root.find("buffers"))
+	{
+		decodedBuffers.reserve(bufferArray->getArray().size());
+
+		for (const JsonValue& buffer : bufferArray->getArray())
+		{
+			size_t byteLength = buffer.at("byteLength").getUint("buffer byteLength");
+			const JsonValue* uri = buffer.find("uri");
+
+			BufferData contents;
+			if (uri == nullptr)
+			{
+				if (buffers.size() != 0 || binary.data == nullptr)
+					throw std::runtime_error("glTF buffer without a URI, only the first buffer of a binary glTF file can have none");
+
+				contents = binary;
+			}
+			else if (uri->getString().compare(0, 5, "data:") == 0)
+			{
+				const std::string& text = uri->getString();
+				size_t separator = text.find(";base64,");
+				if (separator == std::string::npos)
+					throw std::runtime_error("glTF data URIs have to be base64");
+
+				decodedBuffers.push_back(decodeBase64(std::string_view(text).substr(separator + 8)));
+				contents = BufferData{ decodedBuffers.back().data(), decodedBuffers.back().size() };
+			}
+			else
+			{
+				mappedBuffers.push_back(std::make_unique<MappedFile>(directory + decodeUri(uri->getString())));
+				contents = BufferData{ static_cast<const uint8_t*>(mappedBuffers.back()->data()), mappedBuffers.back()->size() };
+			}
+
+			if (contents.size < byteLength)
+				throw std::runtime_error(fmt::format("glTF buffer {} holds {} bytes but declares {}", buffers.size(), contents.size, byteLength));
+
+			buffers.push_back(BufferData{ contents.data, byteLength });
+		}
+	}
+
+	/* Resolve the triangle primitives of every mesh */
+	std::vector<Primitive> primitives;
+	size_t vertexCount = 0;
+	size_t indexCount = 0;
+	geometry.missingNormals = false;
+
+	if (const JsonValue* meshes = root.find("meshes"))
+	{
+		for (const JsonValue& mesh : meshes->getArray())
+		{
+			for (const JsonValue& primitiveObject : mesh.at("primitives").getArray())
+			{
+				uint32_t mode = getUint(primitiveObject, "mode", MODE_TRIANGLES);
+				if (mode != MODE_TRIANGLES)
+				{
+					glacier::g_Logger->warn("Skipping a glTF primitive of mode {}, only triangle lists are imported", mode);
+					continue;
+				}
+
+				const JsonValue& attributes = primitiveObject.at("attributes");
+
+				Primitive primitive = {};
+				primitive.positions = resolveAccessor(root, buffers, attributes.at("POSITION").getUint("POSITION"));
+				primitive.vertexCount = primitive.positions.count;
+
+				if (const JsonValue* normals = attributes.find("NORMAL"))
+				{
+					primitive.normals = resolveAccessor(root, buffers, normals->getUint("NORMAL"));
+					primitive.hasNormals = true;
+				}
+
+				if (const JsonValue* uvs = attributes.find("TEXCOORD_0"))
+				{
+					primitive.uvs = resolveAccessor(root, buffers, uvs->getUint("TEXCOORD_0"));
+					primitive.hasUvs = true;
+				}
+
+				if (const JsonValue* indices = primitiveObject.find("indices"))
+				{
+					primitive.indices = resolveAccessor(root, buffers, indices->getUint("indices"));
+					primitive.hasIndices = true;
+
+					uint32_t type = primitive.indices.componentType;
+					if (primitive.indices.components != 1 || (type != COMPONENT_UNSIGNED_BYTE && type != COMPONENT_UNSIGNED_SHORT && type != COMPONENT_UNSIGNED_INT))
+						throw std::runtime_error("glTF indices have to be unsigned scalars");
+				}
+
+				primitive.indexCount = primitive.hasIndices ? primitive.indices.count : primitive.vertexCount;
+
+				if ((primitive.hasNormals && primitive.normals.count != primitive.vertexCount) || (primitive.hasUvs && primitive.uvs.count != primitive.vertexCount))
+					throw std::runtime_error("glTF primitive attributes have different vertex counts");
+
+				if (primitive.indexCount % 3 != 0)
+					throw std::runtime_error(fmt::format("glTF triangle list has {} indices, which isn't a multiple of 3", primitive.indexCount));
+
+				if (primitive.vertexCount == 0 || primitive.indexCount == 0)
+					continue;
+
+				primitive.firstVertex = vertexCount;
+				primitive.firstIndex = indexCount;
+				vertexCount += primitive.vertexCount;
+				indexCount += primitive.indexCount;
+
+				geometry.missingNormals |= !primitive.hasNormals;
+				primitives.push_back(primitive);
+			}
+		}
+	}
+
+	if (vertexCount == 0 || indexCount == 0)
+		throw std::runtime_error("glTF file has no triangles");
+
+	if (vertexCount > UINT32_MAX || indexCount > UINT32_MAX)
+		throw std::runtime_error(fmt::format("glTF file has {} vertices and {} indices, meshes are limited to {} of each", vertexCount, indexCount, UINT32_MAX));
+
+	geometry.positions.assign(vertexCount * 3, 0.0f);
+	geometry.normals.assign(vertexCount * 3, 0.0f);
+	geometry.uvs.assign(vertexCount * 2, 0.0f);
+	geometry.indices.resize(indexCount);
+
+	/* Convert in ranges, so a single large primitive still uses every thread */
+	std::vector<Range> ranges;
+	for (size_t i = 0; i < primitives.size(); i++)
+	{
+		for (uint32_t first = 0; first < primitives[i].vertexCount; first += RANGE_SIZE)
+			ranges.push_back(Range{ i, false, first, std::min(RANGE_SIZE, primitives[i].vertexCount - first) });
+
+		for (uint32_t first = 0; first < primitives[i].indexCount; first += RANGE_SIZE)
+			ranges.push_back(Range{ i, true, first, std::min(RANGE_SIZE, primitives[i].indexCount - first) });
+	}
+
+	threadPool.parallelFor(ranges.size(), [&ranges, &primitives, &geometry](size_t i)
+		{
+			const Range& range = ranges[i];
+			const Primitive& primitive = primitives[range.primitive];
+
+			if (range.indices)
+			{
+				uint32_t* out = geometry.indices.data() + primitive.firstIndex + range.first;
+
+				if (primitive.hasIndices)
+				{
+					readIndices(primitive, range.first, range.count, out);
+				}
+				else
+				{
+					for (uint32_t j = 0; j < range.count; j++)
+						out[j] = static_cast<uint32_t>(primitive.firstVertex) + range.first + j;
+				}
+
+				return;
+			}
+
+			size_t vertex = primitive.firstVertex + range.first;
+			readFloats(primitive.positions, range.first, range.count, 3, geometry.positions.data() + vertex * 3);
+
+			if (primitive.hasNormals)
+				readFloats(primitive.normals, range.first, range.count, 3, geometry.normals.data() + vertex * 3);
+
+			if (primitive.hasUvs)
+				readFloats(primitive.uvs, range.first, range.count, 2, geometry.uvs.data() + vertex * 2);
+		});
+}
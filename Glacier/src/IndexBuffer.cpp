@@ -2,11 +2,19 @@
 #include "Application.hpp"
 #include "Renderer.hpp"
 #include "internal/utility.hpp"
+#include "internal/DeletionQueue.hpp"
+#include "internal/TextureUploader.hpp"
 
+#include <cstring>
 #include <stdexcept>
 #include <vulkan/vulkan.h>
 
 glacier::IndexBuffer::IndexBuffer(const Application* application, const uint32_t* data, uint64_t size)
+	: IndexBuffer(application, size, [data, size](void* indices) { memcpy(indices, data, size); })
+{
+}
+
+glacier::IndexBuffer::IndexBuffer(const Application* application, uint64_t size, const std::function<void(void* indices)>& write)
 	: m_Application(application)
 {
 	/* Create a staging buffer */
@@ -17,23 +25,47 @@ glacier::IndexBuffer::IndexBuffer(const Application* application, const uint32_t
 	/* Copy data to the staging buffer */
 	void* tmp;
 	vkMapMemory(static_cast<VkDevice>(m_Application->m_Device), stagingBufferMemory, 0, size, 0, &tmp);
-	memcpy(tmp, data, size);
+	try
+	{
+		write(tmp);
+	}
+	catch (...)
+	{
+		vkUnmapMemory(static_cast<VkDevice>(m_Application->m_Device), stagingBufferMemory);
+		vkDestroyBuffer(static_cast<VkDevice>(m_Application->m_Device), stagingBuffer, nullptr);
+		vkFreeMemory(static_cast<VkDevice>(m_Application->m_Device), stagingBufferMemory, nullptr);
+		throw;
+	}
+
 	vkUnmapMemory(static_cast<VkDevice>(m_Application->m_Device), stagingBufferMemory);
 
 	/* Copy data from the staging buffer to the index buffer on the GPU */
 	createBuffer(static_cast<VkDevice>(m_Application->m_Device), static_cast<VkPhysicalDevice>(m_Application->m_PhysicalDevice), size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, reinterpret_cast<VkBuffer*>(&m_Handle), reinterpret_cast<VkDeviceMemory*>(&m_Memory));
 
-	copyBuffers(static_cast<VkDevice>(m_Application->m_Device), static_cast<VkCommandPool>(m_Application->m_Renderer->m_CommandPool), static_cast<VkQueue>(m_Application->m_Renderer->m_GraphicsQueue), &stagingBuffer, reinterpret_cast<VkBuffer*>(&m_Handle), &size, 1);
+	m_LastUsage = ++m_Application->m_TimelineValue;
+	copyBuffers(static_cast<VkDevice>(m_Application->m_Device), static_cast<VkCommandPool>(m_Application->m_Renderer->m_CommandPool), static_cast<VkQueue>(m_Application->m_Renderer->m_GraphicsQueue), static_cast<VkSemaphore>(m_Application->m_Timeline), m_LastUsage, &stagingBuffer, reinterpret_cast<VkBuffer*>(&m_Handle), &size, 1);
 
 	vkDestroyBuffer(static_cast<VkDevice>(m_Application->m_Device), stagingBuffer, nullptr);
 	vkFreeMemory(static_cast<VkDevice>(m_Application->m_Device), stagingBufferMemory, nullptr);
 }
 
+glacier::IndexBuffer::IndexBuffer(const Application* application, std::shared_ptr<const std::vector<uint32_t>> indices, TextureUploader& uploader)
+	: m_Application(application), m_Handle(nullptr), m_Memory(nullptr), m_LastUsage(application->m_TimelineValue)
+{
+	uint64_t size = indices->size() * sizeof(uint32_t);
+	createBuffer(static_cast<VkDevice>(m_Application->m_Device), static_cast<VkPhysicalDevice>(m_Application->m_PhysicalDevice), size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, reinterpret_cast<VkBuffer*>(&m_Handle), reinterpret_cast<VkDeviceMemory*>(&m_Memory));
+
+	uploader.addBuffer(static_cast<VkBuffer>(m_Handle), indices->data(), size, indices);
+}
+
+glacier::IndexBuffer::IndexBuffer(const Application* application)
+	: m_Application(application), m_Handle(nullptr), m_Memory(nullptr), m_LastUsage(0)
+{
+}
+
 glacier::IndexBuffer::~IndexBuffer()
 {
-	if (m_Handle)
-		vkDestroyBuffer(static_cast<VkDevice>(m_Application->m_Device), static_cast<VkBuffer>(m_Handle), nullptr);
-	
-	if (m_Memory)
-		vkFreeMemory(static_cast<VkDevice>(m_Application->m_Device), static_cast<VkDeviceMemory>(m_Memory), nullptr);
+	/* Destroy the buffer and free its memory once the GPU no longer uses it */
+	m_Application->m_DeletionQueue->destroy(VK_OBJECT_TYPE_BUFFER, m_Handle, m_LastUsage);
+	m_Application->m_DeletionQueue->destroy(VK_OBJECT_TYPE_DEVICE_MEMORY, m_Memory, m_LastUsage);
 }
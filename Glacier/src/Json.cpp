@@ -0,0 +1,396 @@
+#include "internal/Json.hpp"
+
+#include <charconv>
+#include <cmath>
+#include <stdexcept>
+
+#include <spdlog/fmt/fmt.h>
+
+/**
+ * @brief Recursive descent over the text of a document
+*/
+class JsonParser
+{
+public:
+	JsonParser(const char* data, size_t size)
+		: m_Data(data), m_Size(size), m_Position(0), m_Depth(0)
+	{
+	}
+
+	JsonValue parseDocument()
+	{
+		JsonValue value = parseValue();
+
+		skipWhitespace();
+		if (m_Position != m_Size)
+			fail("Unexpected data after the document");
+
+		return value;
+	}
+private:
+	/* Deeper documents are rejected rather than overflowing the stack */
+	static constexpr unsigned int MAX_DEPTH = 256;
+
+	const char* m_Data;
+	size_t m_Size;
+	size_t m_Position;
+	unsigned int m_Depth;
+
+	[[noreturn]] void fail(const char* message) const
+	{
+		throw std::runtime_error(fmt::format("Invalid JSON at offset {}: {}", m_Position, message));
+	}
+
+	void skipWhitespace()
+	{
+		while (m_Position < m_Size && (m_Data[m_Position] == ' ' || m_Data[m_Position] == '\t' || m_Data[m_Position] == '\n' || m_Data[m_Position] == '\r'))
+			m_Position++;
+	}
+
+	void expect(char c)
+	{
+		skipWhitespace();
+		if (m_Position >= m_Size || m_Data[m_Position] != c)
+			fail(fmt::format("Expected '{}'", c).c_str());
+
+		m_Position++;
+	}
+
+	bool consume(std::string_view word)
+	{
+		if (m_Size - m_Position < word.size() || std::string_view(m_Data + m_Position, word.size()) != word)
+			return false;
+
+		m_Position += word.size();
+		return true;
+	}
+
+	JsonValue parseValue()
+	{
+		skipWhitespace();
+		if (m_Position >= m_Size)
+			fail("Unexpected end of the document");
+
+		JsonValue value;
+
+		switch (m_Data[m_Position])
+		{
+		case '{':
+			parseObject(value);
+			break;
+		case '[':
+			parseArray(value);
+			break;
+		case '"':
+			value.m_Type = JsonValue::Type::String;
+			value.m_String = parseString();
+			break;
+		case 't':
+		case 'f':
+			value.m_Type = JsonValue::Type::Boolean;
+			value.m_Boolean = m_Data[m_Position] == 't';
+
+			if (!consume(value.m_Boolean ? "true" : "false"))
+				fail("Unknown literal");
+
+			break;
+		case 'n':
+			if (!consume("null"))
+				fail("Unknown literal");
+
+			break;
+		default:
+			value.m_Type = JsonValue::Type::Number;
+			value.m_Number = parseNumber();
+			break;
+		}
+
+		return value;
+	}
+
+	void parseObject(JsonValue& value)
+	{
+		if (++m_Depth > MAX_DEPTH)
+			fail("Nested too deeply");
+
+		value.m_Type = JsonValue::Type::Object;
+		m_Position++;
+
+		skipWhitespace();
+		if (m_Position < m_Size && m_Data[m_Position] == '}')
+		{
+			m_Position++;
+			m_Depth--;
+			return;
+		}
+
+		while (true)
+		{
+			skipWhitespace();
+			if (m_Position >= m_Size || m_Data[m_Position] != '"')
+				fail("Expected a member name");
+
+			std::string key = parseString();
+			expect(':');
+
+			value.m_Members.emplace_back(std::move(key), parseValue());
+
+			skipWhitespace();
+			if (m_Position < m_Size && m_Data[m_Position] == ',')
+			{
+				m_Position++;
+				continue;
+			}
+
+			expect('}');
+			break;
+		}
+
+		m_Depth--;
+	}
+
+	void parseArray(JsonValue& value)
+	{
+		if (++m_Depth > MAX_DEPTH)
+			fail("Nested too deeply");
+
+		value.m_Type = JsonValue::Type::Array;
+		m_Position++;
+
+		skipWhitespace();
+		if (m_Position < m_Size && m_Data[m_Position] == ']')
+		{
+			m_Position++;
+			m_Depth--;
+			return;
+		}
+
+		while (true)
+		{
+			value.m_Array.push_back(parseValue());
+
+			skipWhitespace();
+			if (m_Position < m_Size && m_Data[m_Position] == ',')
+			{
+				m_Position++;
+				continue;
+			}
+
+			expect(']');
+			break;
+		}
+
+		m_Depth--;
+	}
+
+	double parseNumber()
+	{
+		// from_chars doesn't take a leading plus and JSON doesn't allow one either
+		const char* first = m_Data + m_Position;
+		const char* last = m_Data + m_Size;
+
+		double number = 0.0;
+		std::from_chars_result result = std::from_chars(first, last, number);
+		if (result.ec != std::errc() || !std::isfinite(number))
+			fail("Invalid number");
+
+		m_Position += result.ptr - first;
+		return number;
+	}
+
+	uint32_t parseHexDigits()
+	{
+		if (m_Size - m_Position < 4)
+			fail("Truncated escape sequence");
+
+		uint32_t code = 0;
+		std::from_chars_result result = std::from_chars(m_Data + m_Position, m_Data + m_Position + 4, code, 16);
+		if (result.ec != std::errc() || result.ptr != m_Data + m_Position + 4)
+			fail("Invalid escape sequence");
+
+		m_Position += 4;
+		return code;
+	}
+
+	void appendUtf8(std::string& string, uint32_t code)
+	{
+		if (code < 0x80)
+		{
+			string.push_back(static_cast<char>(code));
+		}
+		else if (code < 0x800)
+		{
+			string.push_back(static_cast<char>(0xc0 | (code >> 6)));
+			string.push_back(static_cast<char>(0x80 | (code & 0x3f)));
+		}
+		else if (code < 0x10000)
+		{
+			string.push_back(static_cast<char>(0xe0 | (code >> 12)));
+			string.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3f)));
+			string.push_back(static_cast<char>(0x80 | (code & 0x3f)));
+		}
+		else
+		{
+			string.push_back(static_cast<char>(0xf0 | (code >> 18)));
+			string.push_back(static_cast<char>(0x80 | ((code >> 12) & 0x3f)));
+			string.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3f)));
+			string.push_back(static_cast<char>(0x80 | (code & 0x3f)));
+		}
+	}
+
+	std::string parseString()
+	{
+		m_Position++;
+
+		std::string string;
+		while (true)
+		{
+			// Copy the run up to the next quote or escape at once
+			size_t start = m_Position;
+			while (m_Position < m_Size && m_Data[m_Position] != '"' && m_Data[m_Position] != '\\')
+				m_Position++;
+
+			string.append(m_Data + start, m_Position - start);
+
+			if (m_Position >= m_Size)
+				fail("Unterminated string");
+
+			if (m_Data[m_Position++] == '"')
+				return string;
+
+			if (m_Position >= m_Size)
+				fail("Unterminated string");
+
+			char escape = m_Data[m_Position++];
+			switch (escape)
+			{
+			case '"':
+			case '\\':
+			case '/':
+				string.push_back(escape);
+				break;
+			case 'b':
+				string.push_back('\b');
+				break;
+			case 'f':
+				string.push_back('\f');
+				break;
+			case 'n':
+				string.push_back('\n');
+				break;
+			case 'r':
+				string.push_back('\r');
+				break;
+			case 't':
+				string.push_back('\t');
+				break;
+			case 'u':
+			{
+				uint32_t code = parseHexDigits();
+
+				// Characters outside the basic plane are written as a surrogate pair
+				if (code >= 0xd800 && code < 0xdc00 && consume("\\u"))
+				{
+					uint32_t low = parseHexDigits();
+					if (low < 0xdc00 || low >= 0xe000)
+						fail("Invalid surrogate pair");
+
+					code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+				}
+
+				appendUtf8(string, code);
+				break;
+			}
+			default:
+				fail("Invalid escape sequence");
+			}
+		}
+	}
+};
+
+JsonValue::JsonValue()
+	: m_Type(Type::Null), m_Boolean(false), m_Number(0.0)
+{
+}
+
+JsonValue JsonValue::parse(const char* data, size_t size)
+{
+	return JsonParser(data, size).parseDocument();
+}
+
+JsonValue::Type JsonValue::getType() const
+{
+	return m_Type;
+}
+
+bool JsonValue::getBoolean() const
+{
+	if (m_Type != Type::Boolean)
+		throw std::runtime_error("Expected a JSON boolean");
+
+	return m_Boolean;
+}
+
+double JsonValue::getNumber() const
+{
+	if (m_Type != Type::Number)
+		throw std::runtime_error("Expected a JSON number");
+
+	return m_Number;
+}
+
+const std::string& JsonValue::getString() const
+{
+	if (m_Type != Type::String)
+		throw std::runtime_error("Expected a JSON string");
+
+	return m_String;
+}
+
+const std::vector<JsonValue>& JsonValue::getArray() const
+{
+	if (m_Type != Type::Array)
+		throw std::runtime_error("Expected a JSON array");
+
+	return m_Array;
+}
+
+uint32_t JsonValue::getUint(std::string_view name) const
+{
+	if (m_Type != Type::Number || m_Number < 0.0 || m_Number > 4294967295.0 || std::floor(m_Number) != m_Number)
+		throw std::runtime_error(fmt::format("{} has to be a whole number from 0 to 4294967295", name));
+
+	return static_cast<uint32_t>(m_Number);
+}
+
+const JsonValue* JsonValue::find(std::string_view key) const
+{
+	if (m_Type != Type::Object)
+		return nullptr;
+
+	for (const std::pair<std::string, JsonValue>& member : m_Members)
+	{
+		if (member.first == key)
+			return &member.second;
+	}
+
+	return nullptr;
+}
+
+const JsonValue& JsonValue::at(std::string_view key) const
+{
+	const JsonValue* value = find(key);
+	if (value == nullptr)
+		throw std::runtime_error(fmt::format("Missing JSON member {}", key));
+
+	return *value;
+}
+
+const JsonValue& JsonValue::at(size_t index) const
+{
+	const std::vector<JsonValue>& array = getArray();
+	if (index >= array.size())
+		throw std::runtime_error(fmt::format("JSON index {} is out of range, the array has {} elements", index, array.size()));
+
+	return array[index];
+}
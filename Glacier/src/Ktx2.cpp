@@ -0,0 +1,89 @@
+#include "internal/Ktx2.hpp"
+#include "internal/TextureFormat.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+#include <spdlog/fmt/fmt.h>
+
+// https://registry.khronos.org/KTX/specs/2.0/ktxspec.v2.html
+namespace
+{
+	constexpr uint8_t KTX2_IDENTIFIER[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+
+	/* Header, index and level index are little-endian and packed without padding */
+	constexpr size_t HEADER_SIZE = 80;
+	constexpr size_t LEVEL_INDEX_ENTRY_SIZE = 24;
+
+	template<typename T>
+	T readValue(const uint8_t* data, size_t offset)
+	{
+		T value;
+		memcpy(&value, data + offset, sizeof(T));
+
+		return value;
+	}
+}
+
+Ktx2Image parseKtx2(const void* data, size_t size)
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+
+	if (size < HEADER_SIZE || memcmp(bytes, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0)
+		throw std::runtime_error("Not a KTX2 file");
+
+	uint32_t format = readValue<uint32_t>(bytes, 12);
+	uint32_t width = readValue<uint32_t>(bytes, 20);
+	uint32_t height = readValue<uint32_t>(bytes, 24);
+	uint32_t depth = readValue<uint32_t>(bytes, 28);
+	uint32_t layerCount = readValue<uint32_t>(bytes, 32);
+	uint32_t faceCount = readValue<uint32_t>(bytes, 36);
+	uint32_t levelCount = readValue<uint32_t>(bytes, 40);
+	uint32_t supercompression = readValue<uint32_t>(bytes, 44);
+
+	if (format == 0)
+		throw std::runtime_error("KTX2 files with Basis Universal data must be transcoded first");
+
+	if (supercompression != 0)
+		throw std::runtime_error(fmt::format("KTX2 supercompression scheme {} is not supported", supercompression));
+
+	if (width == 0 || height == 0 || depth > 1 || layerCount > 1 || faceCount != 1)
+		throw std::runtime_error("Only 2D KTX2 textures are supported");
+
+	TexelBlock block;
+	if (!getTexelBlock(static_cast<VkFormat>(format), block))
+		throw std::runtime_error(fmt::format("KTX2 texture format {} is not supported", format));
+
+	// A level count of 0 asks the loader to generate the mip chain from a single stored level
+	uint32_t storedLevels = levelCount == 0 ? 1 : levelCount;
+	if (storedLevels > 32 || ((width >> (storedLevels - 1)) == 0 && (height >> (storedLevels - 1)) == 0))
+		throw std::runtime_error(fmt::format("KTX2 file has too many levels ({}) for a {}x{} texture", levelCount, width, height));
+
+	if (size < HEADER_SIZE + storedLevels * LEVEL_INDEX_ENTRY_SIZE)
+		throw std::runtime_error("KTX2 level index is truncated");
+
+	Ktx2Image image;
+	image.format = static_cast<VkFormat>(format);
+	image.width = width;
+	image.height = height;
+
+	for (uint32_t i = 0; i < storedLevels; i++)
+	{
+		size_t entry = HEADER_SIZE + i * LEVEL_INDEX_ENTRY_SIZE;
+		uint64_t offset = readValue<uint64_t>(bytes, entry);
+		uint64_t length = readValue<uint64_t>(bytes, entry + 8);
+
+		uint32_t levelWidth = width >> i > 0 ? width >> i : 1;
+		uint32_t levelHeight = height >> i > 0 ? height >> i : 1;
+
+		if (length != getImageSize(block, levelWidth, levelHeight))
+			throw std::runtime_error(fmt::format("KTX2 level {} has {} bytes, expected {}", i, length, getImageSize(block, levelWidth, levelHeight)));
+
+		if (offset > size || length > size - offset)
+			throw std::runtime_error(fmt::format("KTX2 level {} lies outside the file", i));
+
+		image.levels.push_back(Ktx2Image::Level{ bytes + offset, static_cast<size_t>(length) });
+	}
+
+	return image;
+}
@@ -0,0 +1,105 @@
+#include "internal/MappedFile.hpp"
+
+#include <stdexcept>
+
+#include <spdlog/fmt/fmt.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string& path)
+	: m_Data(nullptr), m_Size(0)
+{
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		throw std::runtime_error(fmt::format("Failed to open file {}", path));
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size))
+	{
+		CloseHandle(file);
+		throw std::runtime_error(fmt::format("Failed to read the size of file {}", path));
+	}
+
+	m_Size = static_cast<size_t>(size.QuadPart);
+
+	// Empty files can't be mapped
+	if (m_Size > 0)
+	{
+		HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping != nullptr)
+		{
+			m_Data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			// The view keeps the mapping alive
+			CloseHandle(mapping);
+		}
+	}
+
+	CloseHandle(file);
+
+	if (m_Size > 0 && m_Data == nullptr)
+		throw std::runtime_error(fmt::format("Failed to map file {}", path));
+#else
+	int file = open(path.c_str(), O_RDONLY);
+	if (file < 0)
+		throw std::runtime_error(fmt::format("Failed to open file {}", path));
+
+	struct stat status;
+	if (fstat(file, &status) != 0)
+	{
+		close(file);
+		throw std::runtime_error(fmt::format("Failed to read the size of file {}", path));
+	}
+
+	m_Size = static_cast<size_t>(status.st_size);
+
+	// Empty files can't be mapped
+	if (m_Size > 0)
+	{
+		void* data = mmap(nullptr, m_Size, PROT_READ, MAP_PRIVATE, file, 0);
+		if (data != MAP_FAILED)
+		{
+			m_Data = data;
+			// Files are read front to back once, so ask for read-ahead
+			madvise(m_Data, m_Size, MADV_SEQUENTIAL);
+		}
+	}
+
+	// The mapping keeps the file alive
+	close(file);
+
+	if (m_Size > 0 && m_Data == nullptr)
+		throw std::runtime_error(fmt::format("Failed to map file {}", path));
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+	if (m_Data == nullptr)
+		return;
+
+#ifdef _WIN32
+	UnmapViewOfFile(m_Data);
+#else
+	munmap(m_Data, m_Size);
+#endif
+}
+
+const void* MappedFile::data() const
+{
+	return m_Data;
+}
+
+size_t MappedFile::size() const
+{
+	return m_Size;
+}
@@ -0,0 +1,309 @@
+#include "Mesh.hpp"
+#include "Application.hpp"
+#include "FileSystem.hpp"
+#include "internal/AssetWatcher.hpp"
+#include "internal/MeshCodec.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+#include <spdlog/fmt/fmt.h>
+
+namespace
+{
+	constexpr uint8_t MESH_MAGIC[4] = { 'G', 'M', 'S', 'H' };
+	constexpr uint32_t MESH_VERSION = 1;
+
+	/*
+	 * Little-endian and packed without padding:
+	 * magic, version, vertex count, index count, stride, attribute count, vertex stream size (64-bit), index stream size (64-bit),
+	 * then element, component count and offset of every attribute, then the vertex stream and the index stream
+	*/
+	constexpr size_t HEADER_SIZE = 40;
+	constexpr size_t ATTRIBUTE_SIZE = 12;
+
+	/* The smallest maxVertexInputBindingStride Vulkan allows */
+	constexpr uint32_t MAX_STRIDE = 2048;
+
+	template<typename T>
+	T readValue(const uint8_t* data, size_t offset)
+	{
+		T value;
+		memcpy(&value, data + offset, sizeof(T));
+
+		return value;
+	}
+
+	template<typename T>
+	void writeValue(std::vector<uint8_t>& data, size_t offset, T value)
+	{
+		memcpy(data.data() + offset, &value, sizeof(T));
+	}
+}
+
+glacier::Mesh::Mesh(const Application* application, std::string_view path)
+	: m_Application(application), m_VertexCount(0), m_IndexCount(0)
+{
+	FileContents file = FileSystem::read(path);
+
+	try
+	{
+		load(file.data(), file.size());
+	}
+	catch (const std::exception& e)
+	{
+		throw std::runtime_error(fmt::format("Failed to load mesh {}: {}", path, e.what()));
+	}
+
+	watch(path);
+}
+
+glacier::Mesh::Mesh(const Application* application, const void* data, size_t size)
+	: m_Application(application), m_VertexCount(0), m_IndexCount(0)
+{
+	load(data, size);
+}
+
+glacier::Mesh::Mesh(const Application* application, const VertexBufferLayout& layout, const std::vector<uint8_t>& vertices, const std::vector<uint32_t>& indices)
+	: m_Application(application), m_VertexCount(static_cast<uint32_t>(vertices.size() / layout.m_Stride)), m_IndexCount(static_cast<uint32_t>(indices.size()))
+{
+	m_VertexBuffer = std::unique_ptr<VertexBuffer>(new VertexBuffer(m_Application, vertices.data(), vertices.size(), layout));
+	m_IndexBuffer = std::unique_ptr<IndexBuffer>(new IndexBuffer(m_Application, indices.data(), indices.size() * sizeof(uint32_t)));
+}
+
+glacier::Mesh::Mesh(const Application* application, const VertexBufferLayout& layout, std::shared_ptr<const std::vector<uint8_t>> vertices, std::shared_ptr<const std::vector<uint32_t>> indices, TextureUploader& uploader)
+	: m_Application(application), m_VertexCount(static_cast<uint32_t>(vertices->size() / layout.m_Stride)), m_IndexCount(static_cast<uint32_t>(indices->size()))
+{
+	m_VertexBuffer = std::unique_ptr<VertexBuffer>(new VertexBuffer(m_Application, std::move(vertices), layout, uploader));
+	m_IndexBuffer = std::unique_ptr<IndexBuffer>(new IndexBuffer(m_Application, std::move(indices), uploader));
+}
+
+glacier::Mesh::~Mesh()
+{
+	if (m_Application->m_AssetWatcher != nullptr)
+		m_Application->m_AssetWatcher->unwatch(this);
+}
+
+std::vector<uint8_t> glacier::Mesh::encode(const void* vertices, uint32_t vertexCount, const VertexBufferLayout& layout, const uint32_t* indices, uint32_t indexCount)
+{
+	const std::vector<VertexAttribute>& attributes = layout.m_Attributes;
+	if (attributes.empty() || layout.m_Stride > MAX_STRIDE)
+		throw std::runtime_error(fmt::format("Meshes need a vertex layout with attributes and a stride of at most {} bytes", MAX_STRIDE));
+
+	std::vector<uint8_t> data(HEADER_SIZE + attributes.size() * ATTRIBUTE_SIZE);
+	memcpy(data.data(), MESH_MAGIC, sizeof(MESH_MAGIC));
+	writeValue<uint32_t>(data, 4, MESH_VERSION);
+	writeValue<uint32_t>(data, 8, vertexCount);
+	writeValue<uint32_t>(data, 12, indexCount);
+	writeValue<uint32_t>(data, 16, layout.m_Stride);
+	writeValue<uint32_t>(data, 20, static_cast<uint32_t>(attributes.size()));
+
+	for (size_t i = 0; i < attributes.size(); i++)
+	{
+		size_t entry = HEADER_SIZE + i * ATTRIBUTE_SIZE;
+		writeValue<uint32_t>(data, entry, static_cast<uint32_t>(attributes[i].element));
+		writeValue<uint32_t>(data, entry + 4, attributes[i].count);
+		writeValue<uint32_t>(data, entry + 8, attributes[i].offset);
+	}
+
+	size_t vertexData = data.size();
+	encodeVertexStream(vertices, vertexCount, layout.m_Stride, data);
+
+	size_t indexData = data.size();
+	encodeIndexStream(indices, indexCount, data);
+
+	writeValue<uint64_t>(data, 24, indexData - vertexData);
+	writeValue<uint64_t>(data, 32, data.size() - indexData);
+
+	return data;
+}
+
+void glacier::Mesh::decode(const void* data, size_t size, VertexBufferLayout& layout, std::vector<uint8_t>& vertices, std::vector<uint32_t>& indices)
+{
+	Contents contents = parse(data, size, layout);
+
+	vertices.resize(static_cast<size_t>(contents.vertexCount) * layout.m_Stride);
+	decodeVertexStream(contents.vertexData, contents.vertexDataSize, contents.vertexCount, layout.m_Stride, vertices.data());
+
+	indices.resize(contents.indexCount);
+	decodeIndexStream(contents.indexData, contents.indexDataSize, contents.indexCount, indices.data());
+}
+
+const glacier::VertexBuffer& glacier::Mesh::getVertexBuffer() const
+{
+	return *m_VertexBuffer;
+}
+
+const glacier::IndexBuffer& glacier::Mesh::getIndexBuffer() const
+{
+	return *m_IndexBuffer;
+}
+
+uint32_t glacier::Mesh::getVertexCount() const
+{
+	return m_VertexCount;
+}
+
+uint32_t glacier::Mesh::getIndexCount() const
+{
+	return m_IndexCount;
+}
+
+glacier::Mesh::Contents glacier::Mesh::parse(const void* data, size_t size, VertexBufferLayout& layout)
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+
+	if (size < HEADER_SIZE || memcmp(bytes, MESH_MAGIC, sizeof(MESH_MAGIC)) != 0)
+		throw std::runtime_error("Not a .gmesh file");
+
+	uint32_t version = readValue<uint32_t>(bytes, 4);
+	if (version != MESH_VERSION)
+		throw std::runtime_error(fmt::format(".gmesh version {} is not supported, expected {}", version, MESH_VERSION));
+
+	Contents contents;
+	contents.vertexCount = readValue<uint32_t>(bytes, 8);
+	contents.indexCount = readValue<uint32_t>(bytes, 12);
+	uint32_t stride = readValue<uint32_t>(bytes, 16);
+	uint32_t attributeCount = readValue<uint32_t>(bytes, 20);
+	uint64_t vertexDataSize = readValue<uint64_t>(bytes, 24);
+	uint64_t indexDataSize = readValue<uint64_t>(bytes, 32);
+
+	if (stride == 0 || stride > MAX_STRIDE || attributeCount == 0 || attributeCount > stride)
+		throw std::runtime_error(fmt::format("Mesh has {} attributes in a stride of {} bytes", attributeCount, stride));
+
+	size_t streams = HEADER_SIZE + attributeCount * ATTRIBUTE_SIZE;
+	if (size < streams || vertexDataSize > size - streams || indexDataSize > size - streams - vertexDataSize)
+		throw std::runtime_error("Mesh data is truncated");
+
+	layout.m_Attributes.clear();
+	layout.m_Stride = stride;
+
+	for (uint32_t i = 0; i < attributeCount; i++)
+	{
+		size_t entry = HEADER_SIZE + i * ATTRIBUTE_SIZE;
+		uint32_t element = readValue<uint32_t>(bytes, entry);
+		uint32_t count = readValue<uint32_t>(bytes, entry + 4);
+		uint32_t offset = readValue<uint32_t>(bytes, entry + 8);
+
+		if (element > static_cast<uint32_t>(VertexBufferElement::UnsignedPacked1010102Normalized))
+			throw std::runtime_error(fmt::format("Mesh attribute {} has unknown element {}", i, element));
+
+		VertexBufferElement elementType = static_cast<VertexBufferElement>(element);
+		uint32_t format = getVertexFormat(elementType, count);
+		uint32_t attributeSize = getAttributeSize(elementType, count);
+
+		if (format == 0 || offset > stride || attributeSize > stride - offset)
+			throw std::runtime_error(fmt::format("Mesh attribute {} with {} components at offset {} doesn't fit a stride of {} bytes", i, count, offset, stride));
+
+		layout.m_Attributes.push_back(VertexAttribute{ elementType, count, offset, attributeSize, format });
+	}
+
+	contents.vertexData = bytes + streams;
+	contents.vertexDataSize = static_cast<size_t>(vertexDataSize);
+	contents.indexData = bytes + streams + vertexDataSize;
+	contents.indexDataSize = static_cast<size_t>(indexDataSize);
+
+	return contents;
+}
+
+void glacier::Mesh::load(const void* data, size_t size)
+{
+	VertexBufferLayout layout;
+	Contents contents = parse(data, size, layout);
+
+	if (contents.vertexCount == 0 || contents.indexCount == 0)
+		throw std::runtime_error("Mesh has no vertices or no indices");
+
+	uint32_t stride = layout.m_Stride;
+	const VertexAttribute& position = layout.m_Attributes[0];
+
+	// Both streams are decoded straight into the mapped staging memory
+	m_VertexBuffer = std::unique_ptr<VertexBuffer>(new VertexBuffer(m_Application, static_cast<uint64_t>(contents.vertexCount) * stride, layout, [&contents, stride, &position](void* vertices, void* positions)
+		{
+			decodeVertexStream(contents.vertexData, contents.vertexDataSize, contents.vertexCount, stride, vertices, positions, position.offset, position.size);
+		}));
+
+	m_IndexBuffer = std::unique_ptr<IndexBuffer>(new IndexBuffer(m_Application, static_cast<uint64_t>(contents.indexCount) * sizeof(uint32_t), [&contents](void* indices)
+		{
+			decodeIndexStream(contents.indexData, contents.indexDataSize, contents.indexCount, static_cast<uint32_t*>(indices));
+		}));
+
+	m_VertexCount = contents.vertexCount;
+	m_IndexCount = contents.indexCount;
+}
+
+void glacier::Mesh::watch(std::string_view path)
+{
+	if (!m_Application->m_Info.assetHotReload)
+		return;
+
+	// Archives can't change while they are mounted
+	std::string file = FileSystem::resolve(path);
+	if (file.empty())
+		return;
+
+	struct Decoded
+	{
+		VertexBufferLayout layout;
+		std::vector<uint8_t> vertices;
+		std::vector<uint32_t> indices;
+	};
+
+	std::string name(path);
+
+	m_Application->m_AssetWatcher->watch(this, fmt::format("mesh {}", name), { file }, [this, name]() -> std::function<void()>
+		{
+			FileSystem::invalidate(name);
+			FileContents contents = FileSystem::read(name);
+
+			std::shared_ptr<Decoded> decoded = std::make_shared<Decoded>();
+			decode(contents.data(), contents.size(), decoded->layout, decoded->vertices, decoded->indices);
+
+			return [this, decoded]()
+			{
+				reload(decoded->layout, decoded->vertices, decoded->indices);
+			};
+		});
+}
+
+void glacier::Mesh::reload(const VertexBufferLayout& layout, const std::vector<uint8_t>& vertices, const std::vector<uint32_t>& indices)
+{
+	if (!isSameLayout(layout, m_VertexBuffer->m_Layout))
+		throw std::runtime_error("The vertex layout changed, which pipelines created with the mesh can't follow");
+
+	if (vertices.empty() || indices.empty())
+		throw std::runtime_error("Mesh has no vertices or no indices");
+
+	Mesh mesh(m_Application, layout, vertices, indices);
+
+	// Pipelines and draws point at the buffer objects, so only their handles are swapped. The old ones go to the temporary mesh, whose buffers release them once the GPU is done with them.
+	std::swap(m_VertexBuffer->m_Handle, mesh.m_VertexBuffer->m_Handle);
+	std::swap(m_VertexBuffer->m_Memory, mesh.m_VertexBuffer->m_Memory);
+	std::swap(m_VertexBuffer->m_PositionHandle, mesh.m_VertexBuffer->m_PositionHandle);
+	std::swap(m_VertexBuffer->m_PositionMemory, mesh.m_VertexBuffer->m_PositionMemory);
+	std::swap(m_VertexBuffer->m_LastUsage, mesh.m_VertexBuffer->m_LastUsage);
+
+	std::swap(m_IndexBuffer->m_Handle, mesh.m_IndexBuffer->m_Handle);
+	std::swap(m_IndexBuffer->m_Memory, mesh.m_IndexBuffer->m_Memory);
+	std::swap(m_IndexBuffer->m_LastUsage, mesh.m_IndexBuffer->m_LastUsage);
+
+	std::swap(m_VertexCount, mesh.m_VertexCount);
+	std::swap(m_IndexCount, mesh.m_IndexCount);
+}
+
+bool glacier::Mesh::isSameLayout(const VertexBufferLayout& a, const VertexBufferLayout& b)
+{
+	const std::vector<VertexAttribute>& attributes = a.m_Attributes;
+	const std::vector<VertexAttribute>& otherAttributes = b.m_Attributes;
+
+	if (a.m_Stride != b.m_Stride || attributes.size() != otherAttributes.size())
+		return false;
+
+	for (size_t i = 0; i < attributes.size(); i++)
+	{
+		if (attributes[i].element != otherAttributes[i].element || attributes[i].count != otherAttributes[i].count || attributes[i].offset != otherAttributes[i].offset)
+			return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,691 @@
+#include "internal/MeshCodec.hpp"
+#include "internal/Simd.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+	constexpr size_t BLOCK_SIZE = 256;
+	constexpr size_t GROUP_SIZE = 16;
+
+	/* Zeros at the end of every stream, so decoders can always load a whole group */
+	constexpr size_t PADDING = 16;
+
+	/* Payload size of a group by mode: all zero, 2, 4 and 8 bits per value */
+	constexpr size_t s_GroupSizes[4] = { 0, 4, 8, 16 };
+
+	// Zigzag coding moves the sign to the lowest bit, so small negative differences become small values too
+	uint8_t zigzag(uint8_t value)
+	{
+		return static_cast<uint8_t>((value << 1) ^ static_cast<uint8_t>(static_cast<int8_t>(value) >> 7));
+	}
+
+	uint32_t zigzag(uint32_t value)
+	{
+		return (value << 1) ^ static_cast<uint32_t>(static_cast<int32_t>(value) >> 31);
+	}
+
+	/**
+	 * @brief Append one plane of a block
+	 * @param values The zigzagged values of the plane
+	 * @param count Number of values, the last group is padded with zeros
+	*/
+	void encodePlane(const uint8_t* values, size_t count, std::vector<uint8_t>& encoded)
+	{
+		size_t groups = (count + GROUP_SIZE - 1) / GROUP_SIZE;
+
+		size_t header = encoded.size();
+		encoded.resize(header + (groups + 3) / 4, 0);
+
+		for (size_t g = 0; g < groups; g++)
+		{
+			uint8_t group[GROUP_SIZE] = {};
+			memcpy(group, values + g * GROUP_SIZE, std::min(GROUP_SIZE, count - g * GROUP_SIZE));
+
+			uint8_t max = *std::max_element(group, group + GROUP_SIZE);
+			uint32_t mode = max == 0 ? 0 : max < 4 ? 1 : max < 16 ? 2 : 3;
+			encoded[header + g / 4] |= static_cast<uint8_t>(mode << ((g % 4) * 2));
+
+			if (mode == 0)
+				continue;
+
+			// Values are packed from the lowest bits of each byte up
+			size_t payload = encoded.size();
+			encoded.resize(payload + s_GroupSizes[mode], 0);
+
+			uint32_t bits = mode == 3 ? 8 : mode * 2;
+			for (uint32_t i = 0; i < GROUP_SIZE; i++)
+				encoded[payload + i * bits / 8] |= static_cast<uint8_t>(group[i] << ((i * bits) % 8));
+		}
+	}
+
+	/**
+	 * @brief Check a whole plane lies within the stream
+	 * @return The size of the plane in bytes
+	*/
+	size_t getPlaneSize(const uint8_t* data, const uint8_t* end, size_t groups)
+	{
+		size_t size = (groups + 3) / 4;
+		if (static_cast<size_t>(end - data) < size)
+			throw std::runtime_error("Mesh data is truncated");
+
+		for (size_t g = 0; g < groups; g++)
+			size += s_GroupSizes[(data[g / 4] >> ((g % 4) * 2)) & 3];
+
+		if (static_cast<size_t>(end - data) < size)
+			throw std::runtime_error("Mesh data is truncated");
+
+		return size;
+	}
+
+	/*
+	 * Each instruction set implements the same few operations on 16 bytes, the decoders are written once on top of them:
+	 * unpackGroup reads a group without branching on its mode, decodeDeltas undoes the zigzag and sums the bytes up, zipLow and zipHigh interleave two vectors,
+	 * and decodeIndexDeltas undoes the zigzag and sums up 4 indices.
+	*/
+#if defined(GLACIER_SIMD_SSE2)
+	typedef __m128i Vector;
+
+	Vector loadVector(const uint8_t* data)
+	{
+		return _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+	}
+
+	void storeVector(uint8_t* data, Vector vector)
+	{
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(data), vector);
+	}
+
+	Vector broadcast(uint8_t value)
+	{
+		return _mm_set1_epi8(static_cast<char>(value));
+	}
+
+	/* Per mode, masks selecting the 2-bit, 4-bit and 8-bit unpacking of a group */
+	alignas(16) const uint8_t s_ModeMasks[4][3][16] = {
+		{ {}, {}, {} },
+		{ { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF }, {}, {} },
+		{ {}, { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF }, {} },
+		{ {}, {}, { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF } }
+	};
+
+	// Every mode is unpacked and the right one selected with masks, as modes change too often between groups to branch on them
+	inline Vector unpackGroup(const uint8_t* data, uint32_t mode)
+	{
+		__m128i packed = loadVector(data);
+
+		// Byte-wise shifts don't exist, but the bits shifted in from the next byte are masked away
+		const __m128i mask2 = _mm_set1_epi8(3);
+		__m128i v0 = _mm_and_si128(packed, mask2);
+		__m128i v1 = _mm_and_si128(_mm_srli_epi16(packed, 2), mask2);
+		__m128i v2 = _mm_and_si128(_mm_srli_epi16(packed, 4), mask2);
+		__m128i v3 = _mm_and_si128(_mm_srli_epi16(packed, 6), mask2);
+		__m128i unpacked2 = _mm_unpacklo_epi16(_mm_unpacklo_epi8(v0, v1), _mm_unpacklo_epi8(v2, v3));
+
+		const __m128i mask4 = _mm_set1_epi8(15);
+		__m128i unpacked4 = _mm_unpacklo_epi8(_mm_and_si128(packed, mask4), _mm_and_si128(_mm_srli_epi16(packed, 4), mask4));
+
+		const __m128i* masks = reinterpret_cast<const __m128i*>(s_ModeMasks[mode]);
+		__m128i values = _mm_and_si128(unpacked2, _mm_load_si128(masks));
+		values = _mm_or_si128(values, _mm_and_si128(unpacked4, _mm_load_si128(masks + 1)));
+		return _mm_or_si128(values, _mm_and_si128(packed, _mm_load_si128(masks + 2)));
+	}
+
+	Vector decodeDeltas(Vector zigzagged, Vector& carry)
+	{
+		__m128i sign = _mm_sub_epi8(_mm_setzero_si128(), _mm_and_si128(zigzagged, _mm_set1_epi8(1)));
+		__m128i delta = _mm_xor_si128(_mm_and_si128(_mm_srli_epi16(zigzagged, 1), _mm_set1_epi8(0x7F)), sign);
+
+		// Prefix sum in log2(16) steps
+		delta = _mm_add_epi8(delta, _mm_slli_si128(delta, 1));
+		delta = _mm_add_epi8(delta, _mm_slli_si128(delta, 2));
+		delta = _mm_add_epi8(delta, _mm_slli_si128(delta, 4));
+		delta = _mm_add_epi8(delta, _mm_slli_si128(delta, 8));
+
+		__m128i values = _mm_add_epi8(delta, carry);
+
+		// Broadcast the last byte without SSSE3's pshufb
+		__m128i last = _mm_unpackhi_epi8(values, values);
+		last = _mm_unpackhi_epi16(last, last);
+		carry = _mm_shuffle_epi32(last, 0xFF);
+
+		return values;
+	}
+
+	// Interleave the low or high halves of two vectors in units of 1, 2, 4 or 8 bytes
+	template<size_t Size>
+	Vector zipLow(Vector a, Vector b)
+	{
+		switch (Size)
+		{
+		case 1:
+			return _mm_unpacklo_epi8(a, b);
+		case 2:
+			return _mm_unpacklo_epi16(a, b);
+		case 4:
+			return _mm_unpacklo_epi32(a, b);
+		default:
+			return _mm_unpacklo_epi64(a, b);
+		}
+	}
+
+	template<size_t Size>
+	Vector zipHigh(Vector a, Vector b)
+	{
+		switch (Size)
+		{
+		case 1:
+			return _mm_unpackhi_epi8(a, b);
+		case 2:
+			return _mm_unpackhi_epi16(a, b);
+		case 4:
+			return _mm_unpackhi_epi32(a, b);
+		default:
+			return _mm_unpackhi_epi64(a, b);
+		}
+	}
+
+	Vector decodeIndexDeltas(Vector zigzagged, Vector& carry)
+	{
+		__m128i sign = _mm_sub_epi32(_mm_setzero_si128(), _mm_and_si128(zigzagged, _mm_set1_epi32(1)));
+		__m128i delta = _mm_xor_si128(_mm_srli_epi32(zigzagged, 1), sign);
+
+		delta = _mm_add_epi32(delta, _mm_slli_si128(delta, 4));
+		delta = _mm_add_epi32(delta, _mm_slli_si128(delta, 8));
+
+		__m128i values = _mm_add_epi32(delta, carry);
+		carry = _mm_shuffle_epi32(values, 0xFF);
+
+		return values;
+	}
+#elif defined(GLACIER_SIMD_NEON)
+	typedef uint8x16_t Vector;
+
+	Vector loadVector(const uint8_t* data)
+	{
+		return vld1q_u8(data);
+	}
+
+	void storeVector(uint8_t* data, Vector vector)
+	{
+		vst1q_u8(data, vector);
+	}
+
+	Vector broadcast(uint8_t value)
+	{
+		return vdupq_n_u8(value);
+	}
+
+	/* Per mode, masks selecting the 2-bit, 4-bit and 8-bit unpacking of a group */
+	alignas(16) const uint8_t s_ModeMasks[4][3][16] = {
+		{ {}, {}, {} },
+		{ { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF }, {}, {} },
+		{ {}, { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF }, {} },
+		{ {}, {}, { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF } }
+	};
+
+	inline Vector unpackGroup(const uint8_t* data, uint32_t mode)
+	{
+		uint8x16_t packed = vld1q_u8(data);
+		uint8x8_t low = vget_low_u8(packed);
+
+		const uint8x8_t mask2 = vdup_n_u8(3);
+		uint8x8_t v0 = vand_u8(low, mask2);
+		uint8x8_t v1 = vand_u8(vshr_n_u8(low, 2), mask2);
+		uint8x8_t v2 = vand_u8(vshr_n_u8(low, 4), mask2);
+		uint8x8_t v3 = vshr_n_u8(low, 6);
+		uint16x4x2_t zipped2 = vzip_u16(vreinterpret_u16_u8(vzip_u8(v0, v1).val[0]), vreinterpret_u16_u8(vzip_u8(v2, v3).val[0]));
+		uint8x16_t unpacked2 = vreinterpretq_u8_u16(vcombine_u16(zipped2.val[0], zipped2.val[1]));
+
+		uint8x8x2_t zipped4 = vzip_u8(vand_u8(low, vdup_n_u8(15)), vshr_n_u8(low, 4));
+		uint8x16_t unpacked4 = vcombine_u8(zipped4.val[0], zipped4.val[1]);
+
+		uint8x16_t values = vandq_u8(unpacked2, vld1q_u8(s_ModeMasks[mode][0]));
+		values = vorrq_u8(values, vandq_u8(unpacked4, vld1q_u8(s_ModeMasks[mode][1])));
+		return vorrq_u8(values, vandq_u8(packed, vld1q_u8(s_ModeMasks[mode][2])));
+	}
+
+	Vector decodeDeltas(Vector zigzagged, Vector& carry)
+	{
+		uint8x16_t sign = vreinterpretq_u8_s8(vnegq_s8(vreinterpretq_s8_u8(vandq_u8(zigzagged, vdupq_n_u8(1)))));
+		uint8x16_t delta = veorq_u8(vshrq_n_u8(zigzagged, 1), sign);
+
+		// Prefix sum in log2(16) steps, vext with zeros shifts the bytes up
+		const uint8x16_t zero = vdupq_n_u8(0);
+		delta = vaddq_u8(delta, vextq_u8(zero, delta, 15));
+		delta = vaddq_u8(delta, vextq_u8(zero, delta, 14));
+		delta = vaddq_u8(delta, vextq_u8(zero, delta, 12));
+		delta = vaddq_u8(delta, vextq_u8(zero, delta, 8));
+
+		uint8x16_t values = vaddq_u8(delta, carry);
+		carry = vdupq_laneq_u8(values, 15);
+
+		return values;
+	}
+
+	template<size_t Size>
+	Vector zipLow(Vector a, Vector b)
+	{
+		switch (Size)
+		{
+		case 1:
+			return vzip1q_u8(a, b);
+		case 2:
+			return vreinterpretq_u8_u16(vzip1q_u16(vreinterpretq_u16_u8(a), vreinterpretq_u16_u8(b)));
+		case 4:
+			return vreinterpretq_u8_u32(vzip1q_u32(vreinterpretq_u32_u8(a), vreinterpretq_u32_u8(b)));
+		default:
+			return vreinterpretq_u8_u64(vzip1q_u64(vreinterpretq_u64_u8(a), vreinterpretq_u64_u8(b)));
+		}
+	}
+
+	template<size_t Size>
+	Vector zipHigh(Vector a, Vector b)
+	{
+		switch (Size)
+		{
+		case 1:
+			return vzip2q_u8(a, b);
+		case 2:
+			return vreinterpretq_u8_u16(vzip2q_u16(vreinterpretq_u16_u8(a), vreinterpretq_u16_u8(b)));
+		case 4:
+			return vreinterpretq_u8_u32(vzip2q_u32(vreinterpretq_u32_u8(a), vreinterpretq_u32_u8(b)));
+		default:
+			return vreinterpretq_u8_u64(vzip2q_u64(vreinterpretq_u64_u8(a), vreinterpretq_u64_u8(b)));
+		}
+	}
+
+	Vector decodeIndexDeltas(Vector zigzagged, Vector& carry)
+	{
+		uint32x4_t values = vreinterpretq_u32_u8(zigzagged);
+		uint32x4_t sign = vreinterpretq_u32_s32(vnegq_s32(vreinterpretq_s32_u32(vandq_u32(values, vdupq_n_u32(1)))));
+		uint32x4_t delta = veorq_u32(vshrq_n_u32(values, 1), sign);
+
+		const uint32x4_t zero = vdupq_n_u32(0);
+		delta = vaddq_u32(delta, vextq_u32(zero, delta, 3));
+		delta = vaddq_u32(delta, vextq_u32(zero, delta, 2));
+
+		values = vaddq_u32(delta, vreinterpretq_u32_u8(carry));
+		carry = vreinterpretq_u8_u32(vdupq_laneq_u32(values, 3));
+
+		return vreinterpretq_u8_u32(values);
+	}
+#else
+	struct Vector
+	{
+		uint8_t bytes[16];
+	};
+
+	Vector loadVector(const uint8_t* data)
+	{
+		Vector vector;
+		memcpy(vector.bytes, data, sizeof(vector.bytes));
+		return vector;
+	}
+
+	void storeVector(uint8_t* data, Vector vector)
+	{
+		memcpy(data, vector.bytes, sizeof(vector.bytes));
+	}
+
+	Vector broadcast(uint8_t value)
+	{
+		Vector vector;
+		memset(vector.bytes, value, sizeof(vector.bytes));
+		return vector;
+	}
+
+	inline Vector unpackGroup(const uint8_t* data, uint32_t mode)
+	{
+		Vector values = {};
+		if (mode == 3)
+			values = loadVector(data);
+		else if (mode != 0)
+		{
+			uint32_t bits = mode * 2;
+			for (uint32_t i = 0; i < GROUP_SIZE; i++)
+				values.bytes[i] = static_cast<uint8_t>((data[i * bits / 8] >> ((i * bits) % 8)) & ((1u << bits) - 1));
+		}
+
+		return values;
+	}
+
+	Vector decodeDeltas(Vector zigzagged, Vector& carry)
+	{
+		uint8_t value = carry.bytes[0];
+
+		Vector values;
+		for (uint32_t i = 0; i < GROUP_SIZE; i++)
+		{
+			uint8_t z = zigzagged.bytes[i];
+			value = static_cast<uint8_t>(value + ((z >> 1) ^ (0u - (z & 1))));
+			values.bytes[i] = value;
+		}
+
+		carry = broadcast(value);
+		return values;
+	}
+
+	template<size_t Size>
+	Vector zipLow(Vector a, Vector b)
+	{
+		Vector zipped;
+		for (size_t i = 0; i < 8 / Size; i++)
+		{
+			memcpy(zipped.bytes + i * 2 * Size, a.bytes + i * Size, Size);
+			memcpy(zipped.bytes + (i * 2 + 1) * Size, b.bytes + i * Size, Size);
+		}
+
+		return zipped;
+	}
+
+	template<size_t Size>
+	Vector zipHigh(Vector a, Vector b)
+	{
+		Vector zipped;
+		for (size_t i = 0; i < 8 / Size; i++)
+		{
+			memcpy(zipped.bytes + i * 2 * Size, a.bytes + 8 + i * Size, Size);
+			memcpy(zipped.bytes + (i * 2 + 1) * Size, b.bytes + 8 + i * Size, Size);
+		}
+
+		return zipped;
+	}
+
+	Vector decodeIndexDeltas(Vector zigzagged, Vector& carry)
+	{
+		uint32_t value;
+		memcpy(&value, carry.bytes, sizeof(value));
+
+		Vector values;
+		for (uint32_t i = 0; i < 4; i++)
+		{
+			uint32_t z;
+			memcpy(&z, zigzagged.bytes + i * 4, sizeof(z));
+
+			value += (z >> 1) ^ (0u - (z & 1));
+			memcpy(values.bytes + i * 4, &value, sizeof(value));
+		}
+
+		for (uint32_t i = 0; i < 4; i++)
+			memcpy(carry.bytes + i * 4, &value, sizeof(value));
+
+		return values;
+	}
+#endif
+
+	/**
+	 * @brief Turn 4 planes of 16 values into 16 elements of 4 bytes
+	 * @param planes The first plane, planes are BLOCK_SIZE apart
+	 * @param elements Receives 64 bytes
+	*/
+	void transpose4(const uint8_t* planes, uint8_t* elements)
+	{
+		Vector low = zipLow<1>(loadVector(planes), loadVector(planes + BLOCK_SIZE));
+		Vector high = zipHigh<1>(loadVector(planes), loadVector(planes + BLOCK_SIZE));
+		Vector lowNext = zipLow<1>(loadVector(planes + 2 * BLOCK_SIZE), loadVector(planes + 3 * BLOCK_SIZE));
+		Vector highNext = zipHigh<1>(loadVector(planes + 2 * BLOCK_SIZE), loadVector(planes + 3 * BLOCK_SIZE));
+
+		storeVector(elements, zipLow<2>(low, lowNext));
+		storeVector(elements + 16, zipHigh<2>(low, lowNext));
+		storeVector(elements + 32, zipLow<2>(high, highNext));
+		storeVector(elements + 48, zipHigh<2>(high, highNext));
+	}
+
+	/**
+	 * @brief Turn 16 planes of 16 values into 16 elements of 16 bytes, doubling the width of the interleaved units at every step
+	 * @param planes The first plane, planes are BLOCK_SIZE apart
+	 * @param elements Receives the elements
+	*/
+	void transpose16(const uint8_t* planes, Vector elements[16])
+	{
+		// Pairs of planes, for vertices 0-7 and 8-15
+		Vector pairs[16];
+		for (size_t i = 0; i < 8; i++)
+		{
+			Vector a = loadVector(planes + 2 * i * BLOCK_SIZE);
+			Vector b = loadVector(planes + (2 * i + 1) * BLOCK_SIZE);
+			pairs[i] = zipLow<1>(a, b);
+			pairs[i + 8] = zipHigh<1>(a, b);
+		}
+
+		// Groups of 4 planes, indexed by 4 vertices * 4 + 4 planes
+		Vector quads[16];
+		for (size_t h = 0; h < 2; h++)
+		{
+			for (size_t i = 0; i < 4; i++)
+			{
+				quads[h * 8 + i] = zipLow<2>(pairs[h * 8 + 2 * i], pairs[h * 8 + 2 * i + 1]);
+				quads[h * 8 + 4 + i] = zipHigh<2>(pairs[h * 8 + 2 * i], pairs[h * 8 + 2 * i + 1]);
+			}
+		}
+
+		// Groups of 8 planes, indexed by 4 vertices * 4 + 2 vertices * 2 + 8 planes
+		Vector octets[16];
+		for (size_t q = 0; q < 4; q++)
+		{
+			for (size_t i = 0; i < 2; i++)
+			{
+				octets[q * 4 + i] = zipLow<4>(quads[q * 4 + 2 * i], quads[q * 4 + 2 * i + 1]);
+				octets[q * 4 + 2 + i] = zipHigh<4>(quads[q * 4 + 2 * i], quads[q * 4 + 2 * i + 1]);
+			}
+		}
+
+		for (size_t i = 0; i < 8; i++)
+		{
+			elements[i * 2] = zipLow<8>(octets[i * 2], octets[i * 2 + 1]);
+			elements[i * 2 + 1] = zipHigh<8>(octets[i * 2], octets[i * 2 + 1]);
+		}
+	}
+
+	/**
+	 * @brief Decode one plane of a block. Whole groups are written, so the plane must have room for count rounded up to 16 values.
+	 * @tparam Delta Whether the values are zigzagged differences to sum up
+	 * @param last The last value of the plane in the previous block, receives the last value of this one
+	 * @return The start of the next plane
+	*/
+	template<bool Delta>
+	const uint8_t* decodePlane(const uint8_t* data, const uint8_t* end, size_t count, uint8_t& last, uint8_t* plane)
+	{
+		size_t groups = (count + GROUP_SIZE - 1) / GROUP_SIZE;
+		size_t size = getPlaneSize(data, end, groups);
+
+		const uint8_t* header = data;
+		const uint8_t* payload = data + (groups + 3) / 4;
+
+		Vector carry = broadcast(last);
+		for (size_t g = 0; g < groups; g++)
+		{
+			uint32_t mode = (header[g / 4] >> ((g % 4) * 2)) & 3;
+			Vector values = unpackGroup(payload, mode);
+			payload += s_GroupSizes[mode];
+			if (Delta)
+				values = decodeDeltas(values, carry);
+
+			storeVector(plane + g * GROUP_SIZE, values);
+		}
+
+		last = plane[count - 1];
+		return data + size;
+	}
+
+	/**
+	 * @brief Interleave the planes of a block back into elements
+	 * @param planes The first plane to interleave. Planes are BLOCK_SIZE apart.
+	 * @param planeCount Number of planes, the bytes written per element
+	 * @param count Number of elements
+	 * @param elements Receives the elements
+	 * @param stride Distance between elements in bytes
+	*/
+	void interleave(const uint8_t* planes, uint32_t planeCount, size_t count, uint8_t* elements, size_t stride)
+	{
+		uint32_t p = 0;
+		for (; p + 16 <= planeCount; p += 16)
+		{
+			Vector transposed[16];
+			for (size_t v = 0; v < count; v += GROUP_SIZE)
+			{
+				transpose16(planes + p * BLOCK_SIZE + v, transposed);
+
+				uint8_t* element = elements + v * stride + p;
+				if (count - v >= GROUP_SIZE)
+				{
+					// A constant trip count lets the stores read the transposed vectors from registers
+					for (size_t i = 0; i < GROUP_SIZE; i++)
+						storeVector(element + i * stride, transposed[i]);
+				}
+				else
+				{
+					for (size_t i = 0; i < count - v; i++)
+						storeVector(element + i * stride, transposed[i]);
+				}
+			}
+		}
+
+		alignas(16) uint8_t quads[GROUP_SIZE * 4];
+		for (; p + 4 <= planeCount; p += 4)
+		{
+			for (size_t v = 0; v < count; v += GROUP_SIZE)
+			{
+				transpose4(planes + p * BLOCK_SIZE + v, quads);
+
+				size_t n = std::min(GROUP_SIZE, count - v);
+				for (size_t i = 0; i < n; i++)
+					memcpy(elements + (v + i) * stride + p, quads + i * 4, 4);
+			}
+		}
+
+		for (; p < planeCount; p++)
+		{
+			for (size_t v = 0; v < count; v++)
+				elements[v * stride + p] = planes[p * BLOCK_SIZE + v];
+		}
+	}
+}
+
+void encodeVertexStream(const void* vertices, size_t count, uint32_t stride, std::vector<uint8_t>& encoded)
+{
+	const uint8_t* src = static_cast<const uint8_t*>(vertices);
+
+	std::vector<uint8_t> last(stride, 0);
+	uint8_t values[BLOCK_SIZE];
+
+	for (size_t first = 0; first < count; first += BLOCK_SIZE)
+	{
+		size_t n = std::min(BLOCK_SIZE, count - first);
+
+		for (uint32_t b = 0; b < stride; b++)
+		{
+			uint8_t previous = last[b];
+			for (size_t i = 0; i < n; i++)
+			{
+				uint8_t value = src[(first + i) * stride + b];
+				values[i] = zigzag(static_cast<uint8_t>(value - previous));
+				previous = value;
+			}
+
+			last[b] = previous;
+			encodePlane(values, n, encoded);
+		}
+	}
+
+	encoded.resize(encoded.size() + PADDING, 0);
+}
+
+void encodeIndexStream(const uint32_t* indices, size_t count, std::vector<uint8_t>& encoded)
+{
+	uint32_t previous = 0;
+	uint8_t values[4][BLOCK_SIZE];
+
+	for (size_t first = 0; first < count; first += BLOCK_SIZE)
+	{
+		size_t n = std::min(BLOCK_SIZE, count - first);
+
+		for (size_t i = 0; i < n; i++)
+		{
+			uint32_t delta = zigzag(indices[first + i] - previous);
+			previous = indices[first + i];
+
+			for (uint32_t b = 0; b < 4; b++)
+				values[b][i] = static_cast<uint8_t>(delta >> (b * 8));
+		}
+
+		for (uint32_t b = 0; b < 4; b++)
+			encodePlane(values[b], n, encoded);
+	}
+
+	encoded.resize(encoded.size() + PADDING, 0);
+}
+
+void decodeVertexStream(const void* data, size_t size, size_t count, uint32_t stride, void* vertices, void* positions, uint32_t positionOffset, uint32_t positionSize)
+{
+	const uint8_t* src = static_cast<const uint8_t*>(data);
+	if (size < PADDING)
+		throw std::runtime_error("Mesh data is truncated");
+
+	const uint8_t* end = src + size - PADDING;
+	uint8_t* dst = static_cast<uint8_t*>(vertices);
+	uint8_t* positionDst = static_cast<uint8_t*>(positions);
+
+	if (positions != nullptr && positionOffset + positionSize > stride)
+		throw std::runtime_error("Positions lie outside of the vertex");
+
+	// Blocks are put together in cache and copied out whole, which keeps the writes to uncached staging memory sequential
+	std::vector<uint8_t> planes(static_cast<size_t>(stride) * BLOCK_SIZE);
+	std::vector<uint8_t> block(static_cast<size_t>(stride) * BLOCK_SIZE);
+	std::vector<uint8_t> last(stride, 0);
+
+	for (size_t first = 0; first < count; first += BLOCK_SIZE)
+	{
+		size_t n = std::min(BLOCK_SIZE, count - first);
+
+		for (uint32_t b = 0; b < stride; b++)
+			src = decodePlane<true>(src, end, n, last[b], planes.data() + b * BLOCK_SIZE);
+
+		interleave(planes.data(), stride, n, block.data(), stride);
+		memcpy(dst + first * stride, block.data(), n * stride);
+
+		if (positions != nullptr)
+		{
+			interleave(planes.data() + positionOffset * BLOCK_SIZE, positionSize, n, block.data(), positionSize);
+			memcpy(positionDst + first * positionSize, block.data(), n * positionSize);
+		}
+	}
+}
+
+void decodeIndexStream(const void* data, size_t size, size_t count, uint32_t* indices)
+{
+	const uint8_t* src = static_cast<const uint8_t*>(data);
+	if (size < PADDING)
+		throw std::runtime_error("Mesh data is truncated");
+
+	const uint8_t* end = src + size - PADDING;
+
+	alignas(16) uint8_t planes[4 * BLOCK_SIZE];
+	alignas(16) uint8_t block[4 * BLOCK_SIZE];
+	uint8_t last[4] = {};
+
+	Vector carry = broadcast(0);
+
+	for (size_t first = 0; first < count; first += BLOCK_SIZE)
+	{
+		size_t n = std::min(BLOCK_SIZE, count - first);
+
+		for (uint32_t b = 0; b < 4; b++)
+			src = decodePlane<false>(src, end, n, last[b], planes + b * BLOCK_SIZE);
+
+		// Padding at the end of the last group decodes to zero differences, so the carry stays correct
+		for (size_t v = 0; v < n; v += GROUP_SIZE)
+		{
+			uint8_t* elements = block + v * 4;
+			transpose4(planes + v, elements);
+
+			for (uint32_t q = 0; q < 4; q++)
+				storeVector(elements + q * 16, decodeIndexDeltas(loadVector(elements + q * 16), carry));
+		}
+
+		memcpy(indices + first, block, n * sizeof(uint32_t));
+	}
+}
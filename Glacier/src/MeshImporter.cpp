@@ -0,0 +1,392 @@
+#include "MeshImporter.hpp"
+#include "Application.hpp"
+#include "File.hpp"
+#include "FileSystem.hpp"
+#include "VertexPacking.hpp"
+#include "internal/AssetWatcher.hpp"
+#include "internal/GltfParser.hpp"
+#include "internal/MappedFile.hpp"
+#include "internal/ObjParser.hpp"
+#include "internal/ThreadPool.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+#include <spdlog/spdlog.h>
+
+namespace
+{
+	/* Vertices packed per job */
+	constexpr size_t PACK_RANGE_SIZE = 1 << 16;
+
+	double millisecondsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	double millisecondsPerMegabyte(double milliseconds, uint64_t bytes)
+	{
+		return bytes == 0 ? 0.0 : milliseconds * (1024.0 * 1024.0) / static_cast<double>(bytes);
+	}
+
+	bool hasExtension(const std::string& path, std::string_view extension)
+	{
+		if (path.size() < extension.size())
+			return false;
+
+		return std::equal(extension.begin(), extension.end(), path.end() - extension.size(), [](char a, char b)
+			{
+				return a == std::tolower(static_cast<unsigned char>(b));
+			});
+	}
+
+	/**
+	 * @brief Give the vertices without a normal the area weighted average of the normals of their faces
+	*/
+	void computeMissingNormals(ImportedGeometry& geometry)
+	{
+		const std::vector<float>& positions = geometry.positions;
+		std::vector<float> sums(geometry.normals.size(), 0.0f);
+
+		for (size_t i = 0; i + 2 < geometry.indices.size(); i += 3)
+		{
+			const float* a = &positions[static_cast<size_t>(geometry.indices[i]) * 3];
+			const float* b = &positions[static_cast<size_t>(geometry.indices[i + 1]) * 3];
+			const float* c = &positions[static_cast<size_t>(geometry.indices[i + 2]) * 3];
+
+			float ab[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+			float ac[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+
+			// The cross product's length is twice the triangle's area
+			float normal[3] = { ab[1] * ac[2] - ab[2] * ac[1], ab[2] * ac[0] - ab[0] * ac[2], ab[0] * ac[1] - ab[1] * ac[0] };
+
+			for (size_t corner = 0; corner < 3; corner++)
+			{
+				float* sum = &sums[static_cast<size_t>(geometry.indices[i + corner]) * 3];
+				sum[0] += normal[0];
+				sum[1] += normal[1];
+				sum[2] += normal[2];
+			}
+		}
+
+		for (size_t i = 0; i < geometry.normals.size(); i += 3)
+		{
+			float* normal = &geometry.normals[i];
+			if (normal[0] != 0.0f || normal[1] != 0.0f || normal[2] != 0.0f)
+				continue;
+
+			float length = std::sqrt(sums[i] * sums[i] + sums[i + 1] * sums[i + 1] + sums[i + 2] * sums[i + 2]);
+			if (length > 0.0f)
+			{
+				normal[0] = sums[i] / length;
+				normal[1] = sums[i + 1] / length;
+				normal[2] = sums[i + 2] / length;
+			}
+			else
+			{
+				// Only on degenerate faces, any direction will do
+				normal[2] = 1.0f;
+			}
+		}
+	}
+
+	/**
+	 * @brief Interleave the position, normal and texture coordinates of every vertex in a layout
+	*/
+	std::vector<uint8_t> packVertices(const ImportedGeometry& geometry, const glacier::VertexBufferLayout& layout, ThreadPool& threadPool)
+	{
+		struct Stream
+		{
+			const float* data;
+			uint32_t components;
+		};
+
+		const Stream streams[3] = { { geometry.positions.data(), 3 }, { geometry.normals.data(), 3 }, { geometry.uvs.data(), 2 } };
+
+		const std::vector<glacier::VertexAttribute>& attributes = layout.getAttributes();
+		if (attributes.empty() || attributes.size() > 3)
+			throw std::runtime_error(fmt::format("Imported meshes have a position, a normal and texture coordinates, the layout has {} attributes", attributes.size()));
+
+		for (const glacier::VertexAttribute& attribute : attributes)
+		{
+			if (attribute.element == glacier::VertexBufferElement::Int || attribute.element == glacier::VertexBufferElement::UnsignedInt || attribute.element == glacier::VertexBufferElement::Byte || attribute.element == glacier::VertexBufferElement::UnsignedByte)
+				throw std::runtime_error("Imported attributes can't use integer elements, they are converted from floats");
+		}
+
+		size_t vertexCount = geometry.positions.size() / 3;
+		uint32_t stride = layout.getStride();
+
+		std::vector<uint8_t> vertices(vertexCount * stride);
+		size_t rangeCount = (vertexCount + PACK_RANGE_SIZE - 1) / PACK_RANGE_SIZE;
+
+		threadPool.parallelFor(rangeCount, [&attributes, &streams, &vertices, vertexCount, stride](size_t range)
+			{
+				size_t first = range * PACK_RANGE_SIZE;
+				size_t count = std::min(PACK_RANGE_SIZE, vertexCount - first);
+
+				std::vector<float> converted;
+
+				for (size_t i = 0; i < attributes.size(); i++)
+				{
+					const glacier::VertexAttribute& attribute = attributes[i];
+					const Stream& stream = streams[i];
+
+					// Packed elements fill in the 2-bit component themselves when given 3
+					uint32_t components = glacier::isPackedElement(attribute.element) && attribute.count == 4 && stream.components == 3 ? 3 : attribute.count;
+					const float* source = stream.data + first * stream.components;
+
+					if (components != stream.components)
+					{
+						// Missing components are 0, except for the w of a position
+						converted.assign(count * components, 0.0f);
+
+						for (size_t vertex = 0; vertex < count; vertex++)
+						{
+							for (uint32_t c = 0; c < components; c++)
+								converted[vertex * components + c] = c < stream.components ? source[vertex * stream.components + c] : (i == 0 && c == 3 ? 1.0f : 0.0f);
+						}
+
+						source = converted.data();
+					}
+
+					glacier::packVertexAttribute(source, components, count, attribute.element, vertices.data() + first * stride + attribute.offset, stride);
+				}
+			});
+
+		return vertices;
+	}
+
+	/**
+	 * @brief Write a cache file so that no reader ever sees it half-written
+	*/
+	void writeCache(const std::string& path, const std::vector<uint8_t>& contents)
+	{
+		std::string temporary = path + ".tmp";
+		std::error_code error;
+
+		std::ofstream stream(temporary, std::ios::binary);
+		stream.write(reinterpret_cast<const char*>(contents.data()), static_cast<std::streamsize>(contents.size()));
+		stream.close();
+
+		if (!stream)
+		{
+			glacier::g_Logger->warn("Failed to write the mesh cache {}", path);
+			std::filesystem::remove(temporary, error);
+			return;
+		}
+
+		std::filesystem::rename(temporary, path, error);
+
+		if (error)
+		{
+			glacier::g_Logger->warn("Failed to write the mesh cache {}: {}", path, error.message());
+			std::filesystem::remove(temporary, error);
+		}
+	}
+
+	/**
+	 * @brief Find the file on disk a mesh is imported from. Sources are parsed from loose files and their cache is written next to them, so archives can't hold them.
+	*/
+	std::string findSource(std::string_view path)
+	{
+		std::string source = glacier::FileSystem::resolve(path);
+		if (source.empty())
+			throw std::runtime_error(fmt::format("Failed to import mesh {}: the file doesn't exist or lies in an archive", path));
+
+		return source;
+	}
+}
+
+glacier::MeshImporter::MeshImporter(const Application* application)
+	: m_Application(application)
+{
+}
+
+glacier::MeshImporter::~MeshImporter()
+{
+}
+
+glacier::VertexBufferLayout glacier::MeshImporter::getDefaultLayout()
+{
+	VertexBufferLayout layout;
+	layout.push(VertexBufferElement::Float, 3);
+	layout.push(VertexBufferElement::Packed1010102Normalized, 4);
+	layout.push(VertexBufferElement::Half, 2);
+
+	return layout;
+}
+
+std::unique_ptr<glacier::Mesh> glacier::MeshImporter::load(std::string_view path, const VertexBufferLayout& layout, bool useCache)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	std::string source = findSource(path);
+	std::string cache = source + ".gmesh";
+
+	if (useCache)
+	{
+		std::unique_ptr<Mesh> mesh = loadCache(source, cache, layout);
+		if (mesh)
+		{
+			m_Statistics.totalMilliseconds = millisecondsSince(start);
+			g_Logger->info("Loaded mesh {} from its cache in {:.1f} ms, {:.2f} ms per MB of source", path, m_Statistics.totalMilliseconds, millisecondsPerMegabyte(m_Statistics.totalMilliseconds, m_Statistics.sourceBytes));
+
+			watch(mesh.get(), path, source, layout, useCache);
+			return mesh;
+		}
+	}
+
+	std::vector<uint8_t> contents = importFile(source, layout);
+
+	if (useCache)
+		writeCache(cache, contents);
+
+	std::unique_ptr<Mesh> mesh = std::make_unique<Mesh>(m_Application, contents.data(), contents.size());
+
+	m_Statistics.totalMilliseconds = millisecondsSince(start);
+	g_Logger->info("Imported mesh {} ({:.1f} MB, {} vertices, {} indices) in {:.1f} ms, {:.2f} ms per MB", path, m_Statistics.sourceBytes / (1024.0 * 1024.0), m_Statistics.vertexCount, m_Statistics.indexCount,
+		m_Statistics.totalMilliseconds, millisecondsPerMegabyte(m_Statistics.totalMilliseconds, m_Statistics.sourceBytes));
+
+	watch(mesh.get(), path, source, layout, useCache);
+	return mesh;
+}
+
+std::vector<uint8_t> glacier::MeshImporter::import(std::string_view path, const VertexBufferLayout& layout)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	std::vector<uint8_t> contents = importFile(findSource(path), layout);
+	m_Statistics.totalMilliseconds = millisecondsSince(start);
+
+	return contents;
+}
+
+const glacier::MeshImportStatistics& glacier::MeshImporter::getStatistics() const
+{
+	return m_Statistics;
+}
+
+std::unique_ptr<glacier::Mesh> glacier::MeshImporter::loadCache(const std::string& source, const std::string& cache, const VertexBufferLayout& layout)
+{
+	// A missing source is reported by the import
+	std::error_code error;
+	std::filesystem::file_time_type sourceTime = std::filesystem::last_write_time(source, error);
+	if (error)
+		return nullptr;
+
+	std::filesystem::file_time_type cacheTime = std::filesystem::last_write_time(cache, error);
+	if (error || cacheTime < sourceTime)
+		return nullptr;
+
+	try
+	{
+		MappedFile file(cache);
+
+		VertexBufferLayout cachedLayout;
+		Mesh::Contents contents = Mesh::parse(file.data(), file.size(), cachedLayout);
+
+		if (!Mesh::isSameLayout(cachedLayout, layout))
+		{
+			g_Logger->debug("Mesh cache {} has a different vertex layout, importing again", cache);
+			return nullptr;
+		}
+
+		std::unique_ptr<Mesh> mesh = std::make_unique<Mesh>(m_Application, file.data(), file.size());
+
+		m_Statistics = MeshImportStatistics();
+		m_Statistics.sourceBytes = std::filesystem::file_size(source, error);
+		m_Statistics.cached = true;
+		m_Statistics.vertexCount = contents.vertexCount;
+		m_Statistics.indexCount = contents.indexCount;
+
+		return mesh;
+	}
+	catch (const std::exception& e)
+	{
+		g_Logger->warn("Ignoring the mesh cache {}: {}", cache, e.what());
+		return nullptr;
+	}
+}
+
+std::vector<uint8_t> glacier::MeshImporter::importFile(const std::string& source, const VertexBufferLayout& layout)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	ThreadPool& threadPool = *m_Application->m_ThreadPool;
+
+	try
+	{
+		MappedFile file(source);
+		ImportedGeometry geometry;
+
+		if (hasExtension(source, ".obj"))
+		{
+			parseObj(static_cast<const char*>(file.data()), file.size(), threadPool, geometry);
+		}
+		else if (hasExtension(source, ".gltf") || hasExtension(source, ".glb"))
+		{
+			std::filesystem::path directory = std::filesystem::path(source).parent_path();
+			parseGltf(file.data(), file.size(), directory.empty() ? std::string() : directory.string() + '/', threadPool, geometry);
+		}
+		else
+		{
+			throw std::runtime_error("Unknown mesh format, expected .obj, .gltf or .glb");
+		}
+
+		if (geometry.missingNormals)
+			computeMissingNormals(geometry);
+
+		std::vector<uint8_t> vertices = packVertices(geometry, layout, threadPool);
+
+		m_Statistics = MeshImportStatistics();
+		m_Statistics.sourceBytes = file.size();
+		m_Statistics.vertexCount = static_cast<uint32_t>(geometry.positions.size() / 3);
+		m_Statistics.indexCount = static_cast<uint32_t>(geometry.indices.size());
+
+		std::vector<uint8_t> contents = Mesh::encode(vertices.data(), m_Statistics.vertexCount, layout, geometry.indices.data(), m_Statistics.indexCount);
+		m_Statistics.parseMilliseconds = millisecondsSince(start);
+
+		return contents;
+	}
+	catch (const std::exception& e)
+	{
+		throw std::runtime_error(fmt::format("Failed to import mesh {}: {}", source, e.what()));
+	}
+}
+
+void glacier::MeshImporter::watch(Mesh* mesh, std::string_view path, const std::string& source, const VertexBufferLayout& layout, bool useCache) const
+{
+	if (!m_Application->m_Info.assetHotReload)
+		return;
+
+	struct Decoded
+	{
+		VertexBufferLayout layout;
+		std::vector<uint8_t> vertices;
+		std::vector<uint32_t> indices;
+	};
+
+	const Application* application = m_Application;
+
+	// Only the source itself is watched, not the external buffers of a glTF file
+	m_Application->m_AssetWatcher->watch(mesh, fmt::format("mesh {}", path), { source }, [mesh, application, source, layout, useCache]() -> std::function<void()>
+		{
+			MeshImporter importer(application);
+			std::vector<uint8_t> contents = importer.importFile(source, layout);
+
+			if (useCache)
+				writeCache(source + ".gmesh", contents);
+
+			std::shared_ptr<Decoded> decoded = std::make_shared<Decoded>();
+			Mesh::decode(contents.data(), contents.size(), decoded->layout, decoded->vertices, decoded->indices);
+
+			return [mesh, decoded]()
+			{
+				mesh->reload(decoded->layout, decoded->vertices, decoded->indices);
+			};
+		});
+}
@@ -0,0 +1,458 @@
+#include "internal/ObjParser.hpp"
+#include "internal/ThreadPool.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+
+#include <spdlog/fmt/fmt.h>
+
+namespace
+{
+	/* Chunks are at least this large, so small files aren't split into jobs that cost more than they save */
+	constexpr size_t MIN_CHUNK_SIZE = 1 << 20;
+
+	/* Chunks per thread, so a chunk that parses slowly doesn't leave the other threads waiting */
+	constexpr size_t CHUNKS_PER_THREAD = 4;
+
+	enum CornerComponent
+	{
+		Position, Uv, Normal
+	};
+
+	/**
+	 * @brief A face corner as written in the file
+	*/
+	struct Corner
+	{
+		/* 0-based index of the position, uv and normal. Relative ones count from the first of the chunk's own vertices, they were negative in the file. */
+		int32_t indices[3];
+
+		/* Bit per component */
+		uint8_t present;
+		uint8_t relative;
+	};
+
+	/**
+	 * @brief Indices of a corner after relative ones were resolved, UINT32_MAX for missing components
+	*/
+	struct CornerKey
+	{
+		uint32_t indices[3];
+
+		bool operator==(const CornerKey& other) const
+		{
+			return indices[0] == other.indices[0] && indices[1] == other.indices[1] && indices[2] == other.indices[2];
+		}
+	};
+
+	size_t hashCorner(const CornerKey& key)
+	{
+		uint64_t hash = key.indices[0];
+		hash = hash * 0x9e3779b97f4a7c15ull ^ key.indices[1];
+		hash = hash * 0x9e3779b97f4a7c15ull ^ key.indices[2];
+		hash *= 0x9e3779b97f4a7c15ull;
+
+		return static_cast<size_t>(hash ^ (hash >> 32));
+	}
+
+	struct CornerSlot
+	{
+		CornerKey key;
+
+		/* UINT32_MAX for empty slots */
+		uint32_t vertex;
+	};
+
+	std::vector<CornerSlot> growSlots(const std::vector<CornerSlot>& slots)
+	{
+		std::vector<CornerSlot> grown(slots.size() * 2, CornerSlot{ {}, UINT32_MAX });
+		size_t mask = grown.size() - 1;
+
+		for (const CornerSlot& entry : slots)
+		{
+			if (entry.vertex == UINT32_MAX)
+				continue;
+
+			size_t slot = hashCorner(entry.key) & mask;
+			while (grown[slot].vertex != UINT32_MAX)
+				slot = (slot + 1) & mask;
+
+			grown[slot] = entry;
+		}
+
+		return grown;
+	}
+
+	struct Chunk
+	{
+		const char* begin;
+		const char* end;
+
+		/* Vertex data declared in the chunk */
+		std::vector<float> positions;
+		std::vector<float> uvs;
+		std::vector<float> normals;
+
+		/* Three per triangle */
+		std::vector<Corner> corners;
+
+		/* Position, uv and normal count of the chunks before this one */
+		size_t bases[3];
+
+		/* The chunk's vertices and indices, indices start from 0 at its first vertex */
+		std::vector<float> vertexPositions;
+		std::vector<float> vertexUvs;
+		std::vector<float> vertexNormals;
+		std::vector<uint32_t> indices;
+		bool missingNormals;
+
+		size_t firstVertex;
+		size_t firstIndex;
+	};
+
+	[[noreturn]] void fail(const char* file, const char* position, const char* message)
+	{
+		throw std::runtime_error(fmt::format("Invalid OBJ at offset {}: {}", position - file, message));
+	}
+
+	const char* skipSpaces(const char* position, const char* end)
+	{
+		while (position < end && (*position == ' ' || *position == '\t'))
+			position++;
+
+		return position;
+	}
+
+	const char* parseFloat(const char* file, const char* position, const char* end, float& value)
+	{
+		position = skipSpaces(position, end);
+
+		// from_chars doesn't accept a leading plus
+		if (position < end && *position == '+')
+			position++;
+
+		std::from_chars_result result = std::from_chars(position, end, value);
+		if (result.ec != std::errc())
+			fail(file, position, "Expected a number");
+
+		return result.ptr;
+	}
+
+	/**
+	 * @brief Parse the index of a corner component
+	 * @param count Number of vertices of the component declared so far in the chunk
+	 * @return Where the index ends
+	*/
+	const char* parseIndex(const char* file, const char* position, const char* end, size_t count, Corner& corner, CornerComponent component)
+	{
+		int32_t index = 0;
+		std::from_chars_result result = std::from_chars(position, end, index);
+		if (result.ec != std::errc() || index == 0)
+			fail(file, position, "Expected a vertex index");
+
+		if (index > 0)
+		{
+			corner.indices[component] = index - 1;
+		}
+		else
+		{
+			corner.indices[component] = static_cast<int32_t>(count) + index;
+			corner.relative |= 1 << component;
+		}
+
+		corner.present |= 1 << component;
+		return result.ptr;
+	}
+
+	void parseFace(const char* file, const char* position, const char* end, Chunk& chunk)
+	{
+		size_t counts[3] = { chunk.positions.size() / 3, chunk.uvs.size() / 2, chunk.normals.size() / 3 };
+
+		Corner first = {};
+		Corner previous = {};
+		size_t cornerCount = 0;
+
+		while (true)
+		{
+			position = skipSpaces(position, end);
+			if (position >= end || *position == '#')
+				break;
+
+			// position, position/uv, position//normal or position/uv/normal
+			Corner corner = {};
+			position = parseIndex(file, position, end, counts[Position], corner, Position);
+
+			if (position < end && *position == '/')
+			{
+				position++;
+				if (position < end && *position != '/')
+					position = parseIndex(file, position, end, counts[Uv], corner, Uv);
+
+				if (position < end && *position == '/')
+					position = parseIndex(file, position + 1, end, counts[Normal], corner, Normal);
+			}
+
+			// Triangulate as a fan around the first corner
+			if (cornerCount == 0)
+			{
+				first = corner;
+			}
+			else if (cornerCount >= 2)
+			{
+				chunk.corners.push_back(first);
+				chunk.corners.push_back(previous);
+				chunk.corners.push_back(corner);
+			}
+
+			previous = corner;
+			cornerCount++;
+		}
+
+		if (cornerCount < 3)
+			fail(file, position, "A face needs at least 3 corners");
+	}
+
+	void parseChunk(const char* file, Chunk& chunk)
+	{
+		const char* line = chunk.begin;
+
+		while (line < chunk.end)
+		{
+			const char* lineEnd = static_cast<const char*>(memchr(line, '\n', chunk.end - line));
+			const char* next = lineEnd == nullptr ? chunk.end : lineEnd + 1;
+			if (lineEnd == nullptr)
+				lineEnd = chunk.end;
+
+			if (lineEnd > line && lineEnd[-1] == '\r')
+				lineEnd--;
+
+			const char* position = skipSpaces(line, lineEnd);
+
+			if (lineEnd - position >= 2 && position[0] == 'v' && (position[1] == ' ' || position[1] == '\t'))
+			{
+				// Vertex colors and the w component after the position are ignored
+				float values[3];
+				position++;
+				for (float& value : values)
+					position = parseFloat(file, position, lineEnd, value);
+
+				chunk.positions.insert(chunk.positions.end(), values, values + 3);
+			}
+			else if (lineEnd - position >= 3 && position[0] == 'v' && position[1] == 't' && (position[2] == ' ' || position[2] == '\t'))
+			{
+				float u = 0.0f;
+				float v = 0.0f;
+				position = parseFloat(file, position + 2, lineEnd, u);
+
+				if (skipSpaces(position, lineEnd) < lineEnd)
+					parseFloat(file, position, lineEnd, v);
+
+				// OBJ puts the origin at the bottom left, Vulkan at the top left
+				chunk.uvs.push_back(u);
+				chunk.uvs.push_back(1.0f - v);
+			}
+			else if (lineEnd - position >= 3 && position[0] == 'v' && position[1] == 'n' && (position[2] == ' ' || position[2] == '\t'))
+			{
+				float values[3];
+				position += 2;
+				for (float& value : values)
+					position = parseFloat(file, position, lineEnd, value);
+
+				chunk.normals.insert(chunk.normals.end(), values, values + 3);
+			}
+			else if (lineEnd - position >= 2 && position[0] == 'f' && (position[1] == ' ' || position[1] == '\t'))
+			{
+				parseFace(file, position + 1, lineEnd, chunk);
+			}
+
+			line = next;
+		}
+	}
+
+	/**
+	 * @brief Turn the corners of a chunk into vertices and indices
+	 * @param positions, uvs, normals The vertex data of the whole file
+	*/
+	void buildChunk(Chunk& chunk, const std::vector<float>& positions, const std::vector<float>& uvs, const std::vector<float>& normals)
+	{
+		size_t counts[3] = { positions.size() / 3, uvs.size() / 2, normals.size() / 3 };
+		const char* names[3] = { "position", "texture coordinate", "normal" };
+
+		// Open addressing from corner to vertex, grown so that at most half of the slots are taken
+		std::vector<CornerSlot> slots(1024, CornerSlot{ {}, UINT32_MAX });
+		uint32_t vertexCount = 0;
+
+		chunk.indices.reserve(chunk.corners.size());
+		chunk.missingNormals = false;
+
+		for (const Corner& corner : chunk.corners)
+		{
+			CornerKey key;
+			for (uint32_t component = 0; component < 3; component++)
+			{
+				if ((corner.present & (1 << component)) == 0)
+				{
+					key.indices[component] = UINT32_MAX;
+					continue;
+				}
+
+				int64_t index = corner.indices[component];
+				if (corner.relative & (1 << component))
+					index += static_cast<int64_t>(chunk.bases[component]);
+
+				if (index < 0 || static_cast<uint64_t>(index) >= counts[component])
+					throw std::runtime_error(fmt::format("Invalid OBJ: a face uses {} {} of {}", names[component], index + 1, counts[component]));
+
+				key.indices[component] = static_cast<uint32_t>(index);
+			}
+
+			size_t mask = slots.size() - 1;
+			size_t slot = hashCorner(key) & mask;
+			while (slots[slot].vertex != UINT32_MAX && !(slots[slot].key == key))
+				slot = (slot + 1) & mask;
+
+			if (slots[slot].vertex != UINT32_MAX)
+			{
+				chunk.indices.push_back(slots[slot].vertex);
+				continue;
+			}
+
+			slots[slot] = CornerSlot{ key, vertexCount };
+			chunk.indices.push_back(vertexCount++);
+
+			if (vertexCount * 2 > slots.size())
+				slots = growSlots(slots);
+
+			const float* position = &positions[static_cast<size_t>(key.indices[Position]) * 3];
+			chunk.vertexPositions.insert(chunk.vertexPositions.end(), position, position + 3);
+
+			if (key.indices[Uv] != UINT32_MAX)
+			{
+				const float* uv = &uvs[static_cast<size_t>(key.indices[Uv]) * 2];
+				chunk.vertexUvs.insert(chunk.vertexUvs.end(), uv, uv + 2);
+			}
+			else
+			{
+				chunk.vertexUvs.insert(chunk.vertexUvs.end(), 2, 0.0f);
+			}
+
+			if (key.indices[Normal] != UINT32_MAX)
+			{
+				const float* normal = &normals[static_cast<size_t>(key.indices[Normal]) * 3];
+				chunk.vertexNormals.insert(chunk.vertexNormals.end(), normal, normal + 3);
+			}
+			else
+			{
+				chunk.vertexNormals.insert(chunk.vertexNormals.end(), 3, 0.0f);
+				chunk.missingNormals = true;
+			}
+		}
+
+		// The corners aren't needed anymore, and there can be many chunks at once
+		std::vector<Corner>().swap(chunk.corners);
+	}
+}
+
+void parseObj(const char* data, size_t size, ThreadPool& threadPool, ImportedGeometry& geometry)
+{
+	/* Split the text at line ends */
+	size_t chunkCount = std::clamp<size_t>(size / MIN_CHUNK_SIZE, 1, (threadPool.getThreadCount() + 1) * CHUNKS_PER_THREAD);
+	std::vector<Chunk> chunks(chunkCount);
+
+	const char* begin = data;
+	for (size_t i = 0; i < chunkCount; i++)
+	{
+		const char* end = data + size * (i + 1) / chunkCount;
+		if (i + 1 < chunkCount && end > begin)
+		{
+			const char* lineEnd = static_cast<const char*>(memchr(end - 1, '\n', data + size - (end - 1)));
+			end = lineEnd == nullptr ? data + size : lineEnd + 1;
+		}
+
+		chunks[i].begin = begin;
+		chunks[i].end = std::max(begin, end);
+		begin = chunks[i].end;
+	}
+
+	threadPool.parallelFor(chunkCount, [data, &chunks](size_t i)
+		{
+			parseChunk(data, chunks[i]);
+		});
+
+	/* Gather the vertex data, faces can use the vertices of any chunk before their own */
+	std::vector<float> positions;
+	std::vector<float> uvs;
+	std::vector<float> normals;
+	size_t counts[3] = { 0, 0, 0 };
+
+	for (Chunk& chunk : chunks)
+	{
+		chunk.bases[Position] = counts[Position];
+		chunk.bases[Uv] = counts[Uv];
+		chunk.bases[Normal] = counts[Normal];
+
+		counts[Position] += chunk.positions.size() / 3;
+		counts[Uv] += chunk.uvs.size() / 2;
+		counts[Normal] += chunk.normals.size() / 3;
+	}
+
+	positions.reserve(counts[Position] * 3);
+	uvs.reserve(counts[Uv] * 2);
+	normals.reserve(counts[Normal] * 3);
+
+	for (Chunk& chunk : chunks)
+	{
+		positions.insert(positions.end(), chunk.positions.begin(), chunk.positions.end());
+		uvs.insert(uvs.end(), chunk.uvs.begin(), chunk.uvs.end());
+		normals.insert(normals.end(), chunk.normals.begin(), chunk.normals.end());
+
+		std::vector<float>().swap(chunk.positions);
+		std::vector<float>().swap(chunk.uvs);
+		std::vector<float>().swap(chunk.normals);
+	}
+
+	threadPool.parallelFor(chunkCount, [&chunks, &positions, &uvs, &normals](size_t i)
+		{
+			buildChunk(chunks[i], positions, uvs, normals);
+		});
+
+	/* Join the chunks */
+	size_t vertexCount = 0;
+	size_t indexCount = 0;
+	geometry.missingNormals = false;
+
+	for (Chunk& chunk : chunks)
+	{
+		chunk.firstVertex = vertexCount;
+		chunk.firstIndex = indexCount;
+
+		vertexCount += chunk.vertexPositions.size() / 3;
+		indexCount += chunk.indices.size();
+		geometry.missingNormals |= chunk.missingNormals;
+	}
+
+	if (vertexCount == 0 || indexCount == 0)
+		throw std::runtime_error("Invalid OBJ: the file has no faces");
+
+	if (vertexCount > UINT32_MAX || indexCount > UINT32_MAX)
+		throw std::runtime_error(fmt::format("OBJ has {} vertices and {} indices, meshes are limited to {} of each", vertexCount, indexCount, UINT32_MAX));
+
+	geometry.positions.resize(vertexCount * 3);
+	geometry.uvs.resize(vertexCount * 2);
+	geometry.normals.resize(vertexCount * 3);
+	geometry.indices.resize(indexCount);
+
+	threadPool.parallelFor(chunkCount, [&chunks, &geometry](size_t i)
+		{
+			Chunk& chunk = chunks[i];
+
+			std::copy(chunk.vertexPositions.begin(), chunk.vertexPositions.end(), geometry.positions.begin() + chunk.firstVertex * 3);
+			std::copy(chunk.vertexUvs.begin(), chunk.vertexUvs.end(), geometry.uvs.begin() + chunk.firstVertex * 2);
+			std::copy(chunk.vertexNormals.begin(), chunk.vertexNormals.end(), geometry.normals.begin() + chunk.firstVertex * 3);
+
+			uint32_t firstVertex = static_cast<uint32_t>(chunk.firstVertex);
+			std::transform(chunk.indices.begin(), chunk.indices.end(), geometry.indices.begin() + chunk.firstIndex, [firstVertex](uint32_t index) { return index + firstVertex; });
+		});
+}
@@ -1,21 +1,359 @@
 #include "Pipeline.hpp"
 #include "Application.hpp"
 #include "Renderer.hpp"
-
+#include "internal/AssetWatcher.hpp"
+#include "internal/BindlessHeap.hpp"
+#include "internal/PipelineRegistry.hpp"
+#include "internal/ThreadPool.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <memory>
 #include <vulkan/vulkan.h>
 #include <spdlog/spdlog.h>
 #include <glm/glm.hpp>
 
-glacier::Pipeline::Pipeline(const glacier::Application* application, const glacier::Renderer* renderer, const std::unordered_map<ShaderType, Shader*>& shaders, const VertexBuffer& vertexBuffer, const IndexBuffer& indexBuffer)
-	: m_Application(application), m_VertexBuffer(&vertexBuffer), m_IndexBuffer(&indexBuffer), m_Shaders(shaders)
+namespace
+{
+	/**
+	 * @brief Everything needed to create the Vulkan pipelines of a glacier::Pipeline, without pointers into the constructor's stack
+	*/
+	struct PipelineBuildState
+	{
+		VkDevice device;
+		VkRenderPass renderPass; // VK_NULL_HANDLE when using dynamic rendering
+		VkPipelineLayout layout;
+		VkFormat colorFormat;
+		VkFormat depthFormat;
+
+		std::vector<VkPipelineShaderStageCreateInfo> shaderStages;
+
+		/* Keep the modules and entry point names the stages refer to alive */
+		std::vector<std::shared_ptr<void>> shaderModules;
+		std::vector<std::string> entryPoints;
+
+		/* Specialization of each stage, in shaderStages order. Empty for stages without constants. */
+		std::vector<std::vector<VkSpecializationMapEntry>> specializationEntries;
+		std::vector<std::vector<char>> specializationData;
+		std::vector<VkSpecializationInfo> specializationInfos;
+
+		VkVertexInputBindingDescription bindingDescription;
+		std::vector<VkVertexInputAttributeDescription> descriptions;
+
+		/* Size of the first attribute, which is the stride of the depth prepass's position stream */
+		uint32_t positionSize;
+
+		VkPipelineInputAssemblyStateCreateInfo inputAssembly;
+		VkPipelineRasterizationStateCreateInfo rasterizer;
+		VkPipelineMultisampleStateCreateInfo multisample;
+		VkPipelineDepthStencilStateCreateInfo depthStencil;
+		VkPipelineColorBlendAttachmentState colorBlendAttachment;
+		VkPipelineColorBlendStateCreateInfo colorBlend;
+
+		/* Whether to create the depth prepass variant, and the comparison it uses */
+		bool prepass;
+		VkCompareOp prepassCompare;
+	};
+
+	/**
+	 * @brief Get the shader type a vertex buffer element is read as
+	*/
+	glacier::ShaderScalarType attributeType(glacier::VertexBufferElement element)
+	{
+		switch (element)
+		{
+		case glacier::VertexBufferElement::Float:
+		case glacier::VertexBufferElement::Half:
+		case glacier::VertexBufferElement::ByteNormalized:
+		case glacier::VertexBufferElement::UnsignedByteNormalized:
+		case glacier::VertexBufferElement::ShortNormalized:
+		case glacier::VertexBufferElement::UnsignedShortNormalized:
+		case glacier::VertexBufferElement::Packed1010102Normalized:
+		case glacier::VertexBufferElement::UnsignedPacked1010102Normalized:
+			return glacier::ShaderScalarType::Float;
+		case glacier::VertexBufferElement::Int:
+		case glacier::VertexBufferElement::Byte:
+			return glacier::ShaderScalarType::Int;
+		case glacier::VertexBufferElement::UnsignedInt:
+		case glacier::VertexBufferElement::UnsignedByte:
+			return glacier::ShaderScalarType::UnsignedInt;
+		default:
+			return glacier::ShaderScalarType::Unknown;
+		}
+	}
+
+	/**
+	 * @brief Create the pipeline and its depth prepass variant. Safe to call from any thread.
+	 * @param state The pipeline state
+	 * @param entry Receives the created pipelines
+	*/
+	void createPipelines(const PipelineBuildState& state, PipelineRegistry::Entry& entry)
+	{
+		VkPipelineVertexInputStateCreateInfo vertexInputCreateInfo = {};
+		vertexInputCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+		vertexInputCreateInfo.vertexBindingDescriptionCount = 1;
+		vertexInputCreateInfo.pVertexBindingDescriptions = &state.bindingDescription;
+		vertexInputCreateInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(state.descriptions.size());
+		vertexInputCreateInfo.pVertexAttributeDescriptions = state.descriptions.data();
+
+		// The viewport and scissor are set by the renderer every frame
+		VkPipelineViewportStateCreateInfo viewportCreateInfo = {};
+		viewportCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+		viewportCreateInfo.viewportCount = 1;
+		viewportCreateInfo.scissorCount = 1;
+
+		VkPipelineColorBlendStateCreateInfo colorBlendCreateInfo = state.colorBlend;
+		colorBlendCreateInfo.pAttachments = &state.colorBlendAttachment;
+
+		/* Create graphics pipeline */
+		VkGraphicsPipelineCreateInfo graphicsPipelineCreateInfo = {};
+		graphicsPipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+
+		// Shader stages
+		graphicsPipelineCreateInfo.stageCount = static_cast<uint32_t>(state.shaderStages.size());
+		graphicsPipelineCreateInfo.pStages = state.shaderStages.data();
+
+		graphicsPipelineCreateInfo.pVertexInputState = &vertexInputCreateInfo;
+		graphicsPipelineCreateInfo.pInputAssemblyState = &state.inputAssembly;
+		graphicsPipelineCreateInfo.pViewportState = &viewportCreateInfo;
+		graphicsPipelineCreateInfo.pRasterizationState = &state.rasterizer;
+		graphicsPipelineCreateInfo.pMultisampleState = &state.multisample;
+		graphicsPipelineCreateInfo.pDepthStencilState = &state.depthStencil;
+		graphicsPipelineCreateInfo.pColorBlendState = &colorBlendCreateInfo;
+
+		VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+
+		VkPipelineDynamicStateCreateInfo dynamicStateCreateInfo = {};
+		dynamicStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+		dynamicStateCreateInfo.dynamicStateCount = 2;
+		dynamicStateCreateInfo.pDynamicStates = dynamicStates;
+
+		graphicsPipelineCreateInfo.pDynamicState = &dynamicStateCreateInfo;
+
+		graphicsPipelineCreateInfo.layout = state.layout;
+
+		// With dynamic rendering the pipeline only depends on the attachment formats, not on a render pass
+		VkPipelineRenderingCreateInfo renderingCreateInfo = {};
+		renderingCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+		renderingCreateInfo.colorAttachmentCount = 1;
+		renderingCreateInfo.pColorAttachmentFormats = &state.colorFormat;
+		renderingCreateInfo.depthAttachmentFormat = state.depthFormat;
+
+		if (state.renderPass == VK_NULL_HANDLE)
+			graphicsPipelineCreateInfo.pNext = &renderingCreateInfo;
+
+		graphicsPipelineCreateInfo.renderPass = state.renderPass;
+		graphicsPipelineCreateInfo.subpass = 0;
+
+		graphicsPipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;
+		graphicsPipelineCreateInfo.basePipelineIndex = -1;
+
+		if (vkCreateGraphicsPipelines(state.device, VK_NULL_HANDLE, 1, &graphicsPipelineCreateInfo, nullptr, &entry.pipeline) != VK_SUCCESS)
+		{
+			entry.pipeline = VK_NULL_HANDLE;
+			throw std::runtime_error("Failed to create graphics pipeline");
+		}
+
+		if (!state.prepass)
+			return;
+
+		/* Create the depth prepass variant */
+		// Only the vertex stage runs and no colour is written
+		std::vector<VkPipelineShaderStageCreateInfo> depthShaderStages;
+		for (const VkPipelineShaderStageCreateInfo& stage : state.shaderStages)
+		{
+			if (stage.stage == VK_SHADER_STAGE_VERTEX_BIT)
+				depthShaderStages.push_back(stage);
+		}
+
+		// Binding 0 is the packed position stream, the remaining attributes are bound from the interleaved buffer so the vertex shader's inputs stay satisfied
+		VkVertexInputBindingDescription depthBindingDescriptions[2] = { state.bindingDescription, state.bindingDescription };
+		depthBindingDescriptions[0].binding = 0;
+		depthBindingDescriptions[0].stride = state.positionSize;
+		depthBindingDescriptions[1].binding = 1;
+
+		std::vector<VkVertexInputAttributeDescription> depthDescriptions = state.descriptions;
+		if (!depthDescriptions.empty())
+			depthDescriptions[0].offset = 0;
+
+		for (size_t i = 1; i < depthDescriptions.size(); i++)
+			depthDescriptions[i].binding = 1;
+
+		VkPipelineVertexInputStateCreateInfo depthVertexInputCreateInfo = vertexInputCreateInfo;
+		depthVertexInputCreateInfo.vertexBindingDescriptionCount = depthDescriptions.size() > 1 ? 2 : 1;
+		depthVertexInputCreateInfo.pVertexBindingDescriptions = depthBindingDescriptions;
+		depthVertexInputCreateInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(depthDescriptions.size());
+		depthVertexInputCreateInfo.pVertexAttributeDescriptions = depthDescriptions.data();
+
+		VkPipelineDepthStencilStateCreateInfo depthOnlyStencilCreateInfo = state.depthStencil;
+		depthOnlyStencilCreateInfo.depthWriteEnable = VK_TRUE;
+		depthOnlyStencilCreateInfo.depthCompareOp = state.prepassCompare;
+
+		VkPipelineColorBlendAttachmentState depthColorBlendAttachment = state.colorBlendAttachment;
+		depthColorBlendAttachment.colorWriteMask = 0;
+
+		VkPipelineColorBlendStateCreateInfo depthColorBlendCreateInfo = colorBlendCreateInfo;
+		depthColorBlendCreateInfo.pAttachments = &depthColorBlendAttachment;
+
+		VkGraphicsPipelineCreateInfo depthPipelineCreateInfo = graphicsPipelineCreateInfo;
+		depthPipelineCreateInfo.stageCount = static_cast<uint32_t>(depthShaderStages.size());
+		depthPipelineCreateInfo.pStages = depthShaderStages.data();
+		depthPipelineCreateInfo.pVertexInputState = &depthVertexInputCreateInfo;
+		depthPipelineCreateInfo.pDepthStencilState = &depthOnlyStencilCreateInfo;
+		depthPipelineCreateInfo.pColorBlendState = &depthColorBlendCreateInfo;
+
+		if (vkCreateGraphicsPipelines(state.device, VK_NULL_HANDLE, 1, &depthPipelineCreateInfo, nullptr, &entry.depthPipeline) != VK_SUCCESS)
+		{
+			vkDestroyPipeline(state.device, entry.pipeline, nullptr);
+			entry.pipeline = VK_NULL_HANDLE;
+			entry.depthPipeline = VK_NULL_HANDLE;
+			throw std::runtime_error("Failed to create depth prepass pipeline");
+		}
+	}
+}
+
+glacier::Pipeline::Pipeline(const glacier::Application* application, const glacier::Renderer* renderer, const std::unordered_map<ShaderType, Shader*>& shaders, const VertexBuffer& vertexBuffer, const IndexBuffer& indexBuffer, const PipelineDescription& description, CompileMode compileMode)
+	: m_PipelineLayout(nullptr), m_PushConstantStages(0), m_PushConstantSize(0), m_Pipeline(nullptr), m_DepthPipeline(nullptr), m_Description(description), m_Id(0), m_RegistryEntry(nullptr), m_PendingEntry(nullptr), m_Fallback(nullptr), m_LastUsage(0), m_Application(application), m_Renderer(renderer), m_VertexBuffer(&vertexBuffer), m_IndexBuffer(&indexBuffer), m_Shaders(shaders)
 {
 	glacier::g_Logger->trace("Creating pipeline...");
 
+	PipelineRegistry::Entry* entry = static_cast<PipelineRegistry::Entry*>(build(compileMode));
+	m_RegistryEntry = entry;
+	m_PipelineLayout = entry->layout;
+	m_PushConstantStages = entry->pushConstants.stageFlags;
+	m_PushConstantSize = entry->pushConstants.size;
+	m_Id = entry->id;
+
+	if (compileMode == CompileMode::Blocking)
+	{
+		// Runs the job on this thread, unless an identical pipeline is already compiling on a worker
+		try
+		{
+			wait();
+		}
+		catch (...)
+		{
+			m_Application->m_PipelineRegistry->release(entry, 0);
+			throw;
+		}
+	}
+	else if (compileMode == CompileMode::AsyncPriority)
+	{
+		// An identical pipeline may already be queued with a lower priority
+		prioritize();
+	}
+
+	if (m_Application->m_AssetWatcher != nullptr)
+		m_Application->m_AssetWatcher->track(this);
+}
+
+glacier::Pipeline::~Pipeline()
+{
+	if (m_Application->m_AssetWatcher != nullptr)
+		m_Application->m_AssetWatcher->untrack(this);
+
+	// The handles may be shared with other pipelines, so the registry decides when they are destroyed
+	m_Application->m_PipelineRegistry->release(static_cast<PipelineRegistry::Entry*>(m_RegistryEntry), m_LastUsage);
+
+	if (m_PendingEntry != nullptr)
+		m_Application->m_PipelineRegistry->release(static_cast<PipelineRegistry::Entry*>(m_PendingEntry), 0);
+}
+
+bool glacier::Pipeline::isOpaque() const
+{
+	return m_Description.depth.test && m_Description.depth.write && !m_Description.blend.enable;
+}
+
+bool glacier::Pipeline::isReady() const
+{
+	if (m_Pipeline != nullptr)
+		return true;
+
+	const PipelineRegistry::Entry* entry = static_cast<const PipelineRegistry::Entry*>(m_RegistryEntry);
+	if (!entry->job->isDone() || entry->job->hasFailed())
+		return false;
+
+	// The job is done, so its writes to the entry are visible
+	m_Pipeline = entry->pipeline;
+	m_DepthPipeline = entry->depthPipeline;
+
+	return true;
+}
+
+void glacier::Pipeline::wait() const
+{
+	static_cast<const PipelineRegistry::Entry*>(m_RegistryEntry)->job->wait();
+	isReady();
+}
+
+void glacier::Pipeline::prioritize() const
+{
+	m_Application->m_ThreadPool->prioritize(static_cast<const PipelineRegistry::Entry*>(m_RegistryEntry)->job);
+}
+
+void glacier::Pipeline::setFallback(const Pipeline* fallback)
+{
+	m_Fallback = fallback;
+}
+
+void glacier::Pipeline::rebuild()
+{
+	void* pending = build(CompileMode::AsyncPriority);
+
+	// Supersedes a rebuild that hasn't been swapped in yet
+	if (m_PendingEntry != nullptr)
+		m_Application->m_PipelineRegistry->release(static_cast<PipelineRegistry::Entry*>(m_PendingEntry), 0);
+
+	m_PendingEntry = pending;
+}
+
+bool glacier::Pipeline::swapPending()
+{
+	if (m_PendingEntry == nullptr)
+		return true;
+
+	PipelineRegistry::Entry* pending = static_cast<PipelineRegistry::Entry*>(m_PendingEntry);
+	if (!pending->job->isDone())
+		return false;
+
+	PipelineRegistry* registry = m_Application->m_PipelineRegistry;
+
+	if (pending->job->hasFailed())
+	{
+		// The job has logged why, and the old state keeps drawing
+		registry->release(pending, 0);
+	}
+	else
+	{
+		registry->release(static_cast<PipelineRegistry::Entry*>(m_RegistryEntry), m_LastUsage);
+
+		m_RegistryEntry = pending;
+		m_PipelineLayout = pending->layout;
+		m_PushConstantStages = pending->pushConstants.stageFlags;
+		m_PushConstantSize = pending->pushConstants.size;
+		m_Id = pending->id;
+
+		m_Pipeline = nullptr;
+		m_DepthPipeline = nullptr;
+		isReady();
+	}
+
+	m_PendingEntry = nullptr;
+	return true;
+}
+
+void* glacier::Pipeline::build(CompileMode compileMode)
+{
 	std::vector<VkPipelineShaderStageCreateInfo> shaderStages;
+	std::vector<std::shared_ptr<void>> shaderModules;
+	std::vector<std::string> entryPoints;
+	std::vector<const SpecializationConstants*> shaderSpecializations;
+	std::vector<std::pair<VkShaderStageFlagBits, uint64_t>> shaderHashes;
 
 	bool hasVertex = false, hasFragment = false;
 
-	for (const std::pair<ShaderType, Shader*>& pair : shaders)
+	for (const std::pair<ShaderType, Shader*>& pair : m_Shaders)
 	{
 		VkPipelineShaderStageCreateInfo shaderCreateInfo = {};
 		shaderCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -32,38 +370,150 @@ glacier::Pipeline::Pipeline(const glacier::Application* application, const glaci
 			break;
 		}
 
-		shaderCreateInfo.module = static_cast<VkShaderModule>(pair.second->m_ShaderModule);
-		shaderCreateInfo.pName = "main";
+		if (pair.second->m_Reflection.stage != pair.first)
+			throw std::runtime_error("Shader is bound to a different stage than the one it was compiled for");
+
+		shaderCreateInfo.module = static_cast<VkShaderModule>(pair.second->m_ShaderModule.get());
+		shaderCreateInfo.pName = pair.second->m_Reflection.entryPoint.c_str();
+
+		std::unordered_map<ShaderType, SpecializationConstants>::const_iterator specialization = m_Description.specialization.find(pair.first);
 
 		shaderStages.push_back(shaderCreateInfo);
+		shaderModules.push_back(pair.second->m_ShaderModule);
+		entryPoints.push_back(pair.second->m_Reflection.entryPoint);
+		shaderSpecializations.push_back(specialization == m_Description.specialization.end() ? nullptr : &specialization->second);
+		shaderHashes.push_back(std::make_pair(shaderCreateInfo.stage, pair.second->m_Hash));
 	}
 
+	// The map's iteration order is unspecified, so order the stages to get a stable key
+	std::sort(shaderHashes.begin(), shaderHashes.end());
+
 	if (!hasVertex || !hasFragment)
 		throw std::runtime_error("At least one vertex and fragment shader must exist");
 
-	VkPipelineInputAssemblyStateCreateInfo inputAssemblyCreateInfo = {};
-	inputAssemblyCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-	inputAssemblyCreateInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-	inputAssemblyCreateInfo.primitiveRestartEnable = VK_FALSE;
+	/* Validate the vertex layout against the vertex shader's inputs */
+	// Every attribute takes one location, assigned in push order, and matrix and array inputs are reflected as one input per location, so an input's location indexes the layout's attributes
+	const std::vector<VertexAttribute>& attributes = m_VertexBuffer->m_Layout.m_Attributes;
+	for (const ShaderInput& input : m_Shaders.at(ShaderType::Vertex)->m_Reflection.inputs)
+	{
+		if (input.location >= attributes.size())
+			throw std::runtime_error(fmt::format("Vertex input {} at location {} is missing from the vertex buffer layout", input.name, input.location));
+
+		if (attributeType(attributes[input.location].element) != input.type)
+			throw std::runtime_error(fmt::format("Vertex input {} at location {} doesn't match the type of its vertex buffer attribute", input.name, input.location));
+	}
+
+	/* Validate the specialization constants against the shaders' declarations */
+	for (const std::pair<const ShaderType, SpecializationConstants>& pair : m_Description.specialization)
+	{
+		std::unordered_map<ShaderType, Shader*>::const_iterator shader = m_Shaders.find(pair.first);
+		if (shader == m_Shaders.end())
+		{
+			if (pair.second.empty())
+				continue;
+
+			throw std::runtime_error("Specialization constants are set for a stage without a shader");
+		}
+
+		const std::vector<ShaderSpecializationConstant>& declared = shader->second->m_Reflection.specializationConstants;
+
+		for (const SpecializationConstants::Entry& entry : pair.second.m_Entries)
+		{
+			std::vector<ShaderSpecializationConstant>::const_iterator constant = std::find_if(declared.begin(), declared.end(), [&](const ShaderSpecializationConstant& constant) { return constant.id == entry.id; });
+
+			if (constant == declared.end())
+				throw std::runtime_error(fmt::format("Shader has no specialization constant with id {}", entry.id));
+
+			if (constant->type != entry.type)
+				throw std::runtime_error(fmt::format("Specialization constant {} ({}) is set with a value of the wrong type", constant->name, entry.id));
+		}
+	}
+
+	/* Merge the descriptor bindings and push constants of every stage */
+	// Ordered by set then binding, which is also the order they go in the layout key
+	std::map<std::pair<uint32_t, uint32_t>, VkDescriptorSetLayoutBinding> bindings;
+
+	VkPushConstantRange pushConstantRange = {};
+
+	// With bindless resources, set 0 is the heap and every layout shares its push constant range
+	const BindlessHeap* heap = m_Application->m_BindlessHeap;
+
+	for (const std::pair<ShaderType, Shader*>& pair : m_Shaders)
+	{
+		const ShaderReflection& reflection = pair.second->m_Reflection;
+		VkShaderStageFlagBits stage = pair.first == ShaderType::Vertex ? VK_SHADER_STAGE_VERTEX_BIT : VK_SHADER_STAGE_FRAGMENT_BIT;
+
+		for (const ShaderBinding& binding : reflection.bindings)
+		{
+			if (heap != nullptr && binding.set == BindlessHeap::SET)
+			{
+				VkDescriptorType heapType = binding.binding == BindlessHeap::TEXTURE_BINDING ? VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+				uint32_t capacity = binding.binding == BindlessHeap::TEXTURE_BINDING ? heap->getTextureCapacity() : heap->getBufferCapacity();
+
+				if (binding.binding > BindlessHeap::BUFFER_BINDING || static_cast<VkDescriptorType>(binding.type) != heapType)
+					throw std::runtime_error(fmt::format("Descriptor {} is in set {}, which is reserved for the bindless texture array at binding {} and the storage buffer array at binding {}", binding.name, BindlessHeap::SET, BindlessHeap::TEXTURE_BINDING, BindlessHeap::BUFFER_BINDING));
+
+				if (binding.count > capacity)
+					throw std::runtime_error(fmt::format("Descriptor array {} has {} elements, but the bindless heap only holds {}", binding.name, binding.count, capacity));
+
+				continue;
+			}
+
+			if (binding.count == 0)
+				throw std::runtime_error(fmt::format("Runtime-sized descriptor array {} is not supported", binding.name));
+
+			VkDescriptorSetLayoutBinding layoutBinding = {};
+			layoutBinding.binding = binding.binding;
+			layoutBinding.descriptorType = static_cast<VkDescriptorType>(binding.type);
+			layoutBinding.descriptorCount = binding.count;
+
+			std::pair<std::map<std::pair<uint32_t, uint32_t>, VkDescriptorSetLayoutBinding>::iterator, bool> inserted = bindings.emplace(std::make_pair(binding.set, binding.binding), layoutBinding);
+
+			VkDescriptorSetLayoutBinding& merged = inserted.first->second;
+			if (merged.descriptorType != layoutBinding.descriptorType || merged.descriptorCount != layoutBinding.descriptorCount)
+				throw std::runtime_error(fmt::format("Stages disagree on the descriptor at set {} binding {}", binding.set, binding.binding));
+
+			merged.stageFlags |= stage;
+		}
+
+		if (heap != nullptr && reflection.pushConstantSize > BindlessHeap::PUSH_CONSTANT_SIZE)
+			throw std::runtime_error(fmt::format("Push constant block is {} bytes, bindless pipelines have {}", reflection.pushConstantSize, BindlessHeap::PUSH_CONSTANT_SIZE));
 
-	VkPipelineVertexInputStateCreateInfo vertexInputCreateInfo = {};
-	vertexInputCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+		// A single range from offset 0 covers every stage's block
+		if (reflection.pushConstantSize > 0)
+		{
+			pushConstantRange.size = std::max(pushConstantRange.size, reflection.pushConstantSize);
+			pushConstantRange.stageFlags |= stage;
+		}
+	}
 
-	// TODO: Vertex buffers
+	// Sets have to be contiguous, unused ones in between get an empty layout
+	std::vector<std::vector<VkDescriptorSetLayoutBinding>> setBindings(bindings.empty() ? 0 : bindings.rbegin()->first.first + 1);
+	for (const std::pair<const std::pair<uint32_t, uint32_t>, VkDescriptorSetLayoutBinding>& binding : bindings)
+		setBindings[binding.first.first].push_back(binding.second);
 
-	// EDIT
-	//vertexInputCreateInfo.vertexBindingDescriptionCount = 0;
-	//vertexInputCreateInfo.pVertexBindingDescriptions = nullptr;
-	//vertexInputCreateInfo.vertexAttributeDescriptionCount = 0;
-	//vertexInputCreateInfo.pVertexAttributeDescriptions = nullptr;
-	// ->
+	if (heap != nullptr)
+	{
+		// Set 0 always takes the heap's layout, bound once per frame for every pipeline
+		setBindings.resize(std::max<size_t>(setBindings.size(), BindlessHeap::SET + 1));
+
+		pushConstantRange.stageFlags = VK_SHADER_STAGE_ALL_GRAPHICS;
+		pushConstantRange.size = BindlessHeap::PUSH_CONSTANT_SIZE;
+	}
 
-	vertexInputCreateInfo.vertexBindingDescriptionCount = 1;
-	vertexInputCreateInfo.pVertexBindingDescriptions = &(vertexBuffer.m_Layout.getBindingDescription());
-	
-	std::vector<VkVertexInputAttributeDescription> descriptions = vertexBuffer.m_Layout.getAttributeDescriptions();
-	vertexInputCreateInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(descriptions.size());
-	vertexInputCreateInfo.pVertexAttributeDescriptions = descriptions.data();
+	bool strip = m_Description.topology == Topology::LineStrip || m_Description.topology == Topology::TriangleStrip || m_Description.topology == Topology::TriangleFan;
+	if (m_Description.primitiveRestart && !strip)
+		throw std::runtime_error("Primitive restart requires a strip or fan topology");
+
+	// 0 follows the renderer, anything else has to match its attachments
+	uint32_t samples = m_Description.samples == 0 ? m_Renderer->m_Samples : m_Description.samples;
+	if (samples != m_Renderer->m_Samples)
+		throw std::runtime_error(fmt::format("Pipeline requests {} samples, but the renderer uses {}", samples, m_Renderer->m_Samples));
+
+	VkPipelineInputAssemblyStateCreateInfo inputAssemblyCreateInfo = {};
+	inputAssemblyCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	inputAssemblyCreateInfo.topology = static_cast<VkPrimitiveTopology>(m_Description.topology);
+	inputAssemblyCreateInfo.primitiveRestartEnable = m_Description.primitiveRestart ? VK_TRUE : VK_FALSE;
 
 	/*
 	 * float:	VK_FORMAT_R32_SFLOAT
@@ -71,28 +521,8 @@ glacier::Pipeline::Pipeline(const glacier::Application* application, const glaci
 	 * vec3:	VK_FORMAT_R32G32B32_SFLOAT
 	 * vec4:	VK_FORMAT_R32G32B32A32_SFLOAT
 	 */
-	 // END
-
-	VkViewport viewport = {};
-	viewport.x = 0.0f;
-	viewport.y = 0.0f;
-
-	glm::uvec2 size = application->m_Window->getFramebufferSize();
-	viewport.width = static_cast<float>(size.x);
-	viewport.height = static_cast<float>(size.y);
-	viewport.minDepth = 0.0f;
-	viewport.maxDepth = 1.0f;
-
-	VkRect2D scissor = {};
-	scissor.offset = { 0, 0 };
-	scissor.extent = { size.x, size.y };
-
-	VkPipelineViewportStateCreateInfo viewportCreateInfo = {};
-	viewportCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-	viewportCreateInfo.viewportCount = 1;
-	viewportCreateInfo.pViewports = &viewport;
-	viewportCreateInfo.scissorCount = 1;
-	viewportCreateInfo.pScissors = &scissor;
+	VkVertexInputBindingDescription bindingDescription = m_VertexBuffer->m_Layout.getBindingDescription();
+	std::vector<VkVertexInputAttributeDescription> descriptions = m_VertexBuffer->m_Layout.getAttributeDescriptions();
 
 	VkPipelineRasterizationStateCreateInfo rasterizerCreateInfo = {};
 	rasterizerCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
@@ -101,10 +531,8 @@ glacier::Pipeline::Pipeline(const glacier::Application* application, const glaci
 	rasterizerCreateInfo.polygonMode = VK_POLYGON_MODE_FILL;
 	rasterizerCreateInfo.lineWidth = 1.0f;
 
-	// Disable face culling
-	rasterizerCreateInfo.cullMode = VK_CULL_MODE_NONE; // VK_CULL_MODE_BACK_BIT
-
-	rasterizerCreateInfo.frontFace = VK_FRONT_FACE_CLOCKWISE;
+	rasterizerCreateInfo.cullMode = static_cast<VkCullModeFlags>(m_Description.cullMode);
+	rasterizerCreateInfo.frontFace = static_cast<VkFrontFace>(m_Description.frontFace);
 	rasterizerCreateInfo.depthBiasEnable = VK_FALSE;
 	rasterizerCreateInfo.depthBiasConstantFactor = 0.0f;
 	rasterizerCreateInfo.depthBiasClamp = 0.0f;
@@ -113,27 +541,46 @@ glacier::Pipeline::Pipeline(const glacier::Application* application, const glaci
 	VkPipelineMultisampleStateCreateInfo multisampleCreateInfo = {};
 	multisampleCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
 	multisampleCreateInfo.sampleShadingEnable = VK_FALSE;
-	multisampleCreateInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+	multisampleCreateInfo.rasterizationSamples = static_cast<VkSampleCountFlagBits>(samples);
 	multisampleCreateInfo.minSampleShading = 1.0f;
 	multisampleCreateInfo.pSampleMask = nullptr;
 	multisampleCreateInfo.alphaToCoverageEnable = VK_FALSE;
 	multisampleCreateInfo.alphaToOneEnable = VK_FALSE;
 
+	// When opaque geometry went through the depth prepass, its depth is already final, so only test for equality (or better) without writing
+	bool prepass = m_Application->m_Info.depthPrepass && isOpaque();
+
+	VkCompareOp compareOp = static_cast<VkCompareOp>(m_Description.depth.compare);
+	if (prepass && compareOp == VK_COMPARE_OP_LESS)
+		compareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+	else if (prepass && compareOp == VK_COMPARE_OP_GREATER)
+		compareOp = VK_COMPARE_OP_GREATER_OR_EQUAL;
+
+	VkPipelineDepthStencilStateCreateInfo depthStencilCreateInfo = {};
+	depthStencilCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthStencilCreateInfo.depthTestEnable = m_Description.depth.test ? VK_TRUE : VK_FALSE;
+	depthStencilCreateInfo.depthWriteEnable = m_Description.depth.write && !prepass ? VK_TRUE : VK_FALSE;
+	depthStencilCreateInfo.depthCompareOp = compareOp;
+	depthStencilCreateInfo.depthBoundsTestEnable = VK_FALSE;
+	depthStencilCreateInfo.stencilTestEnable = VK_FALSE;
+	depthStencilCreateInfo.minDepthBounds = 0.0f;
+	depthStencilCreateInfo.maxDepthBounds = 1.0f;
+
 	VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
 	colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-	colorBlendAttachment.blendEnable = VK_FALSE;
-	colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
-	colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;
-	colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
-	colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
-	colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+	colorBlendAttachment.blendEnable = m_Description.blend.enable ? VK_TRUE : VK_FALSE;
+	colorBlendAttachment.srcColorBlendFactor = static_cast<VkBlendFactor>(m_Description.blend.srcColor);
+	colorBlendAttachment.dstColorBlendFactor = static_cast<VkBlendFactor>(m_Description.blend.dstColor);
+	colorBlendAttachment.colorBlendOp = static_cast<VkBlendOp>(m_Description.blend.colorOp);
+	colorBlendAttachment.srcAlphaBlendFactor = static_cast<VkBlendFactor>(m_Description.blend.srcAlpha);
+	colorBlendAttachment.dstAlphaBlendFactor = static_cast<VkBlendFactor>(m_Description.blend.dstAlpha);
+	colorBlendAttachment.alphaBlendOp = static_cast<VkBlendOp>(m_Description.blend.alphaOp);
 
 	VkPipelineColorBlendStateCreateInfo colorBlendCreateInfo = {};
 	colorBlendCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
 	colorBlendCreateInfo.logicOpEnable = VK_FALSE;
 	colorBlendCreateInfo.logicOp = VK_LOGIC_OP_COPY;
 	colorBlendCreateInfo.attachmentCount = 1;
-	colorBlendCreateInfo.pAttachments = &colorBlendAttachment;
 	colorBlendCreateInfo.blendConstants[0] = 0.0f;
 	colorBlendCreateInfo.blendConstants[1] = 0.0f;
 	colorBlendCreateInfo.blendConstants[2] = 0.0f;
@@ -141,54 +588,270 @@ glacier::Pipeline::Pipeline(const glacier::Application* application, const glaci
 
 	VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
 	pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-	pipelineLayoutCreateInfo.setLayoutCount = 0;
-	pipelineLayoutCreateInfo.pSetLayouts = nullptr;
-	pipelineLayoutCreateInfo.pushConstantRangeCount = 0;
-	pipelineLayoutCreateInfo.pPushConstantRanges = nullptr;
-
-	if (vkCreatePipelineLayout(static_cast<VkDevice>(application->m_Device), &pipelineLayoutCreateInfo, nullptr, reinterpret_cast<VkPipelineLayout*>(&m_PipelineLayout)) != VK_SUCCESS)
+	pipelineLayoutCreateInfo.setLayoutCount = static_cast<uint32_t>(setBindings.size());
+	pipelineLayoutCreateInfo.pSetLayouts = nullptr; // Created with the layout
+	pipelineLayoutCreateInfo.pushConstantRangeCount = pushConstantRange.size > 0 ? 1 : 0;
+	pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+
+	/* Build the state key */
+	// Everything that affects the compiled pipeline goes in, so equal keys can share a single VkPipeline
+	VkFormat colorFormat = static_cast<VkFormat>(m_Renderer->m_ColorFormat);
+	VkFormat depthFormat = static_cast<VkFormat>(m_Renderer->m_DepthFormat);
+
+	PipelineKey layoutKey;
+	layoutKey.append(pipelineLayoutCreateInfo.setLayoutCount);
+	for (const std::vector<VkDescriptorSetLayoutBinding>& set : setBindings)
 	{
-		throw std::runtime_error("Failed to create pipeline layout");
+		layoutKey.append(set.size());
+
+		for (const VkDescriptorSetLayoutBinding& binding : set)
+		{
+			layoutKey.append(binding.binding);
+			layoutKey.append(binding.descriptorType);
+			layoutKey.append(binding.descriptorCount);
+			layoutKey.append(binding.stageFlags);
+		}
 	}
 
-	/* Create graphics pipeline */
-	VkGraphicsPipelineCreateInfo graphicsPipelineCreateInfo = {};
-	graphicsPipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	layoutKey.append(pipelineLayoutCreateInfo.pushConstantRangeCount);
+	layoutKey.append(pushConstantRange.stageFlags);
+	layoutKey.append(pushConstantRange.size);
+	layoutKey.append(heap != nullptr);
 
-	// Shader stages
-	graphicsPipelineCreateInfo.stageCount = static_cast<uint32_t>(shaderStages.size());
-	graphicsPipelineCreateInfo.pStages = shaderStages.data();
+	PipelineKey key;
+	key.append(layoutKey.data().size());
+	for (char c : layoutKey.data())
+		key.append(c);
 
-	graphicsPipelineCreateInfo.pVertexInputState = &vertexInputCreateInfo;
-	graphicsPipelineCreateInfo.pInputAssemblyState = &inputAssemblyCreateInfo;
-	graphicsPipelineCreateInfo.pViewportState = &viewportCreateInfo;
-	graphicsPipelineCreateInfo.pRasterizationState = &rasterizerCreateInfo;
-	graphicsPipelineCreateInfo.pMultisampleState = &multisampleCreateInfo;
-	graphicsPipelineCreateInfo.pDepthStencilState = nullptr;
-	graphicsPipelineCreateInfo.pColorBlendState = &colorBlendCreateInfo;
+	// Render pass compatibility only depends on the attachment formats, which are the same in both paths
+	key.append(m_Application->m_DynamicRendering);
+	key.append(colorFormat);
+	key.append(depthFormat);
 
-	// TODO: Implement dynamic state (To change viewport size)
-	graphicsPipelineCreateInfo.pDynamicState = nullptr;
+	// Appended field by field, a pair would bring its padding bytes into the key
+	for (const std::pair<VkShaderStageFlagBits, uint64_t>& shader : shaderHashes)
+	{
+		key.append(shader.first);
+		key.append(shader.second);
+	}
 
-	graphicsPipelineCreateInfo.layout = static_cast<VkPipelineLayout>(m_PipelineLayout);
+	// In a fixed stage order, the map's iteration order is unspecified
+	for (ShaderType type : { ShaderType::Vertex, ShaderType::Tesselation, ShaderType::Geometry, ShaderType::Fragment, ShaderType::Compute })
+	{
+		std::unordered_map<ShaderType, SpecializationConstants>::const_iterator specialization = m_Description.specialization.find(type);
+		if (specialization == m_Description.specialization.end() || specialization->second.empty())
+			continue;
 
-	graphicsPipelineCreateInfo.renderPass = static_cast<VkRenderPass>(renderer->m_RenderPass);
-	graphicsPipelineCreateInfo.subpass = 0;
+		key.append(type);
+		key.append(specialization->second.m_Entries.size());
 
-	graphicsPipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;
-	graphicsPipelineCreateInfo.basePipelineIndex = -1;
+		for (const SpecializationConstants::Entry& entry : specialization->second.m_Entries)
+		{
+			key.append(entry.id);
+			key.append(entry.size);
+			key.append(entry.bits);
+		}
+	}
 
-	if (vkCreateGraphicsPipelines(static_cast<VkDevice>(m_Application->m_Device), VK_NULL_HANDLE, 1, &graphicsPipelineCreateInfo, nullptr, reinterpret_cast<VkPipeline*>(&m_Pipeline)) != VK_SUCCESS)
+	key.append(bindingDescription);
+	for (const VkVertexInputAttributeDescription& description : descriptions)
+		key.append(description);
+
+	key.append(inputAssemblyCreateInfo.topology);
+	key.append(inputAssemblyCreateInfo.primitiveRestartEnable);
+	key.append(rasterizerCreateInfo.polygonMode);
+	key.append(rasterizerCreateInfo.cullMode);
+	key.append(rasterizerCreateInfo.frontFace);
+	key.append(multisampleCreateInfo.rasterizationSamples);
+	key.append(depthStencilCreateInfo.depthTestEnable);
+	key.append(depthStencilCreateInfo.depthWriteEnable);
+	key.append(depthStencilCreateInfo.depthCompareOp);
+	key.append(m_Description.depth.compare);
+	key.append(prepass);
+	key.append(colorBlendAttachment);
+
+	/* Hand the state over to the compile job */
+	// The job may run after this constructor returns, so it gets its own copy of everything the create infos point to
+	std::shared_ptr<PipelineBuildState> state = std::make_shared<PipelineBuildState>();
+	state->device = static_cast<VkDevice>(m_Application->m_Device);
+	state->renderPass = m_Application->m_DynamicRendering ? VK_NULL_HANDLE : static_cast<VkRenderPass>(m_Renderer->m_RenderPass);
+	state->colorFormat = colorFormat;
+	state->depthFormat = depthFormat;
+	state->shaderStages = shaderStages;
+	state->shaderModules = shaderModules;
+	state->entryPoints = entryPoints;
+
+	// A shader may be reloaded before the job runs, so the stages point into the state's copies
+	for (size_t i = 0; i < shaderStages.size(); i++)
+		state->shaderStages[i].pName = state->entryPoints[i].c_str();
+
+	state->specializationEntries.resize(shaderStages.size());
+	state->specializationData.resize(shaderStages.size());
+	state->specializationInfos.resize(shaderStages.size());
+
+	for (size_t i = 0; i < shaderStages.size(); i++)
 	{
-		throw std::runtime_error("Failed to create graphics pipeline");
+		if (shaderSpecializations[i] == nullptr || shaderSpecializations[i]->empty())
+			continue;
+
+		std::vector<VkSpecializationMapEntry>& entries = state->specializationEntries[i];
+		std::vector<char>& data = state->specializationData[i];
+
+		for (const SpecializationConstants::Entry& entry : shaderSpecializations[i]->m_Entries)
+		{
+			entries.push_back(VkSpecializationMapEntry{ entry.id, static_cast<uint32_t>(data.size()), entry.size });
+
+			const char* bytes = reinterpret_cast<const char*>(&entry.bits);
+			data.insert(data.end(), bytes, bytes + entry.size);
+		}
+
+		VkSpecializationInfo& info = state->specializationInfos[i];
+		info.mapEntryCount = static_cast<uint32_t>(entries.size());
+		info.pMapEntries = entries.data();
+		info.dataSize = data.size();
+		info.pData = data.data();
+
+		// Points into the state, which lives as long as the compile job
+		state->shaderStages[i].pSpecializationInfo = &info;
 	}
+
+	state->bindingDescription = bindingDescription;
+	state->descriptions = descriptions;
+	state->positionSize = attributes.empty() ? 0 : attributes[0].size;
+	state->inputAssembly = inputAssemblyCreateInfo;
+	state->rasterizer = rasterizerCreateInfo;
+	state->multisample = multisampleCreateInfo;
+	state->depthStencil = depthStencilCreateInfo;
+	state->colorBlendAttachment = colorBlendAttachment;
+	state->colorBlend = colorBlendCreateInfo;
+	state->prepass = prepass;
+	state->prepassCompare = static_cast<VkCompareOp>(m_Description.depth.compare);
+
+	PipelineRegistry* registry = m_Application->m_PipelineRegistry;
+	bool async = compileMode != CompileMode::Blocking;
+
+	return registry->acquire(key, [&](PipelineRegistry::Entry& entry) -> void
+		{
+			entry.layout = registry->acquireLayout(layoutKey, [&](std::vector<VkDescriptorSetLayout>& setLayouts) -> VkPipelineLayout
+				{
+					VkDevice device = static_cast<VkDevice>(m_Application->m_Device);
+
+					// Nothing is registered if this throws, so clean up what was created so far
+					auto destroySetLayouts = [&]() -> void
+					{
+						for (VkDescriptorSetLayout setLayout : setLayouts)
+							vkDestroyDescriptorSetLayout(device, setLayout, nullptr);
+
+						setLayouts.clear();
+					};
+
+					// The registry destroys what is in setLayouts, so the heap's layout only goes into this list
+					std::vector<VkDescriptorSetLayout> pipelineSetLayouts;
+
+					for (size_t i = 0; i < setBindings.size(); i++)
+					{
+						if (heap != nullptr && i == BindlessHeap::SET)
+						{
+							pipelineSetLayouts.push_back(heap->getSetLayout());
+							continue;
+						}
+
+						const std::vector<VkDescriptorSetLayoutBinding>& set = setBindings[i];
+
+						VkDescriptorSetLayoutCreateInfo setLayoutCreateInfo = {};
+						setLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+						setLayoutCreateInfo.bindingCount = static_cast<uint32_t>(set.size());
+						setLayoutCreateInfo.pBindings = set.data();
+
+						VkDescriptorSetLayout setLayout;
+						if (vkCreateDescriptorSetLayout(device, &setLayoutCreateInfo, nullptr, &setLayout) != VK_SUCCESS)
+						{
+							destroySetLayouts();
+							throw std::runtime_error("Failed to create descriptor set layout");
+						}
+
+						setLayouts.push_back(setLayout);
+						pipelineSetLayouts.push_back(setLayout);
+					}
+
+					pipelineLayoutCreateInfo.pSetLayouts = pipelineSetLayouts.data();
+
+					VkPipelineLayout layout;
+					if (vkCreatePipelineLayout(device, &pipelineLayoutCreateInfo, nullptr, &layout) != VK_SUCCESS)
+					{
+						destroySetLayouts();
+						throw std::runtime_error("Failed to create pipeline layout");
+					}
+
+					return layout;
+				});
+
+			entry.pushConstants = pushConstantRange;
+			state->layout = entry.layout;
+
+			PipelineRegistry::Entry* target = &entry;
+			entry.job = std::make_shared<ThreadPool::Job>([state, target, async]()
+				{
+					try
+					{
+						createPipelines(*state, *target);
+					}
+					catch (const std::exception& e)
+					{
+						// Nobody is waiting for an asynchronous pipeline, so this is the only place the failure shows up
+						if (async)
+							glacier::g_Logger->error("Background pipeline compilation failed: {}", e.what());
+
+						throw;
+					}
+				});
+
+			if (async)
+				m_Application->m_ThreadPool->submit(entry.job, compileMode == CompileMode::AsyncPriority);
+		});
 }
 
-glacier::Pipeline::~Pipeline()
+void glacier::SpecializationConstants::set(uint32_t id, bool value)
+{
+	VkBool32 bool32 = value ? VK_TRUE : VK_FALSE;
+	set(id, ShaderScalarType::Bool, &bool32, sizeof(VkBool32));
+}
+
+void glacier::SpecializationConstants::set(uint32_t id, int32_t value)
+{
+	set(id, ShaderScalarType::Int, &value, sizeof(int32_t));
+}
+
+void glacier::SpecializationConstants::set(uint32_t id, uint32_t value)
+{
+	set(id, ShaderScalarType::UnsignedInt, &value, sizeof(uint32_t));
+}
+
+void glacier::SpecializationConstants::set(uint32_t id, float value)
+{
+	set(id, ShaderScalarType::Float, &value, sizeof(float));
+}
+
+void glacier::SpecializationConstants::set(uint32_t id, double value)
 {
-	if (m_Pipeline)
-		vkDestroyPipeline(static_cast<VkDevice>(m_Application->m_Device), static_cast<VkPipeline>(m_Pipeline), nullptr);
+	set(id, ShaderScalarType::Double, &value, sizeof(double));
+}
+
+bool glacier::SpecializationConstants::empty() const
+{
+	return m_Entries.empty();
+}
+
+void glacier::SpecializationConstants::set(uint32_t id, ShaderScalarType type, const void* value, uint32_t size)
+{
+	Entry entry = { id, type, size, 0 };
+	memcpy(&entry.bits, value, size);
+
+	// Kept sorted so equal sets of values produce equal pipeline keys regardless of the order they were set in
+	std::vector<Entry>::iterator it = std::lower_bound(m_Entries.begin(), m_Entries.end(), id, [](const Entry& other, uint32_t id) { return other.id < id; });
 
-	if (m_PipelineLayout)
-		vkDestroyPipelineLayout(static_cast<VkDevice>(m_Application->m_Device), static_cast<VkPipelineLayout>(m_PipelineLayout), nullptr);
+	if (it != m_Entries.end() && it->id == id)
+		*it = entry;
+	else
+		m_Entries.insert(it, entry);
 }
@@ -0,0 +1,146 @@
+#include "internal/PipelineRegistry.hpp"
+#include "internal/DeletionQueue.hpp"
+#include "common.hpp"
+
+#include <algorithm>
+
+PipelineRegistry::PipelineRegistry(VkDevice device, DeletionQueue* deletionQueue)
+	: m_Device(device), m_DeletionQueue(deletionQueue), m_NextId(0), m_Hits(0)
+{
+}
+
+PipelineRegistry::~PipelineRegistry()
+{
+	if (!m_Pipelines.empty())
+		glacier::g_Logger->warn("{} pipelines were not destroyed before the application terminated", m_Pipelines.size());
+
+	for (std::pair<const std::string, Entry>& pair : m_Pipelines)
+	{
+		stopJob(pair.second);
+
+		m_DeletionQueue->destroy(VK_OBJECT_TYPE_PIPELINE, pair.second.pipeline, pair.second.lastUsage);
+		m_DeletionQueue->destroy(VK_OBJECT_TYPE_PIPELINE, pair.second.depthPipeline, pair.second.lastUsage);
+	}
+
+	for (const std::pair<const std::string, LayoutEntry>& pair : m_Layouts)
+		destroyLayout(pair.second);
+}
+
+VkPipelineLayout PipelineRegistry::acquireLayout(const PipelineKey& key, const std::function<VkPipelineLayout(std::vector<VkDescriptorSetLayout>&)>& create)
+{
+	std::unordered_map<std::string, LayoutEntry>::iterator it = m_Layouts.find(key.data());
+	if (it != m_Layouts.end())
+	{
+		it->second.references++;
+		return it->second.layout;
+	}
+
+	LayoutEntry entry = {};
+	entry.layout = create(entry.setLayouts);
+	entry.references = 1;
+
+	return m_Layouts.emplace(key.data(), std::move(entry)).first->second.layout;
+}
+
+void PipelineRegistry::releaseLayout(VkPipelineLayout layout, uint64_t lastUsage)
+{
+	// Layouts are few, so a linear search is cheaper than keeping a reverse map
+	for (std::unordered_map<std::string, LayoutEntry>::iterator it = m_Layouts.begin(); it != m_Layouts.end(); ++it)
+	{
+		if (it->second.layout != layout)
+			continue;
+
+		it->second.lastUsage = std::max(it->second.lastUsage, lastUsage);
+
+		if (--it->second.references == 0)
+		{
+			destroyLayout(it->second);
+			m_Layouts.erase(it);
+		}
+
+		return;
+	}
+}
+
+PipelineRegistry::Entry* PipelineRegistry::acquire(const PipelineKey& key, const std::function<void(Entry&)>& create)
+{
+	std::unordered_map<std::string, Entry>::iterator it = m_Pipelines.find(key.data());
+	if (it != m_Pipelines.end())
+	{
+		it->second.references++;
+		m_Hits++;
+
+		return &it->second;
+	}
+
+	// Unordered map nodes are never moved, so the entry and its key can be referred to by pointer, including by the compile job
+	std::unordered_map<std::string, Entry>::iterator inserted = m_Pipelines.emplace(key.data(), Entry()).first;
+
+	Entry& entry = inserted->second;
+	entry.key = &inserted->first;
+
+	try
+	{
+		create(entry);
+	}
+	catch (...)
+	{
+		m_Pipelines.erase(inserted);
+		throw;
+	}
+
+	entry.id = m_NextId++;
+	entry.references = 1;
+
+	return &entry;
+}
+
+void PipelineRegistry::release(Entry* entry, uint64_t lastUsage)
+{
+	entry->lastUsage = std::max(entry->lastUsage, lastUsage);
+
+	if (--entry->references > 0)
+		return;
+
+	stopJob(*entry);
+
+	m_DeletionQueue->destroy(VK_OBJECT_TYPE_PIPELINE, entry->pipeline, entry->lastUsage);
+	m_DeletionQueue->destroy(VK_OBJECT_TYPE_PIPELINE, entry->depthPipeline, entry->lastUsage);
+	releaseLayout(entry->layout, entry->lastUsage);
+
+	m_Pipelines.erase(m_Pipelines.find(*entry->key));
+}
+
+size_t PipelineRegistry::size() const
+{
+	return m_Pipelines.size();
+}
+
+uint64_t PipelineRegistry::getHits() const
+{
+	return m_Hits;
+}
+
+void PipelineRegistry::destroyLayout(const LayoutEntry& entry)
+{
+	m_DeletionQueue->destroy(VK_OBJECT_TYPE_PIPELINE_LAYOUT, entry.layout, entry.lastUsage);
+
+	for (VkDescriptorSetLayout setLayout : entry.setLayouts)
+		m_DeletionQueue->destroy(VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT, setLayout, entry.lastUsage);
+}
+
+void PipelineRegistry::stopJob(Entry& entry)
+{
+	// The job writes into the entry, so it has to be cancelled or finished before the entry goes away
+	if (!entry.job || entry.job->cancel())
+		return;
+
+	try
+	{
+		entry.job->wait();
+	}
+	catch (const std::exception&)
+	{
+		// Already reported when the job failed, and there is nothing left to destroy
+	}
+}
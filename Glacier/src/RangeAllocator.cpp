@@ -0,0 +1,84 @@
+#include "internal/RangeAllocator.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+RangeAllocator::RangeAllocator(uint32_t capacity)
+	: m_Capacity(0), m_FreeSize(0)
+{
+	reset(0, capacity);
+}
+
+bool RangeAllocator::allocate(uint32_t size, uint32_t& offset)
+{
+	for (std::map<uint32_t, uint32_t>::iterator range = m_FreeRanges.begin(); range != m_FreeRanges.end(); range++)
+	{
+		if (range->second < size)
+			continue;
+
+		offset = range->first;
+		uint32_t remaining = range->second - size;
+
+		m_FreeRanges.erase(range);
+		if (remaining > 0)
+			m_FreeRanges.emplace(offset + size, remaining);
+
+		m_FreeSize -= size;
+		return true;
+	}
+
+	return false;
+}
+
+void RangeAllocator::free(uint32_t offset, uint32_t size)
+{
+	m_FreeSize += size;
+
+	// Merge with the free range that follows, then with the one that precedes
+	std::map<uint32_t, uint32_t>::iterator next = m_FreeRanges.find(offset + size);
+	if (next != m_FreeRanges.end())
+	{
+		size += next->second;
+		m_FreeRanges.erase(next);
+	}
+
+	std::map<uint32_t, uint32_t>::iterator range = m_FreeRanges.emplace(offset, size).first;
+	if (range != m_FreeRanges.begin())
+	{
+		std::map<uint32_t, uint32_t>::iterator previous = std::prev(range);
+		if (previous->first + previous->second == offset)
+		{
+			previous->second += size;
+			m_FreeRanges.erase(range);
+		}
+	}
+}
+
+void RangeAllocator::reset(uint32_t used, uint32_t capacity)
+{
+	m_Capacity = capacity;
+	m_FreeSize = capacity - used;
+
+	m_FreeRanges.clear();
+	if (m_FreeSize > 0)
+		m_FreeRanges.emplace(used, m_FreeSize);
+}
+
+uint32_t RangeAllocator::getCapacity() const
+{
+	return m_Capacity;
+}
+
+uint32_t RangeAllocator::getFreeSize() const
+{
+	return m_FreeSize;
+}
+
+uint32_t RangeAllocator::getLargestFreeRange() const
+{
+	uint32_t largest = 0;
+	for (const std::pair<const uint32_t, uint32_t>& range : m_FreeRanges)
+		largest = std::max(largest, range.second);
+
+	return largest;
+}
@@ -0,0 +1,122 @@
+#include "internal/RenderQueue.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <utility>
+
+uint64_t RenderQueue::makeKey(uint8_t layer, bool translucent, uint16_t pipeline, uint16_t material, float depth)
+{
+	if (!(depth > 0.0f))
+		depth = 0.0f;
+
+	// Non-negative floats order the same as their bit patterns, keep the 23 most significant bits below the sign
+	uint32_t bits;
+	memcpy(&bits, &depth, sizeof(bits));
+	uint64_t quantizedDepth = (bits >> 8) & 0x7fffff;
+
+	uint64_t key = static_cast<uint64_t>(layer) << 56;
+
+	if (translucent)
+	{
+		key |= 1ull << 55;
+		key |= (0x7fffff - quantizedDepth) << 32;
+		key |= static_cast<uint64_t>(pipeline) << 16;
+		key |= material;
+	}
+	else
+	{
+		key |= static_cast<uint64_t>(pipeline) << 39;
+		key |= static_cast<uint64_t>(material) << 23;
+		key |= quantizedDepth;
+	}
+
+	return key;
+}
+
+uint16_t RenderQueue::pipelineIndex(uint32_t id)
+{
+	return denseIndex(m_PipelineIndices, id);
+}
+
+uint16_t RenderQueue::materialIndex(uint32_t id)
+{
+	return denseIndex(m_MaterialIndices, id);
+}
+
+void RenderQueue::clear()
+{
+	m_Items.clear();
+	m_PipelineIndices.clear();
+	m_MaterialIndices.clear();
+}
+
+void RenderQueue::push(uint64_t key, uint32_t index)
+{
+	m_Items.push_back(Item{ key, index });
+}
+
+size_t RenderQueue::size() const
+{
+	return m_Items.size();
+}
+
+uint16_t RenderQueue::denseIndex(std::unordered_map<uint32_t, uint16_t>& indices, uint32_t id)
+{
+	constexpr size_t LAST = std::numeric_limits<uint16_t>::max();
+
+	std::unordered_map<uint32_t, uint16_t>::const_iterator it = indices.find(id);
+	if (it != indices.end())
+		return it->second;
+
+	uint16_t index = static_cast<uint16_t>(std::min(indices.size(), LAST));
+	indices.emplace(id, index);
+
+	return index;
+}
+
+const std::vector<uint32_t>& RenderQueue::sort()
+{
+	// Least significant digit radix sort with 8-bit digits. It is stable, so equal keys keep their submission order.
+	size_t count = m_Items.size();
+	m_Scratch.resize(count);
+
+	// Build the histograms of all digits in a single pass over the keys
+	uint32_t histograms[8][256] = {};
+	for (const Item& item : m_Items)
+	{
+		for (unsigned int digit = 0; digit < 8; digit++)
+			histograms[digit][(item.key >> (digit * 8)) & 0xff]++;
+	}
+
+	Item* src = m_Items.data();
+	Item* dst = m_Scratch.data();
+
+	for (unsigned int digit = 0; digit < 8; digit++)
+	{
+		uint32_t* histogram = histograms[digit];
+
+		// Skip digits that are equal for every key, such as unused layers
+		if (count == 0 || histogram[(src[0].key >> (digit * 8)) & 0xff] == count)
+			continue;
+
+		uint32_t offset = 0;
+		for (unsigned int bucket = 0; bucket < 256; bucket++)
+		{
+			uint32_t bucketCount = histogram[bucket];
+			histogram[bucket] = offset;
+			offset += bucketCount;
+		}
+
+		for (size_t i = 0; i < count; i++)
+			dst[histogram[(src[i].key >> (digit * 8)) & 0xff]++] = src[i];
+
+		std::swap(src, dst);
+	}
+
+	m_Sorted.resize(count);
+	for (size_t i = 0; i < count; i++)
+		m_Sorted[i] = src[i].index;
+
+	return m_Sorted;
+}
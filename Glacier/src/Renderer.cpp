@@ -1,9 +1,14 @@
 #include "Renderer.hpp"
 #include "Application.hpp"
+#include "GeometryPool.hpp"
 #include "Pipeline.hpp"
 #include "internal/utility.hpp"
+#include "internal/BindlessHeap.hpp"
+#include "internal/DeletionQueue.hpp"
+#include "internal/RenderQueue.hpp"
 
 #include <spdlog/spdlog.h>
+#include <algorithm>
 #include <optional>
 #include <vulkan/vulkan.h>
 
@@ -32,20 +37,57 @@ VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>
 	return formats[0];
 }
 
-VkPresentModeKHR choosePresentMode(const std::vector<VkPresentModeKHR>& modes, bool vsync)
+const char* presentModeName(VkPresentModeKHR mode)
 {
-	for (const VkPresentModeKHR& mode : modes)
+	switch (mode)
 	{
-		// If vsync is disabled, prefer immediate.
-		if (vsync == false && mode == VK_PRESENT_MODE_IMMEDIATE_KHR)
-			return mode;
+	case VK_PRESENT_MODE_IMMEDIATE_KHR:
+		return "immediate";
+	case VK_PRESENT_MODE_MAILBOX_KHR:
+		return "mailbox";
+	case VK_PRESENT_MODE_FIFO_KHR:
+		return "FIFO";
+	case VK_PRESENT_MODE_FIFO_RELAXED_KHR:
+		return "FIFO relaxed";
+	default:
+		return "unknown";
+	}
+}
 
-		// If vsync is enabled, prefer triple buffering over double buffering.
-		if (vsync == true && mode == VK_PRESENT_MODE_MAILBOX_KHR)
+VkPresentModeKHR choosePresentMode(const std::vector<VkPresentModeKHR>& modes, const glacier::ApplicationInfo& applicationInfo)
+{
+	VkPresentModeKHR preferred;
+
+	switch (applicationInfo.presentPolicy)
+	{
+	case glacier::PresentPolicy::Fifo:
+		preferred = VK_PRESENT_MODE_FIFO_KHR;
+		break;
+	case glacier::PresentPolicy::FifoRelaxed:
+		preferred = VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+		break;
+	case glacier::PresentPolicy::Mailbox:
+		preferred = VK_PRESENT_MODE_MAILBOX_KHR;
+		break;
+	case glacier::PresentPolicy::Immediate:
+		preferred = VK_PRESENT_MODE_IMMEDIATE_KHR;
+		break;
+	default:
+		// If vsync is enabled, prefer triple buffering over double buffering. If vsync is disabled, prefer immediate.
+		preferred = applicationInfo.vsync ? VK_PRESENT_MODE_MAILBOX_KHR : VK_PRESENT_MODE_IMMEDIATE_KHR;
+		break;
+	}
+
+	for (const VkPresentModeKHR& mode : modes)
+	{
+		if (mode == preferred)
 			return mode;
 	}
 
-	// If the preferred modes aren't available, default to double buffering.
+	// If the preferred mode isn't available, default to double buffering.
+	if (applicationInfo.presentPolicy != glacier::PresentPolicy::Auto)
+		glacier::g_Logger->warn("Present mode {} is not supported, falling back to FIFO", presentModeName(preferred));
+
 	return VK_PRESENT_MODE_FIFO_KHR;
 }
 
@@ -74,12 +116,27 @@ void createSwapchain(const VkPhysicalDevice& physicalDevice, const VkDevice& dev
 	/* Create a swap chain */
 	glacier::g_Logger->trace("Creating swap chain");
 
-	unsigned int imageCount = details.capabilities.minImageCount + 1;
-	if (details.capabilities.minImageCount > 0 && imageCount > details.capabilities.maxImageCount)
+	unsigned int imageCount = applicationInfo.swapchainImageCount;
+	if (imageCount == 0)
+	{
+		imageCount = details.capabilities.minImageCount + 1;
+	}
+	else if (imageCount < details.capabilities.minImageCount)
+	{
+		imageCount = details.capabilities.minImageCount;
+	}
+
+	// A maximum of 0 means there is no limit
+	if (details.capabilities.maxImageCount > 0 && imageCount > details.capabilities.maxImageCount)
 	{
 		imageCount = details.capabilities.maxImageCount;
 	}
 
+	if (applicationInfo.swapchainImageCount != 0 && imageCount != applicationInfo.swapchainImageCount)
+	{
+		glacier::g_Logger->warn("Requested {} swapchain images, but the surface only supports {} to {}", applicationInfo.swapchainImageCount, details.capabilities.minImageCount, details.capabilities.maxImageCount);
+	}
+
 	VkSwapchainCreateInfoKHR swapchainCreateInfo = {};
 	swapchainCreateInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
 	swapchainCreateInfo.surface = surface;
@@ -123,8 +180,8 @@ void createSwapchain(const VkPhysicalDevice& physicalDevice, const VkDevice& dev
 	// Enable clipping of unused pixels for better performance
 	swapchainCreateInfo.clipped = VK_TRUE;
 
-	// TODO: If the window is resized, we need to create an entirely new swapchain
-	swapchainCreateInfo.oldSwapchain = VK_NULL_HANDLE;
+	// Hand over to the previous swapchain, so it is retired instead of competing for the surface
+	swapchainCreateInfo.oldSwapchain = oldSwapchain != nullptr ? *oldSwapchain : VK_NULL_HANDLE;
 
 	if (vkCreateSwapchainKHR(device, &swapchainCreateInfo, nullptr, pSwapchain) != VK_SUCCESS)
 	{
@@ -174,43 +231,174 @@ void createImageViews(const VkDevice& device, const VkSurfaceFormatKHR& surfaceF
 	}
 }
 
+// Choose a depth format
+VkFormat chooseDepthFormat(const VkPhysicalDevice& physicalDevice)
+{
+	// Only depth is used, so prefer formats without a stencil component
+	VkFormat candidates[] = { VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT, VK_FORMAT_D16_UNORM };
+
+	for (VkFormat format : candidates)
+	{
+		VkFormatProperties properties;
+		vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &properties);
+
+		if (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT)
+		{
+			return format;
+		}
+	}
+
+	throw std::runtime_error("Failed to find a supported depth format");
+}
+
+// Create one attachment image per swapchain image
+void createAttachmentImages(const VkDevice& device, const VkPhysicalDevice& physicalDevice, VkFormat format, VkImageUsageFlags usage, VkImageAspectFlags aspect, VkSampleCountFlagBits samples, const VkExtent2D& extent, size_t count, std::vector<VkImage>& images, std::vector<VkDeviceMemory>& memories, std::vector<VkImageView>& imageViews)
+{
+	glacier::g_Logger->trace("Creating attachment images...");
+
+	images.resize(count);
+	memories.resize(count);
+	imageViews.resize(count);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		VkImageCreateInfo imageCreateInfo = {};
+		imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageCreateInfo.format = format;
+		imageCreateInfo.extent = { extent.width, extent.height, 1 };
+		imageCreateInfo.mipLevels = 1;
+		imageCreateInfo.arrayLayers = 1;
+		imageCreateInfo.samples = samples;
+		imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageCreateInfo.usage = usage;
+		imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		if (vkCreateImage(device, &imageCreateInfo, nullptr, &images[i]) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create attachment image");
+		}
+
+		VkMemoryRequirements memoryRequirements;
+		vkGetImageMemoryRequirements(device, images[i], &memoryRequirements);
+
+		VkMemoryAllocateInfo memoryAllocateInfo = {};
+		memoryAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		memoryAllocateInfo.allocationSize = memoryRequirements.size;
+		memoryAllocateInfo.memoryTypeIndex = findMemoryType(physicalDevice, memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+		if (vkAllocateMemory(device, &memoryAllocateInfo, nullptr, &memories[i]) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to allocate memory for attachment image");
+		}
+
+		vkBindImageMemory(device, images[i], memories[i], 0);
+
+		VkImageViewCreateInfo imageViewCreateInfo = {};
+		imageViewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		imageViewCreateInfo.image = images[i];
+		imageViewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		imageViewCreateInfo.format = format;
+		imageViewCreateInfo.subresourceRange.aspectMask = aspect;
+		imageViewCreateInfo.subresourceRange.baseMipLevel = 0;
+		imageViewCreateInfo.subresourceRange.levelCount = 1;
+		imageViewCreateInfo.subresourceRange.baseArrayLayer = 0;
+		imageViewCreateInfo.subresourceRange.layerCount = 1;
+
+		if (vkCreateImageView(device, &imageViewCreateInfo, nullptr, &imageViews[i]) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create attachment image view");
+		}
+	}
+}
+
 // Create render pass
-void createRenderPass(const VkDevice& device, const VkSurfaceFormatKHR& surfaceFormat, VkRenderPass* renderPass)
+void createRenderPass(const VkDevice& device, const VkSurfaceFormatKHR& surfaceFormat, VkFormat depthFormat, VkSampleCountFlagBits samples, VkRenderPass* renderPass)
 {
 	glacier::g_Logger->trace("Creating render pass...");
 
+	bool multisampled = samples != VK_SAMPLE_COUNT_1_BIT;
+
 	// Create color attachment (To clear the screen)
 	VkAttachmentDescription colorAttachment = {};
 	colorAttachment.format = surfaceFormat.format;
-	colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+	colorAttachment.samples = samples;
 	colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+
+	// A multisampled target is only needed until it is resolved into the swapchain image
+	colorAttachment.storeOp = multisampled ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE;
 
 	// We won't do anything with the stencil buffer, so we ignore these
 	colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 	colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 
 	colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-
-	// Create attachment reference
+	colorAttachment.finalLayout = multisampled ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+	// Create depth attachment (Only needed while rendering, so it isn't stored)
+	VkAttachmentDescription depthAttachment = {};
+	depthAttachment.format = depthFormat;
+	depthAttachment.samples = samples;
+	depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+	// Create attachment references
 	VkAttachmentReference colorAttachmentReference = {};
 	colorAttachmentReference.attachment = 0;
 	colorAttachmentReference.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
+	VkAttachmentReference depthAttachmentReference = {};
+	depthAttachmentReference.attachment = 1;
+	depthAttachmentReference.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+	// Create resolve attachment (The swapchain image, when rendering multisampled)
+	VkAttachmentDescription resolveAttachment = {};
+	resolveAttachment.format = surfaceFormat.format;
+	resolveAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+	resolveAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	resolveAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	resolveAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	resolveAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	resolveAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	resolveAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+	VkAttachmentReference resolveAttachmentReference = {};
+	resolveAttachmentReference.attachment = 2;
+	resolveAttachmentReference.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
 	// Create subpass
 	VkSubpassDescription subpassDescription = {};
 	subpassDescription.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
 	subpassDescription.colorAttachmentCount = 1;
 	subpassDescription.pColorAttachments = &colorAttachmentReference;
+	subpassDescription.pResolveAttachments = multisampled ? &resolveAttachmentReference : nullptr;
+	subpassDescription.pDepthStencilAttachment = &depthAttachmentReference;
+
+	// Wait for the acquired image and for the previous use of the depth image before writing to them
+	VkSubpassDependency dependency = {};
+	dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+	dependency.dstSubpass = 0;
+	dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	dependency.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+	dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+	VkAttachmentDescription attachments[] = { colorAttachment, depthAttachment, resolveAttachment };
 
 	// Create render pass
 	VkRenderPassCreateInfo renderPassCreateInfo = {};
 	renderPassCreateInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-	renderPassCreateInfo.attachmentCount = 1;
-	renderPassCreateInfo.pAttachments = &colorAttachment;
+	renderPassCreateInfo.attachmentCount = multisampled ? 3 : 2;
+	renderPassCreateInfo.pAttachments = attachments;
 	renderPassCreateInfo.subpassCount = 1;
 	renderPassCreateInfo.pSubpasses = &subpassDescription;
+	renderPassCreateInfo.dependencyCount = 1;
+	renderPassCreateInfo.pDependencies = &dependency;
 
 	if (vkCreateRenderPass(device, &renderPassCreateInfo, nullptr, renderPass) != VK_SUCCESS)
 	{
@@ -218,7 +406,7 @@ void createRenderPass(const VkDevice& device, const VkSurfaceFormatKHR& surfaceF
 	}
 }
 // Create framebuffers
-void createFramebuffers(const VkDevice& device, const std::vector<VkImageView>& imageViews, const VkRenderPass& renderPass, const VkExtent2D& swapchainExtent, std::vector<VkFramebuffer>& framebuffers)
+void createFramebuffers(const VkDevice& device, const std::vector<VkImageView>& imageViews, const std::vector<VkImageView>& depthImageViews, const std::vector<VkImageView>& multisampledImageViews, const VkRenderPass& renderPass, const VkExtent2D& swapchainExtent, std::vector<VkFramebuffer>& framebuffers)
 {
 	glacier::g_Logger->trace("Creating framebuffers...");
 
@@ -229,9 +417,14 @@ void createFramebuffers(const VkDevice& device, const std::vector<VkImageView>&
 	for (size_t i = 0; i < imageViews.size(); i++)
 	{
 		std::vector<VkImageView> attachments = {
-			imageViews[i]
+			imageViews[i],
+			depthImageViews[i]
 		};
 
+		// Rendering multisampled, the swapchain image is the resolve attachment
+		if (!multisampledImageViews.empty())
+			attachments = { multisampledImageViews[i], depthImageViews[i], imageViews[i] };
+
 		VkFramebufferCreateInfo framebufferCreateInfo = {};
 		framebufferCreateInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
 		framebufferCreateInfo.renderPass = renderPass;
@@ -255,7 +448,8 @@ void createCommandPool(const VkDevice& device, const QueueFamilyIndices& queueFa
 	VkCommandPoolCreateInfo commandPoolCreateInfo = {};
 	commandPoolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
 	commandPoolCreateInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
-	commandPoolCreateInfo.flags = 0;
+	// Command buffers are re-recorded every frame
+	commandPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
 
 	if (vkCreateCommandPool(device, &commandPoolCreateInfo, nullptr, commandPool) != VK_SUCCESS)
 	{
@@ -263,10 +457,10 @@ void createCommandPool(const VkDevice& device, const QueueFamilyIndices& queueFa
 	}
 }
 // Create command buffers
-void createCommandBuffers(const VkDevice& device, const std::vector<VkFramebuffer>& framebuffers, const VkCommandPool& commandPool, std::vector<VkCommandBuffer>& commandBuffers)
+void createCommandBuffers(const VkDevice& device, unsigned int count, const VkCommandPool& commandPool, std::vector<VkCommandBuffer>& commandBuffers)
 {
 	commandBuffers.clear();
-	commandBuffers.resize(framebuffers.size());
+	commandBuffers.resize(count);
 
 	VkCommandBufferAllocateInfo commandBufferAllocateInfo = {};
 	commandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -279,105 +473,464 @@ void createCommandBuffers(const VkDevice& device, const std::vector<VkFramebuffe
 		throw std::runtime_error("Failed to allocate command buffers");
 	}
 }
+// Transition an attachment with a synchronization2 barrier
+void transitionImage(const VkCommandBuffer& commandBuffer, const VkImage& image, VkImageAspectFlags aspect, VkImageLayout oldLayout, VkImageLayout newLayout, VkPipelineStageFlags2 srcStage, VkAccessFlags2 srcAccess, VkPipelineStageFlags2 dstStage, VkAccessFlags2 dstAccess)
+{
+	VkImageMemoryBarrier2 barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+	barrier.srcStageMask = srcStage;
+	barrier.srcAccessMask = srcAccess;
+	barrier.dstStageMask = dstStage;
+	barrier.dstAccessMask = dstAccess;
+	barrier.oldLayout = oldLayout;
+	barrier.newLayout = newLayout;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = image;
+	barrier.subresourceRange.aspectMask = aspect;
+	barrier.subresourceRange.baseMipLevel = 0;
+	barrier.subresourceRange.levelCount = 1;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = 1;
+
+	VkDependencyInfo dependencyInfo = {};
+	dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+	dependencyInfo.imageMemoryBarrierCount = 1;
+	dependencyInfo.pImageMemoryBarriers = &barrier;
+
+	vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+}
 // Destroy swapchain
-void destroySwapchain(const VkDevice& device, std::vector<VkFramebuffer>& framebuffers, VkRenderPass* renderPass, std::vector<VkImageView>& imageViews, VkSwapchainKHR* swapchain)
+void destroySwapchain(DeletionQueue& deletionQueue, uint64_t lastUsage, std::vector<VkFramebuffer>& framebuffers, VkRenderPass* renderPass, std::vector<VkImageView>& imageViews, VkSwapchainKHR* swapchain)
 {
 	for (size_t i = 0; i < framebuffers.size(); i++)
 	{
-		vkDestroyFramebuffer(device, framebuffers[i], nullptr);
+		deletionQueue.destroy(VK_OBJECT_TYPE_FRAMEBUFFER, framebuffers[i], lastUsage);
 	}
 
-	vkDestroyRenderPass(device, *renderPass, nullptr);
+	framebuffers.clear();
+
+	deletionQueue.destroy(VK_OBJECT_TYPE_RENDER_PASS, *renderPass, lastUsage);
 	*renderPass = nullptr;
 
 	for (size_t i = 0; i < imageViews.size(); i++)
 	{
-		vkDestroyImageView(device, imageViews[i], nullptr);
+		deletionQueue.destroy(VK_OBJECT_TYPE_IMAGE_VIEW, imageViews[i], lastUsage);
 	}
 
 	imageViews.clear();
 
-	vkDestroySwapchainKHR(device, *swapchain, nullptr);
+	deletionQueue.destroy(VK_OBJECT_TYPE_SWAPCHAIN_KHR, *swapchain, lastUsage);
 	*swapchain = nullptr;
 }
 /* ------------------ */
 
 void glacier::Renderer::bindPipeline(const Pipeline& pipeline, uint32_t count)
 {
-	/* Unbind old pipeline */
-	if (!m_CommandBuffers.empty())
-		unbindPipeline();
+	// Push constants only live for one frame, so the bound pipeline draws without them
+	m_BoundPipeline = DrawCommand{ &pipeline, pipeline.m_VertexBuffer, pipeline.m_IndexBuffer, count, 0, 0, nullptr, 0, 0.0f, m_Layer, 0, 0 };
+}
+
+void glacier::Renderer::unbindPipeline()
+{
+	// Resources destroyed after this wait for their last usage in the deletion queue, so the GPU doesn't need to be idle
+	m_BoundPipeline.reset();
+}
+
+void glacier::Renderer::draw(const Pipeline& pipeline, const VertexBuffer& vertexBuffer, const IndexBuffer* indexBuffer, uint32_t count, float depth)
+{
+	if (pipeline.m_PushConstantSize > 0 && m_PushConstantSize > pipeline.m_PushConstantSize)
+		throw std::runtime_error(fmt::format("Draw pushes {} bytes of constants, but the pipeline's push constant block is {} bytes", m_PushConstantSize, pipeline.m_PushConstantSize));
+
+	m_DrawCommands.push_back(DrawCommand{ &pipeline, &vertexBuffer, indexBuffer, count, 0, 0, nullptr, 0, depth, m_Layer, m_PushConstantOffset, m_PushConstantSize });
+}
+
+void glacier::Renderer::draw(const Pipeline& pipeline, const GeometryPool& pool, uint32_t mesh, float depth)
+{
+	if (pipeline.m_PushConstantSize > 0 && m_PushConstantSize > pipeline.m_PushConstantSize)
+		throw std::runtime_error(fmt::format("Draw pushes {} bytes of constants, but the pipeline's push constant block is {} bytes", m_PushConstantSize, pipeline.m_PushConstantSize));
+
+	// Validates the handle, the range itself is looked up when the frame is recorded
+	pool.getRange(mesh);
+	m_DrawCommands.push_back(DrawCommand{ &pipeline, &pool.getVertexBuffer(), &pool.getIndexBuffer(), 0, 0, 0, &pool, mesh, depth, m_Layer, m_PushConstantOffset, m_PushConstantSize });
+}
+
+void glacier::Renderer::setLayer(uint8_t layer)
+{
+	m_Layer = layer;
+}
+
+void glacier::Renderer::setPushConstants(const void* data, uint32_t size)
+{
+	// Every device supports at least 128 bytes, which is also the range bindless pipelines share
+	if (size > BindlessHeap::PUSH_CONSTANT_SIZE)
+		throw std::runtime_error(fmt::format("Push constants are limited to {} bytes, got {}", BindlessHeap::PUSH_CONSTANT_SIZE, size));
+
+	m_PushConstantOffset = static_cast<uint32_t>(m_PushConstants.size());
+	m_PushConstantSize = size;
+
+	const char* bytes = static_cast<const char*>(data);
+	m_PushConstants.insert(m_PushConstants.end(), bytes, bytes + size);
+}
+
+const glacier::RenderStatistics& glacier::Renderer::getStatistics() const
+{
+	return m_Statistics;
+}
+
+void glacier::Renderer::recordCommandBuffer(uint32_t frameIndex, uint32_t imageIndex)
+{
+	VkCommandBuffer commandBuffer = static_cast<VkCommandBuffer>(m_CommandBuffers[frameIndex]);
 
-	/* Create command buffers */
 	glm::uvec2 size = m_Application->m_Window->getFramebufferSize();
 	VkExtent2D extent = { size.x, size.y };
 
-	createCommandBuffers(static_cast<VkDevice>(m_Application->m_Device), reinterpret_cast<const std::vector<VkFramebuffer>&>(m_Framebuffers), static_cast<VkCommandPool>(m_CommandPool), reinterpret_cast<std::vector<VkCommandBuffer>&>(m_CommandBuffers));
+	VkCommandBufferBeginInfo commandBufferBeginInfo = {};
+	commandBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	commandBufferBeginInfo.pInheritanceInfo = nullptr;
 
-	for (size_t i = 0; i < m_CommandBuffers.size(); i++)
+	// The command pool allows individual resets, so beginning the buffer discards last frame's commands
+	if (vkBeginCommandBuffer(commandBuffer, &commandBufferBeginInfo) != VK_SUCCESS)
 	{
-		VkCommandBufferBeginInfo commandBufferBeginInfo = {};
-		commandBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-		commandBufferBeginInfo.flags = 0;
-		commandBufferBeginInfo.pInheritanceInfo = nullptr;
+		throw std::runtime_error("Failed to begin command buffer");
+	}
+
+	VkClearValue clearValues[2] = {};
+	clearValues[0].color = { { 0.0f, 0.0f, 0.0f, 1.0f } };
+	clearValues[1].depthStencil = { 1.0f, 0 };
 
-		if (vkBeginCommandBuffer(static_cast<VkCommandBuffer>(m_CommandBuffers[i]), &commandBufferBeginInfo) != VK_SUCCESS)
+	if (m_Application->m_DynamicRendering)
+	{
+		// The previous contents are cleared, so the old layouts can be discarded
+		transitionImage(commandBuffer, static_cast<VkImage>(m_Images[imageIndex]), VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+			VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_NONE, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT);
+
+		transitionImage(commandBuffer, static_cast<VkImage>(m_DepthImages[imageIndex]), VK_IMAGE_ASPECT_DEPTH_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+			VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT);
+
+		VkRenderingAttachmentInfo colorAttachment = {};
+		colorAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+		colorAttachment.imageView = static_cast<VkImageView>(m_ImageViews[imageIndex]);
+		colorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		colorAttachment.clearValue = clearValues[0];
+
+		// Render into the multisampled image and average it into the swapchain image
+		if (!m_MultisampledImages.empty())
 		{
-			throw std::runtime_error("Failed to begin command buffer");
+			transitionImage(commandBuffer, static_cast<VkImage>(m_MultisampledImages[imageIndex]), VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+				VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_NONE, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT);
+
+			colorAttachment.imageView = static_cast<VkImageView>(m_MultisampledImageViews[imageIndex]);
+			colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			colorAttachment.resolveMode = VK_RESOLVE_MODE_AVERAGE_BIT;
+			colorAttachment.resolveImageView = static_cast<VkImageView>(m_ImageViews[imageIndex]);
+			colorAttachment.resolveImageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 		}
 
+		VkRenderingAttachmentInfo depthAttachment = {};
+		depthAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+		depthAttachment.imageView = static_cast<VkImageView>(m_DepthImageViews[imageIndex]);
+		depthAttachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+		depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		depthAttachment.clearValue = clearValues[1];
+
+		VkRenderingInfo renderingInfo = {};
+		renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+		renderingInfo.renderArea.offset = { 0, 0 };
+		renderingInfo.renderArea.extent = extent;
+		renderingInfo.layerCount = 1;
+		renderingInfo.colorAttachmentCount = 1;
+		renderingInfo.pColorAttachments = &colorAttachment;
+		renderingInfo.pDepthAttachment = &depthAttachment;
+
+		vkCmdBeginRendering(commandBuffer, &renderingInfo);
+	}
+	else
+	{
 		// Begin render pass
 		VkRenderPassBeginInfo renderPassBeginInfo = {};
 		renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
 		renderPassBeginInfo.renderPass = static_cast<VkRenderPass>(m_RenderPass);
-		renderPassBeginInfo.framebuffer = static_cast<VkFramebuffer>(m_Framebuffers[i]);
+		renderPassBeginInfo.framebuffer = static_cast<VkFramebuffer>(m_Framebuffers[imageIndex]);
 
 		renderPassBeginInfo.renderArea.offset = { 0, 0 };
 		renderPassBeginInfo.renderArea.extent = extent;
 
-		VkClearValue clearColor = { 0.0f, 0.0f, 0.0f, 1.0f };
-		renderPassBeginInfo.clearValueCount = 1;
-		renderPassBeginInfo.pClearValues = &clearColor;
+		renderPassBeginInfo.clearValueCount = 2;
+		renderPassBeginInfo.pClearValues = clearValues;
+
+		vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+	}
 
-		vkCmdBeginRenderPass(static_cast<VkCommandBuffer>(m_CommandBuffers[i]), &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+	// Viewport and scissor are dynamic, so pipelines don't depend on the swapchain extent
+	VkViewport viewport = {};
+	viewport.x = 0.0f;
+	viewport.y = 0.0f;
+	viewport.width = static_cast<float>(extent.width);
+	viewport.height = static_cast<float>(extent.height);
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
 
-		vkCmdBindPipeline(static_cast<VkCommandBuffer>(m_CommandBuffers[i]), VK_PIPELINE_BIND_POINT_GRAPHICS, static_cast<VkPipeline>(pipeline.m_Pipeline));
+	VkRect2D scissor = {};
+	scissor.offset = { 0, 0 };
+	scissor.extent = extent;
 
-		// $ BEGIN $
-		VkBuffer vertexBuffers[] = { static_cast<VkBuffer>(pipeline.m_VertexBuffer->m_Handle) };
-		VkDeviceSize offsets[] = { 0 };
-		vkCmdBindVertexBuffers(static_cast<VkCommandBuffer>(m_CommandBuffers[i]), 0, 1, vertexBuffers, offsets);
-		if (pipeline.m_IndexBuffer)
-			vkCmdBindIndexBuffer(static_cast<VkCommandBuffer>(m_CommandBuffers[i]), static_cast<VkBuffer>(pipeline.m_IndexBuffer->m_Handle), 0, VK_INDEX_TYPE_UINT32);
-		// $ END $
+	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 
-		if (pipeline.m_IndexBuffer)
-			vkCmdDrawIndexed(static_cast<VkCommandBuffer>(m_CommandBuffers[i]), count, 1, 0, 0, 0);
+	m_Statistics = RenderStatistics();
+
+	// Bound once for the whole frame, every bindless pipeline layout is compatible with the heap's for set 0
+	BindlessHeap* heap = m_Application->m_BindlessHeap;
+	if (heap != nullptr)
+	{
+		VkDescriptorSet set = heap->getSet();
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, heap->getPipelineLayout(), BindlessHeap::SET, 1, &set, 0, nullptr);
+		m_Statistics.descriptorSetBinds++;
+	}
+
+	// The value the upcoming submission of this command buffer will signal
+	uint64_t frameValue = m_Application->m_TimelineValue + 1;
+
+	if (m_BoundPipeline.has_value())
+		m_DrawCommands.push_back(m_BoundPipeline.value());
+
+	/* Replace pipelines that are still compiling with their fallback, or drop their draws */
+	for (DrawCommand& command : m_DrawCommands)
+	{
+		if (command.pipeline->isReady())
+			continue;
+
+		// It is needed right now, so let it skip ahead of pipelines compiled in advance
+		command.pipeline->prioritize();
+
+		const Pipeline* fallback = command.pipeline->m_Fallback;
+		if (fallback != nullptr && fallback->isReady())
+		{
+			command.pipeline = fallback;
+			m_Statistics.fallbackDraws++;
+		}
 		else
-			vkCmdDraw(static_cast<VkCommandBuffer>(m_CommandBuffers[i]), count, 1, 0, 0);
+		{
+			command.pipeline = nullptr;
+			m_Statistics.skippedDraws++;
+		}
+	}
 
-		vkCmdEndRenderPass(static_cast<VkCommandBuffer>(m_CommandBuffers[i]));
+	/* Look up where meshes of geometry pools lie now, allocating since the draw may have compacted or grown the pool */
+	for (DrawCommand& command : m_DrawCommands)
+	{
+		if (command.pool == nullptr || command.pipeline == nullptr)
+			continue;
 
-		if (vkEndCommandBuffer(static_cast<VkCommandBuffer>(m_CommandBuffers[i])) != VK_SUCCESS)
+		// A mesh freed since the draw is dropped, its space may already hold another mesh
+		const GeometryPool::Entry& entry = command.pool->m_Entries[command.mesh];
+		if (!entry.allocated)
 		{
-			throw std::runtime_error("Failed to end command buffer");
+			command.pipeline = nullptr;
+			continue;
 		}
+
+		command.count = entry.range.indexCount;
+		command.firstIndex = entry.range.firstIndex;
+		command.vertexOffset = entry.range.vertexOffset;
 	}
-}
 
-void glacier::Renderer::unbindPipeline()
-{
-	vkDeviceWaitIdle(static_cast<VkDevice>(m_Application->m_Device));
+	m_DrawCommands.erase(std::remove_if(m_DrawCommands.begin(), m_DrawCommands.end(), [](const DrawCommand& command) { return command.pipeline == nullptr; }), m_DrawCommands.end());
 
-	vkFreeCommandBuffers(static_cast<VkDevice>(m_Application->m_Device), static_cast<VkCommandPool>(m_CommandPool), static_cast<uint32_t>(m_CommandBuffers.size()), reinterpret_cast<VkCommandBuffer*>(m_CommandBuffers.data()));
-	m_CommandBuffers.clear();
+	/* Sort draws by key, grouping them by layer, translucency and state */
+	m_RenderQueue->clear();
+	for (size_t i = 0; i < m_DrawCommands.size(); i++)
+	{
+		const DrawCommand& command = m_DrawCommands[i];
+		uint16_t pipeline = m_RenderQueue->pipelineIndex(command.pipeline->m_Id);
+		uint16_t material = m_RenderQueue->materialIndex(command.vertexBuffer->m_Id);
+
+		uint64_t key = RenderQueue::makeKey(command.layer, !command.pipeline->isOpaque(), pipeline, material, command.depth);
+
+		m_RenderQueue->push(key, static_cast<uint32_t>(i));
+	}
+
+	const std::vector<uint32_t>& order = m_RenderQueue->sort();
+
+	// Count the binds the main pass would have needed in submission order, to report what sorting saved
+	uint32_t unsortedBinds = 0;
+	{
+		const void* pipeline = nullptr;
+		const VertexBuffer* vertexBuffer = nullptr;
+		const IndexBuffer* indexBuffer = nullptr;
+
+		for (const DrawCommand& command : m_DrawCommands)
+		{
+			unsortedBinds += command.pipeline->m_Pipeline != pipeline;
+			unsortedBinds += command.vertexBuffer != vertexBuffer;
+			unsortedBinds += command.indexBuffer != nullptr && command.indexBuffer != indexBuffer;
+
+			pipeline = command.pipeline->m_Pipeline;
+			vertexBuffer = command.vertexBuffer;
+			indexBuffer = command.indexBuffer != nullptr ? command.indexBuffer : indexBuffer;
+		}
+	}
+
+	const IndexBuffer* currentIndexBuffer = nullptr;
+
+	// Binding a pipeline with a different layout may disturb the pushed values, so they are pushed again after a layout change
+	const void* currentPushLayout = nullptr;
+	uint32_t currentPushOffset = UINT32_MAX;
+
+	auto pushConstants = [&](const DrawCommand& command) -> void
+	{
+		const Pipeline* pipeline = command.pipeline;
+		if (command.pushConstantSize == 0 || pipeline->m_PushConstantSize == 0)
+			return;
+
+		if (pipeline->m_PipelineLayout == currentPushLayout && command.pushConstantOffset == currentPushOffset)
+			return;
+
+		// A fallback or reloaded pipeline may have a smaller block than the one the draw was validated against
+		uint32_t size = std::min(command.pushConstantSize, pipeline->m_PushConstantSize);
+		vkCmdPushConstants(commandBuffer, static_cast<VkPipelineLayout>(pipeline->m_PipelineLayout), static_cast<VkShaderStageFlags>(pipeline->m_PushConstantStages), 0, size, &m_PushConstants[command.pushConstantOffset]);
+
+		currentPushLayout = pipeline->m_PipelineLayout;
+		currentPushOffset = command.pushConstantOffset;
+		m_Statistics.pushConstantUpdates++;
+	};
+
+	/* Depth prepass: lay down depth for opaque geometry reading positions only, so the main pass shades every pixel once */
+	if (m_Application->m_Info.depthPrepass)
+	{
+		const void* currentDepthPipeline = nullptr;
+		const VertexBuffer* currentPositionBuffer = nullptr;
+
+		for (uint32_t index : order)
+		{
+			const DrawCommand& command = m_DrawCommands[index];
+
+			if (command.pipeline->m_DepthPipeline == nullptr || command.vertexBuffer->m_PositionHandle == nullptr)
+				continue;
+
+			if (command.pipeline->m_DepthPipeline != currentDepthPipeline)
+			{
+				vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, static_cast<VkPipeline>(command.pipeline->m_DepthPipeline));
+				currentDepthPipeline = command.pipeline->m_DepthPipeline;
+				m_Statistics.pipelineBinds++;
+			}
+
+			if (command.vertexBuffer != currentPositionBuffer)
+			{
+				// Positions come from their own tightly packed stream, the remaining attributes aren't consumed without a fragment shader
+				VkBuffer vertexBuffers[] = { static_cast<VkBuffer>(command.vertexBuffer->m_PositionHandle), static_cast<VkBuffer>(command.vertexBuffer->m_Handle) };
+				VkDeviceSize offsets[] = { 0, 0 };
+				vkCmdBindVertexBuffers(commandBuffer, 0, 2, vertexBuffers, offsets);
+				currentPositionBuffer = command.vertexBuffer;
+				m_Statistics.vertexBufferBinds++;
+			}
+
+			if (command.indexBuffer && command.indexBuffer != currentIndexBuffer)
+			{
+				vkCmdBindIndexBuffer(commandBuffer, static_cast<VkBuffer>(command.indexBuffer->m_Handle), 0, VK_INDEX_TYPE_UINT32);
+				currentIndexBuffer = command.indexBuffer;
+				m_Statistics.indexBufferBinds++;
+			}
+
+			pushConstants(command);
+
+			if (command.indexBuffer)
+				vkCmdDrawIndexed(commandBuffer, command.count, 1, command.firstIndex, command.vertexOffset, 0);
+			else
+				vkCmdDraw(commandBuffer, command.count, 1, 0, 0);
+
+			m_Statistics.prepassDrawCalls++;
+		}
+	}
+
+	/* Main pass */
+	// Pipelines with identical state, and fallbacks, share their VkPipeline, so compare handles rather than Pipeline objects
+	const void* currentPipeline = nullptr;
+	const VertexBuffer* currentVertexBuffer = nullptr;
+
+	uint32_t prepassBinds = m_Statistics.pipelineBinds + m_Statistics.vertexBufferBinds + m_Statistics.indexBufferBinds;
+
+	for (uint32_t index : order)
+	{
+		const DrawCommand& command = m_DrawCommands[index];
+
+		// Skip binds of state that is already bound
+		if (command.pipeline->m_Pipeline != currentPipeline)
+		{
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, static_cast<VkPipeline>(command.pipeline->m_Pipeline));
+			currentPipeline = command.pipeline->m_Pipeline;
+			m_Statistics.pipelineBinds++;
+		}
+
+		if (command.vertexBuffer != currentVertexBuffer)
+		{
+			VkBuffer vertexBuffers[] = { static_cast<VkBuffer>(command.vertexBuffer->m_Handle) };
+			VkDeviceSize offsets[] = { 0 };
+			vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+			currentVertexBuffer = command.vertexBuffer;
+			m_Statistics.vertexBufferBinds++;
+		}
+
+		if (command.indexBuffer && command.indexBuffer != currentIndexBuffer)
+		{
+			vkCmdBindIndexBuffer(commandBuffer, static_cast<VkBuffer>(command.indexBuffer->m_Handle), 0, VK_INDEX_TYPE_UINT32);
+			currentIndexBuffer = command.indexBuffer;
+			m_Statistics.indexBufferBinds++;
+		}
+
+		pushConstants(command);
+
+		command.pipeline->m_LastUsage = frameValue;
+		command.vertexBuffer->m_LastUsage = frameValue;
+
+		if (command.indexBuffer)
+			command.indexBuffer->m_LastUsage = frameValue;
+
+		if (command.indexBuffer)
+			vkCmdDrawIndexed(commandBuffer, command.count, 1, command.firstIndex, command.vertexOffset, 0);
+		else
+			vkCmdDraw(commandBuffer, command.count, 1, 0, 0);
+
+		m_Statistics.drawCalls++;
+		m_Statistics.vertices += command.count;
+	}
+
+	uint32_t sortedBinds = m_Statistics.pipelineBinds + m_Statistics.vertexBufferBinds + m_Statistics.indexBufferBinds - prepassBinds;
+	m_Statistics.bindsSavedBySorting = unsortedBinds > sortedBinds ? unsortedBinds - sortedBinds : 0;
+
+	m_RenderQueue->clear();
+	m_DrawCommands.clear();
+
+	m_PushConstants.clear();
+	m_PushConstantOffset = 0;
+	m_PushConstantSize = 0;
+
+	if (m_Application->m_DynamicRendering)
+	{
+		vkCmdEndRendering(commandBuffer);
+
+		transitionImage(commandBuffer, static_cast<VkImage>(m_Images[imageIndex]), VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+			VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT, VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE);
+	}
+	else
+	{
+		vkCmdEndRenderPass(commandBuffer);
+	}
+
+	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to end command buffer");
+	}
 }
 
-glacier::Renderer::Renderer(Application* application)
-	: m_Application(application), m_Swapchain(nullptr)
+glacier::Renderer::Renderer(Application* application, const Renderer* previous)
+	: m_Application(application), m_Swapchain(nullptr), m_RenderPass(nullptr), m_Layer(0), m_PushConstantOffset(0), m_PushConstantSize(0), m_RenderQueue(new RenderQueue())
 {
-	vkDeviceWaitIdle(static_cast<VkDevice>(m_Application->m_Device));
-
 	glacier::g_Logger->trace("Creating swapchain...");
 
 	/* Get queue family indices */
@@ -387,25 +940,53 @@ glacier::Renderer::Renderer(Application* application)
 	SwapchainSupportDetails details = querySwapchainSupport(static_cast<VkPhysicalDevice>(m_Application->m_PhysicalDevice), static_cast<VkSurfaceKHR>(m_Application->m_Surface));
 
 	VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(details.formats);
-	VkPresentModeKHR presentMode = choosePresentMode(details.presentModes, m_Application->m_Info.vsync);
+	VkPresentModeKHR presentMode = choosePresentMode(details.presentModes, m_Application->m_Info);
+	glacier::g_Logger->debug("Present mode: {}", presentModeName(presentMode));
 	VkExtent2D extent = chooseSwapExtent(details.capabilities, *m_Application->m_Window);
 
-	createSwapchain(static_cast<VkPhysicalDevice>(m_Application->m_PhysicalDevice), static_cast<VkDevice>(m_Application->m_Device), static_cast<VkSurfaceKHR>(m_Application->m_Surface), m_Application->m_Info, *m_Application->m_Window, details, surfaceFormat, presentMode, extent, reinterpret_cast<VkSwapchainKHR*>(&m_Swapchain), reinterpret_cast<VkSwapchainKHR*>(&m_Swapchain));
+	createSwapchain(static_cast<VkPhysicalDevice>(m_Application->m_PhysicalDevice), static_cast<VkDevice>(m_Application->m_Device), static_cast<VkSurfaceKHR>(m_Application->m_Surface), m_Application->m_Info, *m_Application->m_Window, details, surfaceFormat, presentMode, extent, previous != nullptr ? reinterpret_cast<const VkSwapchainKHR*>(&previous->m_Swapchain) : nullptr, reinterpret_cast<VkSwapchainKHR*>(&m_Swapchain));
 
 	/* Create image views */
 	std::vector<VkImage>* swapchainImages = reinterpret_cast<std::vector<VkImage>*>(&m_Images);
 	std::vector<VkImageView>* imageViews = reinterpret_cast<std::vector<VkImageView>*>(&m_ImageViews);
 	createImageViews(static_cast<VkDevice>(m_Application->m_Device), surfaceFormat, extent, static_cast<VkSwapchainKHR>(m_Swapchain), *swapchainImages, *imageViews);
 
-	/* Create render pass */
-	createRenderPass(static_cast<VkDevice>(m_Application->m_Device), surfaceFormat, reinterpret_cast<VkRenderPass*>(&m_RenderPass));
+	m_ColorFormat = static_cast<uint32_t>(surfaceFormat.format);
 
-	/* Create framebuffers */
-	std::vector<VkFramebuffer>* framebuffers = reinterpret_cast<std::vector<VkFramebuffer>*>(&m_Framebuffers);
-	createFramebuffers(static_cast<VkDevice>(m_Application->m_Device), *imageViews, static_cast<VkRenderPass>(m_RenderPass), extent, *framebuffers);
+	/* Create depth images */
+	VkFormat depthFormat = chooseDepthFormat(static_cast<VkPhysicalDevice>(m_Application->m_PhysicalDevice));
+	m_DepthFormat = static_cast<uint32_t>(depthFormat);
+
+	m_Samples = m_Application->m_Samples;
+	VkSampleCountFlagBits samples = static_cast<VkSampleCountFlagBits>(m_Samples);
+
+	std::vector<VkImageView>* depthImageViews = reinterpret_cast<std::vector<VkImageView>*>(&m_DepthImageViews);
+	createAttachmentImages(static_cast<VkDevice>(m_Application->m_Device), static_cast<VkPhysicalDevice>(m_Application->m_PhysicalDevice), depthFormat, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_IMAGE_ASPECT_DEPTH_BIT, samples, extent, m_Images.size(), reinterpret_cast<std::vector<VkImage>&>(m_DepthImages), reinterpret_cast<std::vector<VkDeviceMemory>&>(m_DepthMemory), *depthImageViews);
+
+	/* Create multisampled color images */
+	std::vector<VkImageView>* multisampledImageViews = reinterpret_cast<std::vector<VkImageView>*>(&m_MultisampledImageViews);
+	if (samples != VK_SAMPLE_COUNT_1_BIT)
+	{
+		// Resolved at the end of the pass and never read again, so the contents can stay in tile memory
+		createAttachmentImages(static_cast<VkDevice>(m_Application->m_Device), static_cast<VkPhysicalDevice>(m_Application->m_PhysicalDevice), surfaceFormat.format, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT, VK_IMAGE_ASPECT_COLOR_BIT, samples, extent, m_Images.size(), reinterpret_cast<std::vector<VkImage>&>(m_MultisampledImages), reinterpret_cast<std::vector<VkDeviceMemory>&>(m_MultisampledMemory), *multisampledImageViews);
+	}
+
+	// Dynamic rendering draws straight into the image views, so there is no render pass or framebuffer to rebuild
+	if (!m_Application->m_DynamicRendering)
+	{
+		/* Create render pass */
+		createRenderPass(static_cast<VkDevice>(m_Application->m_Device), surfaceFormat, depthFormat, samples, reinterpret_cast<VkRenderPass*>(&m_RenderPass));
+
+		/* Create framebuffers */
+		std::vector<VkFramebuffer>* framebuffers = reinterpret_cast<std::vector<VkFramebuffer>*>(&m_Framebuffers);
+		createFramebuffers(static_cast<VkDevice>(m_Application->m_Device), *imageViews, *depthImageViews, *multisampledImageViews, static_cast<VkRenderPass>(m_RenderPass), extent, *framebuffers);
+	}
 
 	createCommandPool(static_cast<VkDevice>(m_Application->m_Device), queueFamilyIndices, reinterpret_cast<VkCommandPool*>(&m_CommandPool));
 
+	/* Create one command buffer per frame in flight */
+	createCommandBuffers(static_cast<VkDevice>(m_Application->m_Device), m_Application->m_Info.framesInFlight, static_cast<VkCommandPool>(m_CommandPool), reinterpret_cast<std::vector<VkCommandBuffer>&>(m_CommandBuffers));
+
 	/* Get queues */
 	vkGetDeviceQueue(static_cast<VkDevice>(m_Application->m_Device), queueFamilyIndices.graphicsFamily.value(), 0, reinterpret_cast<VkQueue*>(&m_GraphicsQueue));
 	vkGetDeviceQueue(static_cast<VkDevice>(m_Application->m_Device), queueFamilyIndices.presentationFamily.value(), 0, reinterpret_cast<VkQueue*>(&m_PresentationQueue));
@@ -413,15 +994,41 @@ glacier::Renderer::Renderer(Application* application)
 
 glacier::Renderer::~Renderer()
 {
-	vkDeviceWaitIdle(static_cast<VkDevice>(m_Application->m_Device));
+	DeletionQueue* deletionQueue = m_Application->m_DeletionQueue;
+
+	// Everything below was last used by the most recently submitted frame
+	uint64_t lastUsage = m_Application->m_TimelineValue;
 
 	std::vector<VkFramebuffer>* framebuffers = reinterpret_cast<std::vector<VkFramebuffer>*>(&m_Framebuffers);
-	std::vector<VkCommandBuffer>* commandBuffers = reinterpret_cast<std::vector<VkCommandBuffer>*>(&m_CommandBuffers);
 	std::vector<VkImageView>* imageViews = reinterpret_cast<std::vector<VkImageView>*>(&m_ImageViews);
 
-	unbindPipeline();
+	destroySwapchain(*deletionQueue, lastUsage, *framebuffers, reinterpret_cast<VkRenderPass*>(&m_RenderPass), *imageViews, reinterpret_cast<VkSwapchainKHR*>(&m_Swapchain));
+
+	for (size_t i = 0; i < m_DepthImages.size(); i++)
+	{
+		deletionQueue->destroy(VK_OBJECT_TYPE_IMAGE_VIEW, m_DepthImageViews[i], lastUsage);
+		deletionQueue->destroy(VK_OBJECT_TYPE_IMAGE, m_DepthImages[i], lastUsage);
+		deletionQueue->destroy(VK_OBJECT_TYPE_DEVICE_MEMORY, m_DepthMemory[i], lastUsage);
+	}
+
+	m_DepthImageViews.clear();
+	m_DepthImages.clear();
+	m_DepthMemory.clear();
+
+	for (size_t i = 0; i < m_MultisampledImages.size(); i++)
+	{
+		deletionQueue->destroy(VK_OBJECT_TYPE_IMAGE_VIEW, m_MultisampledImageViews[i], lastUsage);
+		deletionQueue->destroy(VK_OBJECT_TYPE_IMAGE, m_MultisampledImages[i], lastUsage);
+		deletionQueue->destroy(VK_OBJECT_TYPE_DEVICE_MEMORY, m_MultisampledMemory[i], lastUsage);
+	}
+
+	m_MultisampledImageViews.clear();
+	m_MultisampledImages.clear();
+	m_MultisampledMemory.clear();
 
-	destroySwapchain(static_cast<VkDevice>(m_Application->m_Device), *framebuffers, reinterpret_cast<VkRenderPass*>(&m_RenderPass), *imageViews, reinterpret_cast<VkSwapchainKHR*>(&m_Swapchain));
+	delete m_RenderQueue;
 
-	vkDestroyCommandPool(static_cast<VkDevice>(m_Application->m_Device), static_cast<VkCommandPool>(m_CommandPool), nullptr);
+	// Destroying the pool frees its command buffers
+	deletionQueue->destroy(VK_OBJECT_TYPE_COMMAND_POOL, m_CommandPool, lastUsage);
+	m_CommandBuffers.clear();
 }
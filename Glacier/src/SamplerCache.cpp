@@ -0,0 +1,61 @@
+#include "internal/SamplerCache.hpp"
+#include "internal/PipelineRegistry.hpp"
+
+#include <stdexcept>
+
+SamplerCache::SamplerCache(VkDevice device)
+	: m_Device(device)
+{
+}
+
+SamplerCache::~SamplerCache()
+{
+	for (const std::pair<const std::string, VkSampler>& pair : m_Samplers)
+		vkDestroySampler(m_Device, pair.second, nullptr);
+}
+
+VkSampler SamplerCache::acquire(const VkSamplerCreateInfo& createInfo)
+{
+	if (createInfo.pNext != nullptr)
+		throw std::runtime_error("Cached samplers can't have extension structures");
+
+	// Serialized field by field, so neither the pointers nor the padding of the create info end up in the key
+	PipelineKey key;
+	key.append(createInfo.flags);
+	key.append(createInfo.magFilter);
+	key.append(createInfo.minFilter);
+	key.append(createInfo.mipmapMode);
+	key.append(createInfo.addressModeU);
+	key.append(createInfo.addressModeV);
+	key.append(createInfo.addressModeW);
+	key.append(createInfo.mipLodBias);
+	key.append(createInfo.anisotropyEnable);
+	key.append(createInfo.maxAnisotropy);
+	key.append(createInfo.compareEnable);
+	key.append(createInfo.compareOp);
+	key.append(createInfo.minLod);
+	key.append(createInfo.maxLod);
+	key.append(createInfo.borderColor);
+	key.append(createInfo.unnormalizedCoordinates);
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	std::unordered_map<std::string, VkSampler>::iterator it = m_Samplers.find(key.data());
+	if (it != m_Samplers.end())
+		return it->second;
+
+	VkSampler sampler;
+	if (vkCreateSampler(m_Device, &createInfo, nullptr, &sampler) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create sampler");
+	}
+
+	m_Samplers.emplace(key.data(), sampler);
+	return sampler;
+}
+
+size_t SamplerCache::size() const
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	return m_Samplers.size();
+}
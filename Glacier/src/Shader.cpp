@@ -1,6 +1,10 @@
 #include "Shader.hpp"
 #include "Application.hpp"
 #include "File.hpp"
+#include "internal/utility.hpp"
+#include "internal/AssetWatcher.hpp"
+#include "internal/ShaderCompiler.hpp"
+#include "internal/SpirvReflection.hpp"
 
 #include <fstream>
 
@@ -8,39 +12,106 @@
 #include <vulkan/vulkan.h>
 
 glacier::Shader::Shader(const Application* application, std::string_view path)
-	: m_Application(application)
+	: m_Application(application), m_Hash(0), m_SourceType(ShaderType::Vertex)
 {
 	/* Read shader from file */
-	Buffer buffer = File(path).read();
+	load(File(path).read(), path);
+}
 
-	/* Create shader module */
-	VkShaderModuleCreateInfo shaderCreateInfo = { };
-	shaderCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-	shaderCreateInfo.codeSize = buffer.size();
-	shaderCreateInfo.pCode = reinterpret_cast<const uint32_t*>(buffer.data());
+glacier::Shader::Shader(const Application* application, const Buffer& buffer)
+	: m_Application(application), m_Hash(0), m_SourceType(ShaderType::Vertex)
+{
+	load(buffer, "from memory");
+}
 
-	if (vkCreateShaderModule(static_cast<VkDevice>(m_Application->m_Device), &shaderCreateInfo, nullptr, reinterpret_cast<VkShaderModule*>(&m_ShaderModule)) != VK_SUCCESS)
-	{
-		throw std::runtime_error(fmt::format("Failed to create shader {}", path));
-	}
+glacier::Shader::Shader(const Application* application, std::string_view path, ShaderType type, const std::vector<ShaderDefine>& defines)
+	: m_Application(application), m_Hash(0), m_SourcePath(File(path).getPath()), m_SourceType(type), m_Defines(defines)
+{
+	/* Compile, or find the SPIR-V in the cache */
+	ShaderCompiler::Result result = m_Application->m_ShaderCompiler->compile(m_SourcePath, type, defines);
+
+	if (result.cached)
+		g_Logger->trace("Loaded shader {} from the cache", m_SourcePath);
+	else
+		g_Logger->debug("Compiled shader {}", m_SourcePath);
+
+	load(result.code, m_SourcePath);
+
+	if (m_Application->m_Info.shaderHotReload)
+		m_Application->m_AssetWatcher->watchShader(this, result.dependencies);
 }
 
-glacier::Shader::Shader(const Application* application, const Buffer& buffer)
-	: m_Application(application)
+glacier::Shader::~Shader()
+{
+	if (!m_SourcePath.empty() && m_Application->m_AssetWatcher != nullptr)
+		m_Application->m_AssetWatcher->unwatch(this);
+
+	// Shader modules are only read during pipeline creation and never by the GPU, so they don't need to wait for the timeline
+	m_ShaderModule.reset();
+}
+
+void glacier::Shader::load(const Buffer& buffer, std::string_view name)
 {
+	ShaderReflection reflection = reflectSpirv(buffer.data(), buffer.size());
+
 	/* Create shader module */
 	VkShaderModuleCreateInfo shaderCreateInfo = { };
 	shaderCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
 	shaderCreateInfo.codeSize = buffer.size();
 	shaderCreateInfo.pCode = reinterpret_cast<const uint32_t*>(buffer.data());
 
-	if (vkCreateShaderModule(static_cast<VkDevice>(m_Application->m_Device), &shaderCreateInfo, nullptr, reinterpret_cast<VkShaderModule*>(&m_ShaderModule)) != VK_SUCCESS)
+	VkDevice device = static_cast<VkDevice>(m_Application->m_Device);
+
+	VkShaderModule module;
+	if (vkCreateShaderModule(device, &shaderCreateInfo, nullptr, &module) != VK_SUCCESS)
 	{
-		throw std::runtime_error("Failed to create shader");
+		throw std::runtime_error(fmt::format("Failed to create shader {}", name));
 	}
+
+	m_ShaderModule = std::shared_ptr<void>(module, [device](void* module) -> void
+		{
+			vkDestroyShaderModule(device, static_cast<VkShaderModule>(module), nullptr);
+		});
+
+	m_Hash = hashBytes(buffer.data(), buffer.size());
+	m_Reflection = std::move(reflection);
 }
 
-glacier::Shader::~Shader()
+const glacier::ShaderReflection& glacier::Shader::getReflection() const
+{
+	return m_Reflection;
+}
+
+glacier::VertexBufferLayout glacier::Shader::createVertexLayout() const
 {
-	vkDestroyShaderModule(static_cast<VkDevice>(m_Application->m_Device), static_cast<VkShaderModule>(m_ShaderModule), nullptr);
+	if (m_Reflection.stage != ShaderType::Vertex)
+		throw std::runtime_error("Only vertex shaders have a vertex layout");
+
+	VertexBufferLayout layout;
+
+	for (size_t i = 0; i < m_Reflection.inputs.size(); i++)
+	{
+		const ShaderInput& input = m_Reflection.inputs[i];
+
+		// Attribute locations are assigned in push order
+		if (input.location != i)
+			throw std::runtime_error(fmt::format("Vertex input locations must be contiguous from 0, found {} at position {}", input.location, i));
+
+		switch (input.type)
+		{
+		case ShaderScalarType::Float:
+			layout.push(VertexBufferElement::Float, input.components);
+			break;
+		case ShaderScalarType::Int:
+			layout.push(VertexBufferElement::Int, input.components);
+			break;
+		case ShaderScalarType::UnsignedInt:
+			layout.push(VertexBufferElement::UnsignedInt, input.components);
+			break;
+		default:
+			throw std::runtime_error(fmt::format("Vertex input {} has no matching vertex buffer element", input.name));
+		}
+	}
+
+	return layout;
 }
@@ -0,0 +1,300 @@
+#include "internal/ShaderCompiler.hpp"
+#include "internal/utility.hpp"
+#include "common.hpp"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <thread>
+#include <unordered_set>
+
+#include <spdlog/spdlog.h>
+
+#ifdef GLACIER_SHADER_COMPILER
+#include <shaderc/shaderc.hpp>
+#endif
+
+namespace
+{
+	/* Changes whenever the compile options below change, so older cache entries are ignored */
+	constexpr const char* CACHE_VERSION = "glacier-spirv-1";
+
+	std::string readText(const std::filesystem::path& path)
+	{
+		std::ifstream stream(path, std::ios::ate | std::ios::binary);
+		if (!stream)
+			throw std::runtime_error(fmt::format("Failed to read shader source {}", path.string()));
+
+		std::string text(static_cast<size_t>(stream.tellg()), '\0');
+		stream.seekg(0);
+		stream.read(text.data(), text.size());
+
+		return text;
+	}
+
+	/**
+	 * @brief Find the file an #include directive refers to
+	 * @param requester The file containing the directive
+	 * @param name The included name
+	 * @param relative Whether the name was quoted, which searches next to the requester before the root directory
+	 * @param root Directory of the top-level source
+	 * @return The path of the included file, empty if it doesn't exist
+	*/
+	std::filesystem::path resolveInclude(const std::filesystem::path& requester, const std::string& name, bool relative, const std::filesystem::path& root)
+	{
+		std::error_code error;
+
+		if (relative)
+		{
+			std::filesystem::path path = requester.parent_path() / name;
+			if (std::filesystem::is_regular_file(path, error))
+				return path.lexically_normal();
+		}
+
+		std::filesystem::path path = root / name;
+		if (std::filesystem::is_regular_file(path, error))
+			return path.lexically_normal();
+
+		return std::filesystem::path();
+	}
+
+	/**
+	 * @brief Collect every file a source includes, depth first. Directives inside comments or disabled blocks are followed too, which can only make the cache key stricter.
+	*/
+	void collectIncludes(const std::filesystem::path& path, const std::string& source, const std::filesystem::path& root, std::unordered_set<std::string>& visited, std::vector<std::pair<std::filesystem::path, std::string>>& includes)
+	{
+		size_t position = 0;
+
+		while (position < source.size())
+		{
+			size_t end = source.find('\n', position);
+			if (end == std::string::npos)
+				end = source.size();
+
+			std::string_view line(source.data() + position, end - position);
+			position = end + 1;
+
+			size_t hash = line.find_first_not_of(" \t");
+			if (hash == std::string_view::npos || line[hash] != '#')
+				continue;
+
+			size_t directive = line.find_first_not_of(" \t", hash + 1);
+			if (directive == std::string_view::npos || line.compare(directive, 7, "include") != 0)
+				continue;
+
+			size_t open = line.find_first_of("\"<", directive + 7);
+			if (open == std::string_view::npos)
+				continue;
+
+			size_t close = line.find(line[open] == '"' ? '"' : '>', open + 1);
+			if (close == std::string_view::npos)
+				continue;
+
+			std::filesystem::path include = resolveInclude(path, std::string(line.substr(open + 1, close - open - 1)), line[open] == '"', root);
+			if (include.empty() || !visited.insert(include.string()).second)
+				continue;
+
+			includes.push_back(std::make_pair(include, readText(include)));
+			collectIncludes(include, includes.back().second, root, visited, includes);
+		}
+	}
+
+#ifdef GLACIER_SHADER_COMPILER
+	/**
+	 * @brief Resolves #include directives for shaderc the same way collectIncludes does
+	*/
+	class Includer : public shaderc::CompileOptions::IncluderInterface
+	{
+	public:
+		Includer(std::filesystem::path root)
+			: m_Root(std::move(root))
+		{
+		}
+
+		shaderc_include_result* GetInclude(const char* requestedSource, shaderc_include_type type, const char* requestingSource, size_t includeDepth) override
+		{
+			Include* include = new Include();
+			include->path = resolveInclude(requestingSource, requestedSource, type == shaderc_include_type_relative, m_Root).string();
+
+			// An empty source name reports an error, with the content as the message. Exceptions mustn't cross into shaderc.
+			try
+			{
+				if (include->path.empty())
+					include->content = fmt::format("Cannot find include file {}", requestedSource);
+				else
+					include->content = readText(include->path);
+			}
+			catch (const std::exception& e)
+			{
+				include->path.clear();
+				include->content = e.what();
+			}
+
+			include->result.source_name = include->path.c_str();
+			include->result.source_name_length = include->path.size();
+			include->result.content = include->content.c_str();
+			include->result.content_length = include->content.size();
+			include->result.user_data = include;
+
+			return &include->result;
+		}
+
+		void ReleaseInclude(shaderc_include_result* data) override
+		{
+			delete static_cast<Include*>(data->user_data);
+		}
+	private:
+		struct Include
+		{
+			std::string path;
+			std::string content;
+			shaderc_include_result result;
+		};
+
+		std::filesystem::path m_Root;
+	};
+
+	shaderc_shader_kind shaderKind(glacier::ShaderType type)
+	{
+		switch (type)
+		{
+		case glacier::ShaderType::Vertex:
+			return shaderc_vertex_shader;
+		case glacier::ShaderType::Geometry:
+			return shaderc_geometry_shader;
+		case glacier::ShaderType::Fragment:
+			return shaderc_fragment_shader;
+		case glacier::ShaderType::Compute:
+			return shaderc_compute_shader;
+		default:
+			// Control and evaluation shaders share a type, so the source has to name its stage with #pragma shader_stage
+			return shaderc_glsl_infer_from_source;
+		}
+	}
+#endif
+}
+
+ShaderCompiler::ShaderCompiler(std::string cacheDirectory)
+	: m_CacheDirectory(std::move(cacheDirectory))
+{
+}
+
+ShaderCompiler::Result ShaderCompiler::compile(const std::string& path, glacier::ShaderType type, const std::vector<glacier::ShaderDefine>& defines) const
+{
+	std::filesystem::path sourcePath = std::filesystem::path(path).lexically_normal();
+	std::filesystem::path root = sourcePath.parent_path();
+
+	Result result;
+
+	/* Gather everything the SPIR-V depends on */
+	std::string source = readText(sourcePath);
+
+	std::unordered_set<std::string> visited = { sourcePath.string() };
+	std::vector<std::pair<std::filesystem::path, std::string>> includes;
+	collectIncludes(sourcePath, source, root, visited, includes);
+
+	result.dependencies.push_back(sourcePath.string());
+	for (const std::pair<std::filesystem::path, std::string>& include : includes)
+		result.dependencies.push_back(include.first.string());
+
+	/* Hash it into the cache key */
+	// Include names are relative to the root, so moving the whole shader directory keeps the cache valid
+	std::string keyData = CACHE_VERSION;
+	keyData += '\0';
+	keyData += std::to_string(static_cast<int>(type));
+	keyData += '\0';
+
+	for (const glacier::ShaderDefine& define : defines)
+		keyData += define.name + '=' + define.value + '\0';
+
+	keyData += source;
+
+	for (const std::pair<std::filesystem::path, std::string>& include : includes)
+	{
+		keyData += '\0';
+		keyData += include.first.lexically_relative(root).generic_string();
+		keyData += '\0';
+		keyData += include.second;
+	}
+
+	std::filesystem::path cachePath;
+	if (!m_CacheDirectory.empty())
+		cachePath = std::filesystem::path(m_CacheDirectory) / fmt::format("{:016x}.spv", hashBytes(keyData.data(), keyData.size()));
+
+	/* Look it up */
+	if (!cachePath.empty())
+	{
+		std::ifstream stream(cachePath, std::ios::ate | std::ios::binary);
+		if (stream)
+		{
+			result.code = glacier::Buffer(static_cast<size_t>(stream.tellg()));
+			stream.seekg(0);
+			stream.read(result.code.data(), result.code.size());
+
+			if (stream)
+			{
+				result.cached = true;
+				return result;
+			}
+		}
+	}
+
+#ifdef GLACIER_SHADER_COMPILER
+	/* Compile */
+	shaderc::CompileOptions options;
+	options.SetOptimizationLevel(shaderc_optimization_level_performance);
+	options.SetWarningsAsErrors();
+	options.SetIncluder(std::make_unique<Includer>(root));
+
+	for (const glacier::ShaderDefine& define : defines)
+		options.AddMacroDefinition(define.name, define.value);
+
+	// A compiler is cheap to create, and keeping one per call avoids sharing it between workers
+	shaderc::Compiler compiler;
+	shaderc::SpvCompilationResult compilation = compiler.CompileGlslToSpv(source, shaderKind(type), sourcePath.string().c_str(), options);
+
+	if (compilation.GetCompilationStatus() != shaderc_compilation_status_success)
+		throw std::runtime_error(fmt::format("Failed to compile shader {}:\n{}", sourcePath.string(), compilation.GetErrorMessage()));
+
+	size_t size = static_cast<size_t>(compilation.cend() - compilation.cbegin()) * sizeof(uint32_t);
+	result.code = glacier::Buffer(size);
+	memcpy(result.code.data(), compilation.cbegin(), size);
+#else
+	throw std::runtime_error(fmt::format("Glacier was built without a GLSL compiler, and {} is not in the shader cache", sourcePath.string()));
+#endif
+
+	/* Store it */
+	// Written under a temporary name first, so other processes never read a partial file
+	if (!cachePath.empty())
+	{
+		std::error_code error;
+		std::filesystem::create_directories(cachePath.parent_path(), error);
+
+		std::filesystem::path temporaryPath = cachePath;
+		temporaryPath += fmt::format(".{}.tmp", std::hash<std::thread::id>()(std::this_thread::get_id()));
+
+		{
+			std::ofstream stream(temporaryPath, std::ios::binary);
+			stream.write(result.code.data(), result.code.size());
+		}
+
+		std::filesystem::rename(temporaryPath, cachePath, error);
+		if (error)
+		{
+			std::filesystem::remove(temporaryPath, error);
+			glacier::g_Logger->warn("Failed to write shader cache entry {}", cachePath.string());
+		}
+	}
+
+	return result;
+}
+
+bool ShaderCompiler::isAvailable()
+{
+#ifdef GLACIER_SHADER_COMPILER
+	return true;
+#else
+	return false;
+#endif
+}
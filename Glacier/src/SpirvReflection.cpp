@@ -0,0 +1,657 @@
+#include "internal/SpirvReflection.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <spdlog/fmt/fmt.h>
+
+// Only the parts of the SPIR-V specification needed to describe a module's interface
+namespace
+{
+	constexpr uint32_t SPIRV_MAGIC = 0x07230203;
+	constexpr uint32_t UNSET = std::numeric_limits<uint32_t>::max();
+
+	// Far above what any device supports, only there to stop a corrupt module from declaring billions of inputs
+	constexpr uint64_t MAX_INPUT_LOCATIONS = 1024;
+
+	enum Opcode : uint32_t
+	{
+		OpName = 5,
+		OpEntryPoint = 15,
+		OpTypeBool = 20,
+		OpTypeInt = 21,
+		OpTypeFloat = 22,
+		OpTypeVector = 23,
+		OpTypeMatrix = 24,
+		OpTypeImage = 25,
+		OpTypeSampler = 26,
+		OpTypeSampledImage = 27,
+		OpTypeArray = 28,
+		OpTypeRuntimeArray = 29,
+		OpTypeStruct = 30,
+		OpTypePointer = 32,
+		OpTypeForwardPointer = 39,
+		OpConstant = 43,
+		OpSpecConstantTrue = 48,
+		OpSpecConstantFalse = 49,
+		OpSpecConstant = 50,
+		OpVariable = 59,
+		OpDecorate = 71,
+		OpMemberDecorate = 72
+	};
+
+	enum Decoration : uint32_t
+	{
+		DecorationSpecId = 1,
+		DecorationBlock = 2,
+		DecorationBufferBlock = 3,
+		DecorationArrayStride = 6,
+		DecorationMatrixStride = 7,
+		DecorationBuiltIn = 11,
+		DecorationLocation = 30,
+		DecorationBinding = 33,
+		DecorationDescriptorSet = 34,
+		DecorationOffset = 35
+	};
+
+	enum StorageClass : uint32_t
+	{
+		StorageClassUniformConstant = 0,
+		StorageClassInput = 1,
+		StorageClassUniform = 2,
+		StorageClassPushConstant = 9,
+		StorageClassStorageBuffer = 12
+	};
+
+	enum ImageDimension : uint32_t
+	{
+		DimensionBuffer = 5,
+		DimensionSubpassData = 6
+	};
+
+	struct Type
+	{
+		uint32_t opcode = 0;
+
+		// The operands following the result id
+		std::vector<uint32_t> operands;
+	};
+
+	struct Decorations
+	{
+		uint32_t location = UNSET;
+		uint32_t set = UNSET;
+		uint32_t binding = UNSET;
+		uint32_t specId = UNSET;
+		uint32_t arrayStride = 0;
+		bool builtIn = false;
+		bool bufferBlock = false;
+	};
+
+	struct MemberDecorations
+	{
+		uint32_t offset = UNSET;
+		uint32_t matrixStride = 0;
+		bool builtIn = false;
+	};
+
+	struct Variable
+	{
+		uint32_t id;
+		uint32_t type;
+		uint32_t storageClass;
+	};
+
+	class Module
+	{
+	public:
+		std::unordered_map<uint32_t, Type> types;
+		std::unordered_map<uint32_t, uint32_t> constants;
+		std::unordered_map<uint32_t, std::string> names;
+		std::unordered_map<uint32_t, Decorations> decorations;
+		std::unordered_map<uint32_t, std::unordered_map<uint32_t, MemberDecorations>> memberDecorations;
+
+		std::vector<Variable> variables;
+
+		// Result type and id of every specialization constant
+		std::vector<std::pair<uint32_t, uint32_t>> specConstants;
+
+		uint32_t executionModel = UNSET;
+		std::string entryPoint;
+
+		const Type& type(uint32_t id) const
+		{
+			std::unordered_map<uint32_t, Type>::const_iterator it = types.find(id);
+			if (it == types.end())
+				throw std::runtime_error(fmt::format("SPIR-V references unknown type %{}", id));
+
+			return it->second;
+		}
+
+		const Decorations& decoration(uint32_t id) const
+		{
+			static const Decorations none;
+
+			std::unordered_map<uint32_t, Decorations>::const_iterator it = decorations.find(id);
+			return it == decorations.end() ? none : it->second;
+		}
+
+		MemberDecorations memberDecoration(uint32_t id, uint32_t member) const
+		{
+			std::unordered_map<uint32_t, std::unordered_map<uint32_t, MemberDecorations>>::const_iterator it = memberDecorations.find(id);
+			if (it == memberDecorations.end())
+				return MemberDecorations();
+
+			std::unordered_map<uint32_t, MemberDecorations>::const_iterator memberIt = it->second.find(member);
+			return memberIt == it->second.end() ? MemberDecorations() : memberIt->second;
+		}
+
+		/**
+		 * @brief The type a pointer type points to
+		*/
+		uint32_t pointee(uint32_t id) const
+		{
+			const Type& t = type(id);
+			if (t.opcode != OpTypePointer)
+				throw std::runtime_error(fmt::format("SPIR-V type %{} is not a pointer", id));
+
+			return t.operands[1];
+		}
+
+		std::string name(uint32_t id) const
+		{
+			std::unordered_map<uint32_t, std::string>::const_iterator it = names.find(id);
+			return it == names.end() ? std::string() : it->second;
+		}
+
+		uint32_t constant(uint32_t id) const
+		{
+			std::unordered_map<uint32_t, uint32_t>::const_iterator it = constants.find(id);
+			if (it == constants.end())
+				throw std::runtime_error(fmt::format("SPIR-V array length %{} is not a constant", id));
+
+			return it->second;
+		}
+
+		glacier::ShaderScalarType scalarType(uint32_t id) const
+		{
+			const Type& t = type(id);
+
+			switch (t.opcode)
+			{
+			case OpTypeBool:
+				return glacier::ShaderScalarType::Bool;
+			case OpTypeInt:
+				return t.operands[1] ? glacier::ShaderScalarType::Int : glacier::ShaderScalarType::UnsignedInt;
+			case OpTypeFloat:
+				return t.operands[0] == 64 ? glacier::ShaderScalarType::Double : glacier::ShaderScalarType::Float;
+			case OpTypeVector:
+			case OpTypeMatrix:
+			case OpTypeArray:
+				return scalarType(t.operands[0]);
+			default:
+				return glacier::ShaderScalarType::Unknown;
+			}
+		}
+
+		/**
+		 * @brief Size of a type in bytes, following the explicit layout decorations
+		*/
+		uint32_t size(uint32_t id, uint32_t matrixStride = 0) const
+		{
+			const Type& t = type(id);
+
+			switch (t.opcode)
+			{
+			case OpTypeBool:
+				return 4;
+			case OpTypeInt:
+			case OpTypeFloat:
+				return t.operands[0] / 8;
+			case OpTypeVector:
+				return t.operands[1] * size(t.operands[0]);
+			case OpTypeMatrix:
+				return t.operands[1] * (matrixStride != 0 ? matrixStride : size(t.operands[0]));
+			case OpTypeArray:
+			{
+				uint32_t stride = decoration(id).arrayStride;
+				return constant(t.operands[1]) * (stride != 0 ? stride : size(t.operands[0], matrixStride));
+			}
+			case OpTypeRuntimeArray:
+				return 0;
+			case OpTypeStruct:
+			{
+				uint32_t end = 0;
+				uint32_t offset = 0;
+
+				for (uint32_t member = 0; member < t.operands.size(); member++)
+				{
+					MemberDecorations decorations = memberDecoration(id, member);
+					if (decorations.offset != UNSET)
+						offset = decorations.offset;
+
+					uint32_t memberSize = size(t.operands[member], decorations.matrixStride);
+					end = std::max(end, offset + memberSize);
+					offset += memberSize;
+				}
+
+				return end;
+			}
+			default:
+				throw std::runtime_error(fmt::format("SPIR-V type %{} has no size", id));
+			}
+		}
+	};
+
+	/**
+	 * @brief Number of operands an instruction needs at least, counting its result id, so that parsing and reflection never read past it
+	*/
+	uint32_t minimumOperands(uint32_t opcode)
+	{
+		switch (opcode)
+		{
+		case OpTypeBool:
+		case OpTypeSampler:
+		case OpTypeStruct:
+			return 1;
+		case OpName:
+		case OpTypeFloat:
+		case OpTypeSampledImage:
+		case OpTypeRuntimeArray:
+		case OpTypeForwardPointer:
+		case OpSpecConstantTrue:
+		case OpSpecConstantFalse:
+		case OpDecorate:
+			return 2;
+		case OpEntryPoint:
+		case OpTypeInt:
+		case OpTypeVector:
+		case OpTypeMatrix:
+		case OpTypeArray:
+		case OpTypePointer:
+		case OpConstant:
+		case OpSpecConstant:
+		case OpVariable:
+		case OpMemberDecorate:
+			return 3;
+		case OpTypeImage:
+			return 8;
+		default:
+			return 0;
+		}
+	}
+
+	/**
+	 * @brief The value of a decoration, which follows the decoration itself
+	*/
+	uint32_t decorationValue(const uint32_t* operands, uint32_t operandCount, uint32_t index)
+	{
+		if (index >= operandCount)
+			throw std::runtime_error(fmt::format("Malformed SPIR-V: decoration {} has no value", operands[index - 1]));
+
+		return operands[index];
+	}
+
+	std::string readString(const uint32_t* words, uint32_t count)
+	{
+		const char* characters = reinterpret_cast<const char*>(words);
+		size_t length = 0;
+
+		while (length < count * 4 && characters[length] != '\0')
+			length++;
+
+		return std::string(characters, length);
+	}
+
+	glacier::ShaderType stageOf(uint32_t executionModel)
+	{
+		switch (executionModel)
+		{
+		case 0:
+			return glacier::ShaderType::Vertex;
+		case 1:
+		case 2:
+			return glacier::ShaderType::Tesselation;
+		case 3:
+			return glacier::ShaderType::Geometry;
+		case 4:
+			return glacier::ShaderType::Fragment;
+		case 5:
+			return glacier::ShaderType::Compute;
+		default:
+			throw std::runtime_error(fmt::format("Unsupported SPIR-V execution model {}", executionModel));
+		}
+	}
+
+	void parse(Module& module, const uint32_t* words, size_t count)
+	{
+		size_t position = 5;
+
+		// Ids of pointer types declared ahead of their definition
+		std::unordered_set<uint32_t> forwardPointers;
+
+		while (position < count)
+		{
+			uint32_t wordCount = words[position] >> 16;
+			uint32_t opcode = words[position] & 0xffff;
+
+			if (wordCount == 0 || position + wordCount > count)
+				throw std::runtime_error("Malformed SPIR-V instruction");
+
+			const uint32_t* operands = words + position + 1;
+			uint32_t operandCount = wordCount - 1;
+
+			if (operandCount < minimumOperands(opcode))
+				throw std::runtime_error(fmt::format("Malformed SPIR-V: instruction {} has {} operands, expected at least {}", opcode, operandCount, minimumOperands(opcode)));
+
+			switch (opcode)
+			{
+			case OpName:
+				module.names[operands[0]] = readString(operands + 1, operandCount - 1);
+				break;
+			case OpEntryPoint:
+				// Only the first entry point is reflected
+				if (module.executionModel == UNSET)
+				{
+					module.executionModel = operands[0];
+					module.entryPoint = readString(operands + 2, operandCount - 2);
+				}
+				break;
+			case OpTypeBool:
+			case OpTypeInt:
+			case OpTypeFloat:
+			case OpTypeVector:
+			case OpTypeMatrix:
+			case OpTypeImage:
+			case OpTypeSampler:
+			case OpTypeSampledImage:
+			case OpTypeArray:
+			case OpTypeRuntimeArray:
+			case OpTypeStruct:
+			case OpTypePointer:
+			{
+				// Types are declared before they are used, which also keeps corrupt modules from making the type graph cyclic
+				if (module.types.count(operands[0]) != 0)
+					throw std::runtime_error(fmt::format("Malformed SPIR-V: type %{} is declared twice", operands[0]));
+
+				if (opcode == OpTypeVector || opcode == OpTypeMatrix || opcode == OpTypeArray || opcode == OpTypeRuntimeArray || opcode == OpTypeStruct)
+				{
+					// Every member of a struct is a type, otherwise only the element type
+					uint32_t end = opcode == OpTypeStruct ? operandCount : 2;
+					for (uint32_t operand = 1; operand < end; operand++)
+					{
+						if (module.types.count(operands[operand]) == 0 && forwardPointers.count(operands[operand]) == 0)
+							throw std::runtime_error(fmt::format("Malformed SPIR-V: type %{} uses type %{} before it is declared", operands[0], operands[operand]));
+					}
+				}
+
+				Type& type = module.types[operands[0]];
+				type.opcode = opcode;
+				type.operands.assign(operands + 1, operands + operandCount);
+				break;
+			}
+			case OpTypeForwardPointer:
+				forwardPointers.insert(operands[0]);
+				break;
+			case OpConstant:
+				// Only 32-bit integers are needed, for array lengths
+				module.constants[operands[1]] = operands[2];
+				break;
+			case OpSpecConstantTrue:
+			case OpSpecConstantFalse:
+			case OpSpecConstant:
+				module.specConstants.push_back(std::make_pair(operands[0], operands[1]));
+
+				if (opcode == OpSpecConstant)
+					module.constants[operands[1]] = operands[2];
+				break;
+			case OpVariable:
+				module.variables.push_back(Variable{ operands[1], operands[0], operands[2] });
+				break;
+			case OpDecorate:
+			{
+				Decorations& decorations = module.decorations[operands[0]];
+
+				switch (operands[1])
+				{
+				case DecorationSpecId:
+					decorations.specId = decorationValue(operands, operandCount, 2);
+					break;
+				case DecorationBufferBlock:
+					decorations.bufferBlock = true;
+					break;
+				case DecorationArrayStride:
+					decorations.arrayStride = decorationValue(operands, operandCount, 2);
+					break;
+				case DecorationBuiltIn:
+					decorations.builtIn = true;
+					break;
+				case DecorationLocation:
+					decorations.location = decorationValue(operands, operandCount, 2);
+					break;
+				case DecorationBinding:
+					decorations.binding = decorationValue(operands, operandCount, 2);
+					break;
+				case DecorationDescriptorSet:
+					decorations.set = decorationValue(operands, operandCount, 2);
+					break;
+				}
+				break;
+			}
+			case OpMemberDecorate:
+			{
+				// Structs are declared after their decorations, so the member index is checked once parsing is done
+				MemberDecorations& decorations = module.memberDecorations[operands[0]][operands[1]];
+
+				switch (operands[2])
+				{
+				case DecorationMatrixStride:
+					decorations.matrixStride = decorationValue(operands, operandCount, 3);
+					break;
+				case DecorationBuiltIn:
+					decorations.builtIn = true;
+					break;
+				case DecorationOffset:
+					decorations.offset = decorationValue(operands, operandCount, 3);
+					break;
+				}
+				break;
+			}
+			}
+
+			position += wordCount;
+		}
+
+		for (const std::pair<const uint32_t, std::unordered_map<uint32_t, MemberDecorations>>& members : module.memberDecorations)
+		{
+			std::unordered_map<uint32_t, Type>::const_iterator it = module.types.find(members.first);
+			if (it == module.types.end() || it->second.opcode != OpTypeStruct)
+				throw std::runtime_error(fmt::format("Malformed SPIR-V: member decorations target %{}, which is not a struct", members.first));
+
+			for (const std::pair<const uint32_t, MemberDecorations>& member : members.second)
+			{
+				if (member.first >= it->second.operands.size())
+					throw std::runtime_error(fmt::format("Malformed SPIR-V: struct %{} has no member {}", members.first, member.first));
+			}
+		}
+	}
+
+	void reflectInput(const Module& module, const Variable& variable, glacier::ShaderReflection& reflection)
+	{
+		const Decorations& decorations = module.decoration(variable.id);
+		if (decorations.builtIn || decorations.location == UNSET)
+			return;
+
+		uint32_t typeId = module.pointee(variable.type);
+
+		// Geometry and tessellation inputs are per-vertex arrays
+		if (reflection.stage != glacier::ShaderType::Vertex && reflection.stage != glacier::ShaderType::Fragment && module.type(typeId).opcode == OpTypeArray)
+			typeId = module.type(typeId).operands[0];
+
+		// Every element of an array takes its own locations, so it is split into inputs like the columns of a matrix
+		uint32_t elements = 1;
+		if (module.type(typeId).opcode == OpTypeArray)
+		{
+			const Type& array = module.type(typeId);
+			elements = module.constant(array.operands[1]);
+			typeId = array.operands[0];
+		}
+
+		const Type& type = module.type(typeId);
+
+		uint32_t columns = 1;
+		uint32_t components = 1;
+
+		if (type.opcode == OpTypeVector)
+		{
+			components = type.operands[1];
+		}
+		else if (type.opcode == OpTypeMatrix)
+		{
+			const Type& column = module.type(type.operands[0]);
+			if (column.opcode != OpTypeVector)
+				throw std::runtime_error(fmt::format("Malformed SPIR-V: the columns of matrix %{} are not vectors", typeId));
+
+			columns = type.operands[1];
+			components = column.operands[1];
+		}
+
+		glacier::ShaderScalarType scalarType = module.scalarType(typeId);
+
+		// 64-bit vectors with more than two components take two locations
+		uint32_t locations = scalarType == glacier::ShaderScalarType::Double && components > 2 ? 2 : 1;
+
+		if (decorations.location + static_cast<uint64_t>(elements) * columns * locations > MAX_INPUT_LOCATIONS)
+			throw std::runtime_error(fmt::format("Input {} at location {} takes more locations than any device has", module.name(variable.id), decorations.location));
+
+		for (uint32_t element = 0; element < elements; element++)
+		{
+			for (uint32_t column = 0; column < columns; column++)
+				reflection.inputs.push_back(glacier::ShaderInput{ module.name(variable.id), decorations.location + (element * columns + column) * locations, scalarType, components });
+		}
+	}
+
+	void reflectBinding(const Module& module, const Variable& variable, glacier::ShaderReflection& reflection)
+	{
+		const Decorations& decorations = module.decoration(variable.id);
+		if (decorations.set == UNSET || decorations.binding == UNSET)
+			return;
+
+		uint32_t typeId = module.pointee(variable.type);
+		uint32_t count = 1;
+
+		const Type* type = &module.type(typeId);
+		if (type->opcode == OpTypeArray)
+		{
+			count = module.constant(type->operands[1]);
+			typeId = type->operands[0];
+			type = &module.type(typeId);
+		}
+		else if (type->opcode == OpTypeRuntimeArray)
+		{
+			count = 0;
+			typeId = type->operands[0];
+			type = &module.type(typeId);
+		}
+
+		glacier::DescriptorType descriptorType;
+
+		switch (type->opcode)
+		{
+		case OpTypeSampler:
+			descriptorType = glacier::DescriptorType::Sampler;
+			break;
+		case OpTypeSampledImage:
+			descriptorType = glacier::DescriptorType::CombinedImageSampler;
+			break;
+		case OpTypeImage:
+		{
+			// Operands: sampled type, dimension, depth, arrayed, multisampled, sampled (1 = sampled, 2 = storage)
+			bool storage = type->operands[5] == 2;
+
+			if (type->operands[1] == DimensionSubpassData)
+				throw std::runtime_error("Input attachments are not supported");
+
+			if (type->operands[1] == DimensionBuffer)
+				descriptorType = storage ? glacier::DescriptorType::StorageTexelBuffer : glacier::DescriptorType::UniformTexelBuffer;
+			else
+				descriptorType = storage ? glacier::DescriptorType::StorageImage : glacier::DescriptorType::SampledImage;
+			break;
+		}
+		case OpTypeStruct:
+			// Before SPIR-V 1.3 storage buffers are uniform blocks decorated with BufferBlock
+			if (variable.storageClass == StorageClassStorageBuffer || module.decoration(typeId).bufferBlock)
+				descriptorType = glacier::DescriptorType::StorageBuffer;
+			else
+				descriptorType = glacier::DescriptorType::UniformBuffer;
+			break;
+		default:
+			throw std::runtime_error(fmt::format("Unsupported descriptor type at set {} binding {}", decorations.set, decorations.binding));
+		}
+
+		std::string name = module.name(variable.id);
+		if (name.empty())
+			name = module.name(typeId);
+
+		reflection.bindings.push_back(glacier::ShaderBinding{ name, decorations.set, decorations.binding, descriptorType, count });
+	}
+}
+
+glacier::ShaderReflection reflectSpirv(const void* code, size_t size)
+{
+	if (size % 4 != 0 || size < 20)
+		throw std::runtime_error("SPIR-V code size must be a multiple of 4 and include the header");
+
+	const uint32_t* words = static_cast<const uint32_t*>(code);
+	if (words[0] != SPIRV_MAGIC)
+		throw std::runtime_error("Invalid SPIR-V magic number");
+
+	Module module;
+	parse(module, words, size / 4);
+
+	if (module.executionModel == UNSET)
+		throw std::runtime_error("SPIR-V module has no entry point");
+
+	glacier::ShaderReflection reflection;
+	reflection.stage = stageOf(module.executionModel);
+	reflection.entryPoint = module.entryPoint;
+
+	for (const Variable& variable : module.variables)
+	{
+		switch (variable.storageClass)
+		{
+		case StorageClassInput:
+			reflectInput(module, variable, reflection);
+			break;
+		case StorageClassUniformConstant:
+		case StorageClassUniform:
+		case StorageClassStorageBuffer:
+			reflectBinding(module, variable, reflection);
+			break;
+		case StorageClassPushConstant:
+			reflection.pushConstantSize = std::max(reflection.pushConstantSize, module.size(module.pointee(variable.type)));
+			break;
+		}
+	}
+
+	std::sort(reflection.inputs.begin(), reflection.inputs.end(), [](const glacier::ShaderInput& a, const glacier::ShaderInput& b) { return a.location < b.location; });
+
+	std::sort(reflection.bindings.begin(), reflection.bindings.end(), [](const glacier::ShaderBinding& a, const glacier::ShaderBinding& b)
+		{
+			return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+		});
+
+	for (const std::pair<uint32_t, uint32_t>& constant : module.specConstants)
+	{
+		const Decorations& decorations = module.decoration(constant.second);
+		if (decorations.specId == UNSET)
+			continue;
+
+		reflection.specializationConstants.push_back(glacier::ShaderSpecializationConstant{ module.name(constant.second), decorations.specId, module.scalarType(constant.first), module.size(constant.first) });
+	}
+
+	return reflection;
+}
@@ -0,0 +1,63 @@
+#include "StorageBuffer.hpp"
+#include "Application.hpp"
+#include "Renderer.hpp"
+#include "internal/utility.hpp"
+#include "internal/BindlessHeap.hpp"
+#include "internal/DeletionQueue.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <vulkan/vulkan.h>
+
+glacier::StorageBuffer::StorageBuffer(const Application* application, const void* data, uint64_t size)
+	: m_Application(application), m_Handle(nullptr), m_Memory(nullptr), m_Size(size), m_Index(UINT32_MAX), m_LastUsage(0)
+{
+	if (size == 0)
+		throw std::runtime_error("Storage buffers can't be empty");
+
+	/* Create a staging buffer */
+	VkBuffer stagingBuffer;
+	VkDeviceMemory stagingBufferMemory;
+	createBuffer(static_cast<VkDevice>(m_Application->m_Device), static_cast<VkPhysicalDevice>(m_Application->m_PhysicalDevice), size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &stagingBuffer, &stagingBufferMemory);
+
+	/* Copy data to the staging buffer */
+	void* tmp;
+	vkMapMemory(static_cast<VkDevice>(m_Application->m_Device), stagingBufferMemory, 0, size, 0, &tmp);
+	memcpy(tmp, data, size);
+	vkUnmapMemory(static_cast<VkDevice>(m_Application->m_Device), stagingBufferMemory);
+
+	/* Copy data from the staging buffer to the storage buffer on the GPU */
+	createBuffer(static_cast<VkDevice>(m_Application->m_Device), static_cast<VkPhysicalDevice>(m_Application->m_PhysicalDevice), size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, reinterpret_cast<VkBuffer*>(&m_Handle), reinterpret_cast<VkDeviceMemory*>(&m_Memory));
+
+	m_LastUsage = ++m_Application->m_TimelineValue;
+	copyBuffers(static_cast<VkDevice>(m_Application->m_Device), static_cast<VkCommandPool>(m_Application->m_Renderer->m_CommandPool), static_cast<VkQueue>(m_Application->m_Renderer->m_GraphicsQueue), static_cast<VkSemaphore>(m_Application->m_Timeline), m_LastUsage, &stagingBuffer, reinterpret_cast<VkBuffer*>(&m_Handle), &size, 1);
+
+	vkDestroyBuffer(static_cast<VkDevice>(m_Application->m_Device), stagingBuffer, nullptr);
+	vkFreeMemory(static_cast<VkDevice>(m_Application->m_Device), stagingBufferMemory, nullptr);
+
+	if (m_Application->m_BindlessHeap != nullptr)
+		m_Index = m_Application->m_BindlessHeap->addBuffer(static_cast<VkBuffer>(m_Handle), size);
+}
+
+glacier::StorageBuffer::~StorageBuffer()
+{
+	// Draws reference storage buffers by index, so any submission so far may have read it
+	uint64_t lastUsage = std::max(m_LastUsage, m_Application->m_TimelineValue);
+
+	if (m_Index != UINT32_MAX)
+		m_Application->m_BindlessHeap->release(BindlessHeap::BUFFER_BINDING, m_Index, lastUsage);
+
+	/* Destroy the buffer and free its memory once the GPU no longer uses it */
+	m_Application->m_DeletionQueue->destroy(VK_OBJECT_TYPE_BUFFER, m_Handle, lastUsage);
+	m_Application->m_DeletionQueue->destroy(VK_OBJECT_TYPE_DEVICE_MEMORY, m_Memory, lastUsage);
+}
+
+uint32_t glacier::StorageBuffer::getIndex() const
+{
+	return m_Index;
+}
+
+uint64_t glacier::StorageBuffer::getSize() const
+{
+	return m_Size;
+}
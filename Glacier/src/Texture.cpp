@@ -0,0 +1,363 @@
+#include "Texture.hpp"
+#include "Application.hpp"
+#include "FileSystem.hpp"
+#include "Renderer.hpp"
+#include "internal/utility.hpp"
+#include "internal/AssetWatcher.hpp"
+#include "internal/BindlessHeap.hpp"
+#include "internal/DeletionQueue.hpp"
+#include "internal/Ktx2.hpp"
+#include "internal/SamplerCache.hpp"
+#include "internal/TextureFormat.hpp"
+#include "internal/TextureUploader.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <vulkan/vulkan.h>
+
+#include <spdlog/spdlog.h>
+
+namespace
+{
+	VkSamplerAddressMode addressMode(glacier::TextureWrap wrap)
+	{
+		switch (wrap)
+		{
+		case glacier::TextureWrap::MirroredRepeat:
+			return VK_SAMPLER_ADDRESS_MODE_MIRRORED_REPEAT;
+		case glacier::TextureWrap::ClampToEdge:
+			return VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		default:
+			return VK_SAMPLER_ADDRESS_MODE_REPEAT;
+		}
+	}
+
+	uint32_t fullMipChain(uint32_t width, uint32_t height)
+	{
+		uint32_t levels = 1;
+		while ((std::max(width, height) >> levels) > 0)
+			levels++;
+
+		return levels;
+	}
+}
+
+glacier::Texture::Texture(const Application* application)
+	: m_Application(application), m_Image(nullptr), m_Memory(nullptr), m_ImageView(nullptr), m_Sampler(nullptr), m_Index(UINT32_MAX), m_Format(VK_FORMAT_UNDEFINED), m_Width(0), m_Height(0), m_MipLevels(0), m_LastUsage(0)
+{
+}
+
+glacier::Texture::Texture(const Application* application, std::string_view path, const TextureInfo& info)
+	: Texture(application)
+{
+	TextureUploader uploader(static_cast<VkDevice>(m_Application->m_Device), static_cast<VkPhysicalDevice>(m_Application->m_PhysicalDevice));
+
+	load(path, info, uploader);
+	m_LastUsage = submit(m_Application, uploader);
+}
+
+glacier::Texture::Texture(const Application* application, const void* pixels, uint32_t width, uint32_t height, const TextureInfo& info)
+	: Texture(application)
+{
+	if (width == 0 || height == 0)
+		throw std::runtime_error("Textures must be at least 1x1 pixels");
+
+	TextureUploader uploader(static_cast<VkDevice>(m_Application->m_Device), static_cast<VkPhysicalDevice>(m_Application->m_PhysicalDevice));
+
+	create(info.srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM, width, height, 1, info);
+
+	// The pixels stay valid until the upload below is submitted, so nothing has to own them
+	std::vector<TextureUploader::Level> levels = { TextureUploader::Level{ pixels, static_cast<size_t>(width) * height * 4 } };
+	uploader.add(static_cast<VkImage>(m_Image), m_Width, m_Height, m_MipLevels, std::move(levels), nullptr);
+
+	m_LastUsage = submit(m_Application, uploader);
+}
+
+glacier::Texture::~Texture()
+{
+	if (m_Application->m_AssetWatcher != nullptr)
+		m_Application->m_AssetWatcher->unwatch(this);
+
+	// Draws reference textures by index, so any submission so far may have sampled it
+	uint64_t lastUsage = std::max(m_LastUsage, m_Application->m_TimelineValue);
+
+	if (m_Index != UINT32_MAX)
+		m_Application->m_BindlessHeap->release(BindlessHeap::TEXTURE_BINDING, m_Index, lastUsage);
+
+	/* Destroy the image and its objects once the GPU no longer uses them */
+	m_Application->m_DeletionQueue->destroy(VK_OBJECT_TYPE_IMAGE_VIEW, m_ImageView, lastUsage);
+	m_Application->m_DeletionQueue->destroy(VK_OBJECT_TYPE_IMAGE, m_Image, lastUsage);
+	m_Application->m_DeletionQueue->destroy(VK_OBJECT_TYPE_DEVICE_MEMORY, m_Memory, lastUsage);
+}
+
+std::vector<std::unique_ptr<glacier::Texture>> glacier::Texture::loadBatch(const Application* application, const std::vector<std::string>& paths, const TextureInfo& info)
+{
+	TextureUploader uploader(static_cast<VkDevice>(application->m_Device), static_cast<VkPhysicalDevice>(application->m_PhysicalDevice));
+
+	std::vector<std::unique_ptr<Texture>> textures;
+	for (const std::string& path : paths)
+	{
+		textures.push_back(std::unique_ptr<Texture>(new Texture(application)));
+		textures.back()->load(path, info, uploader);
+	}
+
+	uint64_t lastUsage = submit(application, uploader);
+	for (std::unique_ptr<Texture>& texture : textures)
+		texture->m_LastUsage = lastUsage;
+
+	return textures;
+}
+
+uint32_t glacier::Texture::getWidth() const
+{
+	return m_Width;
+}
+
+uint32_t glacier::Texture::getHeight() const
+{
+	return m_Height;
+}
+
+uint32_t glacier::Texture::getMipLevels() const
+{
+	return m_MipLevels;
+}
+
+uint32_t glacier::Texture::getIndex() const
+{
+	return m_Index;
+}
+
+void glacier::Texture::load(std::string_view path, const TextureInfo& info, TextureUploader& uploader)
+{
+	upload(decode(m_Application, path, FileSystem::read(path)), info, uploader);
+	watch(path, info);
+}
+
+TextureSource glacier::Texture::decode(const Application* application, std::string_view path, const FileContents& file)
+{
+	Ktx2Image image;
+	try
+	{
+		image = parseKtx2(file.data(), file.size());
+	}
+	catch (const std::exception& e)
+	{
+		throw std::runtime_error(fmt::format("Failed to load texture {}: {}", path, e.what()));
+	}
+
+	TextureSource source;
+	source.format = image.format;
+	source.width = image.width;
+	source.height = image.height;
+	source.owner = file.getOwner();
+
+	for (const Ktx2Image::Level& level : image.levels)
+		source.levels.push_back(TextureUploader::Level{ level.data, level.size });
+
+	/* Decode block-compressed formats the device can't sample */
+	VkFormatProperties formatProperties;
+	vkGetPhysicalDeviceFormatProperties(static_cast<VkPhysicalDevice>(application->m_PhysicalDevice), image.format, &formatProperties);
+
+	if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT))
+	{
+		source.format = getDecodedFormat(image.format);
+		if (source.format == VK_FORMAT_UNDEFINED)
+			throw std::runtime_error(fmt::format("Failed to load texture {}: the device can't sample format {}, and it can't be decoded on the CPU", path, static_cast<int>(image.format)));
+
+		g_Logger->debug("Decoding texture {} on the CPU, the device can't sample format {}", path, static_cast<int>(image.format));
+
+		size_t decodedSize = 0;
+		for (uint32_t i = 0; i < source.levels.size(); i++)
+			decodedSize += static_cast<size_t>(std::max(image.width >> i, 1u)) * std::max(image.height >> i, 1u) * 4;
+
+		// The decoded pixels replace the mapping as the data that has to outlive the upload
+		std::shared_ptr<std::vector<uint8_t>> pixels = std::make_shared<std::vector<uint8_t>>(decodedSize);
+		size_t offset = 0;
+
+		for (uint32_t i = 0; i < source.levels.size(); i++)
+		{
+			uint32_t width = std::max(image.width >> i, 1u);
+			uint32_t height = std::max(image.height >> i, 1u);
+
+			decodeBlocks(image.format, source.levels[i].data, width, height, pixels->data() + offset);
+			source.levels[i] = TextureUploader::Level{ pixels->data() + offset, static_cast<size_t>(width) * height * 4 };
+
+			offset += source.levels[i].size;
+		}
+
+		source.owner = pixels;
+	}
+
+	return source;
+}
+
+void glacier::Texture::upload(TextureSource source, const TextureInfo& info, TextureUploader& uploader)
+{
+	create(source.format, source.width, source.height, static_cast<uint32_t>(source.levels.size()), info);
+	uploader.add(static_cast<VkImage>(m_Image), m_Width, m_Height, m_MipLevels, std::move(source.levels), std::move(source.owner));
+}
+
+void glacier::Texture::watch(std::string_view path, const TextureInfo& info)
+{
+	if (!m_Application->m_Info.assetHotReload)
+		return;
+
+	// Archives can't change while they are mounted
+	std::string file = FileSystem::resolve(path);
+	if (file.empty())
+		return;
+
+	const Application* application = m_Application;
+	std::string name(path);
+
+	m_Application->m_AssetWatcher->watch(this, fmt::format("texture {}", name), { file }, [this, application, name, info]() -> std::function<void()>
+		{
+			FileSystem::invalidate(name);
+			std::shared_ptr<TextureSource> source = std::make_shared<TextureSource>(decode(application, name, FileSystem::read(name)));
+
+			return [this, source, info]()
+			{
+				reload(std::move(*source), info);
+			};
+		});
+}
+
+void glacier::Texture::reload(TextureSource source, const TextureInfo& info)
+{
+	TextureUploader uploader(static_cast<VkDevice>(m_Application->m_Device), static_cast<VkPhysicalDevice>(m_Application->m_PhysicalDevice));
+
+	Texture texture(m_Application);
+	texture.upload(std::move(source), info, uploader);
+	texture.m_LastUsage = submit(m_Application, uploader);
+
+	// The old image goes to the temporary texture, whose destructor releases it once the GPU is done with it
+	std::swap(m_Image, texture.m_Image);
+	std::swap(m_Memory, texture.m_Memory);
+	std::swap(m_ImageView, texture.m_ImageView);
+	std::swap(m_Sampler, texture.m_Sampler);
+	std::swap(m_Index, texture.m_Index);
+	std::swap(m_Format, texture.m_Format);
+	std::swap(m_Width, texture.m_Width);
+	std::swap(m_Height, texture.m_Height);
+	std::swap(m_MipLevels, texture.m_MipLevels);
+	std::swap(m_LastUsage, texture.m_LastUsage);
+}
+
+void glacier::Texture::create(uint32_t format, uint32_t width, uint32_t height, uint32_t levels, const TextureInfo& info)
+{
+	VkDevice device = static_cast<VkDevice>(m_Application->m_Device);
+	VkPhysicalDevice physicalDevice = static_cast<VkPhysicalDevice>(m_Application->m_PhysicalDevice);
+
+	m_Format = format;
+	m_Width = width;
+	m_Height = height;
+	m_MipLevels = levels;
+
+	/* Decide whether the rest of the mip chain is generated */
+	bool generate = false;
+	if (info.generateMips && levels == 1 && fullMipChain(width, height) > 1)
+	{
+		// Blits need linear filtering and both blit directions, which compressed formats never have
+		VkFormatFeatureFlags blitFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+
+		VkFormatProperties formatProperties;
+		vkGetPhysicalDeviceFormatProperties(physicalDevice, static_cast<VkFormat>(format), &formatProperties);
+
+		generate = (formatProperties.optimalTilingFeatures & blitFeatures) == blitFeatures;
+		if (generate)
+			m_MipLevels = fullMipChain(width, height);
+		else
+			g_Logger->warn("Texture format {} can't be blitted, only the stored mip levels are used", format);
+	}
+
+	/* Create the image in device-local memory */
+	VkImageCreateInfo imageCreateInfo = {};
+	imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageCreateInfo.format = static_cast<VkFormat>(format);
+	imageCreateInfo.extent = { width, height, 1 };
+	imageCreateInfo.mipLevels = m_MipLevels;
+	imageCreateInfo.arrayLayers = 1;
+	imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageCreateInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | (generate ? VK_IMAGE_USAGE_TRANSFER_SRC_BIT : 0);
+	imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	if (vkCreateImage(device, &imageCreateInfo, nullptr, reinterpret_cast<VkImage*>(&m_Image)) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create texture image");
+	}
+
+	VkMemoryRequirements memoryRequirements;
+	vkGetImageMemoryRequirements(device, static_cast<VkImage>(m_Image), &memoryRequirements);
+
+	VkMemoryAllocateInfo memoryAllocateInfo = {};
+	memoryAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	memoryAllocateInfo.allocationSize = memoryRequirements.size;
+	memoryAllocateInfo.memoryTypeIndex = findMemoryType(physicalDevice, memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	if (vkAllocateMemory(device, &memoryAllocateInfo, nullptr, reinterpret_cast<VkDeviceMemory*>(&m_Memory)) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to allocate memory for texture image");
+	}
+
+	vkBindImageMemory(device, static_cast<VkImage>(m_Image), static_cast<VkDeviceMemory>(m_Memory), 0);
+
+	/* Create the view */
+	VkImageViewCreateInfo imageViewCreateInfo = {};
+	imageViewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	imageViewCreateInfo.image = static_cast<VkImage>(m_Image);
+	imageViewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	imageViewCreateInfo.format = static_cast<VkFormat>(format);
+	imageViewCreateInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	imageViewCreateInfo.subresourceRange.baseMipLevel = 0;
+	imageViewCreateInfo.subresourceRange.levelCount = m_MipLevels;
+	imageViewCreateInfo.subresourceRange.baseArrayLayer = 0;
+	imageViewCreateInfo.subresourceRange.layerCount = 1;
+
+	if (vkCreateImageView(device, &imageViewCreateInfo, nullptr, reinterpret_cast<VkImageView*>(&m_ImageView)) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create texture image view");
+	}
+
+	/* Get the sampler */
+	VkFilter filter = info.filter == TextureFilter::Nearest ? VK_FILTER_NEAREST : VK_FILTER_LINEAR;
+	float anisotropy = std::min(info.anisotropy, m_Application->m_MaxAnisotropy);
+
+	VkSamplerCreateInfo samplerCreateInfo = {};
+	samplerCreateInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerCreateInfo.magFilter = filter;
+	samplerCreateInfo.minFilter = filter;
+	samplerCreateInfo.mipmapMode = info.filter == TextureFilter::Nearest ? VK_SAMPLER_MIPMAP_MODE_NEAREST : VK_SAMPLER_MIPMAP_MODE_LINEAR;
+	samplerCreateInfo.addressModeU = addressMode(info.wrap);
+	samplerCreateInfo.addressModeV = addressMode(info.wrap);
+	samplerCreateInfo.addressModeW = addressMode(info.wrap);
+	samplerCreateInfo.anisotropyEnable = anisotropy > 1.0f ? VK_TRUE : VK_FALSE;
+	samplerCreateInfo.maxAnisotropy = std::max(anisotropy, 1.0f);
+	samplerCreateInfo.minLod = 0.0f;
+	samplerCreateInfo.maxLod = VK_LOD_CLAMP_NONE;
+	samplerCreateInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+
+	m_Sampler = m_Application->m_SamplerCache->acquire(samplerCreateInfo);
+
+	// The descriptor can be written before the upload, no submission reads it until a draw is given its index
+	if (m_Application->m_BindlessHeap != nullptr)
+		m_Index = m_Application->m_BindlessHeap->addTexture(static_cast<VkImageView>(m_ImageView), static_cast<VkSampler>(m_Sampler));
+}
+
+uint64_t glacier::Texture::submit(const Application* application, TextureUploader& uploader)
+{
+	VkDevice device = static_cast<VkDevice>(application->m_Device);
+	VkCommandPool commandPool = static_cast<VkCommandPool>(application->m_Renderer->m_CommandPool);
+
+	uint64_t signalValue = ++application->m_TimelineValue;
+	TextureUploader::Submission submission = uploader.submit(commandPool, static_cast<VkQueue>(application->m_Renderer->m_GraphicsQueue), static_cast<VkSemaphore>(application->m_Timeline), signalValue);
+
+	// Only this upload is waited for rather than every frame still queued
+	waitTimeline(device, static_cast<VkSemaphore>(application->m_Timeline), signalValue);
+	TextureUploader::release(device, commandPool, submission);
+
+	return signalValue;
+}
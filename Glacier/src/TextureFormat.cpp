@@ -0,0 +1,543 @@
+#include "internal/TextureFormat.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include <spdlog/fmt/fmt.h>
+
+// Block layouts follow the BC sections of the Khronos Data Format Specification
+namespace
+{
+	/* Decoded 4x4 block, in row-major RGBA */
+	typedef uint8_t Block[16][4];
+
+	int divideRounded(int value, int divisor)
+	{
+		return (value + (value >= 0 ? divisor / 2 : -divisor / 2)) / divisor;
+	}
+
+	void expand565(uint16_t color, uint8_t* rgb)
+	{
+		uint32_t r = (color >> 11) & 0x1F;
+		uint32_t g = (color >> 5) & 0x3F;
+		uint32_t b = color & 0x1F;
+
+		rgb[0] = static_cast<uint8_t>((r << 3) | (r >> 2));
+		rgb[1] = static_cast<uint8_t>((g << 2) | (g >> 4));
+		rgb[2] = static_cast<uint8_t>((b << 3) | (b >> 2));
+	}
+
+	/**
+	 * @brief Decode the 8 byte colour block of BC1, BC2 and BC3
+	 * @param threeColor Whether c0 <= c1 selects the mode with a transparent black entry. Only BC1 has it.
+	 * @param opaque Whether the transparent entry is opaque, as it is for BC1 without alpha
+	*/
+	void decodeColor(const uint8_t* data, bool threeColor, bool opaque, Block& block)
+	{
+		uint16_t c0 = static_cast<uint16_t>(data[0] | (data[1] << 8));
+		uint16_t c1 = static_cast<uint16_t>(data[2] | (data[3] << 8));
+
+		uint8_t palette[4][4] = {};
+		expand565(c0, palette[0]);
+		expand565(c1, palette[1]);
+		palette[0][3] = 255;
+		palette[1][3] = 255;
+		palette[2][3] = 255;
+		palette[3][3] = 255;
+
+		if (c0 > c1 || !threeColor)
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				palette[2][c] = static_cast<uint8_t>(divideRounded(2 * palette[0][c] + palette[1][c], 3));
+				palette[3][c] = static_cast<uint8_t>(divideRounded(palette[0][c] + 2 * palette[1][c], 3));
+			}
+		}
+		else
+		{
+			for (int c = 0; c < 3; c++)
+				palette[2][c] = static_cast<uint8_t>((palette[0][c] + palette[1][c] + 1) / 2);
+
+			palette[3][3] = opaque ? 255 : 0;
+		}
+
+		uint32_t indices = data[4] | (data[5] << 8) | (data[6] << 16) | (static_cast<uint32_t>(data[7]) << 24);
+		for (int i = 0; i < 16; i++)
+			memcpy(block[i], palette[(indices >> (2 * i)) & 3], 4);
+	}
+
+	/**
+	 * @brief Decode the 8 byte single channel block of BC3 alpha, BC4 and BC5
+	 * @param channel The channel of the block to write
+	 * @param isSigned Whether the endpoints are signed, for the SNORM formats
+	*/
+	void decodeChannel(const uint8_t* data, int channel, bool isSigned, Block& block)
+	{
+		int palette[8];
+		palette[0] = isSigned ? std::max<int>(static_cast<int8_t>(data[0]), -127) : data[0];
+		palette[1] = isSigned ? std::max<int>(static_cast<int8_t>(data[1]), -127) : data[1];
+
+		if (palette[0] > palette[1])
+		{
+			for (int i = 1; i < 7; i++)
+				palette[i + 1] = divideRounded((7 - i) * palette[0] + i * palette[1], 7);
+		}
+		else
+		{
+			for (int i = 1; i < 5; i++)
+				palette[i + 1] = divideRounded((5 - i) * palette[0] + i * palette[1], 5);
+
+			palette[6] = isSigned ? -127 : 0;
+			palette[7] = isSigned ? 127 : 255;
+		}
+
+		uint64_t indices = 0;
+		for (int i = 0; i < 6; i++)
+			indices |= static_cast<uint64_t>(data[2 + i]) << (8 * i);
+
+		for (int i = 0; i < 16; i++)
+			block[i][channel] = static_cast<uint8_t>(palette[(indices >> (3 * i)) & 7]);
+	}
+
+	/**
+	 * @brief Reads a block least significant bit first
+	*/
+	class BitReader
+	{
+	public:
+		BitReader(const uint8_t* data)
+			: m_Data(data), m_Position(0)
+		{
+		}
+
+		uint32_t read(uint32_t count)
+		{
+			uint32_t value = 0;
+			for (uint32_t i = 0; i < count; i++, m_Position++)
+				value |= ((m_Data[m_Position >> 3] >> (m_Position & 7)) & 1u) << i;
+
+			return value;
+		}
+	private:
+		const uint8_t* m_Data;
+		uint32_t m_Position;
+	};
+
+	struct Bc7Mode
+	{
+		uint32_t subsets;
+		uint32_t partitionBits;
+		uint32_t rotationBits;
+		uint32_t indexSelectionBits;
+		uint32_t colorBits;
+		uint32_t alphaBits;
+		uint32_t endpointPBits;
+		uint32_t sharedPBits;
+		uint32_t indexBits;
+		uint32_t secondaryIndexBits;
+	};
+
+	constexpr Bc7Mode BC7_MODES[8] = {
+		{ 3, 4, 0, 0, 4, 0, 1, 0, 3, 0 },
+		{ 2, 6, 0, 0, 6, 0, 0, 1, 3, 0 },
+		{ 3, 6, 0, 0, 5, 0, 0, 0, 2, 0 },
+		{ 2, 6, 0, 0, 7, 0, 1, 0, 2, 0 },
+		{ 1, 0, 2, 1, 5, 6, 0, 0, 2, 3 },
+		{ 1, 0, 2, 0, 7, 8, 0, 0, 2, 2 },
+		{ 1, 0, 0, 0, 7, 7, 1, 0, 4, 0 },
+		{ 2, 6, 0, 0, 5, 5, 1, 0, 2, 0 }
+	};
+
+	/* Bit i is the subset of pixel i */
+	constexpr uint16_t BC7_PARTITIONS_2[64] = {
+		0xCCCC, 0x8888, 0xEEEE, 0xECC8, 0xC880, 0xFEEC, 0xFEC8, 0xEC80,
+		0xC800, 0xFFEC, 0xFE80, 0xE800, 0xFFE8, 0xFF00, 0xFFF0, 0xF000,
+		0xF710, 0x008E, 0x7100, 0x08CE, 0x008C, 0x7310, 0x3100, 0x8CCE,
+		0x088C, 0x3110, 0x6666, 0x366C, 0x17E8, 0x0FF0, 0x718E, 0x399C,
+		0xAAAA, 0xF0F0, 0x5A5A, 0x33CC, 0x3C3C, 0x55AA, 0x9696, 0xA55A,
+		0x73CE, 0x13C8, 0x324C, 0x3BDC, 0x6996, 0xC33C, 0x9966, 0x0660,
+		0x0272, 0x04E4, 0x4E40, 0x2720, 0xC936, 0x936C, 0x39C6, 0x639C,
+		0x9336, 0x9CC6, 0x817E, 0xE718, 0xCCF0, 0x0FCC, 0x7744, 0xEE22
+	};
+
+	constexpr uint8_t BC7_PARTITIONS_3[64][16] = {
+		{ 0, 0, 1, 1, 0, 0, 1, 1, 0, 2, 2, 1, 2, 2, 2, 2 }, { 0, 0, 0, 1, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2, 2, 1 },
+		{ 0, 0, 0, 0, 2, 0, 0, 1, 2, 2, 1, 1, 2, 2, 1, 1 }, { 0, 2, 2, 2, 0, 0, 2, 2, 0, 0, 1, 1, 0, 1, 1, 1 },
+		{ 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2 }, { 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 2, 2, 0, 0, 2, 2 },
+		{ 0, 0, 2, 2, 0, 0, 2, 2, 1, 1, 1, 1, 1, 1, 1, 1 }, { 0, 0, 1, 1, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1 },
+		{ 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2 }, { 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2 },
+		{ 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 2, 2 }, { 0, 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2 },
+		{ 0, 1, 1, 2, 0, 1, 1, 2, 0, 1, 1, 2, 0, 1, 1, 2 }, { 0, 1, 2, 2, 0, 1, 2, 2, 0, 1, 2, 2, 0, 1, 2, 2 },
+		{ 0, 0, 1, 1, 0, 1, 1, 2, 1, 1, 2, 2, 1, 2, 2, 2 }, { 0, 0, 1, 1, 2, 0, 0, 1, 2, 2, 0, 0, 2, 2, 2, 0 },
+		{ 0, 0, 0, 1, 0, 0, 1, 1, 0, 1, 1, 2, 1, 1, 2, 2 }, { 0, 1, 1, 1, 0, 0, 1, 1, 2, 0, 0, 1, 2, 2, 0, 0 },
+		{ 0, 0, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1, 2, 2 }, { 0, 0, 2, 2, 0, 0, 2, 2, 0, 0, 2, 2, 1, 1, 1, 1 },
+		{ 0, 1, 1, 1, 0, 1, 1, 1, 0, 2, 2, 2, 0, 2, 2, 2 }, { 0, 0, 0, 1, 0, 0, 0, 1, 2, 2, 2, 1, 2, 2, 2, 1 },
+		{ 0, 0, 0, 0, 0, 0, 1, 1, 0, 1, 2, 2, 0, 1, 2, 2 }, { 0, 0, 0, 0, 1, 1, 0, 0, 2, 2, 1, 0, 2, 2, 1, 0 },
+		{ 0, 1, 2, 2, 0, 1, 2, 2, 0, 0, 1, 1, 0, 0, 0, 0 }, { 0, 0, 1, 2, 0, 0, 1, 2, 1, 1, 2, 2, 2, 2, 2, 2 },
+		{ 0, 1, 1, 0, 1, 2, 2, 1, 1, 2, 2, 1, 0, 1, 1, 0 }, { 0, 0, 0, 0, 0, 1, 1, 0, 1, 2, 2, 1, 1, 2, 2, 1 },
+		{ 0, 0, 2, 2, 1, 1, 0, 2, 1, 1, 0, 2, 0, 0, 2, 2 }, { 0, 1, 1, 0, 0, 1, 1, 0, 2, 0, 0, 2, 2, 2, 2, 2 },
+		{ 0, 0, 1, 1, 0, 1, 2, 2, 0, 1, 2, 2, 0, 0, 1, 1 }, { 0, 0, 0, 0, 2, 0, 0, 0, 2, 2, 1, 1, 2, 2, 2, 1 },
+		{ 0, 0, 0, 0, 0, 0, 0, 2, 1, 1, 2, 2, 1, 2, 2, 2 }, { 0, 2, 2, 2, 0, 0, 2, 2, 0, 0, 1, 2, 0, 0, 1, 1 },
+		{ 0, 0, 1, 1, 0, 0, 1, 2, 0, 0, 2, 2, 0, 2, 2, 2 }, { 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2, 0 },
+		{ 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 0, 0, 0, 0 }, { 0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0 },
+		{ 0, 1, 2, 0, 2, 0, 1, 2, 1, 2, 0, 1, 0, 1, 2, 0 }, { 0, 0, 1, 1, 2, 2, 0, 0, 1, 1, 2, 2, 0, 0, 1, 1 },
+		{ 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 0, 0, 0, 0, 1, 1 }, { 0, 1, 0, 1, 0, 1, 0, 1, 2, 2, 2, 2, 2, 2, 2, 2 },
+		{ 0, 0, 0, 0, 0, 0, 0, 0, 2, 1, 2, 1, 2, 1, 2, 1 }, { 0, 0, 2, 2, 1, 1, 2, 2, 0, 0, 2, 2, 1, 1, 2, 2 },
+		{ 0, 0, 2, 2, 0, 0, 1, 1, 0, 0, 2, 2, 0, 0, 1, 1 }, { 0, 2, 2, 0, 1, 2, 2, 1, 0, 2, 2, 0, 1, 2, 2, 1 },
+		{ 0, 1, 0, 1, 2, 2, 2, 2, 2, 2, 2, 2, 0, 1, 0, 1 }, { 0, 0, 0, 0, 2, 1, 2, 1, 2, 1, 2, 1, 2, 1, 2, 1 },
+		{ 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 2, 2, 2, 2 }, { 0, 2, 2, 2, 0, 1, 1, 1, 0, 2, 2, 2, 0, 1, 1, 1 },
+		{ 0, 0, 0, 2, 1, 1, 1, 2, 0, 0, 0, 2, 1, 1, 1, 2 }, { 0, 0, 0, 0, 2, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1, 2 },
+		{ 0, 2, 2, 2, 0, 1, 1, 1, 0, 1, 1, 1, 0, 2, 2, 2 }, { 0, 0, 0, 2, 1, 1, 1, 2, 1, 1, 1, 2, 0, 0, 0, 2 },
+		{ 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 2, 2, 2, 2 }, { 0, 0, 0, 0, 0, 0, 0, 0, 2, 1, 1, 2, 2, 1, 1, 2 },
+		{ 0, 1, 1, 0, 0, 1, 1, 0, 2, 2, 2, 2, 2, 2, 2, 2 }, { 0, 0, 2, 2, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 2, 2 },
+		{ 0, 0, 2, 2, 1, 1, 2, 2, 1, 1, 2, 2, 0, 0, 2, 2 }, { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 1, 1, 2 },
+		{ 0, 0, 0, 2, 0, 0, 0, 1, 0, 0, 0, 2, 0, 0, 0, 1 }, { 0, 2, 2, 2, 1, 2, 2, 2, 0, 2, 2, 2, 1, 2, 2, 2 },
+		{ 0, 1, 0, 1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2 }, { 0, 1, 1, 1, 2, 0, 1, 1, 2, 2, 0, 1, 2, 2, 2, 0 }
+	};
+
+	/* Pixel whose index drops its top bit, for the second subset of two and the second and third subset of three. The first subset's is always pixel 0. */
+	constexpr uint8_t BC7_ANCHORS_2[64] = {
+		15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+		15, 2, 8, 2, 2, 8, 8, 15, 2, 8, 2, 2, 8, 8, 2, 2,
+		15, 15, 6, 8, 2, 8, 15, 15, 2, 8, 2, 2, 2, 15, 15, 6,
+		6, 2, 6, 8, 15, 15, 2, 2, 15, 15, 15, 15, 15, 2, 2, 15
+	};
+
+	constexpr uint8_t BC7_ANCHORS_3_SECOND[64] = {
+		3, 3, 15, 15, 8, 3, 15, 15, 8, 8, 6, 6, 6, 5, 3, 3,
+		3, 3, 8, 15, 3, 3, 6, 10, 5, 8, 8, 6, 8, 5, 15, 15,
+		8, 15, 3, 5, 6, 10, 8, 15, 15, 3, 15, 5, 15, 15, 15, 15,
+		3, 15, 5, 5, 5, 8, 5, 10, 5, 10, 8, 13, 15, 12, 3, 3
+	};
+
+	constexpr uint8_t BC7_ANCHORS_3_THIRD[64] = {
+		15, 8, 8, 3, 15, 15, 3, 8, 15, 15, 15, 15, 15, 15, 15, 8,
+		15, 8, 15, 3, 15, 8, 15, 8, 3, 15, 6, 10, 15, 15, 10, 8,
+		15, 3, 15, 10, 10, 8, 9, 10, 6, 15, 8, 15, 3, 6, 6, 8,
+		15, 3, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 3, 15, 15, 8
+	};
+
+	constexpr uint32_t BC7_WEIGHTS_2[4] = { 0, 21, 43, 64 };
+	constexpr uint32_t BC7_WEIGHTS_3[8] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+	constexpr uint32_t BC7_WEIGHTS_4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	uint8_t interpolateBc7(uint32_t e0, uint32_t e1, uint32_t index, uint32_t indexBits)
+	{
+		const uint32_t* weights = indexBits == 2 ? BC7_WEIGHTS_2 : indexBits == 3 ? BC7_WEIGHTS_3 : BC7_WEIGHTS_4;
+		return static_cast<uint8_t>(((64 - weights[index]) * e0 + weights[index] * e1 + 32) >> 6);
+	}
+
+	void decodeBc7(const uint8_t* data, Block& block)
+	{
+		uint32_t mode = 0;
+		while (mode < 8 && !(data[0] & (1u << mode)))
+			mode++;
+
+		// Reserved mode, decoders output transparent black
+		if (mode == 8)
+		{
+			memset(block, 0, sizeof(Block));
+			return;
+		}
+
+		const Bc7Mode& info = BC7_MODES[mode];
+
+		BitReader bits(data);
+		bits.read(mode + 1);
+
+		uint32_t partition = bits.read(info.partitionBits);
+		uint32_t rotation = bits.read(info.rotationBits);
+		uint32_t indexSelection = bits.read(info.indexSelectionBits);
+
+		/* Endpoints, stored channel by channel */
+		uint32_t endpoints[6][4] = {};
+		uint32_t endpointCount = info.subsets * 2;
+
+		for (uint32_t c = 0; c < 3; c++)
+		{
+			for (uint32_t e = 0; e < endpointCount; e++)
+				endpoints[e][c] = bits.read(info.colorBits);
+		}
+
+		for (uint32_t e = 0; e < endpointCount; e++)
+			endpoints[e][3] = bits.read(info.alphaBits);
+
+		/* P-bits add a shared lowest bit */
+		uint32_t colorPrecision = info.colorBits;
+		uint32_t alphaPrecision = info.alphaBits;
+
+		if (info.endpointPBits || info.sharedPBits)
+		{
+			uint32_t pBits[6];
+			for (uint32_t e = 0; e < endpointCount; e++)
+				pBits[e] = info.endpointPBits ? bits.read(1) : (e % 2 == 0 ? bits.read(1) : pBits[e - 1]);
+
+			for (uint32_t e = 0; e < endpointCount; e++)
+			{
+				for (uint32_t c = 0; c < 3; c++)
+					endpoints[e][c] = (endpoints[e][c] << 1) | pBits[e];
+
+				if (info.alphaBits)
+					endpoints[e][3] = (endpoints[e][3] << 1) | pBits[e];
+			}
+
+			colorPrecision++;
+			if (info.alphaBits)
+				alphaPrecision++;
+		}
+
+		/* Expand to 8 bits by repeating the top bits */
+		for (uint32_t e = 0; e < endpointCount; e++)
+		{
+			for (uint32_t c = 0; c < 3; c++)
+				endpoints[e][c] = (endpoints[e][c] << (8 - colorPrecision)) | (endpoints[e][c] >> (2 * colorPrecision - 8));
+
+			endpoints[e][3] = info.alphaBits ? (endpoints[e][3] << (8 - alphaPrecision)) | (endpoints[e][3] >> (2 * alphaPrecision - 8)) : 255;
+		}
+
+		/* Subsets and anchors */
+		uint32_t subsets[16];
+		bool anchors[16] = { true };
+
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			if (info.subsets == 2)
+				subsets[i] = (BC7_PARTITIONS_2[partition] >> i) & 1;
+			else if (info.subsets == 3)
+				subsets[i] = BC7_PARTITIONS_3[partition][i];
+			else
+				subsets[i] = 0;
+		}
+
+		if (info.subsets == 2)
+		{
+			anchors[BC7_ANCHORS_2[partition]] = true;
+		}
+		else if (info.subsets == 3)
+		{
+			anchors[BC7_ANCHORS_3_SECOND[partition]] = true;
+			anchors[BC7_ANCHORS_3_THIRD[partition]] = true;
+		}
+
+		/* Indices, anchors drop their implicit top bit */
+		uint32_t indices[16];
+		for (uint32_t i = 0; i < 16; i++)
+			indices[i] = bits.read(info.indexBits - (anchors[i] ? 1 : 0));
+
+		uint32_t secondaryIndices[16] = {};
+		if (info.secondaryIndexBits)
+		{
+			for (uint32_t i = 0; i < 16; i++)
+				secondaryIndices[i] = bits.read(info.secondaryIndexBits - (i == 0 ? 1 : 0));
+		}
+
+		/* Interpolate */
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			const uint32_t* e0 = endpoints[subsets[i] * 2];
+			const uint32_t* e1 = endpoints[subsets[i] * 2 + 1];
+
+			uint32_t colorIndex = indices[i];
+			uint32_t colorIndexBits = info.indexBits;
+			uint32_t alphaIndex = indices[i];
+			uint32_t alphaIndexBits = info.indexBits;
+
+			// Modes 4 and 5 have a second set of indices for alpha, mode 4 can swap them
+			if (info.secondaryIndexBits)
+			{
+				if (indexSelection)
+				{
+					colorIndex = secondaryIndices[i];
+					colorIndexBits = info.secondaryIndexBits;
+				}
+				else
+				{
+					alphaIndex = secondaryIndices[i];
+					alphaIndexBits = info.secondaryIndexBits;
+				}
+			}
+
+			for (uint32_t c = 0; c < 3; c++)
+				block[i][c] = interpolateBc7(e0[c], e1[c], colorIndex, colorIndexBits);
+
+			block[i][3] = interpolateBc7(e0[3], e1[3], alphaIndex, alphaIndexBits);
+
+			if (rotation != 0)
+				std::swap(block[i][3], block[i][rotation - 1]);
+		}
+	}
+
+	void decodeBlock(VkFormat format, const uint8_t* data, Block& block)
+	{
+		switch (format)
+		{
+		case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+		case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+			decodeColor(data, true, true, block);
+			break;
+		case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+		case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+			decodeColor(data, true, false, block);
+			break;
+		case VK_FORMAT_BC2_UNORM_BLOCK:
+		case VK_FORMAT_BC2_SRGB_BLOCK:
+			decodeColor(data + 8, false, true, block);
+			for (int i = 0; i < 16; i++)
+				block[i][3] = static_cast<uint8_t>(((data[i / 2] >> (4 * (i % 2))) & 0xF) * 17);
+			break;
+		case VK_FORMAT_BC3_UNORM_BLOCK:
+		case VK_FORMAT_BC3_SRGB_BLOCK:
+			decodeColor(data + 8, false, true, block);
+			decodeChannel(data, 3, false, block);
+			break;
+		case VK_FORMAT_BC4_UNORM_BLOCK:
+		case VK_FORMAT_BC4_SNORM_BLOCK:
+		{
+			bool isSigned = format == VK_FORMAT_BC4_SNORM_BLOCK;
+			memset(block, 0, sizeof(Block));
+			decodeChannel(data, 0, isSigned, block);
+			for (int i = 0; i < 16; i++)
+				block[i][3] = isSigned ? 127 : 255;
+			break;
+		}
+		case VK_FORMAT_BC5_UNORM_BLOCK:
+		case VK_FORMAT_BC5_SNORM_BLOCK:
+		{
+			bool isSigned = format == VK_FORMAT_BC5_SNORM_BLOCK;
+			memset(block, 0, sizeof(Block));
+			decodeChannel(data, 0, isSigned, block);
+			decodeChannel(data + 8, 1, isSigned, block);
+			for (int i = 0; i < 16; i++)
+				block[i][3] = isSigned ? 127 : 255;
+			break;
+		}
+		case VK_FORMAT_BC7_UNORM_BLOCK:
+		case VK_FORMAT_BC7_SRGB_BLOCK:
+			decodeBc7(data, block);
+			break;
+		default:
+			throw std::runtime_error(fmt::format("Cannot decode texture format {} on the CPU", static_cast<int>(format)));
+		}
+	}
+}
+
+bool getTexelBlock(VkFormat format, TexelBlock& block)
+{
+	switch (format)
+	{
+	case VK_FORMAT_R8_UNORM:
+		block = { 1, 1 };
+		return true;
+	case VK_FORMAT_R8G8_UNORM:
+	case VK_FORMAT_R16_SFLOAT:
+		block = { 2, 1 };
+		return true;
+	case VK_FORMAT_R8G8B8A8_UNORM:
+	case VK_FORMAT_R8G8B8A8_SNORM:
+	case VK_FORMAT_R8G8B8A8_SRGB:
+	case VK_FORMAT_B8G8R8A8_UNORM:
+	case VK_FORMAT_B8G8R8A8_SRGB:
+	case VK_FORMAT_A2B10G10R10_UNORM_PACK32:
+	case VK_FORMAT_B10G11R11_UFLOAT_PACK32:
+	case VK_FORMAT_E5B9G9R9_UFLOAT_PACK32:
+	case VK_FORMAT_R16G16_SFLOAT:
+	case VK_FORMAT_R32_SFLOAT:
+		block = { 4, 1 };
+		return true;
+	case VK_FORMAT_R16G16B16A16_SFLOAT:
+	case VK_FORMAT_R32G32_SFLOAT:
+		block = { 8, 1 };
+		return true;
+	case VK_FORMAT_R32G32B32A32_SFLOAT:
+		block = { 16, 1 };
+		return true;
+	case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+	case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+	case VK_FORMAT_BC4_UNORM_BLOCK:
+	case VK_FORMAT_BC4_SNORM_BLOCK:
+		block = { 8, 4 };
+		return true;
+	case VK_FORMAT_BC2_UNORM_BLOCK:
+	case VK_FORMAT_BC2_SRGB_BLOCK:
+	case VK_FORMAT_BC3_UNORM_BLOCK:
+	case VK_FORMAT_BC3_SRGB_BLOCK:
+	case VK_FORMAT_BC5_UNORM_BLOCK:
+	case VK_FORMAT_BC5_SNORM_BLOCK:
+	case VK_FORMAT_BC6H_UFLOAT_BLOCK:
+	case VK_FORMAT_BC6H_SFLOAT_BLOCK:
+	case VK_FORMAT_BC7_UNORM_BLOCK:
+	case VK_FORMAT_BC7_SRGB_BLOCK:
+		block = { 16, 4 };
+		return true;
+	default:
+		return false;
+	}
+}
+
+size_t getImageSize(const TexelBlock& block, uint32_t width, uint32_t height)
+{
+	size_t blocksX = (width + block.extent - 1) / block.extent;
+	size_t blocksY = (height + block.extent - 1) / block.extent;
+
+	return blocksX * blocksY * block.size;
+}
+
+VkFormat getDecodedFormat(VkFormat format)
+{
+	switch (format)
+	{
+	case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+	case VK_FORMAT_BC2_UNORM_BLOCK:
+	case VK_FORMAT_BC3_UNORM_BLOCK:
+	case VK_FORMAT_BC4_UNORM_BLOCK:
+	case VK_FORMAT_BC5_UNORM_BLOCK:
+	case VK_FORMAT_BC7_UNORM_BLOCK:
+		return VK_FORMAT_R8G8B8A8_UNORM;
+	case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+	case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+	case VK_FORMAT_BC2_SRGB_BLOCK:
+	case VK_FORMAT_BC3_SRGB_BLOCK:
+	case VK_FORMAT_BC7_SRGB_BLOCK:
+		return VK_FORMAT_R8G8B8A8_SRGB;
+	case VK_FORMAT_BC4_SNORM_BLOCK:
+	case VK_FORMAT_BC5_SNORM_BLOCK:
+		return VK_FORMAT_R8G8B8A8_SNORM;
+	default:
+		// BC6H is HDR and has no 8-bit equivalent
+		return VK_FORMAT_UNDEFINED;
+	}
+}
+
+void decodeBlocks(VkFormat format, const void* blocks, uint32_t width, uint32_t height, void* pixels)
+{
+	TexelBlock texelBlock;
+	if (!getTexelBlock(format, texelBlock) || texelBlock.extent != 4)
+		throw std::runtime_error(fmt::format("Texture format {} is not block-compressed", static_cast<int>(format)));
+
+	const uint8_t* src = static_cast<const uint8_t*>(blocks);
+	uint8_t* dst = static_cast<uint8_t*>(pixels);
+
+	uint32_t blocksX = (width + 3) / 4;
+	uint32_t blocksY = (height + 3) / 4;
+
+	Block block;
+	for (uint32_t by = 0; by < blocksY; by++)
+	{
+		for (uint32_t bx = 0; bx < blocksX; bx++)
+		{
+			decodeBlock(format, src, block);
+			src += texelBlock.size;
+
+			// Blocks on the right and bottom edge may hang over the image
+			uint32_t columns = std::min(4u, width - bx * 4);
+			uint32_t rows = std::min(4u, height - by * 4);
+
+			for (uint32_t y = 0; y < rows; y++)
+				memcpy(dst + ((static_cast<size_t>(by) * 4 + y) * width + bx * 4) * 4, block[y * 4], columns * 4);
+		}
+	}
+}
@@ -0,0 +1,241 @@
+#include "internal/TextureUploader.hpp"
+#include "internal/utility.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	/* Copy offsets must be a multiple of the texel block size, which is at most 16 bytes */
+	constexpr VkDeviceSize STAGING_ALIGNMENT = 16;
+
+	VkImageMemoryBarrier imageBarrier(VkImage image, uint32_t baseLevel, uint32_t levelCount, VkImageLayout oldLayout, VkImageLayout newLayout, VkAccessFlags srcAccess, VkAccessFlags dstAccess)
+	{
+		VkImageMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.srcAccessMask = srcAccess;
+		barrier.dstAccessMask = dstAccess;
+		barrier.oldLayout = oldLayout;
+		barrier.newLayout = newLayout;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = image;
+		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		barrier.subresourceRange.baseMipLevel = baseLevel;
+		barrier.subresourceRange.levelCount = levelCount;
+		barrier.subresourceRange.baseArrayLayer = 0;
+		barrier.subresourceRange.layerCount = 1;
+
+		return barrier;
+	}
+
+	uint32_t levelExtent(uint32_t extent, uint32_t level)
+	{
+		return std::max(extent >> level, 1u);
+	}
+}
+
+TextureUploader::TextureUploader(VkDevice device, VkPhysicalDevice physicalDevice)
+	: m_Device(device), m_PhysicalDevice(physicalDevice)
+{
+}
+
+void TextureUploader::add(VkImage image, uint32_t width, uint32_t height, uint32_t mipLevels, std::vector<Level> levels, std::shared_ptr<const void> owner)
+{
+	m_Uploads.push_back(Upload{ image, width, height, mipLevels, std::move(levels), std::move(owner) });
+}
+
+void TextureUploader::addBuffer(VkBuffer buffer, const void* data, size_t size, std::shared_ptr<const void> owner)
+{
+	m_BufferUploads.push_back(BufferUpload{ buffer, data, size, std::move(owner) });
+}
+
+TextureUploader::Submission TextureUploader::submit(VkCommandPool commandPool, VkQueue queue, VkSemaphore timeline, uint64_t signalValue)
+{
+	if (m_Uploads.empty() && m_BufferUploads.empty())
+		return Submission();
+
+	/* Lay every level and buffer out in one staging buffer */
+	std::vector<std::vector<VkDeviceSize>> offsets(m_Uploads.size());
+	std::vector<VkDeviceSize> bufferOffsets;
+	VkDeviceSize stagingSize = 0;
+
+	for (size_t i = 0; i < m_Uploads.size(); i++)
+	{
+		for (const Level& level : m_Uploads[i].levels)
+		{
+			stagingSize = (stagingSize + STAGING_ALIGNMENT - 1) / STAGING_ALIGNMENT * STAGING_ALIGNMENT;
+			offsets[i].push_back(stagingSize);
+			stagingSize += level.size;
+		}
+	}
+
+	for (const BufferUpload& upload : m_BufferUploads)
+	{
+		stagingSize = (stagingSize + STAGING_ALIGNMENT - 1) / STAGING_ALIGNMENT * STAGING_ALIGNMENT;
+		bufferOffsets.push_back(stagingSize);
+		stagingSize += upload.size;
+	}
+
+	VkBuffer stagingBuffer;
+	VkDeviceMemory stagingBufferMemory;
+	createBuffer(m_Device, m_PhysicalDevice, stagingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &stagingBuffer, &stagingBufferMemory);
+
+	// Mapped files are paged in by this copy, so the file contents go straight from the page cache to the staging memory
+	void* tmp;
+	vkMapMemory(m_Device, stagingBufferMemory, 0, stagingSize, 0, &tmp);
+
+	for (size_t i = 0; i < m_Uploads.size(); i++)
+	{
+		for (size_t j = 0; j < m_Uploads[i].levels.size(); j++)
+			memcpy(static_cast<char*>(tmp) + offsets[i][j], m_Uploads[i].levels[j].data, m_Uploads[i].levels[j].size);
+	}
+
+	for (size_t i = 0; i < m_BufferUploads.size(); i++)
+		memcpy(static_cast<char*>(tmp) + bufferOffsets[i], m_BufferUploads[i].data, m_BufferUploads[i].size);
+
+	vkUnmapMemory(m_Device, stagingBufferMemory);
+
+	/* Record the copies */
+	VkCommandBufferAllocateInfo commandBufferAllocateInfo = {};
+	commandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	commandBufferAllocateInfo.commandPool = commandPool;
+	commandBufferAllocateInfo.commandBufferCount = 1;
+
+	VkCommandBuffer commandBuffer;
+	vkAllocateCommandBuffers(m_Device, &commandBufferAllocateInfo, &commandBuffer);
+
+	VkCommandBufferBeginInfo commandBufferBeginInfo = {};
+	commandBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	vkBeginCommandBuffer(commandBuffer, &commandBufferBeginInfo);
+
+	std::vector<VkImageMemoryBarrier> barriers;
+	for (const Upload& upload : m_Uploads)
+		barriers.push_back(imageBarrier(upload.image, 0, upload.mipLevels, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, VK_ACCESS_TRANSFER_WRITE_BIT));
+
+	if (!barriers.empty())
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
+
+	for (size_t i = 0; i < m_Uploads.size(); i++)
+	{
+		const Upload& upload = m_Uploads[i];
+
+		std::vector<VkBufferImageCopy> regions;
+		for (uint32_t level = 0; level < upload.levels.size(); level++)
+		{
+			VkBufferImageCopy region = {};
+			region.bufferOffset = offsets[i][level];
+			region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			region.imageSubresource.mipLevel = level;
+			region.imageSubresource.baseArrayLayer = 0;
+			region.imageSubresource.layerCount = 1;
+			region.imageExtent = { levelExtent(upload.width, level), levelExtent(upload.height, level), 1 };
+
+			regions.push_back(region);
+		}
+
+		vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, upload.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(regions.size()), regions.data());
+	}
+
+	/* Generate the missing levels, then make everything readable by shaders */
+	barriers.clear();
+	for (const Upload& upload : m_Uploads)
+	{
+		uint32_t givenLevels = static_cast<uint32_t>(upload.levels.size());
+
+		if (givenLevels >= upload.mipLevels)
+		{
+			barriers.push_back(imageBarrier(upload.image, 0, upload.mipLevels, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT));
+			continue;
+		}
+
+		recordMipGeneration(commandBuffer, upload);
+
+		if (givenLevels > 1)
+			barriers.push_back(imageBarrier(upload.image, 0, givenLevels - 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT));
+
+		barriers.push_back(imageBarrier(upload.image, givenLevels - 1, upload.mipLevels - givenLevels, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_SHADER_READ_BIT));
+		barriers.push_back(imageBarrier(upload.image, upload.mipLevels - 1, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT));
+	}
+
+	if (!barriers.empty())
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
+
+	/* Copy the buffers, then make them readable by vertex and index fetches */
+	for (size_t i = 0; i < m_BufferUploads.size(); i++)
+	{
+		VkBufferCopy region = { bufferOffsets[i], 0, m_BufferUploads[i].size };
+		vkCmdCopyBuffer(commandBuffer, stagingBuffer, m_BufferUploads[i].buffer, 1, &region);
+	}
+
+	if (!m_BufferUploads.empty())
+	{
+		VkMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+	}
+
+	vkEndCommandBuffer(commandBuffer);
+
+	// Signal the timeline, so the caller can tell when this upload is done without waiting for every frame still queued
+	VkTimelineSemaphoreSubmitInfo timelineSubmitInfo = {};
+	timelineSubmitInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	timelineSubmitInfo.signalSemaphoreValueCount = 1;
+	timelineSubmitInfo.pSignalSemaphoreValues = &signalValue;
+
+	VkSubmitInfo submitInfo = {};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.pNext = &timelineSubmitInfo;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+	submitInfo.signalSemaphoreCount = 1;
+	submitInfo.pSignalSemaphores = &timeline;
+
+	vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE);
+
+	m_Uploads.clear();
+	m_BufferUploads.clear();
+
+	return Submission{ commandBuffer, stagingBuffer, stagingBufferMemory };
+}
+
+void TextureUploader::release(VkDevice device, VkCommandPool commandPool, const Submission& submission)
+{
+	if (submission.commandBuffer == VK_NULL_HANDLE)
+		return;
+
+	vkFreeCommandBuffers(device, commandPool, 1, &submission.commandBuffer);
+
+	vkDestroyBuffer(device, submission.stagingBuffer, nullptr);
+	vkFreeMemory(device, submission.stagingMemory, nullptr);
+}
+
+void TextureUploader::recordMipGeneration(VkCommandBuffer commandBuffer, const Upload& upload)
+{
+	// Each level is filtered from the one before it, which has to be finished and readable first
+	for (uint32_t level = static_cast<uint32_t>(upload.levels.size()); level < upload.mipLevels; level++)
+	{
+		VkImageMemoryBarrier barrier = imageBarrier(upload.image, level - 1, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+		VkImageBlit blit = {};
+		blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		blit.srcSubresource.mipLevel = level - 1;
+		blit.srcSubresource.baseArrayLayer = 0;
+		blit.srcSubresource.layerCount = 1;
+		blit.srcOffsets[1] = { static_cast<int32_t>(levelExtent(upload.width, level - 1)), static_cast<int32_t>(levelExtent(upload.height, level - 1)), 1 };
+		blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		blit.dstSubresource.mipLevel = level;
+		blit.dstSubresource.baseArrayLayer = 0;
+		blit.dstSubresource.layerCount = 1;
+		blit.dstOffsets[1] = { static_cast<int32_t>(levelExtent(upload.width, level)), static_cast<int32_t>(levelExtent(upload.height, level)), 1 };
+
+		vkCmdBlitImage(commandBuffer, upload.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, upload.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+	}
+}
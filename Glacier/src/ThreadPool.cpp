@@ -0,0 +1,192 @@
+#include "internal/ThreadPool.hpp"
+
+#include <algorithm>
+
+ThreadPool::Job::Job(std::function<void()> function)
+	: m_Function(std::move(function)), m_Exception(nullptr), m_Claimed(false), m_Done(false)
+{
+}
+
+bool ThreadPool::Job::isDone() const
+{
+	return m_Done.load(std::memory_order_acquire);
+}
+
+bool ThreadPool::Job::hasFailed() const
+{
+	return isDone() && m_Exception != nullptr;
+}
+
+void ThreadPool::Job::wait()
+{
+	if (!tryRun())
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		m_Condition.wait(lock, [this]() { return m_Done.load(std::memory_order_acquire); });
+	}
+
+	if (m_Exception)
+		std::rethrow_exception(m_Exception);
+}
+
+bool ThreadPool::Job::cancel()
+{
+	bool expected = false;
+	if (!m_Claimed.compare_exchange_strong(expected, true))
+		return false;
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Done.store(true, std::memory_order_release);
+	}
+
+	m_Condition.notify_all();
+	return true;
+}
+
+bool ThreadPool::Job::tryRun()
+{
+	bool expected = false;
+	if (!m_Claimed.compare_exchange_strong(expected, true))
+		return false;
+
+	try
+	{
+		m_Function();
+	}
+	catch (...)
+	{
+		m_Exception = std::current_exception();
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Done.store(true, std::memory_order_release);
+	}
+
+	m_Condition.notify_all();
+	return true;
+}
+
+ThreadPool::ThreadPool(unsigned int threadCount)
+	: m_Stopping(false)
+{
+	// Leave one hardware thread for the main thread. The count is 0 when it can't be determined.
+	if (threadCount == 0)
+	{
+		unsigned int hardwareThreads = std::thread::hardware_concurrency();
+		threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+	}
+
+	for (unsigned int i = 0; i < threadCount; i++)
+		m_Threads.emplace_back(&ThreadPool::work, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Stopping = true;
+	}
+
+	m_Condition.notify_all();
+
+	for (std::thread& thread : m_Threads)
+		thread.join();
+
+	for (const std::shared_ptr<Job>& job : m_PriorityQueue)
+		job->cancel();
+
+	for (const std::shared_ptr<Job>& job : m_Queue)
+		job->cancel();
+}
+
+void ThreadPool::submit(const std::shared_ptr<Job>& job, bool priority)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		if (priority)
+			m_PriorityQueue.push_back(job);
+		else
+			m_Queue.push_back(job);
+	}
+
+	m_Condition.notify_one();
+}
+
+void ThreadPool::prioritize(const std::shared_ptr<Job>& job)
+{
+	if (job->m_Claimed.load(std::memory_order_relaxed))
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		if (std::find(m_PriorityQueue.begin(), m_PriorityQueue.end(), job) != m_PriorityQueue.end())
+			return;
+
+		m_PriorityQueue.push_back(job);
+	}
+
+	m_Condition.notify_one();
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& function)
+{
+	std::vector<std::shared_ptr<Job>> jobs;
+	jobs.reserve(count);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		jobs.push_back(std::make_shared<Job>([&function, i]() { function(i); }));
+		submit(jobs.back());
+	}
+
+	// Workers take jobs from the front, so waiting from the back lets the calling thread run the jobs nobody has started yet
+	std::exception_ptr exception = nullptr;
+	for (std::vector<std::shared_ptr<Job>>::reverse_iterator job = jobs.rbegin(); job != jobs.rend(); job++)
+	{
+		// Every job has to finish before returning, they reference the caller's data
+		try
+		{
+			(*job)->wait();
+		}
+		catch (...)
+		{
+			if (!exception)
+				exception = std::current_exception();
+		}
+	}
+
+	if (exception)
+		std::rethrow_exception(exception);
+}
+
+size_t ThreadPool::getThreadCount() const
+{
+	return m_Threads.size();
+}
+
+void ThreadPool::work()
+{
+	while (true)
+	{
+		std::shared_ptr<Job> job;
+
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_Condition.wait(lock, [this]() { return m_Stopping || !m_PriorityQueue.empty() || !m_Queue.empty(); });
+
+			if (m_Stopping)
+				return;
+
+			std::deque<std::shared_ptr<Job>>& queue = m_PriorityQueue.empty() ? m_Queue : m_PriorityQueue;
+			job = std::move(queue.front());
+			queue.pop_front();
+		}
+
+		// Already run by a waiting thread, or through its other queue entry
+		job->tryRun();
+	}
+}
@@ -2,77 +2,261 @@
 #include "Application.hpp"
 #include "Renderer.hpp"
 #include "internal/utility.hpp"
+#include "internal/DeletionQueue.hpp"
+#include "internal/TextureUploader.hpp"
 
+#include <atomic>
+#include <cstring>
 #include <stdexcept>
 #include <vector>
 #include <vulkan/vulkan.h>
 
+#include <spdlog/spdlog.h>
+
+static std::atomic<uint32_t> s_NextVertexBufferId(0);
+
+namespace
+{
+	struct ElementFormats
+	{
+		glacier::VertexBufferElement element;
+
+		/* Indexed by component count - 1 */
+		VkFormat formats[4];
+	};
+
+	constexpr ElementFormats s_ElementFormats[] = {
+		{ glacier::VertexBufferElement::Float, { VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT } },
+		{ glacier::VertexBufferElement::Int, { VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT } },
+		{ glacier::VertexBufferElement::UnsignedInt, { VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT } },
+		{ glacier::VertexBufferElement::Byte, { VK_FORMAT_R8_SINT, VK_FORMAT_R8G8_SINT, VK_FORMAT_R8G8B8_SINT, VK_FORMAT_R8G8B8A8_SINT } },
+		{ glacier::VertexBufferElement::UnsignedByte, { VK_FORMAT_R8_UINT, VK_FORMAT_R8G8_UINT, VK_FORMAT_R8G8B8_UINT, VK_FORMAT_R8G8B8A8_UINT } },
+		{ glacier::VertexBufferElement::Half, { VK_FORMAT_R16_SFLOAT, VK_FORMAT_R16G16_SFLOAT, VK_FORMAT_R16G16B16_SFLOAT, VK_FORMAT_R16G16B16A16_SFLOAT } },
+		{ glacier::VertexBufferElement::ByteNormalized, { VK_FORMAT_R8_SNORM, VK_FORMAT_R8G8_SNORM, VK_FORMAT_R8G8B8_SNORM, VK_FORMAT_R8G8B8A8_SNORM } },
+		{ glacier::VertexBufferElement::UnsignedByteNormalized, { VK_FORMAT_R8_UNORM, VK_FORMAT_R8G8_UNORM, VK_FORMAT_R8G8B8_UNORM, VK_FORMAT_R8G8B8A8_UNORM } },
+		{ glacier::VertexBufferElement::ShortNormalized, { VK_FORMAT_R16_SNORM, VK_FORMAT_R16G16_SNORM, VK_FORMAT_R16G16B16_SNORM, VK_FORMAT_R16G16B16A16_SNORM } },
+		{ glacier::VertexBufferElement::UnsignedShortNormalized, { VK_FORMAT_R16_UNORM, VK_FORMAT_R16G16_UNORM, VK_FORMAT_R16G16B16_UNORM, VK_FORMAT_R16G16B16A16_UNORM } },
+		{ glacier::VertexBufferElement::Packed1010102Normalized, { VK_FORMAT_UNDEFINED, VK_FORMAT_UNDEFINED, VK_FORMAT_A2B10G10R10_SNORM_PACK32, VK_FORMAT_A2B10G10R10_SNORM_PACK32 } },
+		{ glacier::VertexBufferElement::UnsignedPacked1010102Normalized, { VK_FORMAT_UNDEFINED, VK_FORMAT_UNDEFINED, VK_FORMAT_A2B10G10R10_UNORM_PACK32, VK_FORMAT_A2B10G10R10_UNORM_PACK32 } }
+	};
+
+	constexpr bool formatsMatchVulkan()
+	{
+		for (const ElementFormats& formats : s_ElementFormats)
+		{
+			for (uint32_t count = 1; count <= 4; count++)
+			{
+				if (glacier::getVertexFormat(formats.element, count) != static_cast<uint32_t>(formats.formats[count - 1]))
+					return false;
+			}
+		}
+
+		return true;
+	}
+
+	// The public header can't include Vulkan, so its format table is checked here
+	static_assert(formatsMatchVulkan(), "getVertexFormat doesn't match the Vulkan headers");
+
+	// Check the device can fetch every attribute. Only some formats are required to be, 3 component 8 and 16-bit formats often aren't.
+	void checkVertexFormats(VkPhysicalDevice physicalDevice, const std::vector<glacier::VertexAttribute>& attributes)
+	{
+		for (const glacier::VertexAttribute& attribute : attributes)
+		{
+			VkFormatProperties formatProperties;
+			vkGetPhysicalDeviceFormatProperties(physicalDevice, static_cast<VkFormat>(attribute.format), &formatProperties);
+
+			if (!(formatProperties.bufferFeatures & VK_FORMAT_FEATURE_VERTEX_BUFFER_BIT))
+				throw std::runtime_error(fmt::format("The device can't read vertex attributes of format {}, pad them to 4 components", attribute.format));
+		}
+	}
+}
+
 // https://vulkan-tutorial.com/Vertex_buffers/Vertex_input_description
 
 glacier::VertexBuffer::VertexBuffer(const Application* application, const void* data, uint64_t size, const VertexBufferLayout& layout)
-	: m_Layout(layout), m_Application(application)
+	: VertexBuffer(application, size, layout, [data, size, &layout](void* vertices, void* positions)
+		{
+			memcpy(vertices, data, size);
+
+			if (positions != nullptr)
+			{
+				uint32_t stride = layout.m_Stride;
+				uint32_t positionOffset = layout.m_Attributes[0].offset;
+				uint32_t positionSize = layout.m_Attributes[0].size;
+
+				const char* src = static_cast<const char*>(data);
+				char* dst = static_cast<char*>(positions);
+				for (uint64_t i = 0; i < size / stride; i++)
+					memcpy(dst + i * positionSize, src + i * stride + positionOffset, positionSize);
+			}
+		})
+{
+}
+
+glacier::VertexBuffer::VertexBuffer(const Application* application, uint64_t size, const VertexBufferLayout& layout, const std::function<void(void* vertices, void* positions)>& write)
+	: m_Layout(layout), m_Application(application), m_PositionHandle(nullptr), m_PositionMemory(nullptr), m_Id(s_NextVertexBufferId++)
 {
+	VkDevice device = static_cast<VkDevice>(m_Application->m_Device);
+	VkPhysicalDevice physicalDevice = static_cast<VkPhysicalDevice>(m_Application->m_PhysicalDevice);
+
+	checkVertexFormats(physicalDevice, m_Layout.m_Attributes);
+
 	/* Create a staging buffer */
 	VkBuffer stagingBuffer;
 	VkDeviceMemory stagingBufferMemory;
-	createBuffer(static_cast<VkDevice>(m_Application->m_Device), static_cast<VkPhysicalDevice>(m_Application->m_PhysicalDevice), size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &stagingBuffer, &stagingBufferMemory);
+	createBuffer(device, physicalDevice, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &stagingBuffer, &stagingBufferMemory);
+
+	void* vertices;
+	vkMapMemory(device, stagingBufferMemory, 0, size, 0, &vertices);
+
+	/* The depth prepass only needs the first attribute, it gets a tightly packed copy of it */
+	VkBuffer positionStagingBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory positionStagingBufferMemory = VK_NULL_HANDLE;
+	VkDeviceSize positionsSize = 0;
+	void* positions = nullptr;
+
+	const std::vector<VertexAttribute>& attributes = m_Layout.m_Attributes;
+	uint32_t stride = m_Layout.m_Stride;
+
+	if (m_Application->m_Info.depthPrepass && !attributes.empty() && stride > 0)
+	{
+		positionsSize = size / stride * attributes[0].size;
+
+		createBuffer(device, physicalDevice, positionsSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, &positionStagingBuffer, &positionStagingBufferMemory);
+		vkMapMemory(device, positionStagingBufferMemory, 0, positionsSize, 0, &positions);
+	}
 
-	/* Copy data to the staging buffer */
-	void* tmp;
-	vkMapMemory(static_cast<VkDevice>(m_Application->m_Device), stagingBufferMemory, 0, size, 0, &tmp);
-	memcpy(tmp, data, size);
-	vkUnmapMemory(static_cast<VkDevice>(m_Application->m_Device), stagingBufferMemory);
+	/* Fill the staging buffers */
+	try
+	{
+		write(vertices, positions);
+	}
+	catch (...)
+	{
+		vkUnmapMemory(device, stagingBufferMemory);
+		vkDestroyBuffer(device, stagingBuffer, nullptr);
+		vkFreeMemory(device, stagingBufferMemory, nullptr);
+
+		if (positionStagingBuffer != VK_NULL_HANDLE)
+		{
+			vkUnmapMemory(device, positionStagingBufferMemory);
+			vkDestroyBuffer(device, positionStagingBuffer, nullptr);
+			vkFreeMemory(device, positionStagingBufferMemory, nullptr);
+		}
+
+		throw;
+	}
+
+	vkUnmapMemory(device, stagingBufferMemory);
 
 	/* Copy data from the staging buffer to the vertex buffer on the GPU */
-	createBuffer(static_cast<VkDevice>(m_Application->m_Device), static_cast<VkPhysicalDevice>(m_Application->m_PhysicalDevice), size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, reinterpret_cast<VkBuffer*>(&m_Handle), reinterpret_cast<VkDeviceMemory*>(&m_Memory));
+	createBuffer(device, physicalDevice, size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, reinterpret_cast<VkBuffer*>(&m_Handle), reinterpret_cast<VkDeviceMemory*>(&m_Memory));
+
+	std::vector<VkBuffer> srcBuffers = { stagingBuffer };
+	std::vector<VkBuffer> dstBuffers = { static_cast<VkBuffer>(m_Handle) };
+	std::vector<VkDeviceSize> sizes = { size };
 
-	copyBuffers(static_cast<VkDevice>(m_Application->m_Device), static_cast<VkCommandPool>(m_Application->m_Renderer->m_CommandPool), static_cast<VkQueue>(m_Application->m_Renderer->m_GraphicsQueue), &stagingBuffer, reinterpret_cast<VkBuffer*>(&m_Handle), &size, 1);
+	if (positionStagingBuffer != VK_NULL_HANDLE)
+	{
+		vkUnmapMemory(device, positionStagingBufferMemory);
+
+		createBuffer(device, physicalDevice, positionsSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, reinterpret_cast<VkBuffer*>(&m_PositionHandle), reinterpret_cast<VkDeviceMemory*>(&m_PositionMemory));
 
-	vkDestroyBuffer(static_cast<VkDevice>(m_Application->m_Device), stagingBuffer, nullptr);
-	vkFreeMemory(static_cast<VkDevice>(m_Application->m_Device), stagingBufferMemory, nullptr);
+		srcBuffers.push_back(positionStagingBuffer);
+		dstBuffers.push_back(static_cast<VkBuffer>(m_PositionHandle));
+		sizes.push_back(positionsSize);
+	}
+
+	m_LastUsage = ++m_Application->m_TimelineValue;
+	copyBuffers(device, static_cast<VkCommandPool>(m_Application->m_Renderer->m_CommandPool), static_cast<VkQueue>(m_Application->m_Renderer->m_GraphicsQueue), static_cast<VkSemaphore>(m_Application->m_Timeline), m_LastUsage, srcBuffers.data(), dstBuffers.data(), sizes.data(), static_cast<unsigned int>(srcBuffers.size()));
+
+	vkDestroyBuffer(device, stagingBuffer, nullptr);
+	vkFreeMemory(device, stagingBufferMemory, nullptr);
+
+	if (positionStagingBuffer != VK_NULL_HANDLE)
+	{
+		vkDestroyBuffer(device, positionStagingBuffer, nullptr);
+		vkFreeMemory(device, positionStagingBufferMemory, nullptr);
+	}
 }
 
-glacier::VertexBuffer::~VertexBuffer()
+glacier::VertexBuffer::VertexBuffer(const Application* application, std::shared_ptr<const std::vector<uint8_t>> vertices, const VertexBufferLayout& layout, TextureUploader& uploader)
+	: m_Layout(layout), m_Application(application), m_Handle(nullptr), m_Memory(nullptr), m_PositionHandle(nullptr), m_PositionMemory(nullptr), m_Id(s_NextVertexBufferId++), m_LastUsage(application->m_TimelineValue)
 {
-	/* Destroy the buffer and free its memory */
+	VkDevice device = static_cast<VkDevice>(m_Application->m_Device);
+	VkPhysicalDevice physicalDevice = static_cast<VkPhysicalDevice>(m_Application->m_PhysicalDevice);
+
+	checkVertexFormats(physicalDevice, m_Layout.m_Attributes);
 
-	if (m_Handle)
-		vkDestroyBuffer(static_cast<VkDevice>(m_Application->m_Device), static_cast<VkBuffer>(m_Handle), nullptr);
+	uint64_t size = vertices->size();
+	createBuffer(device, physicalDevice, size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, reinterpret_cast<VkBuffer*>(&m_Handle), reinterpret_cast<VkDeviceMemory*>(&m_Memory));
+	uploader.addBuffer(static_cast<VkBuffer>(m_Handle), vertices->data(), size, vertices);
 
-	if (m_Memory)
-		vkFreeMemory(static_cast<VkDevice>(m_Application->m_Device), static_cast<VkDeviceMemory>(m_Memory), nullptr);
+	/* The depth prepass only needs the first attribute, it gets a tightly packed copy of it */
+	const std::vector<VertexAttribute>& attributes = m_Layout.m_Attributes;
+	uint32_t stride = m_Layout.m_Stride;
+
+	if (m_Application->m_Info.depthPrepass && !attributes.empty() && stride > 0)
+	{
+		uint32_t positionOffset = attributes[0].offset;
+		uint32_t positionSize = attributes[0].size;
+
+		std::shared_ptr<std::vector<uint8_t>> positions = std::make_shared<std::vector<uint8_t>>(size / stride * positionSize);
+		for (uint64_t i = 0; i < size / stride; i++)
+			memcpy(positions->data() + i * positionSize, vertices->data() + i * stride + positionOffset, positionSize);
+
+		createBuffer(device, physicalDevice, positions->size(), VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, reinterpret_cast<VkBuffer*>(&m_PositionHandle), reinterpret_cast<VkDeviceMemory*>(&m_PositionMemory));
+		uploader.addBuffer(static_cast<VkBuffer>(m_PositionHandle), positions->data(), positions->size(), positions);
+	}
 }
 
-void glacier::VertexBufferLayout::push(glacier::VertexBufferElement elementType, uint32_t count)
+glacier::VertexBuffer::VertexBuffer(const Application* application, const VertexBufferLayout& layout)
+	: m_Layout(layout), m_Application(application), m_Handle(nullptr), m_Memory(nullptr), m_PositionHandle(nullptr), m_PositionMemory(nullptr), m_Id(s_NextVertexBufferId++), m_LastUsage(0)
 {
-	m_Elements.push_back(std::make_pair(elementType, count));
+	checkVertexFormats(static_cast<VkPhysicalDevice>(m_Application->m_PhysicalDevice), m_Layout.m_Attributes);
 }
 
-VkVertexInputBindingDescription glacier::VertexBufferLayout::getBindingDescription() const
+glacier::VertexBuffer::~VertexBuffer()
 {
-	VkVertexInputBindingDescription vertexInputBindingDescription = {};
-	vertexInputBindingDescription.binding = 0;
+	/* Destroy the buffers and free their memory once the GPU no longer uses them */
+	m_Application->m_DeletionQueue->destroy(VK_OBJECT_TYPE_BUFFER, m_Handle, m_LastUsage);
+	m_Application->m_DeletionQueue->destroy(VK_OBJECT_TYPE_DEVICE_MEMORY, m_Memory, m_LastUsage);
+	m_Application->m_DeletionQueue->destroy(VK_OBJECT_TYPE_BUFFER, m_PositionHandle, m_LastUsage);
+	m_Application->m_DeletionQueue->destroy(VK_OBJECT_TYPE_DEVICE_MEMORY, m_PositionMemory, m_LastUsage);
+}
 
-	unsigned int stride = 0;
-	for (const std::pair<glacier::VertexBufferElement, uint32_t>& pair : m_Elements)
+void glacier::VertexBufferLayout::push(glacier::VertexBufferElement elementType, uint32_t count)
+{
+	uint32_t format = getVertexFormat(elementType, count);
+	if (format == 0)
 	{
-		switch (pair.first)
-		{
-		case glacier::VertexBufferElement::Byte:
-		case glacier::VertexBufferElement::UnsignedByte:
-			stride += 1 * pair.second;
-			break;
-		case glacier::VertexBufferElement::Float:
-			stride += 4 * pair.second;
-			break;
-		case glacier::VertexBufferElement::Int:
-		case glacier::VertexBufferElement::UnsignedInt:
-			stride += 4 * pair.second;
-			break;
-		}
+		if (isPackedElement(elementType))
+			throw std::runtime_error(fmt::format("Packed vertex attributes have 3 or 4 components, got {}", count));
+
+		throw std::runtime_error(fmt::format("Vertex attributes have 1 to 4 components, got {}", count));
 	}
 
-	vertexInputBindingDescription.stride = stride; // TODO: Vertex buffer layout
+	uint32_t size = getAttributeSize(elementType, count);
+
+	m_Attributes.push_back(VertexAttribute{ elementType, count, m_Stride, size, format });
+	m_Stride += size;
+}
+
+uint32_t glacier::VertexBufferLayout::getStride() const
+{
+	return m_Stride;
+}
+
+const std::vector<glacier::VertexAttribute>& glacier::VertexBufferLayout::getAttributes() const
+{
+	return m_Attributes;
+}
+
+VkVertexInputBindingDescription glacier::VertexBufferLayout::getBindingDescription() const
+{
+	VkVertexInputBindingDescription vertexInputBindingDescription = {};
+	vertexInputBindingDescription.binding = 0;
+	vertexInputBindingDescription.stride = m_Stride;
 	vertexInputBindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX; // Instanced rendering: VK_VERTEX_INPUT_RATE_INSTANCE
 
 	return vertexInputBindingDescription;
@@ -81,119 +265,17 @@ VkVertexInputBindingDescription glacier::VertexBufferLayout::getBindingDescripti
 std::vector<VkVertexInputAttributeDescription> glacier::VertexBufferLayout::getAttributeDescriptions() const
 {
 	std::vector<VkVertexInputAttributeDescription> vertexInputAttributeDescriptions;
+	vertexInputAttributeDescriptions.reserve(m_Attributes.size());
 
-	unsigned int i = 0;
-	unsigned int offset = 0;
-	for (const std::pair<glacier::VertexBufferElement, uint32_t>& pair : m_Elements)
+	for (uint32_t i = 0; i < m_Attributes.size(); i++)
 	{
 		VkVertexInputAttributeDescription description = {};
-		description.binding = 0; // TODO
+		description.binding = 0;
 		description.location = i;
-
-		if (pair.second > 4)
-			throw std::runtime_error("Too many elements!");
-
-		description.offset = offset;
-
-		switch (pair.first)
-		{
-		case glacier::VertexBufferElement::Byte:
-			switch (pair.second)
-			{
-			case 1:
-				description.format = VK_FORMAT_R8_SINT;
-				break;
-			case 2:
-				description.format = VK_FORMAT_R8G8_SINT;
-				break;
-			case 3:
-				description.format = VK_FORMAT_R8G8B8_SINT;
-				break;
-			case 4:
-				description.format = VK_FORMAT_R8G8B8A8_SINT;
-				break;
-			}
-			offset += 1 * pair.second;
-			break;
-		case glacier::VertexBufferElement::UnsignedByte:
-			switch (pair.second)
-			{
-			case 1:
-				description.format = VK_FORMAT_R8_UINT;
-				break;
-			case 2:
-				description.format = VK_FORMAT_R8G8_UINT;
-				break;
-			case 3:
-				description.format = VK_FORMAT_R8G8B8_UINT;
-				break;
-			case 4:
-				description.format = VK_FORMAT_R8G8B8A8_UINT;
-				break;
-			}
-			offset += 1 * pair.second;
-			break;
-		case glacier::VertexBufferElement::Int:
-			switch (pair.second)
-			{
-			case 1:
-				description.format = VK_FORMAT_R32_SINT;
-				break;
-			case 2:
-				description.format = VK_FORMAT_R32G32_SINT;
-				break;
-			case 3:
-				description.format = VK_FORMAT_R32G32B32_SINT;
-				break;
-			case 4:
-				description.format = VK_FORMAT_R32G32B32A32_SINT;
-				break;
-			}
-			offset += 4 * pair.second;
-			break;
-		case glacier::VertexBufferElement::UnsignedInt:
-			description.format = VK_FORMAT_R32_UINT;
-			switch (pair.second)
-			{
-			case 1:
-				description.format = VK_FORMAT_R32_UINT;
-				break;
-			case 2:
-				description.format = VK_FORMAT_R32G32_UINT;
-				break;
-			case 3:
-				description.format = VK_FORMAT_R32G32B32_UINT;
-				break;
-			case 4:
-				description.format = VK_FORMAT_R32G32B32A32_UINT;
-				break;
-			}
-			offset += 4 * pair.second;
-			break;
-		case glacier::VertexBufferElement::Float:
-			description.format = VK_FORMAT_R32_SFLOAT;
-			switch (pair.second)
-			{
-			case 1:
-				description.format = VK_FORMAT_R32_SFLOAT;
-				break;
-			case 2:
-				description.format = VK_FORMAT_R32G32_SFLOAT;
-				break;
-			case 3:
-				description.format = VK_FORMAT_R32G32B32_SFLOAT;
-				break;
-			case 4:
-				description.format = VK_FORMAT_R32G32B32A32_SFLOAT;
-				break;
-			}
-			offset += 4 * pair.second;
-			break;
-		}
+		description.format = static_cast<VkFormat>(m_Attributes[i].format);
+		description.offset = m_Attributes[i].offset;
 
 		vertexInputAttributeDescriptions.push_back(description);
-
-		i += 1;
 	}
 
 	return vertexInputAttributeDescriptions;
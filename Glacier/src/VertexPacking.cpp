@@ -0,0 +1,583 @@
+#include "VertexPacking.hpp"
+#include "internal/Simd.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#include <spdlog/fmt/fmt.h>
+
+#ifdef GLACIER_SIMD_SSE2
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+// Every kernel converts count floats into count tightly packed components
+namespace
+{
+	typedef void (*PackFunction)(const float* src, size_t count, void* dst);
+
+	struct Kernels
+	{
+		PackFunction half;
+		PackFunction unorm8;
+		PackFunction snorm8;
+		PackFunction unorm16;
+		PackFunction snorm16;
+	};
+
+	/*
+	 * The scalar kernels clamp and round exactly like the SIMD instructions, so every level gives the same bits.
+	 * Comparing against the bound first turns NaN into the bound like maxps and minps do, and lrint rounds to nearest even like cvtps2dq.
+	*/
+	float clampUnorm(float value)
+	{
+		value = value > 0.0f ? value : 0.0f;
+		return value < 1.0f ? value : 1.0f;
+	}
+
+	float clampSnorm(float value)
+	{
+		value = value > -1.0f ? value : -1.0f;
+		return value < 1.0f ? value : 1.0f;
+	}
+
+	// Rounds to nearest even like F16C, see https://gist.github.com/rygorous/2156668
+	uint16_t floatToHalf(float value)
+	{
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+
+		uint32_t sign = (bits >> 16) & 0x8000;
+		bits &= 0x7FFFFFFF;
+
+		// Infinity, and NaN which stays a quiet NaN with the top of its payload
+		if (bits >= 0x7F800000)
+			return static_cast<uint16_t>(sign | 0x7C00 | (bits > 0x7F800000 ? 0x200 | ((bits >> 13) & 0x3FF) : 0));
+
+		// 65520 and above round past the largest half
+		if (bits >= 0x477FF000)
+			return static_cast<uint16_t>(sign | 0x7C00);
+
+		// Below the smallest normal half, adding 0.5 moves the subnormal bits to the bottom of the mantissa and rounds them
+		if (bits < 0x38800000)
+		{
+			float magnitude;
+			memcpy(&magnitude, &bits, sizeof(magnitude));
+			magnitude += 0.5f;
+
+			uint32_t rounded;
+			memcpy(&rounded, &magnitude, sizeof(rounded));
+			return static_cast<uint16_t>(sign | (rounded - 0x3F000000));
+		}
+
+		// Rebias the exponent from 127 to 15 and round the 13 dropped mantissa bits, ties to the even one
+		uint32_t odd = (bits >> 13) & 1;
+		bits += 0xC8000FFF + odd;
+		return static_cast<uint16_t>(sign | (bits >> 13));
+	}
+
+	uint32_t pack1010102(const float* src, uint32_t components, bool isSigned)
+	{
+		uint32_t bits = 0;
+		for (uint32_t c = 0; c < 4; c++)
+		{
+			uint32_t width = c < 3 ? 10 : 2;
+			float value = c < components ? src[c] : 1.0f;
+
+			float max = static_cast<float>((1u << (isSigned ? width - 1 : width)) - 1);
+			long quantized = std::lrint((isSigned ? clampSnorm(value) : clampUnorm(value)) * max);
+
+			bits |= (static_cast<uint32_t>(quantized) & ((1u << width) - 1)) << (c * 10);
+		}
+
+		return bits;
+	}
+
+	void copyFloats(const float* src, size_t count, void* dst)
+	{
+		memcpy(dst, src, count * sizeof(float));
+	}
+
+	void packHalfScalar(const float* src, size_t count, void* dst)
+	{
+		uint16_t* out = static_cast<uint16_t*>(dst);
+		for (size_t i = 0; i < count; i++)
+			out[i] = floatToHalf(src[i]);
+	}
+
+	void packUnorm8Scalar(const float* src, size_t count, void* dst)
+	{
+		uint8_t* out = static_cast<uint8_t*>(dst);
+		for (size_t i = 0; i < count; i++)
+			out[i] = static_cast<uint8_t>(std::lrint(clampUnorm(src[i]) * 255.0f));
+	}
+
+	void packSnorm8Scalar(const float* src, size_t count, void* dst)
+	{
+		int8_t* out = static_cast<int8_t*>(dst);
+		for (size_t i = 0; i < count; i++)
+			out[i] = static_cast<int8_t>(std::lrint(clampSnorm(src[i]) * 127.0f));
+	}
+
+	void packUnorm16Scalar(const float* src, size_t count, void* dst)
+	{
+		uint16_t* out = static_cast<uint16_t*>(dst);
+		for (size_t i = 0; i < count; i++)
+			out[i] = static_cast<uint16_t>(std::lrint(clampUnorm(src[i]) * 65535.0f));
+	}
+
+	void packSnorm16Scalar(const float* src, size_t count, void* dst)
+	{
+		int16_t* out = static_cast<int16_t*>(dst);
+		for (size_t i = 0; i < count; i++)
+			out[i] = static_cast<int16_t>(std::lrint(clampSnorm(src[i]) * 32767.0f));
+	}
+
+	const Kernels s_ScalarKernels = { packHalfScalar, packUnorm8Scalar, packSnorm8Scalar, packUnorm16Scalar, packSnorm16Scalar };
+
+#ifdef GLACIER_SIMD_SSE2
+	/* SSE2 */
+
+	__m128i quantizeUnorm(const float* src, __m128 scale)
+	{
+		__m128 value = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(src), _mm_setzero_ps()), _mm_set1_ps(1.0f));
+		return _mm_cvtps_epi32(_mm_mul_ps(value, scale));
+	}
+
+	__m128i quantizeSnorm(const float* src, __m128 scale)
+	{
+		__m128 value = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(src), _mm_set1_ps(-1.0f)), _mm_set1_ps(1.0f));
+		return _mm_cvtps_epi32(_mm_mul_ps(value, scale));
+	}
+
+	void packUnorm8SSE2(const float* src, size_t count, void* dst)
+	{
+		uint8_t* out = static_cast<uint8_t*>(dst);
+		const __m128 scale = _mm_set1_ps(255.0f);
+
+		size_t i = 0;
+		for (; i + 16 <= count; i += 16)
+		{
+			__m128i low = _mm_packs_epi32(quantizeUnorm(src + i, scale), quantizeUnorm(src + i + 4, scale));
+			__m128i high = _mm_packs_epi32(quantizeUnorm(src + i + 8, scale), quantizeUnorm(src + i + 12, scale));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packus_epi16(low, high));
+		}
+
+		packUnorm8Scalar(src + i, count - i, out + i);
+	}
+
+	void packSnorm8SSE2(const float* src, size_t count, void* dst)
+	{
+		int8_t* out = static_cast<int8_t*>(dst);
+		const __m128 scale = _mm_set1_ps(127.0f);
+
+		size_t i = 0;
+		for (; i + 16 <= count; i += 16)
+		{
+			__m128i low = _mm_packs_epi32(quantizeSnorm(src + i, scale), quantizeSnorm(src + i + 4, scale));
+			__m128i high = _mm_packs_epi32(quantizeSnorm(src + i + 8, scale), quantizeSnorm(src + i + 12, scale));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packs_epi16(low, high));
+		}
+
+		packSnorm8Scalar(src + i, count - i, out + i);
+	}
+
+	void packUnorm16SSE2(const float* src, size_t count, void* dst)
+	{
+		uint16_t* out = static_cast<uint16_t*>(dst);
+		const __m128 scale = _mm_set1_ps(65535.0f);
+		const __m128i bias = _mm_set1_epi32(32768);
+		const __m128i flip = _mm_set1_epi16(-32768);
+
+		// SSE2 can only pack with signed saturation, so shift into the signed range and flip the top bit back afterwards
+		size_t i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			__m128i low = _mm_sub_epi32(quantizeUnorm(src + i, scale), bias);
+			__m128i high = _mm_sub_epi32(quantizeUnorm(src + i + 4, scale), bias);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_xor_si128(_mm_packs_epi32(low, high), flip));
+		}
+
+		packUnorm16Scalar(src + i, count - i, out + i);
+	}
+
+	void packSnorm16SSE2(const float* src, size_t count, void* dst)
+	{
+		int16_t* out = static_cast<int16_t*>(dst);
+		const __m128 scale = _mm_set1_ps(32767.0f);
+
+		size_t i = 0;
+		for (; i + 8 <= count; i += 8)
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packs_epi32(quantizeSnorm(src + i, scale), quantizeSnorm(src + i + 4, scale)));
+
+		packSnorm16Scalar(src + i, count - i, out + i);
+	}
+
+	// Halves need F16C, which comes with AVX2
+	const Kernels s_SSE2Kernels = { packHalfScalar, packUnorm8SSE2, packSnorm8SSE2, packUnorm16SSE2, packSnorm16SSE2 };
+
+	/* AVX2 and F16C */
+
+	GLACIER_TARGET_AVX2 __m256i quantizeUnormAVX2(const float* src, __m256 scale)
+	{
+		__m256 value = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(src), _mm256_setzero_ps()), _mm256_set1_ps(1.0f));
+		return _mm256_cvtps_epi32(_mm256_mul_ps(value, scale));
+	}
+
+	GLACIER_TARGET_AVX2 __m256i quantizeSnormAVX2(const float* src, __m256 scale)
+	{
+		__m256 value = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(src), _mm256_set1_ps(-1.0f)), _mm256_set1_ps(1.0f));
+		return _mm256_cvtps_epi32(_mm256_mul_ps(value, scale));
+	}
+
+	GLACIER_TARGET_AVX2 void packHalfAVX2(const float* src, size_t count, void* dst)
+	{
+		uint16_t* out = static_cast<uint16_t*>(dst);
+
+		size_t i = 0;
+		for (; i + 8 <= count; i += 8)
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT));
+
+		packHalfScalar(src + i, count - i, out + i);
+	}
+
+	/*
+	 * AVX2 packs within each 128-bit lane, so packing 8 ints from a and b gives a0-3 b0-3 | a4-7 b4-7.
+	 * The 16-bit kernels swap the middle 64-bit quarters back, the 8-bit ones reorder 32-bit groups after packing twice.
+	*/
+	GLACIER_TARGET_AVX2 void packUnorm8AVX2(const float* src, size_t count, void* dst)
+	{
+		uint8_t* out = static_cast<uint8_t*>(dst);
+		const __m256 scale = _mm256_set1_ps(255.0f);
+		const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+		size_t i = 0;
+		for (; i + 32 <= count; i += 32)
+		{
+			__m256i low = _mm256_packs_epi32(quantizeUnormAVX2(src + i, scale), quantizeUnormAVX2(src + i + 8, scale));
+			__m256i high = _mm256_packs_epi32(quantizeUnormAVX2(src + i + 16, scale), quantizeUnormAVX2(src + i + 24, scale));
+			__m256i packed = _mm256_permutevar8x32_epi32(_mm256_packus_epi16(low, high), order);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), packed);
+		}
+
+		packUnorm8SSE2(src + i, count - i, out + i);
+	}
+
+	GLACIER_TARGET_AVX2 void packSnorm8AVX2(const float* src, size_t count, void* dst)
+	{
+		int8_t* out = static_cast<int8_t*>(dst);
+		const __m256 scale = _mm256_set1_ps(127.0f);
+		const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+		size_t i = 0;
+		for (; i + 32 <= count; i += 32)
+		{
+			__m256i low = _mm256_packs_epi32(quantizeSnormAVX2(src + i, scale), quantizeSnormAVX2(src + i + 8, scale));
+			__m256i high = _mm256_packs_epi32(quantizeSnormAVX2(src + i + 16, scale), quantizeSnormAVX2(src + i + 24, scale));
+			__m256i packed = _mm256_permutevar8x32_epi32(_mm256_packs_epi16(low, high), order);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), packed);
+		}
+
+		packSnorm8SSE2(src + i, count - i, out + i);
+	}
+
+	GLACIER_TARGET_AVX2 void packUnorm16AVX2(const float* src, size_t count, void* dst)
+	{
+		uint16_t* out = static_cast<uint16_t*>(dst);
+		const __m256 scale = _mm256_set1_ps(65535.0f);
+		const __m256i bias = _mm256_set1_epi32(32768);
+		const __m256i flip = _mm256_set1_epi16(-32768);
+
+		// packus_epi32 would do, but the signed pack keeps the kernel identical to the SSE2 one
+		size_t i = 0;
+		for (; i + 16 <= count; i += 16)
+		{
+			__m256i low = _mm256_sub_epi32(quantizeUnormAVX2(src + i, scale), bias);
+			__m256i high = _mm256_sub_epi32(quantizeUnormAVX2(src + i + 8, scale), bias);
+			__m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(low, high), 0xD8);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_xor_si256(packed, flip));
+		}
+
+		packUnorm16SSE2(src + i, count - i, out + i);
+	}
+
+	GLACIER_TARGET_AVX2 void packSnorm16AVX2(const float* src, size_t count, void* dst)
+	{
+		int16_t* out = static_cast<int16_t*>(dst);
+		const __m256 scale = _mm256_set1_ps(32767.0f);
+
+		size_t i = 0;
+		for (; i + 16 <= count; i += 16)
+		{
+			__m256i packed = _mm256_packs_epi32(quantizeSnormAVX2(src + i, scale), quantizeSnormAVX2(src + i + 8, scale));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_permute4x64_epi64(packed, 0xD8));
+		}
+
+		packSnorm16SSE2(src + i, count - i, out + i);
+	}
+
+	const Kernels s_AVX2Kernels = { packHalfAVX2, packUnorm8AVX2, packSnorm8AVX2, packUnorm16AVX2, packSnorm16AVX2 };
+#endif
+
+#ifdef GLACIER_SIMD_NEON
+	/* NEON, AArch64 only since it needs round to nearest conversions and vmaxnm */
+
+	// vmaxnm and vminnm return the bound for NaN, like the scalar clamp
+	int32x4_t quantizeUnorm(const float* src, float32x4_t scale)
+	{
+		float32x4_t value = vminnmq_f32(vmaxnmq_f32(vld1q_f32(src), vdupq_n_f32(0.0f)), vdupq_n_f32(1.0f));
+		return vcvtnq_s32_f32(vmulq_f32(value, scale));
+	}
+
+	int32x4_t quantizeSnorm(const float* src, float32x4_t scale)
+	{
+		float32x4_t value = vminnmq_f32(vmaxnmq_f32(vld1q_f32(src), vdupq_n_f32(-1.0f)), vdupq_n_f32(1.0f));
+		return vcvtnq_s32_f32(vmulq_f32(value, scale));
+	}
+
+	void packHalfNEON(const float* src, size_t count, void* dst)
+	{
+		uint16_t* out = static_cast<uint16_t*>(dst);
+
+		size_t i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			float16x8_t packed = vcombine_f16(vcvt_f16_f32(vld1q_f32(src + i)), vcvt_f16_f32(vld1q_f32(src + i + 4)));
+			vst1q_u16(out + i, vreinterpretq_u16_f16(packed));
+		}
+
+		packHalfScalar(src + i, count - i, out + i);
+	}
+
+	void packUnorm8NEON(const float* src, size_t count, void* dst)
+	{
+		uint8_t* out = static_cast<uint8_t*>(dst);
+		const float32x4_t scale = vdupq_n_f32(255.0f);
+
+		size_t i = 0;
+		for (; i + 16 <= count; i += 16)
+		{
+			int16x8_t low = vcombine_s16(vqmovn_s32(quantizeUnorm(src + i, scale)), vqmovn_s32(quantizeUnorm(src + i + 4, scale)));
+			int16x8_t high = vcombine_s16(vqmovn_s32(quantizeUnorm(src + i + 8, scale)), vqmovn_s32(quantizeUnorm(src + i + 12, scale)));
+			vst1q_u8(out + i, vcombine_u8(vqmovun_s16(low), vqmovun_s16(high)));
+		}
+
+		packUnorm8Scalar(src + i, count - i, out + i);
+	}
+
+	void packSnorm8NEON(const float* src, size_t count, void* dst)
+	{
+		int8_t* out = static_cast<int8_t*>(dst);
+		const float32x4_t scale = vdupq_n_f32(127.0f);
+
+		size_t i = 0;
+		for (; i + 16 <= count; i += 16)
+		{
+			int16x8_t low = vcombine_s16(vqmovn_s32(quantizeSnorm(src + i, scale)), vqmovn_s32(quantizeSnorm(src + i + 4, scale)));
+			int16x8_t high = vcombine_s16(vqmovn_s32(quantizeSnorm(src + i + 8, scale)), vqmovn_s32(quantizeSnorm(src + i + 12, scale)));
+			vst1q_s8(out + i, vcombine_s8(vqmovn_s16(low), vqmovn_s16(high)));
+		}
+
+		packSnorm8Scalar(src + i, count - i, out + i);
+	}
+
+	void packUnorm16NEON(const float* src, size_t count, void* dst)
+	{
+		uint16_t* out = static_cast<uint16_t*>(dst);
+		const float32x4_t scale = vdupq_n_f32(65535.0f);
+
+		size_t i = 0;
+		for (; i + 8 <= count; i += 8)
+			vst1q_u16(out + i, vcombine_u16(vqmovun_s32(quantizeUnorm(src + i, scale)), vqmovun_s32(quantizeUnorm(src + i + 4, scale))));
+
+		packUnorm16Scalar(src + i, count - i, out + i);
+	}
+
+	void packSnorm16NEON(const float* src, size_t count, void* dst)
+	{
+		int16_t* out = static_cast<int16_t*>(dst);
+		const float32x4_t scale = vdupq_n_f32(32767.0f);
+
+		size_t i = 0;
+		for (; i + 8 <= count; i += 8)
+			vst1q_s16(out + i, vcombine_s16(vqmovn_s32(quantizeSnorm(src + i, scale)), vqmovn_s32(quantizeSnorm(src + i + 4, scale))));
+
+		packSnorm16Scalar(src + i, count - i, out + i);
+	}
+
+	const Kernels s_NEONKernels = { packHalfNEON, packUnorm8NEON, packSnorm8NEON, packUnorm16NEON, packSnorm16NEON };
+#endif
+
+	const char* getSimdLevelName(glacier::SimdLevel level)
+	{
+		switch (level)
+		{
+		case glacier::SimdLevel::SSE2:
+			return "SSE2";
+		case glacier::SimdLevel::AVX2:
+			return "AVX2";
+		case glacier::SimdLevel::NEON:
+			return "NEON";
+		default:
+			return "Scalar";
+		}
+	}
+
+	glacier::SimdLevel detectSimdLevel()
+	{
+#if defined(GLACIER_SIMD_SSE2)
+		// AVX2 and F16C also need the OS to save the YMM registers
+#if defined(_MSC_VER) && !defined(__clang__)
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] >= 7)
+		{
+			__cpuid(info, 1);
+			bool osxsave = (info[2] & (1 << 27)) != 0;
+			bool avx = (info[2] & (1 << 28)) != 0;
+			bool f16c = (info[2] & (1 << 29)) != 0;
+
+			if (osxsave && avx && f16c && (_xgetbv(0) & 6) == 6)
+			{
+				__cpuidex(info, 7, 0);
+				if (info[1] & (1 << 5))
+					return glacier::SimdLevel::AVX2;
+			}
+		}
+#else
+		unsigned int eax, ebx, ecx, edx;
+		if (__get_cpuid_max(0, nullptr) >= 7 && __get_cpuid(1, &eax, &ebx, &ecx, &edx))
+		{
+			bool osxsave = (ecx & bit_OSXSAVE) != 0;
+			bool avx = (ecx & bit_AVX) != 0;
+			bool f16c = (ecx & bit_F16C) != 0;
+
+			if (osxsave && avx && f16c)
+			{
+				unsigned int xcrLow, xcrHigh;
+				__asm__("xgetbv" : "=a"(xcrLow), "=d"(xcrHigh) : "c"(0));
+
+				__cpuid_count(7, 0, eax, ebx, ecx, edx);
+				if ((xcrLow & 6) == 6 && (ebx & bit_AVX2))
+					return glacier::SimdLevel::AVX2;
+			}
+		}
+#endif
+		return glacier::SimdLevel::SSE2;
+#elif defined(GLACIER_SIMD_NEON)
+		return glacier::SimdLevel::NEON;
+#else
+		return glacier::SimdLevel::Scalar;
+#endif
+	}
+
+	const Kernels& getKernels(glacier::SimdLevel level)
+	{
+		switch (level)
+		{
+#ifdef GLACIER_SIMD_SSE2
+		case glacier::SimdLevel::SSE2:
+			return s_SSE2Kernels;
+		case glacier::SimdLevel::AVX2:
+			return s_AVX2Kernels;
+#endif
+#ifdef GLACIER_SIMD_NEON
+		case glacier::SimdLevel::NEON:
+			return s_NEONKernels;
+#endif
+		default:
+			return s_ScalarKernels;
+		}
+	}
+
+	PackFunction getPackFunction(glacier::SimdLevel level, glacier::VertexBufferElement element)
+	{
+		const Kernels& kernels = getKernels(level);
+
+		switch (element)
+		{
+		case glacier::VertexBufferElement::Float:
+			return copyFloats;
+		case glacier::VertexBufferElement::Half:
+			return kernels.half;
+		case glacier::VertexBufferElement::UnsignedByteNormalized:
+			return kernels.unorm8;
+		case glacier::VertexBufferElement::ByteNormalized:
+			return kernels.snorm8;
+		case glacier::VertexBufferElement::UnsignedShortNormalized:
+			return kernels.unorm16;
+		case glacier::VertexBufferElement::ShortNormalized:
+			return kernels.snorm16;
+		default:
+			throw std::runtime_error("Integer vertex elements aren't converted from floats");
+		}
+	}
+}
+
+static const glacier::SimdLevel s_SupportedSimdLevel = detectSimdLevel();
+static std::atomic<glacier::SimdLevel> s_SimdLevel(s_SupportedSimdLevel);
+
+glacier::SimdLevel glacier::getVertexPackingSimdLevel()
+{
+	return s_SimdLevel.load(std::memory_order_relaxed);
+}
+
+void glacier::setVertexPackingSimdLevel(SimdLevel level)
+{
+	bool supported = level == SimdLevel::Scalar || level == s_SupportedSimdLevel || (level == SimdLevel::SSE2 && s_SupportedSimdLevel == SimdLevel::AVX2);
+	if (!supported)
+		throw std::runtime_error(fmt::format("The CPU doesn't support {} vertex packing, the best it supports is {}", getSimdLevelName(level), getSimdLevelName(s_SupportedSimdLevel)));
+
+	s_SimdLevel.store(level, std::memory_order_relaxed);
+}
+
+void glacier::packVertexAttribute(const float* src, uint32_t components, size_t count, VertexBufferElement element, void* dst, size_t dstStride)
+{
+	if (getVertexFormat(element, components) == 0)
+		throw std::runtime_error(fmt::format("Can't pack {} components into a vertex attribute of this element", components));
+
+	uint32_t attributeSize = getAttributeSize(element, components);
+	if (dstStride == 0)
+		dstStride = attributeSize;
+
+	uint8_t* out = static_cast<uint8_t*>(dst);
+
+	if (isPackedElement(element))
+	{
+		bool isSigned = element == VertexBufferElement::Packed1010102Normalized;
+		for (size_t i = 0; i < count; i++)
+		{
+			uint32_t bits = pack1010102(src + i * components, components, isSigned);
+			memcpy(out + i * dstStride, &bits, sizeof(bits));
+		}
+
+		return;
+	}
+
+	PackFunction function = getPackFunction(getVertexPackingSimdLevel(), element);
+
+	if (dstStride == attributeSize)
+	{
+		function(src, count * components, dst);
+		return;
+	}
+
+	/* Interleaved destinations: convert a chunk into a tight buffer that stays in L1, then scatter it */
+	alignas(32) uint8_t chunk[4096];
+	size_t chunkVertices = sizeof(chunk) / attributeSize;
+
+	for (size_t first = 0; first < count; first += chunkVertices)
+	{
+		size_t vertices = std::min(chunkVertices, count - first);
+		function(src + first * components, vertices * components, chunk);
+
+		for (size_t i = 0; i < vertices; i++)
+			memcpy(out + (first + i) * dstStride, chunk + i * attributeSize, attributeSize);
+	}
+}
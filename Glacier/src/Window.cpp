@@ -6,7 +6,12 @@
 #include <GLFW/glfw3.h>
 
 glacier::Window::Window(const WindowCreateInfo& info)
+	: m_Handle(nullptr), m_Headless(info.headless), m_Open(true), m_HeadlessSize(info.width, info.height)
 {
+	// A headless window never touches GLFW, so it works without a display server
+	if (m_Headless)
+		return;
+
 	if (!glfwInit())
 		throw std::runtime_error("GLFW failed to initialize");
 
@@ -27,22 +32,37 @@ glacier::Window::Window(const WindowCreateInfo& info)
 
 glacier::Window::~Window()
 {
+	if (m_Headless)
+		return;
+
 	glfwDestroyWindow(static_cast<GLFWwindow*>(m_Handle));
 	glfwTerminate();
 }
 
 bool glacier::Window::isOpen() const
 {
+	if (m_Headless)
+		return m_Open;
+
 	return !glfwWindowShouldClose(static_cast<GLFWwindow*>(m_Handle));
 }
 
 void glacier::Window::close()
 {
+	if (m_Headless)
+	{
+		m_Open = false;
+		return;
+	}
+
 	glfwSetWindowShouldClose(static_cast<GLFWwindow*>(m_Handle), GLFW_TRUE);
 }
 
 glm::uvec2 glacier::Window::getSize() const
 {
+	if (m_Headless)
+		return m_HeadlessSize;
+
 	int width;
 	int height;
 
@@ -56,6 +76,9 @@ glm::uvec2 glacier::Window::getSize() const
 
 glm::uvec2 glacier::Window::getFramebufferSize() const
 {
+	if (m_Headless)
+		return m_HeadlessSize;
+
 	int width;
 	int height;
 
@@ -66,3 +89,20 @@ glm::uvec2 glacier::Window::getFramebufferSize() const
 
 	return glm::uvec2(static_cast<unsigned int>(width), static_cast<unsigned int>(height));
 }
+
+bool glacier::Window::isHeadless() const
+{
+	return m_Headless;
+}
+
+void glacier::Window::pollEvents()
+{
+	if (!m_Headless)
+		glfwPollEvents();
+}
+
+void glacier::Window::waitEvents()
+{
+	if (!m_Headless)
+		glfwWaitEvents();
+}
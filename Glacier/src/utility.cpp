@@ -48,7 +48,16 @@ void createBuffer(const VkDevice& device, const VkPhysicalDevice& physicalDevice
 	vkBindBufferMemory(device, *buffer, *memory, 0);
 }
 
-void copyBuffers(const VkDevice& device, const VkCommandPool& commandPool, const VkQueue& graphicsQueue, const VkBuffer* srcBuffers, const VkBuffer* dstBuffers, const VkDeviceSize* bufferSizes, unsigned int bufferCount)
+void copyBuffers(const VkDevice& device, const VkCommandPool& commandPool, const VkQueue& graphicsQueue, const VkSemaphore& timeline, uint64_t signalValue, const VkBuffer* srcBuffers, const VkBuffer* dstBuffers, const VkDeviceSize* bufferSizes, unsigned int bufferCount)
+{
+	std::vector<BufferCopy> copies(bufferCount);
+	for (unsigned int i = 0; i < bufferCount; i++)
+		copies[i] = BufferCopy{ srcBuffers[i], dstBuffers[i], VkBufferCopy{ 0, 0, bufferSizes[i] } };
+
+	copyBufferRegions(device, commandPool, graphicsQueue, timeline, signalValue, copies.data(), copies.size());
+}
+
+void copyBufferRegions(const VkDevice& device, const VkCommandPool& commandPool, const VkQueue& graphicsQueue, const VkSemaphore& timeline, uint64_t signalValue, const BufferCopy* copies, size_t copyCount)
 {
 	/* Create a temporary command buffer to copy the data */
 	VkCommandBufferAllocateInfo commandBufferAllocateInfo = {};
@@ -66,28 +75,49 @@ void copyBuffers(const VkDevice& device, const VkCommandPool& commandPool, const
 
 	vkBeginCommandBuffer(commandBuffer, &commandBufferBeginInfo);
 
-	for (unsigned int i = 0; i < bufferCount; i++)
-	{
-		VkBufferCopy copyRegion = {};
-		copyRegion.srcOffset = 0;
-		copyRegion.dstOffset = 0;
-		copyRegion.size = bufferSizes[i];
-		vkCmdCopyBuffer(commandBuffer, srcBuffers[i], dstBuffers[i], 1, &copyRegion);
-	}
+	for (size_t i = 0; i < copyCount; i++)
+		vkCmdCopyBuffer(commandBuffer, copies[i].src, copies[i].dst, 1, &copies[i].region);
 
 	vkEndCommandBuffer(commandBuffer);
 
+	// Signal the timeline, so only this copy is waited for rather than every frame still queued
+	VkTimelineSemaphoreSubmitInfo timelineSubmitInfo = {};
+	timelineSubmitInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	timelineSubmitInfo.signalSemaphoreValueCount = 1;
+	timelineSubmitInfo.pSignalSemaphoreValues = &signalValue;
+
 	VkSubmitInfo submitInfo = {};
 	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.pNext = &timelineSubmitInfo;
 	submitInfo.commandBufferCount = 1;
 	submitInfo.pCommandBuffers = &commandBuffer;
+	submitInfo.signalSemaphoreCount = 1;
+	submitInfo.pSignalSemaphores = &timeline;
 
 	vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-	vkQueueWaitIdle(graphicsQueue);
+	waitTimeline(device, timeline, signalValue);
 
 	vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
 }
 
+void waitTimeline(const VkDevice& device, const VkSemaphore& timeline, uint64_t value)
+{
+	// Nothing was ever submitted with a value of 0
+	if (value == 0)
+		return;
+
+	VkSemaphoreWaitInfo waitInfo = {};
+	waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+	waitInfo.semaphoreCount = 1;
+	waitInfo.pSemaphores = &timeline;
+	waitInfo.pValues = &value;
+
+	if (vkWaitSemaphores(device, &waitInfo, UINT64_MAX) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to wait for timeline semaphore");
+	}
+}
+
 QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device, VkSurfaceKHR surface)
 {
 	QueueFamilyIndices queueFamilyIndices;
@@ -150,3 +180,17 @@ SwapchainSupportDetails querySwapchainSupport(VkPhysicalDevice device, VkSurface
 
 	return details;
 }
+
+uint64_t hashBytes(const void* data, size_t size)
+{
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+
+	uint64_t hash = 0xcbf29ce484222325ull;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ull;
+	}
+
+	return hash;
+}
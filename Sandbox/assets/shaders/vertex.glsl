@@ -8,6 +8,9 @@ layout (location = 1) in vec3 in_Color;
 
 layout (location = 0) out vec3 out_FragColor;
 
+// The depth prepass runs this shader in a separate pipeline, which must produce bit-identical depth
+invariant gl_Position;
+
 void main()
 {
 	gl_Position = vec4(in_Position, 1.0);
@@ -2,7 +2,53 @@
 
 #include <glacier.hpp>
 
-glacier::ApplicationInfo generateApplicationInfo()
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Command-line options of the sandbox
+*/
+struct SandboxOptions
+{
+	/* Number of procedurally generated objects to draw. 0 draws the default quad. */
+	unsigned int objects = 0;
+
+	/* Number of frames to run before stopping. 0 runs until the window is closed. */
+	unsigned int frames = 0;
+
+	/* Number of identical pipelines the objects alternate between, to exercise draw sorting */
+	unsigned int pipelines = 1;
+
+	bool vsync = true;
+	bool headless = false;
+	bool depthPrepass = false;
+
+	/* Compile every pipeline but the first in the background, drawing with the first until they are ready */
+	bool asyncPipelines = false;
+
+	/* Discard back faces. Every generated mesh is wound clockwise, so nothing visible is lost. */
+	bool cullBackFaces = false;
+
+	/* Put every generated mesh in one geometry pool, so the whole scene binds one vertex and one index buffer */
+	bool geometryPool = false;
+
+	/* MSAA sample count */
+	unsigned int samples = 1;
+
+	/* Compile the GLSL shaders at runtime and reload them when they are edited */
+	bool glsl = false;
+
+	/* A .obj, .gltf or .glb file drawn instead of the default quad, relative to the resource directory, and imported again when it is saved. There is no camera, so it should lie in clip space. */
+	std::string model;
+};
+
+glacier::ApplicationInfo generateApplicationInfo(const SandboxOptions& options)
 {
 	glacier::WindowCreateInfo windowInfo = { 0 };
 	windowInfo.title = "SandboxApp";
@@ -11,8 +57,13 @@ glacier::ApplicationInfo generateApplicationInfo()
 	windowInfo.width = 800;
 	windowInfo.height = 600;
 	windowInfo.resizable = true;
+	windowInfo.headless = options.headless;
 
-	glacier::ApplicationInfo info = { "SandboxApp", 0, 1, 0, true, windowInfo };
+	glacier::ApplicationInfo info = { "SandboxApp", 0, 1, 0, options.vsync, windowInfo };
+	info.depthPrepass = options.depthPrepass;
+	info.samples = options.samples;
+	info.shaderHotReload = options.glsl;
+	info.assetHotReload = !options.model.empty();
 
 	return info;
 }
@@ -20,11 +71,28 @@ glacier::ApplicationInfo generateApplicationInfo()
 class SandboxApp : public glacier::Application
 {
 private:
+	/**
+	 * @brief A procedurally generated object of the stress scene
+	*/
+	struct Object
+	{
+		/* nullptr when the mesh is in the geometry pool */
+		glacier::VertexBuffer* vertexBuffer;
+		glacier::IndexBuffer* indexBuffer;
+
+		/* Handle of the mesh in the geometry pool */
+		uint32_t mesh;
+
+		uint32_t indexCount;
+		float depth;
+		glacier::Pipeline* pipeline;
+	};
+
 	unsigned int frames = 0;
 	double timer = 0.0;
 public:
-	SandboxApp()
-		: Application(generateApplicationInfo()), m_Pipeline(nullptr), m_VertexShaderSource(nullptr), m_FragmentShaderSource(nullptr), m_VertexShader(nullptr), m_FragmentShader(nullptr), m_VertexBuffer(nullptr), m_IndexBuffer(nullptr)
+	SandboxApp(const SandboxOptions& options)
+		: Application(generateApplicationInfo(options)), m_Options(options), m_Pipeline(nullptr), m_VertexShaderSource(nullptr), m_FragmentShaderSource(nullptr), m_VertexShader(nullptr), m_FragmentShader(nullptr), m_VertexBuffer(nullptr), m_IndexBuffer(nullptr), m_GeometryPool(nullptr)
 	{}
 
 	~SandboxApp()
@@ -32,6 +100,9 @@ public:
 
 	void initialize() override
 	{
+		if (m_Options.glsl)
+			return;
+
 		m_VertexShaderSource = glacier::File("shaders/vertex.spv").read_ptr();
 		m_FragmentShaderSource = glacier::File("shaders/fragment.spv").read_ptr();
 	}
@@ -50,48 +121,123 @@ public:
 			0, 2, 3
 		};
 
-		glacier::VertexBufferLayout layout;
-		layout.push(glacier::VertexBufferElement::Float, 3);
-		layout.push(glacier::VertexBufferElement::Float, 3);
+		if (m_Options.glsl)
+		{
+			m_VertexShader = new glacier::Shader(this, "shaders/vertex.glsl", glacier::ShaderType::Vertex);
+			m_FragmentShader = new glacier::Shader(this, "shaders/fragment.glsl", glacier::ShaderType::Fragment);
+		}
+		else
+		{
+			m_VertexShader = new glacier::Shader(this, *m_VertexShaderSource);
+			m_FragmentShader = new glacier::Shader(this, *m_FragmentShaderSource);
+		}
+
+		// The layout follows the vertex shader's inputs
+		glacier::VertexBufferLayout layout = m_VertexShader->createVertexLayout();
 
 		m_VertexBuffer = new glacier::VertexBuffer(this, vertexBuffer, sizeof(vertexBuffer), layout);
 		m_IndexBuffer = new glacier::IndexBuffer(this, indexBuffer, 6 * sizeof(unsigned int));
 
-		m_VertexShader = new glacier::Shader(this, *m_VertexShaderSource);
-		m_FragmentShader = new glacier::Shader(this, *m_FragmentShaderSource);
+		// The model is converted into the shader's layout, its normals take the place of the color
+		const glacier::VertexBuffer* pipelineVertexBuffer = m_VertexBuffer;
+		const glacier::IndexBuffer* pipelineIndexBuffer = m_IndexBuffer;
+
+		if (!m_Options.model.empty())
+		{
+			glacier::MeshImporter importer(this);
+			m_Model = importer.load(m_Options.model, layout);
+
+			pipelineVertexBuffer = &m_Model->getVertexBuffer();
+			pipelineIndexBuffer = &m_Model->getIndexBuffer();
+		}
 
 		std::unordered_map<glacier::ShaderType, glacier::Shader*> shaders;
 		shaders.insert(std::make_pair(glacier::ShaderType::Vertex, m_VertexShader));
 		shaders.insert(std::make_pair(glacier::ShaderType::Fragment, m_FragmentShader));
 
-		m_Pipeline = new glacier::Pipeline(this, renderer, shaders, *m_VertexBuffer, *m_IndexBuffer);
+		glacier::PipelineDescription description;
+		description.cullMode = m_Options.cullBackFaces ? glacier::CullMode::Back : glacier::CullMode::None;
+
+		m_Pipeline = new glacier::Pipeline(this, renderer, shaders, *pipelineVertexBuffer, *pipelineIndexBuffer, description);
+
+		m_Pipelines.push_back(m_Pipeline);
+		glacier::CompileMode compileMode = m_Options.asyncPipelines ? glacier::CompileMode::Async : glacier::CompileMode::Blocking;
 
-		renderer->bindPipeline(*m_Pipeline, 6);
+		for (unsigned int i = 1; i < m_Options.pipelines; i++)
+		{
+			glacier::Pipeline* pipeline = new glacier::Pipeline(this, renderer, shaders, *pipelineVertexBuffer, *pipelineIndexBuffer, description, compileMode);
+			pipeline->setFallback(m_Pipeline);
+
+			m_Pipelines.push_back(pipeline);
+		}
+
+		// The model is drawn every frame instead, since reloading it may change its index count
+		if (m_Options.objects > 0)
+			generateObjects(layout);
+		else if (!m_Model)
+			renderer->bindPipeline(*m_Pipeline, 6);
 	}
 
 	void update(double delta) override {}
 
-	void render(glacier::Renderer* renderer) override {}
+	void render(glacier::Renderer* renderer) override
+	{
+		if (m_Options.objects > 0 || m_Options.frames > 0)
+			measureFrame(renderer);
+
+		if (m_Model && m_Objects.empty())
+			renderer->draw(*m_Pipeline, m_Model->getVertexBuffer(), &m_Model->getIndexBuffer(), m_Model->getIndexCount());
+
+		for (const Object& object : m_Objects)
+		{
+			if (object.vertexBuffer == nullptr)
+				renderer->draw(*object.pipeline, *m_GeometryPool, object.mesh, object.depth);
+			else
+				renderer->draw(*object.pipeline, *object.vertexBuffer, object.indexBuffer, object.indexCount, object.depth);
+		}
+	}
 
 	void terminateRenderer(glacier::Renderer* renderer) override
 	{
 		renderer->unbindPipeline();
 
+		for (const Object& object : m_Objects)
+		{
+			delete object.vertexBuffer;
+			delete object.indexBuffer;
+		}
+
+		m_Objects.clear();
+
+		delete m_GeometryPool;
+		m_GeometryPool = nullptr;
+
 		delete m_VertexShader;
 		delete m_FragmentShader;
 
 		delete m_VertexBuffer;
 		delete m_IndexBuffer;
 
-		delete m_Pipeline;
+		m_Model.reset();
+
+		for (glacier::Pipeline* pipeline : m_Pipelines)
+			delete pipeline;
+
+		m_Pipelines.clear();
+		m_Pipeline = nullptr;
 	}
 
 	void terminate() override
 	{
 		delete m_VertexShaderSource;
 		delete m_FragmentShaderSource;
+
+		if (m_Options.objects > 0 || m_Options.frames > 0)
+			printSummary();
 	}
 private:
+	SandboxOptions m_Options;
+
 	glacier::Buffer* m_VertexShaderSource;
 	glacier::Buffer* m_FragmentShaderSource;
 
@@ -101,5 +247,183 @@ private:
 	glacier::VertexBuffer* m_VertexBuffer;
 	glacier::IndexBuffer* m_IndexBuffer;
 
+	/* The mesh loaded with --model */
+	std::unique_ptr<glacier::Mesh> m_Model;
+
+	/* Holds the meshes of the stress scene with --pool */
+	glacier::GeometryPool* m_GeometryPool;
+
 	glacier::Pipeline* m_Pipeline;
+	std::vector<glacier::Pipeline*> m_Pipelines;
+
+	std::vector<Object> m_Objects;
+
+	/* Benchmark measurements */
+	std::vector<double> m_FrameTimes; // Milliseconds
+	std::chrono::steady_clock::time_point m_LastFrame;
+	unsigned int m_RenderedFrames = 0;
+	uint64_t m_TotalDrawCalls = 0;
+	uint64_t m_TotalPipelineBinds = 0;
+	uint64_t m_TotalVertexBufferBinds = 0;
+	uint64_t m_TotalIndexBufferBinds = 0;
+	uint64_t m_TotalPrepassDrawCalls = 0;
+	uint64_t m_TotalBindsSaved = 0;
+	uint64_t m_TotalSkippedDraws = 0;
+	uint64_t m_TotalFallbackDraws = 0;
+	uint64_t m_TotalVertices = 0;
+	unsigned int m_StatisticsFrames = 0;
+
+	/**
+	 * @brief Generate one polygon mesh per object, laid out on a grid covering the viewport. Neighbouring objects overlap at random depths.
+	 * @param layout The vertex layout of the generated meshes
+	*/
+	void generateObjects(const glacier::VertexBufferLayout& layout)
+	{
+		std::mt19937 random(1337);
+		std::uniform_real_distribution<float> colorDistribution(0.2f, 1.0f);
+		std::uniform_real_distribution<float> depthDistribution(0.1f, 0.9f);
+
+		unsigned int columns = static_cast<unsigned int>(std::ceil(std::sqrt(static_cast<double>(m_Options.objects))));
+		float cell = 2.0f / static_cast<float>(columns);
+
+		m_Objects.reserve(m_Options.objects);
+
+		// Start small, so loading also exercises growing the pool
+		if (m_Options.geometryPool)
+			m_GeometryPool = new glacier::GeometryPool(this, layout, 1024, 4096);
+
+		for (unsigned int i = 0; i < m_Options.objects; i++)
+		{
+			float centerX = -1.0f + cell * (static_cast<float>(i % columns) + 0.5f);
+			float centerY = -1.0f + cell * (static_cast<float>(i / columns) + 0.5f);
+			float radius = cell * 0.75f;
+			float depth = depthDistribution(random);
+
+			// Vary the vertex count between objects so that meshes differ in size
+			unsigned int sides = 3 + i % 14;
+
+			std::vector<float> vertices;
+			vertices.reserve((sides + 1) * 6);
+
+			float r = colorDistribution(random), g = colorDistribution(random), b = colorDistribution(random);
+
+			vertices.insert(vertices.end(), { centerX, centerY, depth, r, g, b });
+			for (unsigned int side = 0; side < sides; side++)
+			{
+				float angle = 6.2831853f * static_cast<float>(side) / static_cast<float>(sides);
+				vertices.insert(vertices.end(), { centerX + radius * std::cos(angle), centerY + radius * std::sin(angle), depth, r * 0.5f, g * 0.5f, b * 0.5f });
+			}
+
+			std::vector<uint32_t> indices;
+			indices.reserve(sides * 3);
+
+			for (uint32_t side = 0; side < sides; side++)
+				indices.insert(indices.end(), { 0, 1 + side, 1 + (side + 1) % sides });
+
+			Object object;
+			if (m_GeometryPool != nullptr)
+			{
+				object.vertexBuffer = nullptr;
+				object.indexBuffer = nullptr;
+				object.mesh = m_GeometryPool->allocate(vertices.data(), sides + 1, indices.data(), static_cast<uint32_t>(indices.size()));
+			}
+			else
+			{
+				object.vertexBuffer = new glacier::VertexBuffer(this, vertices.data(), vertices.size() * sizeof(float), layout);
+				object.indexBuffer = new glacier::IndexBuffer(this, indices.data(), indices.size() * sizeof(uint32_t));
+				object.mesh = 0;
+			}
+
+			object.indexCount = static_cast<uint32_t>(indices.size());
+			object.depth = depth;
+			object.pipeline = m_Pipelines[i % m_Pipelines.size()];
+
+			m_Objects.push_back(object);
+		}
+
+		glacier::g_Logger->info("Generated {} objects", m_Objects.size());
+
+		if (m_GeometryPool != nullptr)
+		{
+			glacier::GeometryPoolStatistics statistics = m_GeometryPool->getStatistics();
+			glacier::g_Logger->info("Geometry pool holds {} of {} vertices and {} of {} indices, rebuilt {} times while growing", statistics.vertexCapacity - statistics.freeVertices, statistics.vertexCapacity, statistics.indexCapacity - statistics.freeIndices, statistics.indexCapacity, statistics.compactions);
+		}
+	}
+
+	void measureFrame(glacier::Renderer* renderer)
+	{
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+		if (m_RenderedFrames > 0)
+		{
+			m_FrameTimes.push_back(std::chrono::duration<double, std::milli>(now - m_LastFrame).count());
+
+			// The statistics of the previously recorded frame
+			const glacier::RenderStatistics& statistics = renderer->getStatistics();
+			m_TotalDrawCalls += statistics.drawCalls;
+			m_TotalPipelineBinds += statistics.pipelineBinds;
+			m_TotalVertexBufferBinds += statistics.vertexBufferBinds;
+			m_TotalIndexBufferBinds += statistics.indexBufferBinds;
+			m_TotalPrepassDrawCalls += statistics.prepassDrawCalls;
+			m_TotalBindsSaved += statistics.bindsSavedBySorting;
+			m_TotalSkippedDraws += statistics.skippedDraws;
+			m_TotalFallbackDraws += statistics.fallbackDraws;
+			m_TotalVertices += statistics.vertices;
+			m_StatisticsFrames++;
+		}
+
+		m_LastFrame = now;
+		m_RenderedFrames++;
+
+		if (m_Options.frames > 0 && m_FrameTimes.size() >= m_Options.frames)
+			stop();
+	}
+
+	void printSummary() const
+	{
+		std::vector<double> sorted = m_FrameTimes;
+		std::sort(sorted.begin(), sorted.end());
+
+		auto percentile = [&sorted](double p) -> double
+		{
+			if (sorted.empty())
+				return 0.0;
+
+			return sorted[static_cast<size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5)];
+		};
+
+		double total = 0.0;
+		for (double time : sorted)
+			total += time;
+
+		double mean = sorted.empty() ? 0.0 : total / static_cast<double>(sorted.size());
+		double frames = m_StatisticsFrames > 0 ? static_cast<double>(m_StatisticsFrames) : 1.0;
+
+		std::cout << "{\n";
+		std::cout << "  \"objects\": " << m_Options.objects << ",\n";
+		std::cout << "  \"geometry_pool\": " << (m_Options.geometryPool ? "true" : "false") << ",\n";
+		std::cout << "  \"frames\": " << sorted.size() << ",\n";
+		std::cout << "  \"device\": \"" << getDeviceName() << "\",\n";
+		std::cout << "  \"frame_time_ms\": {\n";
+		std::cout << "    \"mean\": " << mean << ",\n";
+		std::cout << "    \"p50\": " << percentile(0.50) << ",\n";
+		std::cout << "    \"p90\": " << percentile(0.90) << ",\n";
+		std::cout << "    \"p95\": " << percentile(0.95) << ",\n";
+		std::cout << "    \"p99\": " << percentile(0.99) << ",\n";
+		std::cout << "    \"max\": " << percentile(1.0) << "\n";
+		std::cout << "  },\n";
+		std::cout << "  \"fps\": " << (mean > 0.0 ? 1000.0 / mean : 0.0) << ",\n";
+		std::cout << "  \"per_frame\": {\n";
+		std::cout << "    \"draw_calls\": " << static_cast<double>(m_TotalDrawCalls) / frames << ",\n";
+		std::cout << "    \"prepass_draw_calls\": " << static_cast<double>(m_TotalPrepassDrawCalls) / frames << ",\n";
+		std::cout << "    \"pipeline_binds\": " << static_cast<double>(m_TotalPipelineBinds) / frames << ",\n";
+		std::cout << "    \"vertex_buffer_binds\": " << static_cast<double>(m_TotalVertexBufferBinds) / frames << ",\n";
+		std::cout << "    \"index_buffer_binds\": " << static_cast<double>(m_TotalIndexBufferBinds) / frames << ",\n";
+		std::cout << "    \"binds_saved_by_sorting\": " << static_cast<double>(m_TotalBindsSaved) / frames << ",\n";
+		std::cout << "    \"skipped_draws\": " << static_cast<double>(m_TotalSkippedDraws) / frames << ",\n";
+		std::cout << "    \"fallback_draws\": " << static_cast<double>(m_TotalFallbackDraws) / frames << ",\n";
+		std::cout << "    \"vertices\": " << static_cast<double>(m_TotalVertices) / frames << "\n";
+		std::cout << "  }\n";
+		std::cout << "}" << std::endl;
+	}
 };
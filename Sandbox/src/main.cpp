@@ -1,5 +1,7 @@
 #include <iostream>
 #include <memory>
+#include <string>
+#include <cstring>
 
 #include <glacier.hpp>
 #include <SandboxApp.hpp>
@@ -7,6 +9,7 @@
 int main(int argc, char** argv)
 {
 	int resourceDirectoryArgumentIndex = -1;
+	SandboxOptions options;
 
 	for (unsigned int i = 1; i < argc; i++)
 	{
@@ -71,6 +74,103 @@ int main(int argc, char** argv)
 				return -1;
 			}
 		}
+		else if (strcmp(argv[i], "--objects") == 0 || strcmp(argv[i], "--frames") == 0 || strcmp(argv[i], "--pipelines") == 0 || strcmp(argv[i], "--samples") == 0)
+		{
+			if (argc > i + 1)
+			{
+				unsigned int& value = strcmp(argv[i], "--objects") == 0 ? options.objects : strcmp(argv[i], "--frames") == 0 ? options.frames : strcmp(argv[i], "--pipelines") == 0 ? options.pipelines : options.samples;
+
+				i++;
+
+				try
+				{
+					value = static_cast<unsigned int>(std::stoul(argv[i]));
+				}
+				catch (const std::exception&)
+				{
+					glacier::g_Logger->error("Invalid number {}", argv[i]);
+					return -1;
+				}
+
+				continue;
+			}
+			else
+			{
+				glacier::g_Logger->error("Not enough arguments");
+				return -1;
+			}
+		}
+		else if (strcmp(argv[i], "--vsync") == 0)
+		{
+			if (argc > i + 1)
+			{
+				i++;
+
+				if (strcmp(argv[i], "on") == 0)
+				{
+					options.vsync = true;
+				}
+				else if (strcmp(argv[i], "off") == 0)
+				{
+					options.vsync = false;
+				}
+				else
+				{
+					glacier::g_Logger->error("Invalid vsync mode");
+					return -1;
+				}
+
+				continue;
+			}
+			else
+			{
+				glacier::g_Logger->error("Not enough arguments");
+				return -1;
+			}
+		}
+		else if (strcmp(argv[i], "--headless") == 0)
+		{
+			options.headless = true;
+			continue;
+		}
+		else if (strcmp(argv[i], "--prepass") == 0)
+		{
+			options.depthPrepass = true;
+			continue;
+		}
+		else if (strcmp(argv[i], "--async") == 0)
+		{
+			options.asyncPipelines = true;
+			continue;
+		}
+		else if (strcmp(argv[i], "--cull") == 0)
+		{
+			options.cullBackFaces = true;
+			continue;
+		}
+		else if (strcmp(argv[i], "--pool") == 0)
+		{
+			options.geometryPool = true;
+			continue;
+		}
+		else if (strcmp(argv[i], "--glsl") == 0)
+		{
+			options.glsl = true;
+			continue;
+		}
+		else if (strcmp(argv[i], "--model") == 0)
+		{
+			if (argc > i + 1)
+			{
+				options.model = argv[++i];
+				continue;
+			}
+			else
+			{
+				glacier::g_Logger->error("Not enough arguments");
+				return -1;
+			}
+		}
 		else
 		{
 			glacier::g_Logger->error("Invalid command-line arguments");
@@ -86,7 +186,7 @@ int main(int argc, char** argv)
 
 	try
 	{
-		app = std::make_shared<SandboxApp>();
+		app = std::make_shared<SandboxApp>(options);
 		app->run();
 	}
 	catch (const std::exception& e)